@@ -0,0 +1,57 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include "emulator.h"
+#include "z80.h"
+#include "machinestate.h"
+
+#include "z80_macros.h"
+
+namespace
+{
+
+// Whole emulation of one frame, as run by cap32_main (starting from boot).
+void BM_EmulateFrame(benchmark::State& state)
+{
+   bench_init_emulator();
+   for (auto _ : state) {
+      bench_run_frame();
+   }
+   state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EmulateFrame);
+
+// Whole emulation of frames during which the CPU endlessly copies 4kB from
+// &8000 to &9000 with interrupts disabled, through copy.
+void runCopyLoop(benchmark::State& state, const std::vector<byte>& copy)
+{
+   bench_init_emulator();
+   // di ; ld hl,&8000 ; ld de,&9000 ; ld bc,&1000 ; <copy> ; jr &4001
+   std::vector<byte> code = { 0xf3, 0x21, 0x00, 0x80, 0x11, 0x00, 0x90, 0x01, 0x00, 0x10 };
+   code.insert(code.end(), copy.begin(), copy.end());
+   code.push_back(0x18);
+   code.push_back(static_cast<byte>(1 - static_cast<int>(code.size() + 1)));
+   for (size_t n = 0; n < code.size(); n++) {
+      z80_write_mem(0x4000 + n, code[n]);
+   }
+   _PC = 0x4000;
+   for (auto _ : state) {
+      bench_run_frame();
+   }
+   state.SetItemsProcessed(state.iterations());
+}
+
+void BM_EmulateFrame_Ldir(benchmark::State& state)
+{
+   // ldir
+   runCopyLoop(state, { 0xed, 0xb0 });
+}
+BENCHMARK(BM_EmulateFrame_Ldir);
+
+void BM_EmulateFrame_CopyLoop(benchmark::State& state)
+{
+   // ld a,(hl) ; ld (de),a ; inc hl ; inc de ; dec bc ; ld a,b ; or c ; jr nz,-9
+   runCopyLoop(state, { 0x7e, 0x12, 0x23, 0x13, 0x0b, 0x78, 0xb1, 0x20, 0xf7 });
+}
+BENCHMARK(BM_EmulateFrame_CopyLoop);
+
+}
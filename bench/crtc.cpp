@@ -0,0 +1,132 @@
+#include <benchmark/benchmark.h>
+#include "crtc.h"
+#include "cap32.h"
+#include "z80.h"
+#include "emulator.h"
+#include "machinestate.h"
+
+extern thread_local t_CPC CPC;
+extern thread_local SDL_Surface *back_surface;
+
+namespace
+{
+
+const int CHARS_PER_LINE = 48;
+
+// Pre-renders and renders a full line with the given pre-renderer, i.e. what
+// crtc_cycle does for each character depending on set_prerender's choice.
+void BM_PreRender(benchmark::State& state, void (*prerender)())
+{
+   bench_init_emulator();
+   for (int i = 0; i < 50; i++) {
+      bench_run_frame(); // let the firmware initialize the screen
+   }
+   // The CRTC is in the middle of a line: restore its state afterwards.
+   void (*saved_prerender)() = PreRender;
+   dword *saved_rend_pos = RendPos;
+   byte *saved_rend_out = RendOut, *saved_rend_wid = RendWid, *saved_scr_pos = CPC.scr_pos;
+   PreRender = prerender;
+   for (auto _ : state) {
+      RendPos = RendStart;
+      RendOut = reinterpret_cast<byte *>(RendStart);
+      RendWid = &HorzPix[0];
+      CPC.scr_pos = static_cast<byte *>(back_surface->pixels);
+      for (int i = 0; i < CHARS_PER_LINE; i++) {
+         PreRender();
+         CPC.scr_render();
+      }
+   }
+   PreRender = saved_prerender;
+   RendPos = saved_rend_pos;
+   RendOut = saved_rend_out;
+   RendWid = saved_rend_wid;
+   CPC.scr_pos = saved_scr_pos;
+   state.SetItemsProcessed(state.iterations() * CHARS_PER_LINE);
+}
+BENCHMARK_CAPTURE(BM_PreRender, border, prerender_border);
+BENCHMARK_CAPTURE(BM_PreRender, border_half, prerender_border_half);
+BENCHMARK_CAPTURE(BM_PreRender, sync, prerender_sync);
+BENCHMARK_CAPTURE(BM_PreRender, sync_half, prerender_sync_half);
+BENCHMARK_CAPTURE(BM_PreRender, normal, prerender_normal);
+BENCHMARK_CAPTURE(BM_PreRender, normal_half, prerender_normal_half);
+BENCHMARK_CAPTURE(BM_PreRender, normal_plus, prerender_normal_plus);
+BENCHMARK_CAPTURE(BM_PreRender, normal_half_plus, prerender_normal_half_plus);
+
+// Renders a full line of pre-rendered characters with the given render
+// function: pair the scalar functions with their render_simd_variant to compare.
+void BM_Render(benchmark::State& state, void (*render)())
+{
+   bench_init_emulator();
+   for (int i = 0; i < 50; i++) {
+      bench_run_frame();
+   }
+   void (*saved_prerender)() = PreRender;
+   dword *saved_rend_pos = RendPos;
+   byte *saved_rend_out = RendOut, *saved_rend_wid = RendWid, *saved_scr_pos = CPC.scr_pos;
+   RendPos = RendStart;
+   for (int i = 0; i < CHARS_PER_LINE; i++) {
+      prerender_normal();
+   }
+   for (auto _ : state) {
+      RendOut = reinterpret_cast<byte *>(RendStart);
+      RendWid = &HorzPix[0];
+      CPC.scr_pos = static_cast<byte *>(back_surface->pixels);
+      for (int i = 0; i < CHARS_PER_LINE; i++) {
+         render();
+      }
+      benchmark::ClobberMemory();
+   }
+   PreRender = saved_prerender;
+   RendPos = saved_rend_pos;
+   RendOut = saved_rend_out;
+   RendWid = saved_rend_wid;
+   CPC.scr_pos = saved_scr_pos;
+   state.SetItemsProcessed(state.iterations() * CHARS_PER_LINE);
+}
+BENCHMARK_CAPTURE(BM_Render, 8bpp, render8bpp);
+BENCHMARK_CAPTURE(BM_Render, 8bpp_simd, render_simd_variant(render8bpp));
+BENCHMARK_CAPTURE(BM_Render, 8bpp_doubleY, render8bpp_doubleY);
+BENCHMARK_CAPTURE(BM_Render, 8bpp_doubleY_simd, render_simd_variant(render8bpp_doubleY));
+BENCHMARK_CAPTURE(BM_Render, 16bpp, render16bpp);
+BENCHMARK_CAPTURE(BM_Render, 16bpp_simd, render_simd_variant(render16bpp));
+BENCHMARK_CAPTURE(BM_Render, 16bpp_doubleY, render16bpp_doubleY);
+BENCHMARK_CAPTURE(BM_Render, 16bpp_doubleY_simd, render_simd_variant(render16bpp_doubleY));
+BENCHMARK_CAPTURE(BM_Render, 24bpp, render24bpp);
+BENCHMARK_CAPTURE(BM_Render, 24bpp_simd, render_simd_variant(render24bpp));
+BENCHMARK_CAPTURE(BM_Render, 24bpp_doubleY, render24bpp_doubleY);
+BENCHMARK_CAPTURE(BM_Render, 24bpp_doubleY_simd, render_simd_variant(render24bpp_doubleY));
+BENCHMARK_CAPTURE(BM_Render, 32bpp, render32bpp);
+BENCHMARK_CAPTURE(BM_Render, 32bpp_simd, render_simd_variant(render32bpp));
+BENCHMARK_CAPTURE(BM_Render, 32bpp_doubleY, render32bpp_doubleY);
+BENCHMARK_CAPTURE(BM_Render, 32bpp_doubleY_simd, render_simd_variant(render32bpp_doubleY));
+
+// Runs the CRTC (and rendering) alone, one character at a time, on the screen
+// set up by the firmware. With display_enabled false, R1 is set to 0 so that the
+// whole frame is border.
+void BM_CrtcCycle(benchmark::State& state, bool display_enabled)
+{
+   bench_init_emulator();
+   for (int i = 0; i < 50; i++) {
+      bench_run_frame();
+   }
+   if (!display_enabled) {
+      reg_pair port;
+      port.w.l = 0xbc00;
+      z80_OUT_handler(port, 1);
+      port.w.l = 0xbd00;
+      z80_OUT_handler(port, 0);
+   }
+   bench_sync_surface();
+   for (auto _ : state) {
+      crtc_cycle(1);
+      if (VDU.frame_completed) {
+         VDU.frame_completed = 0;
+         bench_sync_surface();
+      }
+   }
+   state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_CrtcCycle, display, true);
+BENCHMARK_CAPTURE(BM_CrtcCycle, border, false);
+
+}
@@ -0,0 +1,67 @@
+#include "emulator.h"
+
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include "argparse.h"
+#include "cap32.h"
+#include "keyboard.h"
+#include "z80.h"
+#include "machinestate.h"
+
+extern thread_local t_CPC CPC;
+extern CapriceArgs args;
+extern char chAppPath[];
+extern thread_local SDL_Surface *back_surface;
+
+void bench_init_emulator()
+{
+   static bool initialized = false;
+   if (initialized) {
+      emulator_reset();
+      return;
+   }
+   if (getcwd(chAppPath, _MAX_PATH) == nullptr) {
+      fprintf(stderr, "getcwd failed\n");
+      exit(-1);
+   }
+   args.headless = true;
+   loadConfiguration(CPC, getConfigurationFilename());
+   CPC.limit_speed = 0;
+   CPC.snd_enabled = 0;
+   CPC.joysticks = 0;
+   CPC.auto_pause = 0;
+   CPC.printer = 0;
+   z80_init_tables();
+   if (video_init()) {
+      fprintf(stderr, "video_init() failed. Aborting.\n");
+      exit(-1);
+   }
+   CPC.InputMapper = new InputMapper(&CPC);
+   if (emulator_init()) {
+      fprintf(stderr, "emulator_init() failed. Aborting.\n");
+      exit(-1);
+   }
+   initialized = true;
+}
+
+void bench_sync_surface()
+{
+   dword dwOffset = CPC.scr_pos - CPC.scr_base;
+   if (VDU.scrln > 0) {
+      CPC.scr_base = static_cast<byte *>(back_surface->pixels) + (VDU.scrln * CPC.scr_line_offs);
+   } else {
+      CPC.scr_base = static_cast<byte *>(back_surface->pixels);
+   }
+   CPC.scr_pos = CPC.scr_base + dwOffset;
+}
+
+void bench_run_frame()
+{
+   while (true) {
+      bench_sync_surface();
+      if (z80_execute() == EC_FRAME_COMPLETE) {
+         return;
+      }
+   }
+}
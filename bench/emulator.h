@@ -0,0 +1,16 @@
+#ifndef BENCH_EMULATOR_H
+#define BENCH_EMULATOR_H
+
+// Initializes the emulator the same way cap32_main does, but without any
+// window nor sound, from the cap32.cfg found in the current directory.
+// Only done once, subsequent calls just reset the emulated CPC.
+void bench_init_emulator();
+
+// Points the rendering position in the back surface to the current beam
+// position, as cap32_main does before resuming the emulation.
+void bench_sync_surface();
+
+// Runs the emulation until the current frame is complete.
+void bench_run_frame();
+
+#endif
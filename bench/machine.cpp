@@ -0,0 +1,42 @@
+#include <benchmark/benchmark.h>
+#include <future>
+#include <memory>
+#include <vector>
+#include "cap32.h"
+#include "emulator.h"
+#include "machine.h"
+
+namespace
+{
+
+const unsigned int FRAMES_PER_RUN = 10;
+
+// Independent machines, each one on its own thread, running frames at the same
+// time. Ideally, frames per second scale linearly with the number of machines,
+// up to the number of cores.
+void BM_ParallelMachines(benchmark::State& state)
+{
+   bench_init_emulator(); // for the configuration path
+   std::vector<std::unique_ptr<Machine>> machines;
+   for (int i = 0; i < state.range(0); i++) {
+      machines.push_back(std::make_unique<Machine>());
+      if (machines.back()->init(getConfigurationFilename())) {
+         state.SkipWithError("Machine::init failed");
+         return;
+      }
+   }
+   for (auto _ : state) {
+      std::vector<std::future<int>> runs;
+      for (auto& machine : machines) {
+         Machine *m = machine.get();
+         runs.push_back(std::async(std::launch::async, [m]() { return m->runFrames(FRAMES_PER_RUN); }));
+      }
+      for (auto& run : runs) {
+         run.get();
+      }
+   }
+   state.SetItemsProcessed(state.iterations() * state.range(0) * FRAMES_PER_RUN);
+}
+BENCHMARK(BM_ParallelMachines)->RangeMultiplier(2)->Range(1, 8)->UseRealTime();
+
+}
@@ -0,0 +1,11 @@
+#include <benchmark/benchmark.h>
+#include <SDL_main.h>
+
+int main(int argc, char **argv)
+{
+	::benchmark::Initialize(&argc, argv);
+	if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+	::benchmark::RunSpecifiedBenchmarks();
+	::benchmark::Shutdown();
+	return 0;
+}
@@ -0,0 +1,54 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include "cap32.h"
+#include "machinestate.h"
+
+extern thread_local t_CPC CPC;
+extern std::unique_ptr<byte[]> pbSndBuffer;
+extern byte *pbSndBufferEnd;
+
+void Synthesizer_Stereo16();
+void Synthesizer_Stereo8();
+void Synthesizer_Mono16();
+void Synthesizer_Mono8();
+
+namespace
+{
+
+// Produces one sample per iteration with the given synthesizer (the stereo 16
+// bits block one when null, band-limited or not), with the 3 channels playing a tone, noise on channel A and the
+// envelope on channel C.
+void BM_Synthesizer(benchmark::State& state, void (*synthesizer)(), bool band_limited = false)
+{
+   CPC.speed = 4;
+   CPC.snd_playback_rate = 2;
+   CPC.snd_stereo = 1;
+   CPC.snd_bits = 1;
+   CPC.snd_band_limited = band_limited;
+   CPC.snd_buffersize = 4096;
+   pbSndBuffer = std::make_unique<byte[]>(CPC.snd_buffersize);
+   pbSndBufferEnd = pbSndBuffer.get() + CPC.snd_buffersize;
+   CPC.snd_bufferptr = pbSndBuffer.get();
+   InitAY();
+   const byte registers[16] = { 0x40, 0x01, 0x80, 0x00, 0xc0, 0x00, 0x0f, 0x30, 0x0f, 0x0c, 0x10, 0x00, 0x10, 0x0e, 0, 0 };
+   for (int n = 0; n < 14; n++) {
+      SetAYRegister(n, registers[n]);
+   }
+   if (!synthesizer) {
+      synthesizer = PSG.Synthesizer;
+   }
+   for (auto _ : state) {
+      synthesizer();
+   }
+   AY_flush();
+   PSG.buffer_full = 0;
+   state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_Synthesizer, Stereo16, Synthesizer_Stereo16);
+BENCHMARK_CAPTURE(BM_Synthesizer, Stereo8, Synthesizer_Stereo8);
+BENCHMARK_CAPTURE(BM_Synthesizer, Mono16, Synthesizer_Mono16);
+BENCHMARK_CAPTURE(BM_Synthesizer, Mono8, Synthesizer_Mono8);
+BENCHMARK_CAPTURE(BM_Synthesizer, Block, nullptr);
+BENCHMARK_CAPTURE(BM_Synthesizer, BandLimited, nullptr, true);
+
+}
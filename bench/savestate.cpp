@@ -0,0 +1,59 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include "emulator.h"
+#include "savestate.h"
+
+namespace
+{
+
+// Capture of the whole machine, as done every second for the rewind history.
+void BM_SaveStateCapture(benchmark::State& state)
+{
+   bench_init_emulator();
+   for (int n = 0; n < 100; n++) {
+      bench_run_frame();
+   }
+   std::vector<byte> saved;
+   for (auto _ : state) {
+      savestate_capture(saved);
+   }
+   state.SetBytesProcessed(state.iterations() * saved.size());
+}
+BENCHMARK(BM_SaveStateCapture);
+
+void BM_SaveStateRestore(benchmark::State& state)
+{
+   bench_init_emulator();
+   for (int n = 0; n < 100; n++) {
+      bench_run_frame();
+   }
+   std::vector<byte> saved;
+   savestate_capture(saved);
+   for (auto _ : state) {
+      savestate_restore(saved);
+   }
+   state.SetBytesProcessed(state.iterations() * saved.size());
+}
+BENCHMARK(BM_SaveStateRestore);
+
+// Adding one second of emulation to the rewind history: the previous newest
+// state gets delta encoded.
+void BM_RewindPush(benchmark::State& state)
+{
+   bench_init_emulator();
+   RewindBuffer buffer(64*1024*1024);
+   std::vector<byte> saved;
+   for (auto _ : state) {
+      state.PauseTiming();
+      for (int n = 0; n < 50; n++) {
+         bench_run_frame();
+      }
+      savestate_capture(saved);
+      state.ResumeTiming();
+      buffer.push(saved);
+   }
+   state.counters["bytes_per_state"] = buffer.memoryUsed() / static_cast<double>(buffer.count());
+}
+BENCHMARK(BM_RewindPush)->Iterations(60);
+
+}
@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "cap32.h"
+#include "disk.h"
+#include "slotshandler.h"
+#include "emulator.h"
+
+extern thread_local t_drive driveA;
+
+namespace
+{
+
+std::string tempFile(const std::string& extension)
+{
+   return std::string(P_tmpdir) + "/cap32_bench" + extension;
+}
+
+// Loads a formatted (data format) disk image.
+void BM_DskLoad(benchmark::State& state)
+{
+   bench_init_emulator();
+   std::string filename = tempFile(".dsk");
+   auto drive = std::make_unique<t_drive>();
+   if (dsk_format(drive.get(), 0) || dsk_save(filename, drive.get())) {
+      state.SkipWithError("Couldn't create the disk image");
+      return;
+   }
+   dsk_eject(drive.get());
+   for (auto _ : state) {
+      if (dsk_load(filename, &driveA)) {
+         state.SkipWithError("Couldn't load the disk image");
+         break;
+      }
+   }
+   dsk_eject(&driveA);
+   remove(filename.c_str());
+   state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DskLoad);
+
+// Loads a snapshot of the CPC taken after the firmware initialization.
+void BM_SnapshotLoad(benchmark::State& state)
+{
+   bench_init_emulator();
+   for (int i = 0; i < 50; i++) {
+      bench_run_frame();
+   }
+   std::string filename = tempFile(".sna");
+   if (snapshot_save(filename)) {
+      state.SkipWithError("Couldn't save the snapshot");
+      return;
+   }
+   for (auto _ : state) {
+      if (snapshot_load(filename)) {
+         state.SkipWithError("Couldn't load the snapshot");
+         break;
+      }
+   }
+   remove(filename.c_str());
+   state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SnapshotLoad);
+
+}
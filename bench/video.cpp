@@ -0,0 +1,48 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include "video.h"
+#include "cap32.h"
+
+void filter_supereagle(Uint8 *srcPtr, Uint32 srcPitch, Uint8 *dstPtr, Uint32 dstPitch, int width, int height);
+void filter_scale2x(Uint8 *srcPtr, Uint32 srcPitch, Uint8 *dstPtr, Uint32 dstPitch, int width, int height);
+void filter_ascale2x(Uint8 *srcPtr, Uint32 srcPitch, Uint8 *dstPtr, Uint32 dstPitch, int width, int height);
+void filter_tv2x(Uint8 *srcPtr, Uint32 srcPitch, Uint8 *dstPtr, Uint32 dstPitch, int width, int height);
+void filter_bilinear(Uint8 *srcPtr, Uint32 srcPitch, Uint8 *dstPtr, Uint32 dstPitch, int width, int height);
+void filter_bicubic(Uint8 *srcPtr, Uint32 srcPitch, Uint8 *dstPtr, Uint32 dstPitch, int width, int height);
+void filter_dotmatrix(Uint8 *srcPtr, Uint32 srcPitch, Uint8 *dstPtr, Uint32 dstPitch, int width, int height);
+
+namespace
+{
+
+typedef void (*filter_t)(Uint8 *srcPtr, Uint32 srcPitch, Uint8 *dstPtr, Uint32 dstPitch, int width, int height);
+
+// Scales a full visible CPC screen (16bpp, as required by these filters) once
+// per iteration. The source has a 2 lines and 2 columns margin on each side as
+// some filters read neighbouring pixels.
+void BM_Filter(benchmark::State& state, filter_t filter)
+{
+   const int width = CPC_VISIBLE_SCR_WIDTH, height = CPC_VISIBLE_SCR_HEIGHT;
+   const int src_pitch = (width + 4) * sizeof(Uint16);
+   const int dst_pitch = 2 * width * sizeof(Uint16);
+   std::vector<Uint16> src((width + 4) * (height + 4));
+   std::vector<Uint16> dst(2 * width * 2 * height);
+   for (size_t i = 0; i < src.size(); i++) {
+      // Vertical stripes and some diagonals, to exercise the edge detection.
+      src[i] = ((i / 8) % 2 || (i % 13) == 0) ? 0xf800 : 0x07e0;
+   }
+   Uint8 *src_start = reinterpret_cast<Uint8 *>(&src[2 * (width + 4) + 2]);
+   for (auto _ : state) {
+      filter(src_start, src_pitch, reinterpret_cast<Uint8 *>(dst.data()), dst_pitch, width, height);
+      benchmark::DoNotOptimize(dst.data());
+   }
+   state.SetItemsProcessed(state.iterations() * width * height);
+}
+BENCHMARK_CAPTURE(BM_Filter, supereagle, filter_supereagle);
+BENCHMARK_CAPTURE(BM_Filter, scale2x, filter_scale2x);
+BENCHMARK_CAPTURE(BM_Filter, ascale2x, filter_ascale2x);
+BENCHMARK_CAPTURE(BM_Filter, tv2x, filter_tv2x);
+BENCHMARK_CAPTURE(BM_Filter, bilinear, filter_bilinear);
+BENCHMARK_CAPTURE(BM_Filter, bicubic, filter_bicubic);
+BENCHMARK_CAPTURE(BM_Filter, dotmatrix, filter_dotmatrix);
+
+}
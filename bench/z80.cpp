@@ -0,0 +1,97 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include "z80.h"
+#include "cap32.h"
+
+#include "z80_macros.h"
+#include "machinestate.h"
+
+
+namespace
+{
+
+// Code is repeated up to this address, data used by the instructions lives
+// above it so that the code is never overwritten.
+const word CODE_END = 0xf000;
+const word DATA = 0xf800;
+
+// Executes code, repeated over the whole code area, one instruction at a time.
+void runCode(benchmark::State& state, const std::vector<byte>& code)
+{
+   std::vector<byte> memory(0x10000, 0);
+   for (size_t addr = 0; addr + code.size() <= CODE_END; addr += code.size()) {
+      std::copy(code.begin(), code.end(), memory.begin() + addr);
+   }
+   byte *saved_read[4], *saved_write[4];
+   for (int n = 0; n < 4; n++) {
+      saved_read[n] = membank_read[n];
+      saved_write[n] = membank_write[n];
+      membank_read[n] = membank_write[n] = &memory[n * 0x4000];
+   }
+   z80 = t_z80regs();
+   _HL = _DE = _IX = _IY = DATA;
+   _BC = 0x1234;
+   z80_index_debug_points();
+
+   for (auto _ : state) {
+      if (_PC >= CODE_END - code.size()) {
+         _PC = 0;
+      }
+      z80_execute_instruction();
+   }
+   state.SetItemsProcessed(state.iterations());
+
+   for (int n = 0; n < 4; n++) {
+      membank_read[n] = saved_read[n];
+      membank_write[n] = saved_write[n];
+   }
+}
+
+void BM_Z80_Main(benchmark::State& state)
+{
+   // ld a,b ; add a,c ; xor d ; inc bc ; dec e ; ld a,(hl) ; ld (hl),a ; push bc ; pop bc
+   runCode(state, { 0x78, 0x81, 0xaa, 0x03, 0x1d, 0x7e, 0x77, 0xc5, 0xc1 });
+}
+BENCHMARK(BM_Z80_Main);
+
+void BM_Z80_CB(benchmark::State& state)
+{
+   // rlc b ; bit 0,(hl) ; set 0,a ; srl (hl)
+   runCode(state, { 0xcb, 0x00, 0xcb, 0x46, 0xcb, 0xc7, 0xcb, 0x3e });
+}
+BENCHMARK(BM_Z80_CB);
+
+void BM_Z80_ED(benchmark::State& state)
+{
+   // neg ; adc hl,bc ; ld a,i ; sbc hl,de
+   runCode(state, { 0xed, 0x44, 0xed, 0x4a, 0xed, 0x57, 0xed, 0x52 });
+}
+BENCHMARK(BM_Z80_ED);
+
+void BM_Z80_DD_FD(benchmark::State& state)
+{
+   // ld a,(ix+5) ; add a,(iy+2) ; ld (ix+3),a ; ld l,(iy+1)
+   runCode(state, { 0xdd, 0x7e, 0x05, 0xfd, 0x86, 0x02, 0xdd, 0x77, 0x03, 0xfd, 0x6e, 0x01 });
+}
+BENCHMARK(BM_Z80_DD_FD);
+
+void BM_Z80_DDCB_FDCB(benchmark::State& state)
+{
+   // bit 0,(ix+5) ; rlc (iy+2)
+   runCode(state, { 0xdd, 0xcb, 0x05, 0x46, 0xfd, 0xcb, 0x02, 0x06 });
+}
+BENCHMARK(BM_Z80_DDCB_FDCB);
+
+void BM_Z80_Mixed(benchmark::State& state)
+{
+   // An instruction of each group, as in instruction exercisers:
+   // ld a,b ; add a,(hl) ; rlc b ; neg ; ld a,(ix+5) ; add a,(iy+2) ;
+   // bit 0,(ix+5) ; rlc (iy+2) ; inc ix ; dec ix ; push iy ; pop iy ;
+   // ld a,ixh ; add a,iyl
+   runCode(state, { 0x78, 0x86, 0xcb, 0x00, 0xed, 0x44, 0xdd, 0x7e, 0x05, 0xfd, 0x86, 0x02,
+                    0xdd, 0xcb, 0x05, 0x46, 0xfd, 0xcb, 0x02, 0x06, 0xdd, 0x23, 0xdd, 0x2b,
+                    0xfd, 0xe5, 0xfd, 0xe1, 0xdd, 0x7c, 0xfd, 0x85 });
+}
+BENCHMARK(BM_Z80_Mixed);
+
+}
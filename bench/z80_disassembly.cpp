@@ -0,0 +1,22 @@
+#include <benchmark/benchmark.h>
+#include "z80_disassembly.h"
+#include "emulator.h"
+
+namespace
+{
+
+// Disassembles the code reachable from the reset vector of the firmware.
+void BM_Disassemble(benchmark::State& state)
+{
+   bench_init_emulator();
+   size_t lines = 0;
+   for (auto _ : state) {
+      auto code = disassemble({0});
+      lines = code.lines.size();
+   }
+   state.counters["lines"] = static_cast<double>(lines);
+   state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Disassemble);
+
+}
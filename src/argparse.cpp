@@ -16,14 +16,26 @@
 const struct option long_options[] =
 {
    {"autocmd",  required_argument, nullptr, 'a'},
+   {"batch", required_argument, nullptr, 'b'},
    {"cfg_file", required_argument, nullptr, 'c'},
+   {"expect_hash", required_argument, nullptr, 'e'},
+   {"frames", required_argument, nullptr, 'f'},
+   {"headless", no_argument, nullptr, 'H'},
    {"inject", required_argument, nullptr, 'i'},
+   {"jobs", required_argument, nullptr, 'j'},
+   {"hash_log", required_argument, nullptr, 'l'},
+   {"video", required_argument, nullptr, 'm'},
    {"offset", required_argument, nullptr, 'o'},
    {"override", required_argument, nullptr, 'O'},
+   {"video_to_png", required_argument, nullptr, 'p'},
+   {"record", required_argument, nullptr, 'r'},
+   {"replay", required_argument, nullptr, 'R'},
    {"sym_file", required_argument, nullptr, 's'},
    {"version",  no_argument, nullptr, 'V'},
    {"help",     no_argument, nullptr, 'h'},
    {"verbose",  no_argument, nullptr, 'v'},
+   {"wav", required_argument, nullptr, 'w'},
+   {"ym", required_argument, nullptr, 'y'},
    {nullptr, 0, nullptr, 0},
 };
 
@@ -36,14 +48,26 @@ void usage(std::ostream &os, char *progPath, int errcode)
    os << "Usage: " << progname << " [options] <slotfile(s)>\n";
    os << "\nSupported options are:\n";
    os << "   -a/--autocmd=<command>: execute command as soon as the emulator starts.\n";
+   os << "   -b/--batch=<manifest>:  run the scripted jobs listed in <manifest> on parallel headless machines and exit (see the man page).\n";
    os << "   -c/--cfg_file=<file>:   use <file> as the emulator configuration file instead of the default.\n";
+   os << "   -e/--expect_hash=<hash>: hash expected for the frame checked by the next CAP32_ASSERTHASH. Can be repeated.\n";
+   os << "   -f/--frames=<count>:    exit after <count> frames have been emulated.\n";
    os << "   -h/--help:              shows this help\n";
+   os << "   -H/--headless:          run without window nor sound, as fast as possible (for scripted runs, see -a and -f).\n";
    os << "   -i/--inject=<file>:     inject a binary in memory after the CPC startup finishes\n";
+   os << "   -j/--jobs=<count>:      number of machines running --batch jobs in parallel (default: one per core).\n";
+   os << "   -l/--hash_log=<file>:   write the hash of every emulated frame to <file>.\n";
+   os << "   -m/--video=<file>:      record every frame displayed, losslessly, in <file> (see --video_to_png).\n";
    os << "   -o/--offset=<address>:  offset at which to inject the binary provided with -i (default: 0x6000)\n";
    os << "   -O/--override:          override an option from the config. Can be repeated. (example: -O system.model=3)\n";
+   os << "   -p/--video_to_png=<file>: convert the frames recorded with -m in <file> to PNG images and exit.\n";
+   os << "   -r/--record=<file>:     record the inputs of the emulated CPC from startup in <file>.\n";
+   os << "   -R/--replay=<file>:     replay the inputs recorded with -r from <file>, ignoring the keyboard, joystick and mouse.\n";
    os << "   -s/--sym_file=<file>:   use <file> as a source of symbols and entry points for disassembling in developers' tools.\n";
    os << "   -V/--version:           outputs version and exit\n";
    os << "   -v/--verbose:           be talkative\n";
+   os << "   -w/--wav=<file>:        record the sound of the emulated CPC in the WAV <file>, also when --headless.\n";
+   os << "   -y/--ym=<file>:         record the AY registers of the emulated CPC, frame by frame, in the YM6 <file>.\n";
    os << "\nslotfiles is an optional list of files giving the content of the various CPC ports.\n";
    os << "Ports files are identified by their extension. Supported formats are .dsk (disk), .cdt or .voc (tape), .cpr (cartridge), .sna (snapshot), or .zip (archive containing one or more of the supported ports files).\n";
    os << "\nExample: " << progname << " sorcery.dsk\n";
@@ -80,6 +104,7 @@ std::string replaceCap32Keys(std::string command)
     { "CAP32_DELAY", cap32_keystroke(CAP32_DELAY) },
     { "CAP32_PASTE", cap32_keystroke(CAP32_PASTE) },
     { "CAP32_DEVTOOLS", cap32_keystroke(CAP32_DEVTOOLS) },
+    { "CAP32_ASSERTHASH", cap32_keystroke(CAP32_ASSERTHASH) },
     { "CPC_F1", cpc_keystroke(CPC_F1) },
     { "CPC_F2", cpc_keystroke(CPC_F2) },
   };
@@ -102,7 +127,7 @@ void parseArguments(int argc, char **argv, std::vector<std::string>& slot_list,
 
    optind = 0; // To please test framework, when this function is called multiple times !
    while(true) {
-      c = getopt_long (argc, argv, "a:c:hi:o:O:s:vV",
+      c = getopt_long (argc, argv, "a:b:c:e:f:hHi:j:l:m:o:O:p:r:R:s:vVw:y:",
                        long_options, &option_index);
       // Logs before processing of the -v will not be visible.
       LOG_DEBUG("Next option: " << c << "(" << static_cast<char>(c) << ")");
@@ -119,18 +144,47 @@ void parseArguments(int argc, char **argv, std::vector<std::string>& slot_list,
             args.autocmd += "\n";
             break;
 
+         case 'b':
+            args.batchFile = optarg;
+            args.headless = true;
+            break;
+
          case 'c':
             args.cfgFilePath = optarg;
             break;
 
+         case 'e':
+            args.expectedHashes.push_back(std::stoull(optarg, nullptr, 16));
+            break;
+
+         case 'f':
+            args.maxFrames = std::stoul(optarg, nullptr, 0);
+            break;
+
          case 'h':
             usage(std::cout, argv[0], 0);
             break;
 
+         case 'H':
+            args.headless = true;
+            break;
+
          case 'i':
             args.binFile = optarg;
             break;
 
+         case 'j':
+            args.batchJobs = std::stoul(optarg, nullptr, 0);
+            break;
+
+         case 'l':
+            args.hashLogFile = optarg;
+            break;
+
+         case 'm':
+            args.videoFile = optarg;
+            break;
+
          case 'o':
             args.binOffset = std::stol(optarg, nullptr, 0);
             break;
@@ -156,6 +210,18 @@ void parseArguments(int argc, char **argv, std::vector<std::string>& slot_list,
               break;
             }
 
+         case 'p':
+            args.videoToPngFile = optarg;
+            break;
+
+         case 'r':
+            args.recordFile = optarg;
+            break;
+
+         case 'R':
+            args.replayFile = optarg;
+            break;
+
          case 's':
             args.symFilePath = optarg;
             break;
@@ -164,6 +230,14 @@ void parseArguments(int argc, char **argv, std::vector<std::string>& slot_list,
             log_verbose = true;
             break;
 
+         case 'w':
+            args.wavFile = optarg;
+            break;
+
+         case 'y':
+            args.ymFile = optarg;
+            break;
+
          case 'V':
             // Version
             std::cout << "Caprice32 " << VERSION_STRING;
@@ -1,6 +1,7 @@
 #ifndef ARGPARSE_H
 #define ARGPARSE_H
 
+#include <cstdint>
 #include <map>
 #include <string>
 #include <vector>
@@ -15,6 +16,18 @@ class CapriceArgs
       size_t binOffset;
       std::map<std::string, std::map<std::string, std::string>> cfgOverrides;
       std::string symFilePath;
+      bool headless = false;
+      unsigned long maxFrames = 0;
+      std::string recordFile;
+      std::string replayFile;
+      std::string wavFile;
+      std::string ymFile;
+      std::string videoFile;
+      std::string videoToPngFile;
+      std::string batchFile;
+      unsigned int batchJobs = 0;
+      std::vector<uint64_t> expectedHashes;
+      std::string hashLogFile;
 };
 
 std::string replaceCap32Keys(std::string command);
@@ -3,28 +3,13 @@
 #include "cap32.h"
 #include "SDL.h"
 #include "crtc.h"
+#include "machinestate.h"
 
-byte *pbRegisterPage;
-extern SDL_Color colours[32];
-extern t_GateArray GateArray;
-extern t_CRTC CRTC;
-extern t_CPC CPC;
-extern t_PSG PSG;
-extern SDL_Surface *back_surface;
-extern dword dwXScale;
-extern byte *membank_config[8][4];
-extern byte *membank_write[4];
-
-asic_t asic;
-
-struct asic_color_t {
-  double r;
-  double g;
-  double b;
-  bool set;
-};
-
-asic_color_t asic_colours[32];
+extern thread_local SDL_Color colours[32];
+extern thread_local t_CPC CPC;
+extern thread_local SDL_Surface *back_surface;
+extern thread_local dword dwXScale;
+extern thread_local byte *membank_config[8][4];
 
 void asic_reset() {
   asic.locked = true;
@@ -177,8 +162,10 @@ void asic_dma_cycle() {
     {
       word addr = 0x6C00 + (c << 2);
       *(membank_write[addr >> 14] + (addr & 0x3fff)) = static_cast<byte>(channel.source_address & 0xFF);
+      ram_mark_write(addr);
       addr++;
       *(membank_write[addr >> 14] + (addr & 0x3fff)) = static_cast<byte>((channel.source_address & 0xFF00) >> 8);
+      ram_mark_write(addr);
       /* Useless ?
       addr++;
       *(membank_write[addr >> 14] + (addr & 0x3fff)) = channel.prescaler;
@@ -199,6 +186,7 @@ void asic_dma_cycle() {
   {
     word addr = 0x6C0F;
     *(membank_write[addr >> 14] + (addr & 0x3fff)) = dcsr;
+    ram_mark_write(addr);
   }
 }
 
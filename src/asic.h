@@ -49,8 +49,12 @@ struct asic_t {
   dma_t dma;
 };
 
-extern asic_t asic;
-extern byte *pbRegisterPage;
+struct asic_color_t {
+  double r;
+  double g;
+  double b;
+  bool set;
+};
 
 void asic_set_palette();
 void asic_reset();
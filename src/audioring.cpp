@@ -0,0 +1,51 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Ring of sound samples between the emulation and the audio callback.
+*/
+
+#include "audioring.h"
+
+#include <algorithm>
+#include <cstring>
+
+AudioRing::AudioRing(size_t capacity) : buffer(capacity)
+{
+}
+
+size_t AudioRing::write(const byte *data, size_t size)
+{
+   size_t head = written.load(std::memory_order_relaxed);
+   // Acquire: the consumer is done with the bytes it has taken.
+   size_t room = buffer.size() - (head - taken.load(std::memory_order_acquire));
+   size_t count = std::min(size, room);
+   if (count < size) {
+      overrun_bytes.fetch_add(size - count, std::memory_order_relaxed);
+   }
+   size_t pos = head % buffer.size();
+   size_t first = std::min(count, buffer.size() - pos);
+   memcpy(&buffer[pos], data, first);
+   memcpy(&buffer[0], data + first, count - first);
+   // Release: the bytes are in the buffer before the consumer can see them.
+   written.store(head + count, std::memory_order_release);
+   return count;
+}
+
+size_t AudioRing::read(byte *data, size_t size)
+{
+   size_t tail = taken.load(std::memory_order_relaxed);
+   size_t count = std::min(size, written.load(std::memory_order_acquire) - tail);
+   if (count < size) {
+      underrun_count.fetch_add(1, std::memory_order_relaxed);
+   }
+   size_t pos = tail % buffer.size();
+   size_t first = std::min(count, buffer.size() - pos);
+   memcpy(data, &buffer[pos], first);
+   memcpy(data + first, &buffer[0], count - first);
+   taken.store(tail + count, std::memory_order_release);
+   return count;
+}
+
+size_t AudioRing::available() const
+{
+   return written.load(std::memory_order_acquire) - taken.load(std::memory_order_acquire);
+}
@@ -0,0 +1,51 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Ring of sound samples between the emulation, which produces them, and the
+   SDL audio callback, which plays them.
+   There is exactly one producer thread and one consumer thread: neither ever
+   locks nor waits for the other. Each side only writes its own position and
+   reads the other one.
+*/
+
+#ifndef AUDIORING_H
+#define AUDIORING_H
+
+#include "types.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class AudioRing {
+  public:
+    // Capacity in bytes.
+    explicit AudioRing(size_t capacity);
+
+    // Producer side. Appends as much of data as fits, the rest is dropped (and
+    // counted as overrun). Returns the number of bytes appended.
+    size_t write(const byte *data, size_t size);
+    // Consumer side. Takes up to size bytes, and counts an underrun if there
+    // were not enough. Returns the number of bytes taken.
+    size_t read(byte *data, size_t size);
+
+    // Bytes written and not read yet. From either side, this is a lower bound
+    // for the consumer and an upper bound for the producer.
+    size_t available() const;
+    size_t capacity() const { return buffer.size(); }
+
+    // Number of reads which could not be fully served.
+    uint64_t underruns() const { return underrun_count.load(std::memory_order_relaxed); }
+    // Number of bytes dropped because the ring was full.
+    uint64_t overruns() const { return overrun_bytes.load(std::memory_order_relaxed); }
+
+  private:
+    std::vector<byte> buffer;
+    // Total bytes written and read since the start: their difference is the
+    // fill level and, modulo the capacity, they are the positions in buffer.
+    std::atomic<size_t> written{0};
+    std::atomic<size_t> taken{0};
+    std::atomic<uint64_t> underrun_count{0};
+    std::atomic<uint64_t> overrun_bytes{0};
+};
+
+#endif
@@ -0,0 +1,209 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Batch runs.
+*/
+
+#include "batch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include "argparse.h"
+#include "framehash.h"
+#include "log.h"
+#include "machine.h"
+#include "stringutils.h"
+
+namespace
+{
+
+std::string unescape(const std::string& str)
+{
+   std::string result;
+   for (size_t i = 0; i < str.size(); i++) {
+      if (str[i] == '\\' && i + 1 < str.size()) {
+         if (str[i + 1] == 'n') {
+            result += '\n';
+            i++;
+            continue;
+         }
+         if (str[i + 1] == '\\') {
+            result += '\\';
+            i++;
+            continue;
+         }
+      }
+      result += str[i];
+   }
+   return result;
+}
+
+bool is_hash(const std::string& str)
+{
+   return str.size() == 16 && std::all_of(str.begin(), str.end(), [](char c) { return isxdigit(static_cast<unsigned char>(c)); });
+}
+
+struct t_BatchResult {
+   bool passed = false;
+   std::string hash;
+   std::string error;
+   double seconds = 0;
+};
+
+t_BatchResult run_job(Machine& machine, const t_BatchJob& job, const std::string& configFile)
+{
+   t_BatchResult result;
+   auto start = std::chrono::steady_clock::now();
+   std::vector<std::string> slot_list;
+   if (!job.image.empty()) {
+      slot_list.push_back(job.image);
+   }
+   int iErrCode = machine.init(configFile, slot_list);
+   if (!iErrCode) {
+      machine.autocmd(job.autocmd);
+      iErrCode = machine.runFrames(job.frames);
+   }
+   if (iErrCode) {
+      result.error = "emulation failed with error " + std::to_string(iErrCode);
+   } else {
+      auto screenshots = machine.screenshots();
+      result.hash = frame_hash_to_string(screenshots.empty() ? machine.frameHash() : screenshots.back());
+      result.passed = job.expected_hash.empty() || job.expected_hash == result.hash;
+      if (!result.passed) {
+         result.error = "expected " + job.expected_hash;
+      }
+   }
+   result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   return result;
+}
+
+}
+
+bool batch_parse_manifest(std::istream& manifest, const std::string& base_dir, std::vector<t_BatchJob>& jobs)
+{
+   std::string line;
+   for (unsigned int line_number = 1; std::getline(manifest, line); line_number++) {
+      if (!line.empty() && line.back() == '\r') {
+         line.pop_back();
+      }
+      if (line.empty() || line[0] == '#') {
+         continue;
+      }
+      auto fields = stringutils::split(line, '\t');
+      if (fields.size() < 3 || fields.size() > 4) {
+         LOG_ERROR("Manifest line " << line_number << ": expected 3 or 4 tab separated fields, got " << fields.size());
+         return false;
+      }
+      t_BatchJob job;
+      job.line = line_number;
+      job.image = fields[0];
+      if (!job.image.empty() && std::filesystem::path(job.image).is_relative()) {
+         job.image = (std::filesystem::path(base_dir) / job.image).string();
+      }
+      job.autocmd = replaceCap32Keys(unescape(fields[1])) + "\n";
+      try {
+         job.frames = std::stoul(fields[2], nullptr, 0);
+      } catch (const std::exception&) {
+         job.frames = 0;
+      }
+      if (!job.frames) {
+         LOG_ERROR("Manifest line " << line_number << ": invalid number of frames '" << fields[2] << "'");
+         return false;
+      }
+      if (fields.size() == 4 && !fields[3].empty()) {
+         if (!is_hash(fields[3])) {
+            LOG_ERROR("Manifest line " << line_number << ": invalid hash '" << fields[3] << "'");
+            return false;
+         }
+         job.expected_hash = stringutils::lower(fields[3]);
+      }
+      jobs.push_back(job);
+   }
+   return true;
+}
+
+WorkStealingQueues::WorkStealingQueues(size_t workers, size_t jobs)
+{
+   for (size_t i = 0; i < workers; i++) {
+      queues.push_back(std::make_unique<Queue>());
+   }
+   for (size_t job = 0; job < jobs; job++) {
+      queues[job % workers]->jobs.push_back(job);
+   }
+}
+
+bool WorkStealingQueues::next(size_t worker, size_t& job)
+{
+   {
+      Queue& own = *queues[worker];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.jobs.empty()) {
+         job = own.jobs.front();
+         own.jobs.pop_front();
+         return true;
+      }
+   }
+   // Jobs are never added: once all the queues were seen empty, all the work is
+   // being done.
+   for (size_t i = 1; i < queues.size(); i++) {
+      Queue& victim = *queues[(worker + i) % queues.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.jobs.empty()) {
+         job = victim.jobs.back();
+         victim.jobs.pop_back();
+         return true;
+      }
+   }
+   return false;
+}
+
+int batch_run(const std::string& manifest, const std::string& configFile, unsigned int workers)
+{
+   std::ifstream in(manifest);
+   if (!in) {
+      LOG_ERROR("Could not open batch manifest " << manifest);
+      return -1;
+   }
+   std::vector<t_BatchJob> jobs;
+   std::string base_dir = std::filesystem::path(manifest).parent_path().string();
+   if (!batch_parse_manifest(in, base_dir.empty() ? "." : base_dir, jobs)) {
+      return -1;
+   }
+   workers = std::max(1u, std::min(workers, static_cast<unsigned int>(jobs.size())));
+   LOG_INFO("Running " << jobs.size() << " jobs on " << workers << " machines");
+
+   auto start = std::chrono::steady_clock::now();
+   WorkStealingQueues queues(workers, jobs.size());
+   std::vector<t_BatchResult> results(jobs.size());
+   std::mutex output_mutex;
+   std::vector<std::thread> threads;
+   for (unsigned int worker = 0; worker < workers; worker++) {
+      threads.emplace_back([&, worker]() {
+         Machine machine;
+         size_t job;
+         while (queues.next(worker, job)) {
+            results[job] = run_job(machine, jobs[job], configFile);
+            const t_BatchResult& result = results[job];
+            std::lock_guard<std::mutex> lock(output_mutex);
+            std::cout << (result.passed ? "PASS" : "FAIL") << " line " << jobs[job].line << ": "
+                      << (jobs[job].image.empty() ? "-" : jobs[job].image) << " "
+                      << std::fixed << std::setprecision(2) << result.seconds << "s " << result.hash
+                      << (result.error.empty() ? "" : " (" + result.error + ")") << std::endl;
+         }
+      });
+   }
+   for (auto& thread : threads) {
+      thread.join();
+   }
+
+   size_t passed = std::count_if(results.begin(), results.end(), [](const t_BatchResult& r) { return r.passed; });
+   double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   std::cout << "Batch: " << passed << "/" << jobs.size() << " jobs passed in "
+             << std::fixed << std::setprecision(2) << seconds << "s on " << workers << " machines" << std::endl;
+   return passed == jobs.size() ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Batch runs (--batch): a list of scripted runs, spread over independent
+   machines (see machine.h) running in parallel.
+   The manifest has one job per line, with tab separated fields:
+     image <tab> autocmd <tab> frames [<tab> expected hash]
+   - image: file to load (as given on the command line), may be empty. Relative
+     paths are relative to the directory of the manifest.
+   - autocmd: keys to type, as with -a. \n stands for a new line.
+   - frames: number of frames after which the job ends, if CAP32_EXIT wasn't
+     typed before.
+   - expected hash: frame_hash of the screen taken with the last CAP32_SCRNSHOT
+     or, if there isn't any, of the screen at the end. Without it, the job
+     passes as long as it runs, and its hash is reported.
+   Empty lines and lines starting with # are ignored.
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstddef>
+#include <deque>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct t_BatchJob {
+   unsigned int line;
+   std::string image;
+   std::string autocmd;
+   unsigned long frames;
+   std::string expected_hash;
+};
+
+// Returns false if a line can't be parsed, jobs then holds the ones before it.
+bool batch_parse_manifest(std::istream& manifest, const std::string& base_dir, std::vector<t_BatchJob>& jobs);
+
+// Work stealing scheduling of jobs over workers: each worker takes jobs from
+// the front of its own queue and, once it is empty, steals from the back of
+// the others.
+class WorkStealingQueues {
+  public:
+    // Jobs 0 to jobs-1 are dealt to the workers in turn.
+    WorkStealingQueues(size_t workers, size_t jobs);
+    // Next job for worker. Returns false once all the queues are empty.
+    bool next(size_t worker, size_t& job);
+
+  private:
+    struct Queue {
+      std::mutex mutex;
+      std::deque<size_t> jobs;
+    };
+    std::vector<std::unique_ptr<Queue>> queues;
+};
+
+// Runs the jobs of manifest on workers machines configured from configFile,
+// reporting each job as it ends and a summary on stdout.
+// Returns 0 if all jobs passed, 1 if some failed, -1 if the manifest is invalid.
+int batch_run(const std::string& manifest, const std::string& configFile, unsigned int workers);
+
+#endif
@@ -41,7 +41,15 @@
 #include "cartridge.h"
 #include "asic.h"
 #include "argparse.h"
+#include "audioring.h"
+#include "capture.h"
+#include "videocapture.h"
+#include "screenshot.h"
 #include "slotshandler.h"
+#include "savestate.h"
+#include "movie.h"
+#include "batch.h"
+#include "framehash.h"
 #include "fileutils.h"
 
 #include <errno.h>
@@ -57,74 +65,79 @@
 #include "log.h"
 
 #include "savepng.h"
+#include "machinestate.h"
 
 #define MAX_LINE_LEN 256
 
 #define MAX_NB_JOYSTICKS 2
 
 #define POLL_INTERVAL_MS 1
+// Sound buffers (of the size of the ones of the audio device) the audio ring
+// can hold, and the ones the emulation keeps ready ahead of the audio callback.
+#define AUDIO_RING_BUFFERS 4
+#define AUDIO_QUEUED_BUFFERS 1
 
 #ifndef DESTDIR
 #define DESTDIR ""
 #endif
 
-extern byte bTapeLevel;
-extern t_z80regs z80;
-extern std::vector<Breakpoint> breakpoints;
+extern thread_local byte bTapeLevel;
+extern thread_local std::vector<Breakpoint> breakpoints;
 
 extern dword *ScanPos;
 extern dword *ScanStart;
-extern word MaxVSync;
-extern t_flags1 flags1;
-extern t_new_dt new_dt;
 extern t_disk_format disk_format[];
 
-extern byte* pbCartridgePages[];
+extern thread_local byte* pbCartridgePages[];
 
 extern SDL_Window* mainSDLWindow;
 
 SDL_AudioDeviceID audio_device_id = 0;
-SDL_Surface *back_surface = nullptr;
-video_plugin* vid_plugin;
+thread_local SDL_Surface *back_surface = nullptr;
+thread_local video_plugin* vid_plugin;
 SDL_Joystick* joysticks[MAX_NB_JOYSTICKS];
 std::list<DevTools> devtools;
 
 dword dwTicks, dwTicksOffset, dwTicksTarget, dwTicksTargetFPS;
 dword dwFPS, dwFrameCount;
-dword dwXScale, dwYScale;
-dword dwSndBufferCopied;
+thread_local dword dwXScale, dwYScale;
 
 dword osd_timing;
 std::string osd_message;
 
 std::string lastSavedSnapshot;
 
-dword dwBreakPoint, dwTrace, dwMF2ExitAddr;
-dword dwMF2Flags = 0;
+thread_local dword dwBreakPoint, dwTrace;
 std::unique_ptr<byte[]> pbSndBuffer;
-byte *pbGPBuffer = nullptr;
+std::unique_ptr<AudioRing> audio_ring;
+byte audio_silence;
+thread_local byte *pbGPBuffer = nullptr;
 byte *pbSndBufferEnd = nullptr;
 byte *pbSndStream = nullptr;
-byte *membank_read[4], *membank_write[4], *memmap_ROM[256];
-byte *pbRAM = nullptr;
-byte *pbRAMbuffer = nullptr;
-byte *pbROM = nullptr;
-byte *pbROMlo = nullptr;
-byte *pbROMhi = nullptr;
-byte *pbExpansionROM = nullptr;
-byte *pbMF2ROMbackup = nullptr;
-byte *pbMF2ROM = nullptr;
-std::vector<byte> pbTapeImage;
-byte keyboard_matrix[16];
-
-std::list<SDL_Event> virtualKeyboardEvents;
-dword nextVirtualEventFrameCount, dwFrameCountOverall = 0;
-dword breakPointsToSkipBeforeProceedingWithVirtualEvents = 0;
-
-t_MemBankConfig membank_config;
-
-FILE *pfileObject;
-FILE *pfoPrinter;
+thread_local byte *pbRAMbuffer = nullptr;
+thread_local byte *pbROM = nullptr;
+thread_local byte *pbMF2ROMbackup = nullptr;
+thread_local byte *pbMF2ROM = nullptr;
+thread_local std::vector<byte> pbTapeImage;
+thread_local byte keyboard_matrix[16];
+
+thread_local std::list<SDL_Event> virtualKeyboardEvents;
+thread_local dword nextVirtualEventFrameCount, dwFrameCountOverall = 0;
+thread_local dword breakPointsToSkipBeforeProceedingWithVirtualEvents = 0;
+
+#define REWIND_INTERVAL_FRAMES 50 // one state per second of emulation
+thread_local RewindBuffer rewind_buffer;
+thread_local std::vector<byte> rewind_state;
+thread_local dword nextRewindFrameCount = 0;
+
+FILE *pfoHashLog = nullptr;
+size_t expectedHashesChecked = 0;
+
+thread_local t_MemBankConfig membank_config;
+thread_local std::vector<t_MemBankConfig> membank_configs;
+
+thread_local FILE *pfileObject;
+thread_local FILE *pfoPrinter;
 
 #ifdef DEBUG
 dword dwDebugFlag = 0;
@@ -196,7 +209,7 @@ double *video_get_rgb_color(int color) {
    return colours_rgb[color];
 }
 
-SDL_Color colours[32];
+thread_local SDL_Color colours[32];
 
 byte bit_values[8] = {
    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80
@@ -241,16 +254,10 @@ t_CPC::t_CPC() {
   snapshot.drive = DRIVE::SNAPSHOT;
 }
 
-t_CPC CPC;
-t_CRTC CRTC;
-t_FDC FDC;
-t_GateArray GateArray;
-t_PPI PPI;
-t_PSG PSG;
-t_VDU VDU;
+thread_local t_CPC CPC;
 
-t_drive driveA;
-t_drive driveB;
+thread_local t_drive driveA;
+thread_local t_drive driveB;
 
 #define psg_write \
 { \
@@ -333,6 +340,96 @@ void ga_init_banking (t_MemBankConfig& membank_config, unsigned char RAM_bank)
 
 
 
+void ga_init_banking_tables ()
+{
+   size_t banks = CPC.ram_size > 64 ? CPC.ram_size / 64 - 1 : 1;
+   membank_configs.resize(banks);
+   for (size_t bank = 0; bank < banks; bank++) {
+      ga_init_banking(membank_configs[bank], bank);
+   }
+   if (GateArray.RAM_bank >= banks) {
+      GateArray.RAM_bank = 0;
+   }
+   membank_config = membank_configs[GateArray.RAM_bank];
+}
+
+
+
+void ram_update_write_pages ()
+{
+   for (int n = 0; n < 4; n++) {
+      membank_write_page[n] = RAM_MAX_PAGES;
+      if (membank_write[n] >= pbRAM && membank_write[n] < pbRAM + CPC.ram_size*1024) {
+         unsigned int page = (membank_write[n] - pbRAM) >> RAM_PAGE_SHIFT;
+         if (page + 4 <= RAM_MAX_PAGES) {
+            membank_write_page[n] = page;
+         }
+      }
+   }
+}
+
+
+
+void ram_mark_dirty (size_t offset, size_t size)
+{
+   if (!size) {
+      return;
+   }
+   size_t last = std::min((offset + size - 1) >> RAM_PAGE_SHIFT, static_cast<size_t>(RAM_MAX_PAGES - 1));
+   for (size_t page = offset >> RAM_PAGE_SHIFT; page <= last; page++) {
+      ram_page_stamp[page] = ram_write_stamp;
+   }
+}
+
+
+
+void ram_mark_all_dirty ()
+{
+   ram_mark_dirty(0, CPC.ram_size*1024);
+}
+
+
+
+dword ram_dirty_checkpoint ()
+{
+   return ram_write_stamp++;
+}
+
+
+
+bool ram_page_written_since (unsigned int page, dword checkpoint)
+{
+   // Pages beyond the tracked range are always considered dirty.
+   return page >= RAM_MAX_PAGES || ram_page_stamp[page] > checkpoint;
+}
+
+
+
+// Writes to the register page are decoded by the ASIC, the page keeps what can
+// be read back.
+void asic_register_page_write_handler (word addr, byte val)
+{
+   if (asic_register_page_write(addr, val)) {
+      *(membank_write[addr >> 14] + (addr & 0x3fff)) = val;
+   }
+}
+
+
+
+// The Multiface 2 ROM takes the first 8KB of its bank: as for any other ROM,
+// writes go to the RAM below. Its RAM takes the next 8KB.
+void mf2_write_handler (word addr, byte val)
+{
+   if (addr & 0x2000) {
+      *(pbMF2ROM + (addr & 0x3fff)) = val;
+   } else {
+      *(membank_write[addr >> 14] + (addr & 0x3fff)) = val;
+      ram_mark_write(addr);
+   }
+}
+
+
+
 void ga_memory_manager ()
 {
    dword mem_bank;
@@ -340,27 +437,24 @@ void ga_memory_manager ()
       mem_bank = 0; // no expansion memory
       GateArray.RAM_config = 0; // the only valid configuration is 0
    } else {
-      mem_bank = (GateArray.RAM_config >> 3) & 7; // extract expansion memory bank
+      mem_bank = (GateArray.RAM_ext << 3) | ((GateArray.RAM_config >> 3) & 7); // extract expansion memory bank
       if (((mem_bank+2)*64) > CPC.ram_size) { // selection is beyond available memory?
          mem_bank = 0; // force default mapping
       }
    }
    if (mem_bank != GateArray.RAM_bank) { // requested bank is different from the active one?
       GateArray.RAM_bank = mem_bank;
-      ga_init_banking(membank_config, GateArray.RAM_bank);
+      membank_config = membank_configs[mem_bank];
    }
    for (int n = 0; n < 4; n++) { // remap active memory banks
       membank_read[n] = membank_config[GateArray.RAM_config & 7][n];
       membank_write[n] = membank_config[GateArray.RAM_config & 7][n];
+      membank_write_handler[n] = nullptr;
    }
    if (!(GateArray.ROM_config & 0x04)) { // lower ROM is enabled?
       if (dwMF2Flags & MF2_ACTIVE) { // is the Multiface 2 paged in?
-         // TODO: I think this is why the MF2 doesn't work properly:
-         // ROM should be loaded R/O at 0x0000-0x1FFF (i.e not loaded in membank_write ?)
-         // Writes should probably be disabled in membank_write (pointing to a dummy buffer, but not MF2 ROM ?)
-         // MF2 also has a RAM (8kB) that should be loaded as R/W at 0x2000-0x3FFF
-         membank_read[GateArray.lower_ROM_bank] = pbMF2ROM;
-         membank_write[GateArray.lower_ROM_bank] = pbMF2ROM;
+         membank_read[GateArray.lower_ROM_bank] = pbMF2ROM; // 8KB of ROM then 8KB of RAM
+         membank_write_handler[GateArray.lower_ROM_bank] = mf2_write_handler;
       } else {
          membank_read[GateArray.lower_ROM_bank] = pbROMlo; // 'page in' lower ROM
       }
@@ -368,10 +462,12 @@ void ga_memory_manager ()
    if (CPC.model > 2 && GateArray.registerPageOn) {
       membank_read[1] = pbRegisterPage;
       membank_write[1] = pbRegisterPage;
+      membank_write_handler[1] = asic_register_page_write_handler;
    }
    if (!(GateArray.ROM_config & 0x08)) { // upper/expansion ROM is enabled?
       membank_read[3] = pbExpansionROM; // 'page in' upper/expansion ROM
    }
+   ram_update_write_pages();
 }
 
 
@@ -586,6 +682,9 @@ void z80_OUT_handler (reg_pair port, byte val)
      #endif
      LOG_DEBUG("RAM config: " << std::hex << static_cast<int>(val) << std::dec);
      GateArray.RAM_config = val;
+     // Expansions of more than 512KB also decode A10-A8 (inverted), which
+     // select the 512KB block: &7Fxx for the first one down to &78xx.
+     GateArray.RAM_ext = CPC.ram_size > 576 ? (~port.b.h & 7) : 0;
      ga_memory_manager();
      if (CPC.mf2) { // MF2 enabled?
         *(pbMF2ROM + 0x03fff) = val;
@@ -761,6 +860,9 @@ void z80_OUT_handler (reg_pair port, byte val)
    }
 // printer port ---------------------------------------------------------------
    if (!(port.b.h & 0x10)) { // printer port?
+      if (CPC.snd_pp_device) {
+         AY_flush(); // the Digiblaster plays through the sound mixer
+      }
       CPC.printer_port = val ^ 0x80; // invert bit 7
       if (pfoPrinter) {
          if (!(CPC.printer_port & 0x80)) { // only grab data bytes; ignore the strobe signal
@@ -1085,7 +1187,7 @@ void emulator_reset ()
    GateArray.requested_scr_mode = 1; // set to mode 1
    GateArray.registerPageOn = false;
    GateArray.lower_ROM_bank = 0;
-   ga_init_banking(membank_config, GateArray.RAM_bank);
+   ga_init_banking_tables();
 
 // PPI
    memset(&PPI, 0, sizeof(PPI)); // clear PPI data structure
@@ -1107,9 +1209,12 @@ void emulator_reset ()
    for (int n = 0; n < 4; n++) { // initialize active read/write bank configuration
       membank_read[n] = membank_config[0][n];
       membank_write[n] = membank_config[0][n];
+      membank_write_handler[n] = nullptr;
    }
    membank_read[0] = pbROMlo; // 'page in' lower ROM
    membank_read[3] = pbROMhi; // 'page in' upper ROM
+   ram_update_write_pages();
+   ram_mark_all_dirty();
 
 // Multiface 2
    dwMF2Flags = 0;
@@ -1149,7 +1254,7 @@ int emulator_init ()
    pbROMhi =
    pbExpansionROM = pbROM + 16384;
    memset(memmap_ROM, 0, sizeof(memmap_ROM[0]) * 256); // clear the expansion ROM map
-   ga_init_banking(membank_config, GateArray.RAM_bank); // init the CPC memory banking map
+   ga_init_banking_tables(); // init the CPC memory banking maps
    if ((iErr = emulator_patch_ROM())) {
       LOG_ERROR("Failed patching the ROM");
       return iErr;
@@ -1268,6 +1373,11 @@ int emulator_init ()
    emulator_reset();
    CPC.paused = false;
 
+   // States refer to the ROMs and RAM allocated above, they can't be restored anymore.
+   rewind_buffer.clear();
+   rewind_buffer.setBudget(CPC.rewind_size * 1024);
+   nextRewindFrameCount = dwFrameCountOverall + REWIND_INTERVAL_FRAMES;
+
    return 0;
 }
 
@@ -1309,6 +1419,7 @@ void bin_load (const std::string& filename, const size_t offset)
   size_t ram_size = 0XFFFF; // TODO: Find a way to have the real RAM size
   size_t max_size = ram_size - offset;
   size_t read = fread(&pbRAM[offset], 1, max_size, file);
+  ram_mark_dirty(offset, read);
   if (!feof(file)) {
     LOG_ERROR("Bin file too big to fit in memory");
     return;
@@ -1357,14 +1468,17 @@ void printer_stop ()
 
 
 
-void audio_update (void *userdata __attribute__((unused)), byte *stream, int len)
+// Runs on the SDL audio thread, which doesn't see the thread local CPC of the
+// emulation thread: it is passed as userdata.
+void audio_update (void *userdata, byte *stream, int len)
 {
-  if (CPC.snd_ready) {
-    //LOG_VERBOSE("Audio: audio_update: copying " << len << " bytes");
-    memcpy(stream, pbSndBuffer.get(), len);
-    dwSndBufferCopied = 1;
-  } else {
-    LOG_VERBOSE("Audio: audio_update: skipping the copy of " << len << " bytes: sound buffer not ready");
+  size_t count = 0;
+  if (static_cast<t_CPC*>(userdata)->snd_ready) {
+    count = audio_ring->read(stream, len);
+  }
+  if (count < static_cast<size_t>(len)) {
+    // The emulation is late: better a short silence than old samples.
+    memset(stream + count, audio_silence, len - count);
   }
 }
 
@@ -1392,6 +1506,13 @@ int audio_init ()
 
    CPC.snd_ready = false;
 
+   if (args.headless) {
+      // No audio device: the sound is only emulated for the capture (see -w).
+      dword samples = static_cast<dword>(freq_table[CPC.snd_playback_rate] * FRAME_PERIOD_MS / 1000);
+      audio_init_buffer(samples * (CPC.snd_stereo + 1) * (CPC.snd_bits + 1));
+      return 0;
+   }
+
    for (int i = 0; i < SDL_GetNumAudioDevices(0); i++) {
       LOG_VERBOSE("Audio: device " << i << ": " << SDL_GetAudioDeviceName(i, 0));
    }
@@ -1401,7 +1522,7 @@ int audio_init ()
    desired.channels = CPC.snd_stereo+1;
    desired.samples = audio_align_samples(desired.freq * FRAME_PERIOD_MS / 1000);
    desired.callback = audio_update;
-   desired.userdata = nullptr;
+   desired.userdata = &CPC;
 
    audio_device_id = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained, 0 /* no change allowed */);
    if (audio_device_id == 0) {
@@ -1413,21 +1534,31 @@ int audio_init ()
    LOG_VERBOSE("Audio: Desired: Freq: " << desired.freq << ", Format: " << desired.format << ", Channels: " << static_cast<int>(desired.channels) << ", Samples: " << desired.samples << ", Size: " << desired.size);
    LOG_VERBOSE("Audio: Obtained: Freq: " << obtained.freq << ", Format: " << obtained.format << ", Channels: " << static_cast<int>(obtained.channels) << ", Samples: " << obtained.samples << ", Size: " << obtained.size);
 
-   CPC.snd_buffersize = obtained.size; // size is samples * channels * bytes per sample (1 or 2)
+   audio_init_buffer(obtained.size); // size is samples * channels * bytes per sample (1 or 2)
+   audio_ring = std::make_unique<AudioRing>(AUDIO_RING_BUFFERS * CPC.snd_buffersize);
+   audio_silence = obtained.silence;
+   CPC.snd_ready = true;
+   LOG_VERBOSE("Audio: Sound buffer ready");
+
+   return 0;
+}
+
+
+
+// Sound buffer of size bytes, filled by the emulation.
+void audio_init_buffer (dword size)
+{
+   CPC.snd_buffersize = size;
    pbSndBuffer = std::make_unique<byte[]>(CPC.snd_buffersize); // allocate the sound data buffer
    pbSndBufferEnd = pbSndBuffer.get() + CPC.snd_buffersize;
    memset(pbSndBuffer.get(), 0, CPC.snd_buffersize);
    CPC.snd_bufferptr = pbSndBuffer.get(); // init write cursor
-   CPC.snd_ready = true;
-   LOG_VERBOSE("Audio: Sound buffer ready");
 
    InitAY();
 
    for (int n = 0; n < 16; n++) {
       SetAYRegister(n, PSG.RegisterAY.Index[n]); // init sound emulation with valid values
    }
-
-   return 0;
 }
 
 
@@ -1436,6 +1567,31 @@ void audio_shutdown ()
 {
    SDL_CloseAudioDevice(audio_device_id);
    audio_device_id = 0;
+   if (audio_ring) {
+      LOG_VERBOSE("Audio: " << audio_ring->underruns() << " underruns, " << audio_ring->overruns() << " bytes dropped");
+      CPC.snd_ready = false;
+      audio_ring.reset();
+   }
+}
+
+
+
+// Hands the sound buffer just filled by the emulation over to the audio
+// callback.
+void audio_queue_buffer ()
+{
+   if (audio_ring) {
+      audio_ring->write(pbSndBuffer.get(), CPC.snd_buffersize);
+   }
+}
+
+
+
+// Whether enough sound is ready ahead of the audio callback for the emulation
+// to wait before producing more.
+bool audio_queue_full ()
+{
+   return audio_ring && audio_ring->available() > AUDIO_QUEUED_BUFFERS * CPC.snd_buffersize;
 }
 
 
@@ -1603,11 +1759,13 @@ void video_set_style ()
                }
                break;
    }
+   CPC.scr_render = render_simd_variant(CPC.scr_render);
 }
 
 
 void mouse_init ()
 {
+  if (args.headless) return;
   // hide the mouse cursor unless we emulate phazer
   ShowCursor(CPC.phazer_emulation);
 }
@@ -1615,7 +1773,14 @@ void mouse_init ()
 
 int video_init ()
 {
-   vid_plugin=&video_plugin_list[CPC.scr_style];
+   return video_init_plugin(args.headless ? &video_headless_plugin : &video_plugin_list[CPC.scr_style]);
+}
+
+
+
+int video_init_plugin (video_plugin* plugin)
+{
+   vid_plugin = plugin;
    LOG_DEBUG("video_init: vid_plugin = " << vid_plugin->name)
 
    back_surface=vid_plugin->init(vid_plugin, CPC.scr_scale, CPC.scr_window==0);
@@ -1789,10 +1954,13 @@ void loadConfiguration (t_CPC &CPC, const std::string& configFilename)
       CPC.model = 2;
    }
    CPC.jumpers = conf.getIntValue("system", "jumpers", 0x1e) & 0x1e; // OEM is Amstrad, video refresh is 50Hz
-   CPC.ram_size = conf.getIntValue("system", "ram_size", 128) & 0x02c0; // 128KB RAM
-   if (CPC.ram_size > 576) {
-      CPC.ram_size = 576;
-   } else if ((CPC.model >= 2) && (CPC.ram_size < 128)) {
+   CPC.ram_size = conf.getIntValue("system", "ram_size", 128) & ~0x3f; // 128KB RAM
+   if (CPC.ram_size > RAM_MAX_SIZE) {
+      CPC.ram_size = RAM_MAX_SIZE;
+   } else if (CPC.ram_size < 64) {
+      CPC.ram_size = 64;
+   }
+   if ((CPC.model >= 2) && (CPC.ram_size < 128)) {
       CPC.ram_size = 128; // minimum RAM size for CPC 6128 is 128KB
    }
    CPC.speed = conf.getIntValue("system", "speed", DEF_SPEED_SETTING); // original CPC speed
@@ -1802,6 +1970,7 @@ void loadConfiguration (t_CPC &CPC, const std::string& configFilename)
    CPC.limit_speed = conf.getIntValue("system", "limit_speed", 1) & 1;
    CPC.auto_pause = conf.getIntValue("system", "auto_pause", 1) & 1;
    CPC.boot_time = conf.getIntValue("system", "boot_time", 5);
+   CPC.rewind_size = conf.getIntValue("system", "rewind_size", 4096);
    CPC.printer = conf.getIntValue("system", "printer", 0) & 1;
    CPC.mf2 = conf.getIntValue("system", "mf2", 0) & 1;
    CPC.keyboard = conf.getIntValue("system", "keyboard", 0);
@@ -1854,6 +2023,7 @@ void loadConfiguration (t_CPC &CPC, const std::string& configFilename)
       CPC.snd_volume = 80;
    }
    CPC.snd_pp_device = conf.getIntValue("sound", "pp_device", 0) & 1;
+   CPC.snd_band_limited = conf.getIntValue("sound", "band_limited", 0) & 1;
 
    CPC.kbd_layout = conf.getStringValue("control", "kbd_layout", "keymap_us.map");
 
@@ -1879,6 +2049,10 @@ void loadConfiguration (t_CPC &CPC, const std::string& configFilename)
    }
    CPC.printer_file = conf.getStringValue("file", "printer_file", appPath + "/printer.dat");
    CPC.sdump_dir = conf.getStringValue("file", "sdump_dir", appPath + "/screenshots");
+   CPC.sdump_compression = conf.getIntValue("file", "sdump_compression", SCREENSHOT_COMPRESSION_DEFAULT);
+   if (CPC.sdump_compression > SCREENSHOT_COMPRESSION_MAX) {
+      CPC.sdump_compression = SCREENSHOT_COMPRESSION_DEFAULT;
+   }
 
    CPC.rom_path = conf.getStringValue("rom", "rom_path", appPath + "/rom/");
    for (int iRomNum = 0; iRomNum < 16; iRomNum++) { // loop for ROMs 0-15
@@ -1908,6 +2082,7 @@ bool saveConfiguration (t_CPC &CPC, const std::string& configFilename)
    conf.setIntValue("system", "mf2", CPC.mf2);
    conf.setIntValue("system", "keyboard", CPC.keyboard);
    conf.setIntValue("system", "boot_time", CPC.boot_time);
+   conf.setIntValue("system", "rewind_size", CPC.rewind_size);
    conf.setIntValue("system", "joystick_emulation", static_cast<int>(CPC.joystick_emulation));
    conf.setIntValue("system", "joysticks", CPC.joysticks);
    conf.setIntValue("system", "joystick_menu_button", CPC.joystick_menu_button + 1);
@@ -1937,6 +2112,7 @@ bool saveConfiguration (t_CPC &CPC, const std::string& configFilename)
    conf.setIntValue("sound", "stereo", CPC.snd_stereo);
    conf.setIntValue("sound", "volume", CPC.snd_volume);
    conf.setIntValue("sound", "pp_device", CPC.snd_pp_device);
+   conf.setIntValue("sound", "band_limited", CPC.snd_band_limited);
 
    conf.setStringValue("control", "kbd_layout", CPC.kbd_layout);
 
@@ -1953,6 +2129,7 @@ bool saveConfiguration (t_CPC &CPC, const std::string& configFilename)
    }
    conf.setStringValue("file", "printer_file", CPC.printer_file);
    conf.setStringValue("file", "sdump_dir", CPC.sdump_dir);
+   conf.setIntValue("file", "sdump_compression", CPC.sdump_compression);
 
    conf.setStringValue("rom", "rom_path", CPC.rom_path);
    for (int iRomNum = 0; iRomNum < 16; iRomNum++) { // loop for ROMs 0-15
@@ -2012,6 +2189,7 @@ void cleanupShowUI(SDL_Surface* guiBackSurface)
 
 bool userConfirmsQuitWithoutSaving()
 {
+   if (args.headless) return true;
    auto guiBackSurface = prepareShowUI();
    bool confirmed = false;
    // Show warning
@@ -2031,6 +2209,7 @@ bool userConfirmsQuitWithoutSaving()
 
 void showVKeyboard()
 {
+   if (args.headless) return;
    auto guiBackSurface = prepareShowUI();
    // Activate virtual keyboard
    try {
@@ -2050,6 +2229,7 @@ void showVKeyboard()
 
 void showGui()
 {
+   if (args.headless) return;
    auto guiBackSurface = prepareShowUI();
    try {
       CapriceGui capriceGui(mainSDLWindow, /*bInMainView=*/true);
@@ -2097,6 +2277,7 @@ void loadBreakpoints()
 
 bool showDevTools()
 {
+  if (args.headless) return false;
   // TODO: Find a clean way to restore the relative mouse mode when exiting all dev tools.
   // Alternatively, cleanly disable JoystickEmulation::Mouse mode here.
   SDL_SetRelativeMouseMode(SDL_bool(false));
@@ -2127,10 +2308,7 @@ void dumpScreen() {
    std::string dumpFile = "screenshot_" + getDateString() + ".png";
    std::string dumpPath = dir + "/" + dumpFile;
    LOG_INFO("Dumping screen to " + dumpPath);
-   if (SDL_SavePNG(back_surface, dumpPath)) {
-     LOG_ERROR("Could not write screenshot file to " + dumpPath);
-   }
-   else {
+   if (screenshot_save(back_surface, dumpPath, CPC.sdump_compression)) {
      set_osd_message("Captured " + dumpFile);
    }
 }
@@ -2167,12 +2345,64 @@ void loadSnapshot() {
    }
 }
 
+void rewindCapture() {
+   if (!CPC.rewind_size || dwFrameCountOverall < nextRewindFrameCount) return;
+   // Capture is not possible during FDC transfers, retry on next frame.
+   if (savestate_capture(rewind_state)) return;
+   rewind_buffer.push(rewind_state);
+   nextRewindFrameCount = dwFrameCountOverall + REWIND_INTERVAL_FRAMES;
+}
+
+void rewindEmulation() {
+   if (movie_active()) {
+     LOG_INFO("Rewinding ends the movie in progress");
+     movie_stop();
+   }
+   if (!rewind_buffer.pop(rewind_state)) {
+     set_osd_message("Rewind: no history");
+     return;
+   }
+   if (savestate_restore(rewind_state)) {
+     LOG_ERROR("Could not restore rewind state");
+     rewind_buffer.clear();
+     return;
+   }
+   nextRewindFrameCount = dwFrameCountOverall + REWIND_INTERVAL_FRAMES;
+   set_osd_message("Rewind: " + std::to_string(rewind_buffer.count()) + "s left");
+}
+
+// CAP32_ASSERTHASH compares the hash of the next complete frame with the next
+// one given with --expect_hash. Scripted regression checks can then do without
+// writing and comparing screenshots.
+void checkFrameHash(uint64_t hash) {
+   std::string hash_str = frame_hash_to_string(hash);
+   if (expectedHashesChecked >= args.expectedHashes.size()) {
+     LOG_INFO("Frame " << dwFrameCountOverall << " hash: " << hash_str);
+     return;
+   }
+   uint64_t expected = args.expectedHashes[expectedHashesChecked++];
+   if (hash != expected) {
+     LOG_ERROR("Frame " << dwFrameCountOverall << " hash is " << hash_str << ", expected " << frame_hash_to_string(expected));
+     cleanExit(1, false);
+   }
+   LOG_INFO("Frame " << dwFrameCountOverall << " hash matches " << hash_str);
+}
+
+uint64_t frame_finish(bool hash) {
+  asic_draw_sprites();
+  return hash ? frame_hash(back_surface) : 0;
+}
+
 bool driveAltered() {
   return driveA.altered || driveB.altered;
 }
 
 void doCleanUp ()
 {
+   movie_stop();
+   capture_stop();
+   capture_video_stop();
+   screenshot_flush();
    printer_stop();
    emulator_shutdown();
 
@@ -2190,6 +2420,11 @@ void doCleanUp ()
    }
    #endif
 
+   if (pfoHashLog) {
+     fclose(pfoHashLog);
+     pfoHashLog = nullptr;
+   }
+
    SDL_Quit();
 }
 
@@ -2198,6 +2433,10 @@ void cleanExit(int returnCode, bool askIfUnsaved)
    if (askIfUnsaved && driveAltered() && !userConfirmsQuitWithoutSaving()) {
      return;
    }
+   if (returnCode == 0 && expectedHashesChecked < args.expectedHashes.size()) {
+     LOG_ERROR("Exiting with " << args.expectedHashes.size() - expectedHashesChecked << " expected frame hash(es) not checked");
+     returnCode = 1;
+   }
    for (auto& devtool : devtools) {
      devtool.Deactivate();
    }
@@ -2708,6 +2947,7 @@ int cap32_main (int argc, char **argv)
 {
    int iExitCondition;
    bool take_screenshot = false;
+   bool check_frame_hash = false;
    bool bin_loaded = false;
    SDL_Event event;
    std::vector<std::string> slot_list;
@@ -2721,7 +2961,9 @@ int cap32_main (int argc, char **argv)
    }
    parseArguments(argc, argv, slot_list, args);
 
-   if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_TIMER | SDL_INIT_NOPARACHUTE) < 0) { // initialize SDL
+   // In headless mode, only events are needed: they carry the autocmd keystrokes.
+   Uint32 sdl_subsystems = args.headless ? SDL_INIT_EVENTS : (SDL_INIT_VIDEO | SDL_INIT_AUDIO);
+   if (SDL_Init(sdl_subsystems | SDL_INIT_TIMER | SDL_INIT_NOPARACHUTE) < 0) { // initialize SDL
       fprintf(stderr, "SDL_Init() failed: %s\n", SDL_GetError());
       exit(-1);
    }
@@ -2735,7 +2977,30 @@ int cap32_main (int argc, char **argv)
       strncpy(chAppPath,APP_PATH,_MAX_PATH);
    #endif
 
+   if (!args.batchFile.empty()) {
+      unsigned int workers = args.batchJobs ? args.batchJobs : std::max(1u, std::thread::hardware_concurrency());
+      int result = batch_run(args.batchFile, getConfigurationFilename(), workers);
+      SDL_Quit();
+      return result;
+   }
+   if (!args.videoToPngFile.empty()) {
+      std::string prefix = args.videoToPngFile;
+      size_t dot = prefix.rfind('.');
+      if (dot != std::string::npos && prefix.find('/', dot) == std::string::npos) {
+         prefix.erase(dot);
+      }
+      int result = capture_video_to_png(args.videoToPngFile, prefix);
+      SDL_Quit();
+      return result;
+   }
+
    loadConfiguration(CPC, getConfigurationFilename()); // retrieve the emulator configuration
+   if (args.headless) {
+      CPC.limit_speed = 0; // run flat out
+      CPC.snd_enabled = args.wavFile.empty() ? 0 : 1; // no audio device, only the sound capture
+      CPC.joysticks = 0;
+      CPC.auto_pause = 0;
+   }
    if (CPC.printer) {
       if (!printer_start()) { // start capturing printer output, if enabled
          CPC.printer = 0;
@@ -2788,6 +3053,31 @@ int cap32_main (int argc, char **argv)
    // Give some time to the CPC to start before sending any command
    nextVirtualEventFrameCount = dwFrameCountOverall + CPC.boot_time;
 
+   if (!args.recordFile.empty() && movie_record_start(args.recordFile)) {
+      fprintf(stderr, "Could not record the movie. Aborting.\n");
+      cleanExit(-1);
+   }
+   if (!args.replayFile.empty() && movie_replay_start(args.replayFile)) {
+      fprintf(stderr, "Could not replay the movie. Aborting.\n");
+      cleanExit(-1);
+   }
+   if (!args.wavFile.empty() && (!CPC.snd_enabled || capture_wav_start(args.wavFile))) {
+      fprintf(stderr, "Could not capture the sound. Aborting.\n");
+      cleanExit(-1);
+   }
+   if (!args.ymFile.empty() && capture_ym_start(args.ymFile)) {
+      fprintf(stderr, "Could not capture the AY registers. Aborting.\n");
+      cleanExit(-1);
+   }
+   if (!args.videoFile.empty() && capture_video_start(args.videoFile, back_surface)) {
+      fprintf(stderr, "Could not capture the video. Aborting.\n");
+      cleanExit(-1);
+   }
+   if (!args.hashLogFile.empty() && !(pfoHashLog = fopen(args.hashLogFile.c_str(), "w"))) {
+      fprintf(stderr, "Could not open the frame hash log. Aborting.\n");
+      cleanExit(-1);
+   }
+
 // ----------------------------------------------------------------------------
 
    update_timings();
@@ -2916,6 +3206,11 @@ int cap32_main (int argc, char **argv)
                            take_screenshot = true;
                            break;
 
+                        case CAP32_ASSERTHASH:
+                           // Same as the screenshot, checked once the frame is complete.
+                           check_frame_hash = true;
+                           break;
+
                         case CAP32_DELAY:
                            // Reuse boot_time as it is a reasonable wait time for Plus transition between the F1/F2 nag screen and the command line.
                            // TODO: Support an argument to CAP32_DELAY in autocmd instead.
@@ -2938,6 +3233,10 @@ int cap32_main (int argc, char **argv)
                            loadSnapshot();
                            break;
 
+                        case CAP32_REWIND:
+                           rewindEmulation();
+                           break;
+
                         case CAP32_TAPEPLAY:
                            LOG_VERBOSE("Request to play tape");
                            Tape_Rewind();
@@ -3182,11 +3481,11 @@ int cap32_main (int argc, char **argv)
 
          if (CPC.limit_speed) { // limit to original CPC speed?
             if (CPC.snd_enabled) {
-               if (iExitCondition == EC_SOUND_BUFFER) { // Emulation filled a sound buffer.
-                  if (!dwSndBufferCopied) {
-                     continue; // delay emulation until our audio callback copied and played the buffer
-                  }
-                  dwSndBufferCopied = 0;
+               if (iExitCondition == EC_SOUND_BUFFER && audio_queue_full()) { // Emulation filled a sound buffer.
+                  // Delay emulation until the audio callback played enough of
+                  // the queued ones, without spinning on it.
+                  std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+                  continue;
                }
             } else if (iExitCondition == EC_CYCLE_COUNT) {
                dwTicks = SDL_GetTicks();
@@ -3208,7 +3507,13 @@ int cap32_main (int argc, char **argv)
          }
          CPC.scr_pos = CPC.scr_base + dwOffset; // update current rendering position
 
+         movie_begin_execute();
          iExitCondition = z80_execute(); // run the emulation until an exit condition is met
+         movie_end_execute();
+         if (iExitCondition == EC_SOUND_BUFFER) {
+            audio_queue_buffer();
+            capture_sound_buffer(pbSndBuffer.get(), CPC.snd_buffersize);
+         }
 
          if (iExitCondition == EC_BREAKPOINT) {
             if (z80.breakpoint_reached || z80.watchpoint_reached) {
@@ -3237,6 +3542,18 @@ int cap32_main (int argc, char **argv)
          if (iExitCondition == EC_FRAME_COMPLETE) { // emulation finished rendering a complete frame?
             dwFrameCountOverall++;
             dwFrameCount++;
+            movie_frame_completed();
+            capture_frame_completed();
+            uint64_t hash = frame_finish(check_frame_hash || pfoHashLog);
+            if (pfoHashLog) {
+              fprintf(pfoHashLog, "%u %s\n", dwFrameCountOverall, frame_hash_to_string(hash).c_str());
+            }
+            if (check_frame_hash) {
+              check_frame_hash = false;
+              checkFrameHash(hash);
+            }
+            // Before the OSD and the FPS counter, which are not part of the CPC screen.
+            capture_video_frame(back_surface);
             if (SDL_GetTicks() < osd_timing) {
                print(static_cast<byte *>(back_surface->pixels) + CPC.scr_line_offs, osd_message.c_str(), true);
             } else if (CPC.scr_fps) {
@@ -3244,12 +3561,16 @@ int cap32_main (int argc, char **argv)
                sprintf(chStr, "%3dFPS %3d%%", static_cast<int>(dwFPS), static_cast<int>(dwFPS) * 100 / (1000 / static_cast<int>(FRAME_PERIOD_MS)));
                print(static_cast<byte *>(back_surface->pixels) + CPC.scr_line_offs, chStr, true); // display the frames per second counter
             }
-            asic_draw_sprites();
             video_display(); // update PC display
+            rewindCapture();
             if (take_screenshot) {
               dumpScreen();
               take_screenshot = false;
             }
+            if (args.maxFrames && dwFrameCountOverall >= args.maxFrames) {
+              LOG_INFO("Reached " << dwFrameCountOverall << " frames, exiting.");
+              cleanExit(0, false);
+            }
          }
       }
       else { // We are paused. No need to burn CPU cycles
@@ -33,6 +33,7 @@
 #include "phazer.h"
 
 class InputMapper;
+struct video_plugin;
 //#define DEBUG
 //#define DEBUG_CRTC
 //#define DEBUG_FDC
@@ -203,6 +204,7 @@ class t_CPC {
    bool paused;
    unsigned int auto_pause;
    unsigned int boot_time;
+   unsigned int rewind_size;    // memory budget of the rewind history in kB, 0 to disable it
    unsigned int keyboard_line;
    unsigned int tape_motor;
    unsigned int tape_play_button;
@@ -257,6 +259,7 @@ class t_CPC {
    unsigned int snd_stereo;
    unsigned int snd_volume;
    unsigned int snd_pp_device;
+   unsigned int snd_band_limited;
    unsigned int snd_buffersize;
    unsigned char *snd_bufferptr;
    union {
@@ -284,6 +287,7 @@ class t_CPC {
 
    std::string printer_file;
    std::string sdump_dir;
+   unsigned int sdump_compression;
 
    std::string rom_path;
    std::string rom_file[16];
@@ -363,6 +367,7 @@ typedef struct {
    bool registerPageOn;
    unsigned char RAM_bank;
    unsigned char RAM_config;
+   unsigned char RAM_ext; // 512KB block of the expansion, for more than 576KB of RAM
    unsigned char upper_ROM;
    unsigned int requested_scr_mode;
    unsigned int scr_mode;
@@ -428,23 +433,63 @@ typedef struct {
 
 using t_MemBankConfig = std::array<std::array<byte*, 4>, 8>;
 
+// Banks whose writes need more than storing the byte at membank_write (the
+// ASIC register page, the Multiface 2) have a handler doing the whole write
+// instead. The other ones have none, so a write only costs a pointer test.
+using t_WriteHandler = void (*)(word addr, byte val);
+
+// Dirty page tracking of the RAM.
+// Every write to a 4KB page of pbRAM stamps it with ram_write_stamp. A client
+// (save states, devtools...) takes a checkpoint and later asks which pages were
+// written to since, so that it only needs to look at those.
+#define RAM_PAGE_SHIFT 12
+#define RAM_PAGE_SIZE  (1 << RAM_PAGE_SHIFT)
+#define RAM_MAX_SIZE   (64 + 4096) // KB: the base 64KB and a 4MB expansion
+#define RAM_MAX_PAGES  (RAM_MAX_SIZE*1024 / RAM_PAGE_SIZE)
+// The stamps and ram_mark_write, to be called on each write through
+// membank_write, are in machinestate.h.
+// To be called when writing to pbRAM directly.
+void ram_mark_dirty(size_t offset, size_t size);
+void ram_mark_all_dirty();
+// Pages written to from now on will be reported as dirty for the returned checkpoint.
+dword ram_dirty_checkpoint();
+bool ram_page_written_since(unsigned int page, dword checkpoint);
+// To be called whenever membank_write is modified.
+void ram_update_write_pages();
+
 // cap32.cpp
 void set_osd_message(const std::string& message, uint32_t for_milliseconds = 1000);
 void ga_init_banking(t_MemBankConfig& membank_config, unsigned char RAM_bank);
+// Precomputes the banking map of every 64KB bank of the expansion RAM into
+// membank_configs, and selects the one of GateArray.RAM_bank. To be called
+// whenever pbRAM or CPC.ram_size change.
+void ga_init_banking_tables();
+void ga_memory_manager();
 bool driveAltered();
+// Completes the picture of a frame the emulation just finished rendering (the
+// Plus hardware sprites are drawn over it) and returns its frame_hash, or 0 if
+// hash is false. Nothing of the emulator itself (OSD, FPS) must be drawn on the
+// surface before, so that the hash only depends on the emulated machine.
+uint64_t frame_finish(bool hash);
 void emulator_reset();
 int  emulator_init();
+void emulator_shutdown();
 int  video_set_palette();
 void init_joystick_emulation();
 void update_cpc_speed();
 int  printer_start();
 void printer_stop();
 int audio_init ();
+void audio_init_buffer (dword size);
 void audio_shutdown ();
 void audio_pause ();
 void audio_resume ();
+void audio_queue_buffer ();
+bool audio_queue_full ();
 void mouse_init ();
 int video_init ();
+// Same as video_init, with the given plugin instead of the configured one.
+int video_init_plugin (video_plugin* plugin);
 void video_shutdown ();
 void cleanExit(int returnCode, bool askIfUnsaved = true);
 
@@ -474,6 +519,12 @@ void Calculate_Level_Tables();
 void ResetAYChipEmulation();
 void InitAYCounterVars();
 void InitAY();
+// Renders the samples the block synthesizer has not produced yet.
+void AY_flush();
+// Size and raw copy of the synthesizer state not held in t_PSG, for save states.
+size_t AY_state_size();
+void AY_save_state(byte *dst);
+void AY_load_state(const byte *src);
 
 double *video_get_green_palette(int mode);
 double *video_get_rgb_color(int color);
@@ -0,0 +1,279 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Capture of the sound of the emulated CPC.
+*/
+
+#include "capture.h"
+
+#include <memory>
+#include "cap32.h"
+#include "errors.h"
+#include "log.h"
+#include "machinestate.h"
+
+extern thread_local t_CPC CPC;
+extern dword freq_table[];
+
+CaptureWriter::CaptureWriter(FILE *file, size_t max_queued) : file(file), max_queued(max_queued), thread(&CaptureWriter::loop, this)
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+   close();
+}
+
+bool CaptureWriter::close()
+{
+   if (thread.joinable()) {
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         stopping = true;
+      }
+      cv.notify_one();
+      thread.join();
+      if (fclose(file)) {
+         write_failed = true;
+      }
+   }
+   return !write_failed;
+}
+
+bool CaptureWriter::write(std::vector<byte> data)
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (queued + data.size() > max_queued) {
+         dropped_bytes.fetch_add(data.size(), std::memory_order_relaxed);
+         return false;
+      }
+      queued += data.size();
+      chunks.push_back({-1, std::move(data)});
+   }
+   cv.notify_one();
+   return true;
+}
+
+void CaptureWriter::rewrite(long offset, std::vector<byte> data)
+{
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      chunks.push_back({offset, std::move(data)});
+   }
+   cv.notify_one();
+}
+
+void CaptureWriter::loop()
+{
+   while (true) {
+      Chunk chunk;
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         cv.wait(lock, [this]() { return stopping || !chunks.empty(); });
+         if (chunks.empty()) {
+            return;
+         }
+         chunk = std::move(chunks.front());
+         chunks.pop_front();
+         if (chunk.offset < 0) {
+            queued -= chunk.data.size();
+         }
+      }
+      if (chunk.offset >= 0 && fseek(file, chunk.offset, SEEK_SET)) {
+         write_failed = true;
+      }
+      if (!chunk.data.empty() && fwrite(chunk.data.data(), chunk.data.size(), 1, file) != 1) {
+         write_failed = true;
+      }
+      if (chunk.offset >= 0) {
+         fseek(file, 0, SEEK_END);
+      }
+   }
+}
+
+
+
+namespace
+{
+
+// About 45s of stereo 16 bits sound at 44.1kHz, and 20 minutes of YM frames.
+const size_t WAV_MAX_QUEUED = 8 * 1024 * 1024;
+const size_t YM_MAX_QUEUED = 1024 * 1024;
+const size_t WAV_HEADER_SIZE = 44;
+const char YM_SONG_INFO[] = "\0\0Recorded with Caprice32";
+const size_t YM_FRAMES_OFFSET = 12;
+const int YM_REGISTERS = 16;
+
+thread_local std::unique_ptr<CaptureWriter> wav_writer;
+thread_local std::string wav_filename;
+thread_local unsigned int wav_rate, wav_channels, wav_bits;
+thread_local dword wav_data_size;
+
+thread_local std::unique_ptr<CaptureWriter> ym_writer;
+thread_local std::string ym_filename;
+thread_local dword ym_frames;
+thread_local bool ym_envelope_written;
+
+void put_le(std::vector<byte>& out, dword val, int size)
+{
+   for (int i = 0; i < size; i++) {
+      out.push_back(val >> (8 * i));
+   }
+}
+
+void put_be(std::vector<byte>& out, dword val, int size)
+{
+   for (int i = size - 1; i >= 0; i--) {
+      out.push_back(val >> (8 * i));
+   }
+}
+
+std::vector<byte> wav_header()
+{
+   std::vector<byte> header;
+   dword block_align = wav_channels * wav_bits / 8;
+   header.insert(header.end(), { 'R', 'I', 'F', 'F' });
+   put_le(header, WAV_HEADER_SIZE - 8 + wav_data_size, 4);
+   header.insert(header.end(), { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+   put_le(header, 16, 4); // size of the format chunk
+   put_le(header, 1, 2); // PCM
+   put_le(header, wav_channels, 2);
+   put_le(header, wav_rate, 4);
+   put_le(header, wav_rate * block_align, 4);
+   put_le(header, block_align, 2);
+   put_le(header, wav_bits, 2);
+   header.insert(header.end(), { 'd', 'a', 't', 'a' });
+   put_le(header, wav_data_size, 4);
+   return header;
+}
+
+// Uncompressed YM6, frames not interleaved so that they can be streamed.
+std::vector<byte> ym_header()
+{
+   std::vector<byte> header;
+   header.insert(header.end(), { 'Y', 'M', '6', '!', 'L', 'e', 'O', 'n', 'A', 'r', 'D', '!' });
+   put_be(header, ym_frames, 4);
+   put_be(header, 0, 4); // attributes: not interleaved
+   put_be(header, 0, 2); // digidrums
+   put_be(header, 1000000, 4); // AY clock of the CPC
+   put_be(header, 50, 2); // frames per second
+   put_be(header, 0, 4); // loop frame
+   put_be(header, 0, 2); // additional data
+   header.insert(header.end(), YM_SONG_INFO, YM_SONG_INFO + sizeof(YM_SONG_INFO)); // name, author, comment
+   return header;
+}
+
+FILE *open_capture_file(const std::string& filename)
+{
+   FILE *file = fopen(filename.c_str(), "wb");
+   if (!file) {
+      LOG_ERROR("Could not open " << filename << " for writing");
+   }
+   return file;
+}
+
+void stop_writer(std::unique_ptr<CaptureWriter>& writer, const std::string& filename)
+{
+   if (!writer->close()) {
+      LOG_ERROR("Could not write " << filename);
+   }
+   if (writer->droppedBytes()) {
+      LOG_ERROR("Capture to " << filename << " could not keep up: " << writer->droppedBytes() << " bytes dropped");
+   }
+   writer.reset();
+}
+
+}
+
+int capture_wav_start(const std::string& filename)
+{
+   if (wav_writer) {
+      stop_writer(wav_writer, wav_filename);
+   }
+   FILE *file = open_capture_file(filename);
+   if (!file) {
+      return ERR_CAPTURE_WRITE;
+   }
+   wav_filename = filename;
+   wav_rate = freq_table[CPC.snd_playback_rate];
+   wav_channels = CPC.snd_stereo + 1;
+   wav_bits = CPC.snd_bits ? 16 : 8;
+   wav_data_size = 0;
+   wav_writer = std::make_unique<CaptureWriter>(file, WAV_MAX_QUEUED);
+   wav_writer->write(wav_header());
+   LOG_INFO("Capturing the sound to " << filename);
+   return 0;
+}
+
+int capture_ym_start(const std::string& filename)
+{
+   if (ym_writer) {
+      stop_writer(ym_writer, ym_filename);
+   }
+   FILE *file = open_capture_file(filename);
+   if (!file) {
+      return ERR_CAPTURE_WRITE;
+   }
+   ym_filename = filename;
+   ym_frames = 0;
+   ym_envelope_written = true; // the first frame sets the envelope
+   ym_writer = std::make_unique<CaptureWriter>(file, YM_MAX_QUEUED);
+   ym_writer->write(ym_header());
+   LOG_INFO("Capturing the AY registers to " << filename);
+   return 0;
+}
+
+void capture_stop()
+{
+   if (wav_writer) {
+      wav_writer->rewrite(0, wav_header());
+      stop_writer(wav_writer, wav_filename);
+   }
+   if (ym_writer) {
+      ym_writer->write({ 'E', 'n', 'd', '!' });
+      std::vector<byte> frames;
+      put_be(frames, ym_frames, 4);
+      ym_writer->rewrite(YM_FRAMES_OFFSET, frames);
+      stop_writer(ym_writer, ym_filename);
+   }
+}
+
+bool capture_active()
+{
+   return wav_writer || ym_writer;
+}
+
+void capture_sound_buffer(const byte *data, size_t size)
+{
+   if (!wav_writer) return;
+   if (freq_table[CPC.snd_playback_rate] != wav_rate || CPC.snd_stereo + 1 != wav_channels || (CPC.snd_bits ? 16u : 8u) != wav_bits) {
+      LOG_ERROR("Sound format changed: stopping the capture to " << wav_filename);
+      wav_writer->rewrite(0, wav_header());
+      stop_writer(wav_writer, wav_filename);
+      return;
+   }
+   if (wav_writer->write(std::vector<byte>(data, data + size))) {
+      wav_data_size += size;
+   }
+}
+
+void capture_ay_register(int num)
+{
+   if (num == 13) {
+      ym_envelope_written = true;
+   }
+}
+
+void capture_frame_completed()
+{
+   if (!ym_writer) return;
+   std::vector<byte> frame(PSG.RegisterAY.Index, PSG.RegisterAY.Index + YM_REGISTERS);
+   if (!ym_envelope_written) {
+      frame[13] = 0xff; // don't restart the envelope
+   }
+   frame[14] = frame[15] = 0; // no YM6 special effects
+   ym_envelope_written = false;
+   if (ym_writer->write(std::move(frame))) {
+      ym_frames++;
+   }
+}
@@ -0,0 +1,82 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Capture of the sound of the emulated CPC: the output of the sound emulation
+   to a WAV file, and the AY registers, once per frame, to a YM6 file.
+   Files are written by a background thread, so that the emulation never waits
+   for the disk: if the disk can't keep up, what does not fit in the queue is
+   dropped (and reported when the capture stops) rather than slowing down the
+   emulation.
+*/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "types.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CaptureWriter {
+  public:
+    // Takes ownership of file. At most max_queued bytes wait to be written.
+    CaptureWriter(FILE *file, size_t max_queued);
+    // Closes the file if not done yet.
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    // Appends data to the file. Returns false if it had to be dropped because
+    // the queue is full.
+    bool write(std::vector<byte> data);
+    // Overwrites the file at offset, once what was queued before is written
+    // (e.g. a header completed at the end). Never dropped.
+    void rewrite(long offset, std::vector<byte> data);
+
+    // Writes what is queued and closes the file. Returns false if writing to
+    // the file failed.
+    bool close();
+
+    uint64_t droppedBytes() const { return dropped_bytes.load(std::memory_order_relaxed); }
+
+  private:
+    struct Chunk {
+      long offset; // -1 to append
+      std::vector<byte> data;
+    };
+    void loop();
+
+    FILE *file;
+    const size_t max_queued;
+    size_t queued = 0;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Chunk> chunks;
+    bool stopping = false;
+    std::atomic<uint64_t> dropped_bytes{0};
+    std::atomic<bool> write_failed{false};
+    std::thread thread;
+};
+
+// Starts writing the sound produced by the emulation to filename, in the
+// current sample format. Returns 0 or an error code.
+int capture_wav_start(const std::string& filename);
+// Starts writing the AY registers to filename. Returns 0 or an error code.
+int capture_ym_start(const std::string& filename);
+// Completes the files being written and waits for them to be written.
+void capture_stop();
+bool capture_active();
+
+// To be called with each sound buffer filled by the emulation.
+void capture_sound_buffer(const byte *data, size_t size);
+// To be called with each write to an AY register.
+void capture_ay_register(int num);
+// To be called when the emulation completes a frame.
+void capture_frame_completed();
+
+#endif
@@ -8,15 +8,15 @@
 #include <algorithm>
 #include <memory>
 #include <string>
+#include "machinestate.h"
 
 const uint32_t CARTRIDGE_NB_PAGES = 32;
 const uint32_t CARTRIDGE_PAGE_SIZE = 16*1024;
 const uint32_t CARTRIDGE_MAX_SIZE = CARTRIDGE_NB_PAGES*CARTRIDGE_PAGE_SIZE;
 
-std::unique_ptr<byte[]> pbCartridgeImage = nullptr;
-byte *pbCartridgePages[CARTRIDGE_NB_PAGES] = { nullptr };
+thread_local std::unique_ptr<byte[]> pbCartridgeImage = nullptr;
+thread_local byte *pbCartridgePages[CARTRIDGE_NB_PAGES] = { nullptr };
 
-extern byte* pbROMlo;
 
 void cpr_eject ()
 {
@@ -21,21 +21,27 @@
 */
 
 #include <math.h>
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define CRTC_AVX2
+#endif
 
 #include "cap32.h"
 #include "crtc.h"
 #include "z80.h"
 #include "log.h"
 #include "asic.h"
+#include "machinestate.h"
 
-extern t_CPC CPC;
-extern t_CRTC CRTC;
-extern t_GateArray GateArray;
-extern t_VDU VDU;
-extern t_z80regs z80;
+extern thread_local t_CPC CPC;
 
-extern dword dwXScale;
-extern byte *pbRAM;
+extern thread_local dword dwXScale;
 
 #ifdef DEBUG_CRTC
 extern dword dwDebugFlag;
@@ -53,28 +59,8 @@ extern FILE *pfoDebug;
 #define MIN_VHOLD_RANGE 46
 #define MAX_VHOLD_RANGE 74
 
-t_flags1 flags1;
-t_new_dt new_dt;
-
-dword LastPreRend;
-word MinVSync, MaxVSync;
-int iMonHSPeakPos, iMonHSStartPos, iMonHSEndPos, iMonHSPeakToStart, iMonHSStartToPeak, iMonHSEndToPeak, iMonHSPeakToEnd;
-int HorzPos, MonHSYNC, MonFreeSync;
-int HSyncDuration, MinHSync, MaxHSync;
-int HadP;
-byte PosShift, HorzChar, HorzMax;
-
-dword *ModeMaps[4];
-dword *ModeMap;
-byte HorzPix[49];
-byte RendBuff[800];
-byte *RendWid, *RendOut;
-dword *RendStart, *RendPos;
-
 word MAXlate[0x7400];
 
-void (*PreRender)();
-
 // Version 2 translation tables - static
 dword M0Map[0x200] = {
    0x00000000,0x00000000,0x00000000,0x08080808,0x08080808,0x00000000,0x08080808,0x08080808,
@@ -845,12 +831,19 @@ dword shiftLittleEndianDwordTriplet(dword val1, dword val2, dword val3, unsigned
 
 void prerender_normal()
 {
+#ifdef __SSE2__
+   // Both ModeMap entries (2 dwords each) in a single store.
+   __m128i val1 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ModeMap + (getRAMByte(CRTC.next_address) * 2)));
+   __m128i val2 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ModeMap + (getRAMByte(CRTC.next_address + 1) * 2)));
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(RendPos), _mm_unpacklo_epi64(val1, val2));
+#else
    byte bVidMem = getRAMByte(CRTC.next_address);
    *RendPos = *(ModeMap + (bVidMem * 2));
    *(RendPos + 1) = *(ModeMap + (bVidMem * 2) + 1);
    bVidMem = getRAMByte(CRTC.next_address + 1);
    *(RendPos + 2) = *(ModeMap + (bVidMem * 2));
    *(RendPos + 3) = *(ModeMap + (bVidMem * 2) + 1);
+#endif
    RendPos += 4;
 }
 
@@ -867,6 +860,17 @@ void prerender_normal_plus()
          next_address -= ((CRTC.registers[9] + 1 - asic.vscroll) * 0x0800);
       }
    }
+#ifdef __SSE2__
+   // The 16 pixels are the bytes from 8 - byteShift of the ModeMap entries of
+   // the 3 video bytes put one after the other: each half is made of 2 shifted
+   // entries, both halves are shifted at once.
+   __m128i entry1 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ModeMap + (getRAMByte(next_address - byteOffset - 1) * 2)));
+   __m128i entry2 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ModeMap + (getRAMByte(next_address - byteOffset) * 2)));
+   __m128i entry3 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(ModeMap + (getRAMByte(next_address - byteOffset + 1) * 2)));
+   __m128i high = _mm_sll_epi64(_mm_unpacklo_epi64(entry2, entry3), _mm_cvtsi32_si128(8 * byteShift));
+   __m128i low = _mm_srl_epi64(_mm_unpacklo_epi64(entry1, entry2), _mm_cvtsi32_si128(64 - 8 * byteShift));
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(RendPos), _mm_or_si128(high, low));
+#else
    byte bVidMem1 = getRAMByte(next_address - byteOffset - 1);
    byte bVidMem2 = getRAMByte(next_address - byteOffset);
    dword val1, val2, val3, val4;
@@ -884,6 +888,7 @@ void prerender_normal_plus()
    val4 = *(ModeMap + (bVidMem1 * 2) + 1);
    *(RendPos + 2) = shiftLittleEndianDwordTriplet(val1, val2, val3, byteShift);
    *(RendPos + 3) = shiftLittleEndianDwordTriplet(val2, val3, val4, byteShift);
+#endif
 
    RendPos += 4;
 }
@@ -952,12 +957,16 @@ unsigned int getPixel()
 
 
 
+// The render functions, like the other per character code, take a reference to
+// CPC once: being thread local with a non trivial type, each access to it
+// otherwise goes through its initialization check.
 void render8bpp()
 {
+   t_CPC& cpc = CPC;
    byte bCount = *RendWid++;
    while (bCount--) {
       byte val = getPixel();
-      *CPC.scr_pos++ = val;
+      *cpc.scr_pos++ = val;
    }
 }
 
@@ -965,11 +974,12 @@ void render8bpp()
 
 void render8bpp_doubleY()
 {
+   t_CPC& cpc = CPC;
    byte bCount = *RendWid++;
    while (bCount--) {
       byte val = getPixel();
-      *(CPC.scr_pos + CPC.scr_bps) = val;
-      *CPC.scr_pos++ = val;
+      *(cpc.scr_pos + cpc.scr_bps) = val;
+      *cpc.scr_pos++ = val;
    }
 }
 
@@ -977,11 +987,12 @@ void render8bpp_doubleY()
 
 void render16bpp()
 {
+   t_CPC& cpc = CPC;
    byte bCount = *RendWid++;
    while (bCount--) {
       word val = getPixel();
-      *reinterpret_cast<word*>(CPC.scr_pos) = val;
-      CPC.scr_pos += 2;
+      *reinterpret_cast<word*>(cpc.scr_pos) = val;
+      cpc.scr_pos += 2;
    }
 }
 
@@ -989,12 +1000,13 @@ void render16bpp()
 
 void render16bpp_doubleY()
 {
+   t_CPC& cpc = CPC;
    byte bCount = *RendWid++;
    while (bCount--) {
       word val = getPixel();
-      *reinterpret_cast<word*>(CPC.scr_pos) = val;
-      *(reinterpret_cast<word*>(CPC.scr_pos + CPC.scr_bps)) = val;
-      CPC.scr_pos += 2;
+      *reinterpret_cast<word*>(cpc.scr_pos) = val;
+      *(reinterpret_cast<word*>(cpc.scr_pos + cpc.scr_bps)) = val;
+      cpc.scr_pos += 2;
    }
 }
 
@@ -1002,12 +1014,13 @@ void render16bpp_doubleY()
 
 void render24bpp()
 {
+   t_CPC& cpc = CPC;
    byte bCount = *RendWid++;
    while (bCount--) {
       dword val = getPixel();
-      *reinterpret_cast<word *>(CPC.scr_pos) = static_cast<word>(val);
-      *(CPC.scr_pos + 2) = static_cast<byte>(val >> 16);
-      CPC.scr_pos += 3;
+      *reinterpret_cast<word *>(cpc.scr_pos) = static_cast<word>(val);
+      *(cpc.scr_pos + 2) = static_cast<byte>(val >> 16);
+      cpc.scr_pos += 3;
    }
 }
 
@@ -1015,16 +1028,17 @@ void render24bpp()
 
 void render24bpp_doubleY()
 {
+   t_CPC& cpc = CPC;
    byte bCount = *RendWid++;
    while (bCount--) {
       dword val = getPixel();
-      *reinterpret_cast<word *>(CPC.scr_pos + CPC.scr_bps) = static_cast<word>(val);
-      *reinterpret_cast<word *>(CPC.scr_pos) = static_cast<word>(val);
+      *reinterpret_cast<word *>(cpc.scr_pos + cpc.scr_bps) = static_cast<word>(val);
+      *reinterpret_cast<word *>(cpc.scr_pos) = static_cast<word>(val);
       val >>= 16;
-      CPC.scr_pos += 2;
-      *(CPC.scr_pos + CPC.scr_bps) = static_cast<byte>(val);
-      *(CPC.scr_pos) = static_cast<byte>(val);
-      CPC.scr_pos++;
+      cpc.scr_pos += 2;
+      *(cpc.scr_pos + cpc.scr_bps) = static_cast<byte>(val);
+      *(cpc.scr_pos) = static_cast<byte>(val);
+      cpc.scr_pos++;
    }
 }
 
@@ -1032,11 +1046,12 @@ void render24bpp_doubleY()
 
 void render32bpp()
 {
+   t_CPC& cpc = CPC;
    byte bCount = *RendWid++;
    while (bCount--) {
       dword val = getPixel();
-      *reinterpret_cast<dword*>(CPC.scr_pos) = val;
-      CPC.scr_pos += 4;
+      *reinterpret_cast<dword*>(cpc.scr_pos) = val;
+      cpc.scr_pos += 4;
    }
 }
 
@@ -1044,40 +1059,357 @@ void render32bpp()
 
 void render32bpp_doubleY()
 {
+   t_CPC& cpc = CPC;
    byte bCount = *RendWid++;
    while (bCount--) {
       dword val = getPixel();
-      *reinterpret_cast<dword*>(CPC.scr_pos) = val;
-      *(reinterpret_cast<dword*>(CPC.scr_pos + CPC.scr_bps)) = val;
-      CPC.scr_pos += 4;
+      *reinterpret_cast<dword*>(cpc.scr_pos) = val;
+      *(reinterpret_cast<dword*>(cpc.scr_pos + cpc.scr_bps)) = val;
+      cpc.scr_pos += 4;
+   }
+}
+
+
+
+#ifdef CRTC_AVX2
+// AVX2 variants of the render functions: palette lookups are done 8 pixels at a
+// time with a gather, the remaining pixels of the character go through the
+// scalar code.
+
+__attribute__((target("avx2"))) static inline __m256i getPixels8()
+{
+   __m256i indexes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(RendOut)));
+   RendOut += 8;
+   return _mm256_i32gather_epi32(reinterpret_cast<const int*>(GateArray.palette), indexes, 4);
+}
+
+// Low byte of each pixel, in the low 8 bytes.
+__attribute__((target("avx2"))) static inline __m128i getPixels8_8bpp()
+{
+   const __m256i low_bytes = _mm256_setr_epi8(
+         0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+         0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+   __m256i val = _mm256_shuffle_epi8(getPixels8(), low_bytes);
+   return _mm_unpacklo_epi32(_mm256_castsi256_si128(val), _mm256_extracti128_si256(val, 1));
+}
+
+// Stores the 3 low bytes of each pixel, without writing past the 24 bytes.
+__attribute__((target("avx2"))) static inline void storePixels8_24bpp(byte *pos, __m256i val)
+{
+   const __m256i low_3_bytes = _mm256_setr_epi8(
+         0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+         0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+   val = _mm256_shuffle_epi8(val, low_3_bytes);
+   __m128i high = _mm256_extracti128_si256(val, 1);
+   _mm_storeu_si128(reinterpret_cast<__m128i*>(pos), _mm256_castsi256_si128(val));
+   _mm_storel_epi64(reinterpret_cast<__m128i*>(pos + 12), high);
+   dword last = _mm_cvtsi128_si32(_mm_srli_si128(high, 8));
+   memcpy(pos + 20, &last, 4);
+}
+
+__attribute__((target("avx2"))) void render8bpp_avx2()
+{
+   byte bCount = *RendWid++;
+   for (; bCount >= 8; bCount -= 8) {
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(CPC.scr_pos), getPixels8_8bpp());
+      CPC.scr_pos += 8;
+   }
+   while (bCount--) {
+      *CPC.scr_pos++ = getPixel();
+   }
+}
+
+__attribute__((target("avx2"))) void render8bpp_doubleY_avx2()
+{
+   byte bCount = *RendWid++;
+   for (; bCount >= 8; bCount -= 8) {
+      __m128i val = getPixels8_8bpp();
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(CPC.scr_pos), val);
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(CPC.scr_pos + CPC.scr_bps), val);
+      CPC.scr_pos += 8;
+   }
+   while (bCount--) {
+      byte val = getPixel();
+      *(CPC.scr_pos + CPC.scr_bps) = val;
+      *CPC.scr_pos++ = val;
+   }
+}
+
+__attribute__((target("avx2"))) static inline __m128i getPixels8_16bpp()
+{
+   __m256i val = getPixels8();
+   return _mm_packus_epi32(_mm256_castsi256_si128(val), _mm256_extracti128_si256(val, 1));
+}
+
+__attribute__((target("avx2"))) void render16bpp_avx2()
+{
+   t_CPC& cpc = CPC;
+   byte bCount = *RendWid++;
+   for (; bCount >= 8; bCount -= 8) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(cpc.scr_pos), getPixels8_16bpp());
+      cpc.scr_pos += 16;
+   }
+   while (bCount--) {
+      word val = getPixel();
+      *reinterpret_cast<word*>(cpc.scr_pos) = val;
+      cpc.scr_pos += 2;
    }
 }
 
+__attribute__((target("avx2"))) void render16bpp_doubleY_avx2()
+{
+   t_CPC& cpc = CPC;
+   byte bCount = *RendWid++;
+   for (; bCount >= 8; bCount -= 8) {
+      __m128i val = getPixels8_16bpp();
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(cpc.scr_pos), val);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(cpc.scr_pos + cpc.scr_bps), val);
+      cpc.scr_pos += 16;
+   }
+   while (bCount--) {
+      word val = getPixel();
+      *reinterpret_cast<word*>(cpc.scr_pos) = val;
+      *(reinterpret_cast<word*>(cpc.scr_pos + cpc.scr_bps)) = val;
+      cpc.scr_pos += 2;
+   }
+}
+
+__attribute__((target("avx2"))) void render24bpp_avx2()
+{
+   byte bCount = *RendWid++;
+   for (; bCount >= 8; bCount -= 8) {
+      storePixels8_24bpp(CPC.scr_pos, getPixels8());
+      CPC.scr_pos += 24;
+   }
+   while (bCount--) {
+      dword val = getPixel();
+      *reinterpret_cast<word *>(CPC.scr_pos) = static_cast<word>(val);
+      *(CPC.scr_pos + 2) = static_cast<byte>(val >> 16);
+      CPC.scr_pos += 3;
+   }
+}
+
+__attribute__((target("avx2"))) void render24bpp_doubleY_avx2()
+{
+   byte bCount = *RendWid++;
+   for (; bCount >= 8; bCount -= 8) {
+      __m256i val = getPixels8();
+      storePixels8_24bpp(CPC.scr_pos, val);
+      storePixels8_24bpp(CPC.scr_pos + CPC.scr_bps, val);
+      CPC.scr_pos += 24;
+   }
+   while (bCount--) {
+      dword val = getPixel();
+      *reinterpret_cast<word *>(CPC.scr_pos + CPC.scr_bps) = static_cast<word>(val);
+      *reinterpret_cast<word *>(CPC.scr_pos) = static_cast<word>(val);
+      *(CPC.scr_pos + CPC.scr_bps + 2) = static_cast<byte>(val >> 16);
+      *(CPC.scr_pos + 2) = static_cast<byte>(val >> 16);
+      CPC.scr_pos += 3;
+   }
+}
+
+__attribute__((target("avx2"))) void render32bpp_avx2()
+{
+   t_CPC& cpc = CPC;
+   byte bCount = *RendWid++;
+   for (; bCount >= 8; bCount -= 8) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(cpc.scr_pos), getPixels8());
+      cpc.scr_pos += 32;
+   }
+   while (bCount--) {
+      dword val = getPixel();
+      *reinterpret_cast<dword*>(cpc.scr_pos) = val;
+      cpc.scr_pos += 4;
+   }
+}
+
+__attribute__((target("avx2"))) void render32bpp_doubleY_avx2()
+{
+   t_CPC& cpc = CPC;
+   byte bCount = *RendWid++;
+   for (; bCount >= 8; bCount -= 8) {
+      __m256i val = getPixels8();
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(cpc.scr_pos), val);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(cpc.scr_pos + cpc.scr_bps), val);
+      cpc.scr_pos += 32;
+   }
+   while (bCount--) {
+      dword val = getPixel();
+      *reinterpret_cast<dword*>(cpc.scr_pos) = val;
+      *(reinterpret_cast<dword*>(cpc.scr_pos + cpc.scr_bps)) = val;
+      cpc.scr_pos += 4;
+   }
+}
+#endif
+
+
+
+bool render_avx2_supported()
+{
+#ifdef CRTC_AVX2
+   __builtin_cpu_init(); // may be called before the constructors
+   return __builtin_cpu_supports("avx2");
+#else
+   return false;
+#endif
+}
+
+
+
+void (*render_simd_variant(void (*render)()))()
+{
+#ifdef CRTC_AVX2
+   if (render_avx2_supported()) {
+      if (render == render8bpp) return render8bpp_avx2;
+      if (render == render8bpp_doubleY) return render8bpp_doubleY_avx2;
+      if (render == render16bpp) return render16bpp_avx2;
+      if (render == render16bpp_doubleY) return render16bpp_doubleY_avx2;
+      if (render == render24bpp) return render24bpp_avx2;
+      if (render == render24bpp_doubleY) return render24bpp_doubleY_avx2;
+      if (render == render32bpp) return render32bpp_avx2;
+      if (render == render32bpp_doubleY) return render32bpp_doubleY_avx2;
+   }
+#endif
+   return render;
+}
+
+
+
+// Number of characters (up to max_chars) from the current position during
+// which the CRTC does nothing else than fetching and rendering video memory:
+// no register match, no HSYNC (neither from the CRTC nor from the monitor), no
+// scan line change and no pending delayed instruction.
+// Registers can only be changed by the Z80 between two calls to crtc_cycle, so
+// this only holds for the current call.
+int crtc_quiet_chars(int max_chars)
+{
+#ifdef DEBUG_CRTC
+   if (dwDebugFlag) {
+      return 0; // trace every character
+   }
+#endif
+   if (CPC.phazer_pressed || flags1.inHSYNC || CRTC.flag_newscan ||
+       CRTC.CharInstSL != NoChar || CRTC.CharInstMR != NoChar) {
+      return 0;
+   }
+   unsigned int count = CRTC.char_count;
+   if (count == CRTC.registers[0]) {
+      return 0;
+   }
+   // The character counter must not match (nor wrap around) on any of the
+   // characters of the run.
+   unsigned int next_match = 256;
+   for (unsigned int match : { static_cast<unsigned int>(CRTC.registers[0]), static_cast<unsigned int>(CRTC.registers[1]),
+                               static_cast<unsigned int>(CRTC.registers[2]), CRTC.hstart, CRTC.hend }) {
+      if (match > count && match < next_match) {
+         next_match = match;
+      }
+   }
+   int chars = std::min(max_chars, static_cast<int>(next_match - count - 1));
+   // Nor must the monitor start a new line.
+   if (MonHSYNC <= HorzPos) {
+      return 0;
+   }
+   return std::min(chars, (MonHSYNC - HorzPos - 1) >> 8);
+}
+
+
+// Whether the CRTC may fetch any of the video memory bytes from first to last
+// (included) while running through chars characters for which
+// crtc_quiet_chars holds.
+bool crtc_quiet_chars_fetch(int chars, const byte *first, const byte *last)
+{
+   if (!VDU.flag_drawing || last < pbRAM || first >= pbRAM + 0x10000) {
+      return false;
+   }
+   if (CPC.model > 2) {
+      return true; // soft scroll fetches around the address, keep it simple
+   }
+   unsigned int lo = first - pbRAM, hi = last - pbRAM;
+   auto fetched = [lo, hi](unsigned int address) { return address + 1 >= lo && address <= hi; };
+   if (fetched(CRTC.next_address)) {
+      return true;
+   }
+   for (int i = 0; i < chars; i++) {
+      if (fetched(MAXlate[(CRTC.addr + CRTC.char_count + i) & 0x73ff] | CRTC.scr_base)) {
+         return true;
+      }
+   }
+   return false;
+}
+
+
+
+// Runs through characters for which crtc_quiet_chars holds.
+static inline void crtc_cycle_quiet(int chars)
+{
+   int pos_increment = chars << 8;
+   while (chars) {
+      // HorzChar is a byte: past the horizontal cut-off, it can wrap around
+      // (e.g. it starts at 0xff on some lines) and rendering resume.
+      int run = chars;
+      bool render = false;
+      if (VDU.flag_drawing) {
+         if (HorzChar < HorzMax) {
+            run = std::min(chars, HorzMax - HorzChar);
+            render = true;
+         } else {
+            run = std::min(chars, 0x100 - HorzChar);
+         }
+      }
+      for (int i = 0; i < run; i++) {
+         if (render) {
+            if (flags1.combined != LastPreRend) {
+               set_prerender(); // change pre-renderer if necessary
+            }
+            PreRender(); // translate CPC video memory bytes to entries referencing the palette
+            CPC.scr_render(); // render to the video surface at the current bit depth
+         }
+         CRTC.next_address = MAXlate[(CRTC.addr + CRTC.char_count) & 0x73ff] | CRTC.scr_base; // next address for PreRender
+         flags1.dt.combined = new_dt.combined; // update the DISPTMG flags
+         CRTC.char_count++;
+      }
+      HorzChar += run;
+      chars -= run;
+   }
+   iMonHSStartPos += pos_increment;
+   iMonHSEndPos += pos_increment;
+   iMonHSPeakPos += pos_increment;
+   HorzPos += pos_increment;
+}
+
 
 
 void crtc_cycle(int repeat_count)
 {
+   t_CPC& cpc = CPC;
    while (repeat_count) {
+      int quiet_chars = crtc_quiet_chars(repeat_count);
+      if (quiet_chars) {
+         crtc_cycle_quiet(quiet_chars);
+         repeat_count -= quiet_chars;
+         continue;
+      }
       if (VDU.flag_drawing) { // are we within the rendering area?
          if (HorzChar < HorzMax) { // below horizontal cut-off?
             if (flags1.combined != LastPreRend) {
                set_prerender(); // change pre-renderer if necessary
             }
             PreRender(); // translate CPC video memory bytes to entries referencing the palette
-            CPC.scr_render(); // render to the video surface at the current bit depth
+            cpc.scr_render(); // render to the video surface at the current bit depth
          }
       }
       // https://www.cpcwiki.eu/index.php/Amstrad_Magnum_Phaser#Technical
       // If the trigger of the phazer is released, the CRTC continuously updates R16 and R17 (handled in OUT handler).
       // If the trigger is pressed, it only updates it when the phazer receives light from the screen.
-      if (CPC.phazer_pressed) {
-        unsigned int x = ((CPC.scr_pos - CPC.scr_base) * 8) / CPC.scr_bpp;
-        unsigned int y = VDU.scrln*CPC.dwYScale;
+      if (cpc.phazer_pressed) {
+        unsigned int x = ((cpc.scr_pos - cpc.scr_base) * 8) / cpc.scr_bpp;
+        unsigned int y = VDU.scrln*cpc.dwYScale;
         // Why the +4? I have absolutely no idea, but this works. Without it, the position is shifted
         // slightly to the left.
         auto address = CRTC.addr + CRTC.char_count + 4;
-        if (CPC.phazer_x >= x && CPC.phazer_x < x + 16 &&
-            CPC.phazer_y >= y && CPC.phazer_y < y + 2) {
+        if (cpc.phazer_x >= x && cpc.phazer_x < x + 16 &&
+            cpc.phazer_y >= y && cpc.phazer_y < y + 2) {
           CRTC.registers[16] = address >> 8;
           CRTC.registers[17] = address & 0xFF;
         }
@@ -1160,7 +1492,7 @@ void crtc_cycle(int repeat_count)
       HorzChar++;
       if (HorzPos >= MonHSYNC) {
          if (VDU.flag_drawing) {
-            CPC.scr_base += CPC.scr_line_offs; // advance surface pointer to next row
+            cpc.scr_base += cpc.scr_line_offs; // advance surface pointer to next row
          }
          HadP = 1;
          iMonHSPeakPos = HorzPos - MonHSYNC;
@@ -1184,7 +1516,7 @@ void crtc_cycle(int repeat_count)
          }
          RendOut = reinterpret_cast<byte *>(RendStart);
          RendWid = &HorzPix[0];
-         CPC.scr_pos = CPC.scr_base;
+         cpc.scr_pos = cpc.scr_base;
          VDU.scrln++;
          VDU.scanline++;
          if (static_cast<dword>(VDU.scrln) >= MAX_DRAWN) {
@@ -1357,10 +1689,14 @@ void crtc_init()
       ModeMaps[3] = M3Map;
    }
    ModeMap = ModeMaps[0];
-   for (int l = 0; l < 0x7400; l++) {
-      int j = l << 1; // actual address
-      MAXlate[l] = (j & 0x7FE) | ((j & 0x6000) << 1);
-   }
+   // Shared by all the emulation threads.
+   static std::once_flag maxlate_initialized;
+   std::call_once(maxlate_initialized, [] {
+      for (int l = 0; l < 0x7400; l++) {
+         int j = l << 1; // actual address
+         MAXlate[l] = (j & 0x7FE) | ((j & 0x6000) << 1);
+      }
+   });
 
    int Wid;
    if (dwXScale == 1) {
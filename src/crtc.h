@@ -56,6 +56,8 @@ void prerender_normal();
 void prerender_normal_half();
 void prerender_normal_plus();
 void prerender_normal_half_plus();
+int crtc_quiet_chars(int max_chars);
+bool crtc_quiet_chars_fetch(int chars, const byte *first, const byte *last);
 void crtc_cycle(int repeat_count);
 void crtc_init();
 void crtc_reset();
@@ -69,5 +71,9 @@ void render24bpp();
 void render24bpp_doubleY();
 void render32bpp();
 void render32bpp_doubleY();
+// Whether the CPU supports the AVX2 variants of the render functions.
+bool render_avx2_supported();
+// Returns the fastest variant of a render function supported by the CPU.
+void (*render_simd_variant(void (*render)()))();
 
 #endif
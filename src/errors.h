@@ -34,6 +34,13 @@
 #define ERR_SDUMP                32
 #define ERR_CPR_INVALID          33
 #define ERR_IPF_DYNLIB_LOAD      34
+#define ERR_SAVESTATE_BUSY       35
+#define ERR_SAVESTATE_INVALID    36
+#define ERR_MOVIE_INVALID        37
+#define ERR_MOVIE_WRITE          38
+#define ERR_MACHINE_NOT_READY    39
+#define ERR_CAPTURE_WRITE        40
+#define ERR_CAPTURE_FORMAT       41
 
 #define ERR_JOYSTICKS_INIT       45
 
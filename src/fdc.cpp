@@ -23,16 +23,15 @@
 #include "cap32.h"
 #include "disk.h"
 #include "z80.h"
+#include "machinestate.h"
 
-extern t_CPC CPC;
-extern t_FDC FDC;
-extern t_z80regs z80;
+extern thread_local t_CPC CPC;
 
-extern byte *pbGPBuffer;
+extern thread_local byte *pbGPBuffer;
 
 #ifdef DEBUG_FDC
 extern FILE *pfoDebug;
-dword dwBytesTransferred = 0;
+thread_local dword dwBytesTransferred = 0;
 #endif
 
 #define CMD_CODE  0
@@ -102,11 +101,11 @@ fdc_cmd_table_def fdc_cmd_table[MAX_CMD_COUNT] = {
    {0x5d, 9, 7, CPU_TO_FDC, fdc_scan},    // scan high or equal
 };
 
-extern t_drive driveA;
-extern t_drive driveB;
-t_drive *active_drive; // reference to the currently selected drive
-t_track *active_track; // reference to the currently selected track, of the active_drive
-dword read_status_delay = 0;
+extern thread_local t_drive driveA;
+extern thread_local t_drive driveB;
+thread_local t_drive *active_drive; // reference to the currently selected drive
+thread_local t_track *active_track; // reference to the currently selected track, of the active_drive
+thread_local dword read_status_delay = 0;
 
 
 
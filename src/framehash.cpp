@@ -0,0 +1,156 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Digest of the emulated screen.
+*/
+
+#include "framehash.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+
+const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r)
+{
+   return (x << r) | (x >> (64 - r));
+}
+
+// Little endian reads, whatever the host.
+inline uint64_t read64(const unsigned char* p)
+{
+   uint64_t val;
+   memcpy(&val, p, sizeof(val));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+   val = __builtin_bswap64(val);
+#endif
+   return val;
+}
+
+inline uint64_t read32(const unsigned char* p)
+{
+   uint32_t val;
+   memcpy(&val, p, sizeof(val));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+   val = __builtin_bswap32(val);
+#endif
+   return val;
+}
+
+inline uint64_t xxh_round(uint64_t acc, uint64_t input)
+{
+   acc += input * PRIME64_2;
+   acc = rotl(acc, 31);
+   return acc * PRIME64_1;
+}
+
+inline uint64_t xxh_merge_round(uint64_t acc, uint64_t val)
+{
+   acc ^= xxh_round(0, val);
+   return acc * PRIME64_1 + PRIME64_4;
+}
+
+}
+
+XXH64::XXH64(uint64_t seed) : seed(seed)
+{
+   acc[0] = seed + PRIME64_1 + PRIME64_2;
+   acc[1] = seed + PRIME64_2;
+   acc[2] = seed;
+   acc[3] = seed - PRIME64_1;
+}
+
+void XXH64::update(const void* data, size_t len)
+{
+   const unsigned char* p = static_cast<const unsigned char*>(data);
+   total_len += len;
+   if (buffered) {
+      size_t fill = std::min(len, sizeof(buffer) - buffered);
+      memcpy(buffer + buffered, p, fill);
+      buffered += fill;
+      p += fill;
+      len -= fill;
+      if (buffered < sizeof(buffer)) {
+         return;
+      }
+      for (int i = 0; i < 4; i++) {
+         acc[i] = xxh_round(acc[i], read64(buffer + i * 8));
+      }
+      buffered = 0;
+   }
+   // Stripes of 32 bytes, the main loop when hashing a frame.
+   uint64_t v1 = acc[0], v2 = acc[1], v3 = acc[2], v4 = acc[3];
+   for (; len >= 32; p += 32, len -= 32) {
+      v1 = xxh_round(v1, read64(p));
+      v2 = xxh_round(v2, read64(p + 8));
+      v3 = xxh_round(v3, read64(p + 16));
+      v4 = xxh_round(v4, read64(p + 24));
+   }
+   acc[0] = v1; acc[1] = v2; acc[2] = v3; acc[3] = v4;
+   memcpy(buffer, p, len);
+   buffered = len;
+}
+
+uint64_t XXH64::digest() const
+{
+   uint64_t h;
+   if (total_len >= 32) {
+      h = rotl(acc[0], 1) + rotl(acc[1], 7) + rotl(acc[2], 12) + rotl(acc[3], 18);
+      for (int i = 0; i < 4; i++) {
+         h = xxh_merge_round(h, acc[i]);
+      }
+   } else {
+      h = seed + PRIME64_5;
+   }
+   h += total_len;
+
+   const unsigned char* p = buffer;
+   size_t len = buffered;
+   for (; len >= 8; p += 8, len -= 8) {
+      h ^= xxh_round(0, read64(p));
+      h = rotl(h, 27) * PRIME64_1 + PRIME64_4;
+   }
+   if (len >= 4) {
+      h ^= read32(p) * PRIME64_1;
+      h = rotl(h, 23) * PRIME64_2 + PRIME64_3;
+      p += 4;
+      len -= 4;
+   }
+   for (; len; p++, len--) {
+      h ^= *p * PRIME64_5;
+      h = rotl(h, 11) * PRIME64_1;
+   }
+
+   h ^= h >> 33;
+   h *= PRIME64_2;
+   h ^= h >> 29;
+   h *= PRIME64_3;
+   h ^= h >> 32;
+   return h;
+}
+
+uint64_t frame_hash(SDL_Surface* surface)
+{
+   XXH64 hash;
+   const unsigned char* line = static_cast<const unsigned char*>(surface->pixels);
+   size_t line_size = surface->w * surface->format->BytesPerPixel;
+   for (int y = 0; y < surface->h; y++) {
+      hash.update(line, line_size);
+      line += surface->pitch;
+   }
+   return hash.digest();
+}
+
+std::string frame_hash_to_string(uint64_t hash)
+{
+   char str[17];
+   snprintf(str, sizeof(str), "%016llx", static_cast<unsigned long long>(hash));
+   return str;
+}
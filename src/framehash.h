@@ -0,0 +1,37 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Digest of the emulated screen, to check the result of scripted runs without
+   going through screenshots.
+*/
+
+#ifndef FRAMEHASH_H
+#define FRAMEHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <SDL_video.h>
+
+// Streaming XXH64 (https://github.com/Cyan4973/xxHash): the digest of the data
+// given to update, in as many calls as needed, is the same as in one go.
+class XXH64 {
+  public:
+    explicit XXH64(uint64_t seed = 0);
+    void update(const void* data, size_t len);
+    uint64_t digest() const;
+
+  private:
+    uint64_t acc[4];
+    uint64_t seed;
+    uint64_t total_len = 0;
+    unsigned char buffer[32];
+    size_t buffered = 0;
+};
+
+// Digest of the pixels of surface. Only the visible part of each line is
+// hashed: the padding at the end of the lines is not.
+uint64_t frame_hash(SDL_Surface* surface);
+// As 16 hexadecimal digits.
+std::string frame_hash_to_string(uint64_t hash);
+
+#endif
@@ -269,6 +269,10 @@ namespace wGui
         CButton *m_pMemAddWatchPoint;
         CButton *m_pMemRemoveWatchPoint;
         CDropDown* m_pMemWatchPointType;
+        CLabel* m_pMemWatchPointValueLbl;
+        CEditBox* m_pMemWatchPointValue;
+        CLabel* m_pMemWatchPointMaskLbl;
+        CEditBox* m_pMemWatchPointMask;
 
         CGroupBox* m_pMemConfigGrp;
         CLabel* m_pMemConfigMemLbl;
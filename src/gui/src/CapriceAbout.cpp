@@ -8,7 +8,7 @@
 #include "wg_error.h"
 
 // CPC emulation properties, defined in cap32.h:
-extern t_CPC CPC;
+extern thread_local t_CPC CPC;
 
 namespace wGui {
 
@@ -14,15 +14,12 @@
 #include "z80.h"
 #include "z80_macros.h"
 #include "z80_disassembly.h"
+#include "machinestate.h"
 
-extern t_z80regs z80;
-extern t_CPC CPC;
-extern t_GateArray GateArray;
-extern t_PSG PSG;
-extern std::vector<Breakpoint> breakpoints;
-extern std::vector<Watchpoint> watchpoints;
-extern byte* pbROMlo;
-extern byte* pbExpansionROM;
+extern thread_local std::vector<word> z80_step_out_addresses;
+extern thread_local t_CPC CPC;
+extern thread_local std::vector<Breakpoint> breakpoints;
+extern thread_local std::vector<Watchpoint> watchpoints;
 t_MemBankConfig memtool_membank_config;
 
 namespace wGui {
@@ -372,7 +369,7 @@ CapriceDevTools::CapriceDevTools(const CRect& WindowRect, CWindow* pParent, CFon
     m_MemDisplayValue = -1;
 
     // TODO: Support read, write and R/W watch points
-    m_pMemWatchPointsGrp = new CGroupBox(CRect(CPoint(380, 13), 240, 120), m_pGroupBoxTabMemory, "Watch points");
+    m_pMemWatchPointsGrp = new CGroupBox(CRect(CPoint(380, 13), 240, 145), m_pGroupBoxTabMemory, "Watch points");
     m_pMemWatchPoints = new CListBox(CRect(CPoint(10, 5), 80, 80), m_pMemWatchPointsGrp,
         /*bSingleSelection=*/false, /*iItemHeight=*/15, monoFontEngine);
     m_pMemRemoveWatchPoint = new CButton(CRect(CPoint(110, 5), 100, 20), m_pMemWatchPointsGrp, "Remove selected");
@@ -383,9 +380,17 @@ CapriceDevTools::CapriceDevTools(const CRect& WindowRect, CWindow* pParent, CFon
     m_pMemWatchPointType->AddItem(SListItem("W"));
     m_pMemWatchPointType->AddItem(SListItem("RW"));
     m_pMemWatchPointType->SelectItem(2);
-    m_pMemAddWatchPoint = new CButton(CRect(CPoint(110, 65), 50, 20), m_pMemWatchPointsGrp, "Add");
-
-    m_pMemConfigGrp = new CGroupBox(CRect(CPoint(380, 143), 240, 100), m_pGroupBoxTabMemory, "RAM config");
+    // Optional condition: only trigger when (byte & mask) == (value & mask).
+    // The mask defaults to FF when only the value is given.
+    m_pMemWatchPointValueLbl = new CLabel(CPoint(110, 70), m_pMemWatchPointsGrp, "=");
+    m_pMemWatchPointValue = new CEditBox(CRect(CPoint(120, 65), 30, 20), m_pMemWatchPointsGrp);
+    m_pMemWatchPointValue->SetContentType(CEditBox::HEXNUMBER);
+    m_pMemWatchPointMaskLbl = new CLabel(CPoint(160, 70), m_pMemWatchPointsGrp, "/");
+    m_pMemWatchPointMask = new CEditBox(CRect(CPoint(170, 65), 30, 20), m_pMemWatchPointsGrp);
+    m_pMemWatchPointMask->SetContentType(CEditBox::HEXNUMBER);
+    m_pMemAddWatchPoint = new CButton(CRect(CPoint(110, 90), 50, 20), m_pMemWatchPointsGrp, "Add");
+
+    m_pMemConfigGrp = new CGroupBox(CRect(CPoint(380, 168), 240, 100), m_pGroupBoxTabMemory, "RAM config");
     m_pMemConfigMemLbl = new CLabel(CPoint(10, 30), m_pMemConfigGrp, "Mem:");
     m_pMemConfigCurLbl = new CLabel(CPoint(10, 55), m_pMemConfigGrp, "Cur:");
     m_pMemConfigROMLbl = new CLabel(CPoint(60, 0), m_pMemConfigGrp, "ROM");
@@ -839,6 +844,10 @@ void CapriceDevTools::UpdateWatchPointsList()
     oss << std::hex << std::setw(4) << std::setfill('0') << bp.address << "  "
       << ((bp.type & READ) ? "R" : "")
       << ((bp.type & WRITE) ? "W" : "");
+    if (bp.mask) {
+      oss << " =" << std::setw(2) << static_cast<int>(bp.value)
+        << "/" << std::setw(2) << static_cast<int>(bp.mask);
+    }
     m_pMemWatchPoints->AddItem(SListItem(oss.str()));
   }
 }
@@ -1212,7 +1221,7 @@ bool CapriceDevTools::HandleMessage(CMessage* pMessage)
             }
             if (pMessage->Source() == m_pButtonStepOut) {
               z80.step_out = 1;
-              z80.step_out_addresses.clear();
+              z80_step_out_addresses.clear();
               ResumeExecution();
               break;
             }
@@ -1353,7 +1362,16 @@ bool CapriceDevTools::HandleMessage(CMessage* pMessage)
               try
               {
                 WatchpointType type = WatchpointType(m_pMemWatchPointType->GetSelectedIndex() + 1);
-                watchpoints.emplace_back(static_cast<word>(std::stol(m_pMemNewWatchPoint->GetWindowText(), nullptr, 16)), type);
+                word address = static_cast<word>(std::stol(m_pMemNewWatchPoint->GetWindowText(), nullptr, 16));
+                byte value = 0, mask = 0;
+                if (!m_pMemWatchPointValue->GetWindowText().empty()) {
+                  value = static_cast<byte>(std::stol(m_pMemWatchPointValue->GetWindowText(), nullptr, 16));
+                  mask = 0xff;
+                }
+                if (!m_pMemWatchPointMask->GetWindowText().empty()) {
+                  mask = static_cast<byte>(std::stol(m_pMemWatchPointMask->GetWindowText(), nullptr, 16));
+                }
+                watchpoints.emplace_back(address, type, value, mask);
                 UpdateWatchPointsList();
               } catch(...) {}
               break;
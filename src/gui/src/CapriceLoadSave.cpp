@@ -37,9 +37,9 @@ char *realpath(const char *path, char *resolved_path) {
 
 
 // CPC emulation properties, defined in cap32.h:
-extern t_CPC CPC;
-extern t_drive driveA;
-extern t_drive driveB;
+extern thread_local t_CPC CPC;
+extern thread_local t_drive driveA;
+extern thread_local t_drive driveB;
 
 namespace wGui {
 
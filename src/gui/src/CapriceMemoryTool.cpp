@@ -7,9 +7,9 @@
 #include <iomanip>
 #include <sstream>
 #include <string>
+#include "machinestate.h"
 
-extern byte *pbRAM;
-extern t_CPC CPC;
+extern thread_local t_CPC CPC;
 
 namespace wGui {
 
@@ -97,6 +97,7 @@ bool CapriceMemoryTool::HandleMessage(CMessage* pMessage)
               if(!adress.empty() && !value.empty() && pokeAdress < 65536 && pokeValue >= -128 && pokeValue <= 255) {
                 std::cout << "Poking " << pokeAdress << " with " << pokeValue << std::endl;
                 pbRAM[pokeAdress] = pokeValue;
+                ram_mark_dirty(pokeAdress, 1);
                 UpdateTextMemory();
               } else {
                 std::cout << "Cannot poke " << adress << "(" << pokeAdress << ") with " << value << "(" << pokeValue << ")" << std::endl;
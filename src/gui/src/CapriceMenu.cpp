@@ -12,7 +12,7 @@
 #include "cap32.h"
 
 // CPC emulation properties, defined in cap32.h:
-extern t_CPC CPC;
+extern thread_local t_CPC CPC;
 
 namespace wGui {
 
@@ -12,7 +12,7 @@
 #include "wg_messagebox.h"
 
 // CPC emulation properties, defined in cap32.h:
-extern t_CPC CPC;
+extern thread_local t_CPC CPC;
 std::vector<std::string> mapFileList;
 
 namespace wGui {
@@ -68,7 +68,7 @@ CapriceOptions::CapriceOptions(const CRect& WindowRect, CWindow* pParent, CFontE
     m_pScrollBarRamSize = new CScrollBar(CRect(CPoint(90, 25), 120, 12), m_pGroupBoxTabGeneral,
                                                                              CScrollBar::HORIZONTAL);
     m_pScrollBarRamSize->SetMinLimit(1); // * 64.  Minimum is 128k if model is 6128!
-    m_pScrollBarRamSize->SetMaxLimit(9); // * 64 = 576k
+    m_pScrollBarRamSize->SetMaxLimit(RAM_MAX_SIZE / 64); // * 64 = 4160k (4MB expansion)
     m_pScrollBarRamSize->SetStepSize(1);  // will multiply by 64. With the current scrollbar, it would otherwise
                                           // (stepsize of 64) be possible to select values that are no multiple
                                           // of 64.
@@ -3,7 +3,7 @@
 #include "keyboard.h"
 #include <string>
 
-extern t_CPC CPC;
+extern thread_local t_CPC CPC;
 
 namespace wGui {
 
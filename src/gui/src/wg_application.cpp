@@ -32,9 +32,9 @@
 #include "log.h"
 
 // CPC emulation properties, defined in cap32.h:
-extern t_CPC CPC;
+extern thread_local t_CPC CPC;
 // Video plugin, defined in video.h:
-extern video_plugin* vid_plugin;
+extern thread_local video_plugin* vid_plugin;
 
 namespace wGui
 {
@@ -33,7 +33,7 @@
 #include <algorithm>
 #include <string>
 
-extern video_plugin* vid_plugin;
+extern thread_local video_plugin* vid_plugin;
 
 
 namespace wGui
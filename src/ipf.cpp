@@ -18,8 +18,9 @@
 #include "CapsLib.h"
 #include <string>
 #include <memory>
+#include <mutex>
 
-extern t_CPC CPC;
+extern thread_local t_CPC CPC;
 
 // Track decoding variables
 static bool fWrapped;
@@ -31,6 +32,9 @@ static word s_wCRC;
 
 static struct CapsTrackInfoT1 cti;
 static dword dwLockFlags = DI_LOCK_UPDATEFD|DI_LOCK_TYPE;
+// Neither these variables nor the IPF library are thread safe: only one
+// emulation thread can load an image at a time.
+static std::mutex ipf_mutex;
 
 // CRC-16 CCITT, for track level header and data checksums
 static void Crc (byte b_)
@@ -343,6 +347,7 @@ int ipf_load (const std::string &filename, t_drive *drive)
   long id = -1;
   struct CapsImageInfo cii;
   struct CapsVersionInfo vi = { 0, 0, 0, 0 };
+  std::lock_guard<std::mutex> lock(ipf_mutex);
 
   dsk_eject(drive);
 
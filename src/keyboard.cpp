@@ -9,7 +9,7 @@
 #include "log.h"
 
 extern byte bit_values[8];
-extern t_CPC CPC;
+extern thread_local t_CPC CPC;
 
 const CPCScancode InputMapper::cpc_kbd[CPC_KEYBOARD_NUM][CPC_KEY_NUM] = {
   { // original CPC keyboard
@@ -955,7 +955,9 @@ std::map<CapriceKey, PCKey> InputMapper::SDLkeysymFromCPCkeys_us = {
   { CAP32_JOY,       SDLK_F7 },
   { CAP32_PHAZER,    SDLK_F7 | MOD_PC_SHIFT },
   { CAP32_FPS,       SDLK_F8 },
+  { CAP32_ASSERTHASH, SDLK_F8 | MOD_PC_SHIFT },
   { CAP32_SPEED,     SDLK_F9 },
+  { CAP32_REWIND,    SDLK_F9 | MOD_PC_SHIFT },
   { CAP32_EXIT,      SDLK_F10 },
   { CAP32_PASTE,     SDLK_F11 },
   { CAP32_DEBUG,     SDLK_F12 },
@@ -1185,6 +1187,8 @@ const std::map<const std::string, const CapriceKey> InputMapper::CPCkeysFromStri
    {"CAP32_MF2STOP",   CAP32_MF2STOP},
    {"CAP32_RESET",     CAP32_RESET},
    {"CAP32_NEXTDISKA", CAP32_NEXTDISKA},
+   {"CAP32_REWIND",    CAP32_REWIND},
+   {"CAP32_ASSERTHASH", CAP32_ASSERTHASH},
    {"CAP32_SCRNSHOT",  CAP32_SCRNSHOT},
    {"CAP32_SNAPSHOT",  CAP32_SNAPSHOT},
    {"CAP32_LD_SNAP",   CAP32_LD_SNAP},
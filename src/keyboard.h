@@ -42,7 +42,9 @@ typedef enum {
    CAP32_DELAY,
    CAP32_PASTE,
    CAP32_DEVTOOLS,
-   CAP32_NEXTDISKA
+   CAP32_NEXTDISKA,
+   CAP32_REWIND,
+   CAP32_ASSERTHASH
 } CAP32_KEYS;
 
 typedef enum {
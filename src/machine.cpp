@@ -0,0 +1,253 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Independent emulated machines.
+*/
+
+#include "machine.h"
+
+#include <list>
+#include "cap32.h"
+#include "errors.h"
+#include "framehash.h"
+#include "keyboard.h"
+#include "log.h"
+#include "slotshandler.h"
+#include "tape.h"
+#include "z80.h"
+#include "machinestate.h"
+
+extern thread_local t_CPC CPC;
+extern thread_local t_drive driveA;
+extern thread_local t_drive driveB;
+extern thread_local SDL_Surface *back_surface;
+extern thread_local dword dwFrameCountOverall;
+extern thread_local std::list<SDL_Event> virtualKeyboardEvents;
+extern thread_local dword nextVirtualEventFrameCount;
+extern thread_local dword breakPointsToSkipBeforeProceedingWithVirtualEvents;
+extern thread_local std::vector<byte> pbTapeImage;
+extern thread_local byte keyboard_matrix[16];
+
+Machine::Machine() : plugin(video_headless_plugin), thread(&Machine::loop, this)
+{
+}
+
+Machine::~Machine()
+{
+   call([this]() { doShutdown(); });
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+   }
+   cv.notify_one();
+   thread.join();
+}
+
+int Machine::init(const std::string& configFile, const std::vector<std::string>& slot_list)
+{
+   return call([&]() { return doInit(configFile, slot_list); }).get();
+}
+
+void Machine::autocmd(const std::string& autocmd)
+{
+   call([this, autocmd]() {
+      virtualKeyboardEvents = CPC.InputMapper->StringToEvents(autocmd);
+      // Give some time to the CPC to start, as cap32_main does.
+      nextVirtualEventFrameCount = dwFrameCountOverall + CPC.boot_time;
+   }).get();
+}
+
+int Machine::runFrames(unsigned int count)
+{
+   return call([this, count]() { return doRunFrames(count); }).get();
+}
+
+bool Machine::exited()
+{
+   return call([this]() { return exit_requested; }).get();
+}
+
+std::vector<uint64_t> Machine::screenshots()
+{
+   return call([this]() { return screenshot_hashes; }).get();
+}
+
+uint64_t Machine::frameHash()
+{
+   return call([]() { return frame_hash(back_surface); }).get();
+}
+
+void Machine::loop()
+{
+   while (true) {
+      std::function<void()> task;
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         cv.wait(lock, [this]() { return stopping || !tasks.empty(); });
+         if (tasks.empty()) {
+            return;
+         }
+         task = std::move(tasks.front());
+         tasks.pop_front();
+      }
+      task();
+   }
+}
+
+int Machine::doInit(const std::string& configFile, const std::vector<std::string>& slot_list)
+{
+   if (initialized) {
+      doShutdown();
+      // Back to a machine as fresh as a new one.
+      CPC = t_CPC();
+      dwFrameCountOverall = 0;
+      breakPointsToSkipBeforeProceedingWithVirtualEvents = 0;
+   }
+   virtualKeyboardEvents.clear();
+   exit_requested = false;
+   screenshot_requested = false;
+   screenshot_hashes.clear();
+
+   loadConfiguration(CPC, configFile);
+   // No host device: see machine.h
+   CPC.limit_speed = 0;
+   CPC.snd_enabled = 0;
+   CPC.joysticks = 0;
+   CPC.auto_pause = 0;
+   CPC.printer = 0;
+
+   z80_init_tables();
+   int iErrCode = video_init_plugin(&plugin);
+   if (iErrCode) {
+      LOG_ERROR("Machine: could not create the video surface");
+      return iErrCode;
+   }
+   fillSlots(slot_list, CPC);
+   CPC.InputMapper = new InputMapper(&CPC);
+   initialized = true;
+   if ((iErrCode = emulator_init())) {
+      LOG_ERROR("Machine: could not power on the emulated CPC");
+      return iErrCode;
+   }
+   if ((iErrCode = loadSlots())) {
+      LOG_ERROR("Machine: could not load the media");
+   }
+   return iErrCode;
+}
+
+int Machine::doRunFrames(unsigned int count)
+{
+   if (!initialized) {
+      return ERR_MACHINE_NOT_READY;
+   }
+   while (count && !exit_requested) {
+      if (!virtualKeyboardEvents.empty()
+          && (nextVirtualEventFrameCount < dwFrameCountOverall)
+          && (breakPointsToSkipBeforeProceedingWithVirtualEvents == 0)) {
+         doVirtualEvent();
+      }
+
+      // Same as the main loop: the surface is always the one of this machine,
+      // but the rendering position is recomputed from the current scan line.
+      dword dwOffset = CPC.scr_pos - CPC.scr_base;
+      if (VDU.scrln > 0) {
+         CPC.scr_base = static_cast<byte *>(back_surface->pixels) + (VDU.scrln * CPC.scr_line_offs);
+      } else {
+         CPC.scr_base = static_cast<byte *>(back_surface->pixels);
+      }
+      CPC.scr_pos = CPC.scr_base + dwOffset;
+
+      int iExitCondition = z80_execute();
+      // Old flavour breakpoints (see CAP32_WAITBREAK) are handled as in the
+      // main loop, the other ones have nobody to stop for.
+      if (iExitCondition == EC_BREAKPOINT) {
+         z80.break_point = 0xffffffff;
+         if (!z80.breakpoint_reached && !z80.watchpoint_reached) {
+            z80.trace = 1; // to rearm the break point after the next instruction
+            if (breakPointsToSkipBeforeProceedingWithVirtualEvents > 0) {
+               breakPointsToSkipBeforeProceedingWithVirtualEvents--;
+            }
+         }
+      } else if (z80.break_point == 0xffffffff) {
+         z80.break_point = 0;
+      }
+
+      if (iExitCondition == EC_FRAME_COMPLETE) {
+         dwFrameCountOverall++;
+         count--;
+         uint64_t hash = frame_finish(screenshot_requested);
+         if (screenshot_requested) {
+            screenshot_hashes.push_back(hash);
+            screenshot_requested = false;
+         }
+      }
+   }
+   return 0;
+}
+
+// Same as cap32_main does for virtual events, without going through the SDL
+// event queue which is shared by all the threads.
+void Machine::doVirtualEvent()
+{
+   SDL_Event event = virtualKeyboardEvents.front();
+   virtualKeyboardEvents.pop_front();
+   CPCScancode scancode = CPC.InputMapper->CPCscancodeFromKeysym(event.key.keysym);
+   if (!(scancode & MOD_EMU_KEY)) {
+      applyKeypress(scancode, keyboard_matrix, event.type == SDL_KEYDOWN);
+      // Keep the key pressed long enough for the firmware to see it.
+      nextVirtualEventFrameCount = dwFrameCountOverall + ((event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) ? 1 : 0);
+      return;
+   }
+   if (event.type != SDL_KEYUP) {
+      return;
+   }
+   switch (scancode) {
+      case CAP32_SCRNSHOT:
+      case CAP32_ASSERTHASH:
+         // Taken once the frame is complete.
+         screenshot_requested = true;
+         break;
+
+      case CAP32_DELAY:
+         nextVirtualEventFrameCount = dwFrameCountOverall + CPC.boot_time;
+         break;
+
+      case CAP32_WAITBREAK:
+         breakPointsToSkipBeforeProceedingWithVirtualEvents++;
+         z80.break_point = 0;
+         break;
+
+      case CAP32_RESET:
+         emulator_reset();
+         break;
+
+      case CAP32_TAPEPLAY:
+         Tape_Rewind();
+         if (!pbTapeImage.empty()) {
+            CPC.tape_play_button = CPC.tape_play_button ? 0 : 0x10;
+         }
+         break;
+
+      case CAP32_EXIT:
+         exit_requested = true;
+         break;
+
+      default:
+         LOG_VERBOSE("Machine: ignoring emulator key " << scancode);
+         break;
+   }
+}
+
+void Machine::doShutdown()
+{
+   if (!initialized) {
+      return;
+   }
+   dsk_eject(&driveA);
+   dsk_eject(&driveB);
+   tape_eject();
+   emulator_shutdown();
+   delete CPC.InputMapper;
+   CPC.InputMapper = nullptr;
+   video_shutdown();
+   initialized = false;
+}
@@ -0,0 +1,95 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Independent emulated machines, to run several CPCs in parallel in the same
+   process (e.g. for batch jobs).
+   The state of the emulated machine (CPC, z80, CRTC, GateArray, PSG, FDC,
+   pbRAM, membank_read...) is thread local, mostly gathered in machinestate.h:
+   the emulator code keeps using it as globals, and each thread sees its own
+   machine. A Machine owns a thread on
+   which all its emulation runs, everything done with it goes through call().
+   Machines are headless and silent: host devices (window, audio, joysticks,
+   printer) are only available to the emulator running on the main thread.
+*/
+
+#ifndef MACHINE_H
+#define MACHINE_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "video.h"
+
+class Machine {
+  public:
+    Machine();
+    // Powers the machine off and waits for the tasks in progress to finish.
+    ~Machine();
+
+    Machine(const Machine&) = delete;
+    Machine& operator=(const Machine&) = delete;
+
+    // The methods below wait for their task to be done on the thread of the
+    // machine: they must not be called from a task of the same machine.
+
+    // Loads the configuration and powers the machine on, with the media in
+    // slot_list (same as the command line: disks, tape, snapshot, cartridge).
+    // Returns 0 or an error code.
+    int init(const std::string& configFile, const std::vector<std::string>& slot_list = {});
+    // Types autocmd (as built from -a, keywords replaced) once the CPC has
+    // started, while running frames. Of the emulator keywords, only
+    // CAP32_DELAY, CAP32_WAITBREAK, CAP32_SCRNSHOT, CAP32_ASSERTHASH,
+    // CAP32_RESET, CAP32_TAPEPLAY and CAP32_EXIT have an effect.
+    void autocmd(const std::string& autocmd);
+    // Emulates count frames, or until CAP32_EXIT is typed. Breakpoints set from
+    // the developers' tools are ignored. Returns 0 or an error code.
+    int runFrames(unsigned int count);
+    // Whether CAP32_EXIT was typed.
+    bool exited();
+    // frame_hash of the frames completed after each CAP32_SCRNSHOT or
+    // CAP32_ASSERTHASH.
+    std::vector<uint64_t> screenshots();
+    // frame_hash of the last completed frame.
+    uint64_t frameHash();
+
+    // Runs f on the thread of the machine, where the emulator globals are the
+    // ones of this machine. Tasks are run in order.
+    template<typename F>
+    auto call(F f) -> std::future<decltype(f())> {
+      auto task = std::make_shared<std::packaged_task<decltype(f())()>>(std::move(f));
+      auto result = task->get_future();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.emplace_back([task]() { (*task)(); });
+      }
+      cv.notify_one();
+      return result;
+    }
+
+  private:
+    void loop();
+    // These run on the thread of the machine.
+    int doInit(const std::string& configFile, const std::vector<std::string>& slot_list);
+    int doRunFrames(unsigned int count);
+    void doShutdown();
+    void doVirtualEvent();
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> tasks;
+    bool stopping = false;
+    bool initialized = false;
+    bool exit_requested = false;
+    bool screenshot_requested = false;
+    std::vector<uint64_t> screenshot_hashes;
+    // The headless plugin stores the surface geometry in itself.
+    video_plugin plugin;
+    std::thread thread;
+};
+
+#endif
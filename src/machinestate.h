@@ -0,0 +1,257 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   State of the emulated machine touched while emulating: the Z80, the memory
+   banks, the chips, and the internals of the CRTC rendering and of the PSG
+   synthesis.
+   It is one thread local object, so that each thread runs its own machine
+   (see machine.h) and a function only needs to look up the thread local
+   storage once to reach all of it. On ELF targets the lookup is an offset from
+   the thread pointer; elsewhere (emutls on Windows, TLV on macOS) it is a call.
+   It has no constructor nor destructor and is defined in this header, so that
+   accessing it never goes through an initialization check either: it is zeroed
+   when a thread starts.
+   The rest of the state of a machine (configuration in CPC, media, debugger,
+   captures...) is made of separate thread local globals, only used once per
+   frame or per event.
+   The members keep the names of the globals they used to be: the macros at the
+   end of this file let the emulator code use these names.
+*/
+
+#ifndef MACHINESTATE_H
+#define MACHINESTATE_H
+
+#include <type_traits>
+#include "types.h"
+#include "asic.h"
+#include "cap32.h"
+#include "crtc.h"
+#include "z80.h"
+
+// PSG synthesis (psg.cpp)
+union TLoopCount {
+   struct {
+      dword Lo;
+      dword Hi;
+   };
+   int64_t Re;
+};
+
+union TCounter {
+   struct {
+      word Lo;
+      word Hi;
+   };
+   dword Re;
+};
+
+union TNoise {
+   struct {
+      word Low;
+      word Val;
+   };
+   dword Seed;
+};
+
+union TEnvelopeCounter {
+   struct {
+      dword Lo;
+      dword Hi;
+   };
+   int64_t Re;
+};
+
+#define BLEP_RING 32 // power of 2, at least BLEP_WIDTH (psg.cpp)
+
+struct t_MachineState {
+   // Z80
+   t_z80regs z80;
+   int iCycleCount, iWSAdjust;
+   int iEventCycleCount, iEventDeadline;
+
+   // Memory
+   byte *membank_read[4], *membank_write[4], *memmap_ROM[256];
+   t_WriteHandler membank_write_handler[4];
+   // First page of each bank of membank_write, RAM_MAX_PAGES if outside of the
+   // RAM. Only meaningful once ram_update_write_pages was called.
+   unsigned int membank_write_page[4];
+   // The 4 entries after RAM_MAX_PAGES absorb writes to banks mapped outside of the RAM.
+   dword ram_page_stamp[RAM_MAX_PAGES + 4];
+   dword ram_write_stamp;
+   byte *pbRAM, *pbROMlo, *pbROMhi, *pbExpansionROM;
+   dword dwMF2Flags, dwMF2ExitAddr;
+
+   // Chips
+   t_CRTC CRTC;
+   t_FDC FDC;
+   t_GateArray GateArray;
+   t_PPI PPI;
+   t_PSG PSG;
+   t_VDU VDU;
+   asic_t asic;
+   asic_color_t asic_colours[32];
+   byte *pbRegisterPage;
+
+   // CRTC rendering (crtc.cpp)
+   t_flags1 flags1;
+   t_new_dt new_dt;
+   dword LastPreRend;
+   word MinVSync, MaxVSync;
+   int iMonHSPeakPos, iMonHSStartPos, iMonHSEndPos, iMonHSPeakToStart, iMonHSStartToPeak, iMonHSEndToPeak, iMonHSPeakToEnd;
+   int HorzPos, MonHSYNC, MonFreeSync;
+   int HSyncDuration, MinHSync, MaxHSync;
+   int HadP;
+   byte PosShift, HorzChar, HorzMax;
+   dword *ModeMaps[4];
+   dword *ModeMap;
+   byte HorzPix[49];
+   byte RendBuff[800];
+   byte *RendWid, *RendOut;
+   dword *RendStart, *RendPos;
+   void (*PreRender)();
+
+   // PSG synthesis (psg.cpp)
+   int Level_PP[256];
+   TLoopCount LoopCount;
+   int64_t LoopCountInit;
+   bool Ton_EnA, Ton_EnB, Ton_EnC, Noise_EnA, Noise_EnB, Noise_EnC;
+   bool Envelope_EnA, Envelope_EnB, Envelope_EnC;
+   void (*Case_EnvType)();
+   TCounter Ton_Counter_A, Ton_Counter_B, Ton_Counter_C, Noise_Counter;
+   TNoise Noise_Generator;
+   TEnvelopeCounter Envelope_Counter;
+   byte Ton_A, Ton_B, Ton_C;
+   int Level_AR[32], Level_AL[32], Level_BR[32], Level_BL[32], Level_CR[32], Level_CL[32];
+   int LevelTape;
+   byte Index_AL, Index_AR, Index_BL, Index_BR, Index_CL, Index_CR;
+   int PreAmp, PreAmpMax;
+   int Left_Chan, Right_Chan;
+   // Samples due but not rendered yet by the block synthesizer.
+   int Samples_Pending;
+   int Sample_Bytes;
+   void (*Synthesizer_Render)(int count);
+   // Band-limited synthesis
+   float Blep_Residual_L[BLEP_RING], Blep_Residual_R[BLEP_RING];
+   int Blep_Pos;
+   int Blep_Level_L, Blep_Level_R;
+};
+
+static_assert(std::is_trivial<t_MachineState>::value, "t_MachineState must stay trivial (see above)");
+
+inline thread_local t_MachineState machine_state;
+
+#define z80                   (machine_state.z80)
+#define iCycleCount           (machine_state.iCycleCount)
+#define iWSAdjust             (machine_state.iWSAdjust)
+#define iEventCycleCount      (machine_state.iEventCycleCount)
+#define iEventDeadline        (machine_state.iEventDeadline)
+
+#define membank_read          (machine_state.membank_read)
+#define membank_write         (machine_state.membank_write)
+#define memmap_ROM            (machine_state.memmap_ROM)
+#define membank_write_handler (machine_state.membank_write_handler)
+#define membank_write_page    (machine_state.membank_write_page)
+#define ram_page_stamp        (machine_state.ram_page_stamp)
+#define ram_write_stamp       (machine_state.ram_write_stamp)
+#define pbRAM                 (machine_state.pbRAM)
+#define pbROMlo               (machine_state.pbROMlo)
+#define pbROMhi               (machine_state.pbROMhi)
+#define pbExpansionROM        (machine_state.pbExpansionROM)
+#define dwMF2Flags            (machine_state.dwMF2Flags)
+#define dwMF2ExitAddr         (machine_state.dwMF2ExitAddr)
+
+#define CRTC                  (machine_state.CRTC)
+#define FDC                   (machine_state.FDC)
+#define GateArray             (machine_state.GateArray)
+#define PPI                   (machine_state.PPI)
+#define PSG                   (machine_state.PSG)
+#define VDU                   (machine_state.VDU)
+#define asic                  (machine_state.asic)
+#define asic_colours          (machine_state.asic_colours)
+#define pbRegisterPage        (machine_state.pbRegisterPage)
+
+#define flags1                (machine_state.flags1)
+#define new_dt                (machine_state.new_dt)
+#define LastPreRend           (machine_state.LastPreRend)
+#define MinVSync              (machine_state.MinVSync)
+#define MaxVSync              (machine_state.MaxVSync)
+#define iMonHSPeakPos         (machine_state.iMonHSPeakPos)
+#define iMonHSStartPos        (machine_state.iMonHSStartPos)
+#define iMonHSEndPos          (machine_state.iMonHSEndPos)
+#define iMonHSPeakToStart     (machine_state.iMonHSPeakToStart)
+#define iMonHSStartToPeak     (machine_state.iMonHSStartToPeak)
+#define iMonHSEndToPeak       (machine_state.iMonHSEndToPeak)
+#define iMonHSPeakToEnd       (machine_state.iMonHSPeakToEnd)
+#define HorzPos               (machine_state.HorzPos)
+#define MonHSYNC              (machine_state.MonHSYNC)
+#define MonFreeSync           (machine_state.MonFreeSync)
+#define HSyncDuration         (machine_state.HSyncDuration)
+#define MinHSync              (machine_state.MinHSync)
+#define MaxHSync              (machine_state.MaxHSync)
+#define HadP                  (machine_state.HadP)
+#define PosShift              (machine_state.PosShift)
+#define HorzChar              (machine_state.HorzChar)
+#define HorzMax               (machine_state.HorzMax)
+#define ModeMaps              (machine_state.ModeMaps)
+#define ModeMap               (machine_state.ModeMap)
+#define HorzPix               (machine_state.HorzPix)
+#define RendBuff              (machine_state.RendBuff)
+#define RendWid               (machine_state.RendWid)
+#define RendOut               (machine_state.RendOut)
+#define RendStart             (machine_state.RendStart)
+#define RendPos               (machine_state.RendPos)
+#define PreRender             (machine_state.PreRender)
+
+#define Level_PP              (machine_state.Level_PP)
+#define LoopCount             (machine_state.LoopCount)
+#define LoopCountInit         (machine_state.LoopCountInit)
+#define Ton_EnA               (machine_state.Ton_EnA)
+#define Ton_EnB               (machine_state.Ton_EnB)
+#define Ton_EnC               (machine_state.Ton_EnC)
+#define Noise_EnA             (machine_state.Noise_EnA)
+#define Noise_EnB             (machine_state.Noise_EnB)
+#define Noise_EnC             (machine_state.Noise_EnC)
+#define Envelope_EnA          (machine_state.Envelope_EnA)
+#define Envelope_EnB          (machine_state.Envelope_EnB)
+#define Envelope_EnC          (machine_state.Envelope_EnC)
+#define Case_EnvType          (machine_state.Case_EnvType)
+#define Ton_Counter_A         (machine_state.Ton_Counter_A)
+#define Ton_Counter_B         (machine_state.Ton_Counter_B)
+#define Ton_Counter_C         (machine_state.Ton_Counter_C)
+#define Noise_Counter         (machine_state.Noise_Counter)
+#define Noise_Generator       (machine_state.Noise_Generator)
+#define Envelope_Counter      (machine_state.Envelope_Counter)
+#define Ton_A                 (machine_state.Ton_A)
+#define Ton_B                 (machine_state.Ton_B)
+#define Ton_C                 (machine_state.Ton_C)
+#define Level_AR              (machine_state.Level_AR)
+#define Level_AL              (machine_state.Level_AL)
+#define Level_BR              (machine_state.Level_BR)
+#define Level_BL              (machine_state.Level_BL)
+#define Level_CR              (machine_state.Level_CR)
+#define Level_CL              (machine_state.Level_CL)
+#define LevelTape             (machine_state.LevelTape)
+#define Index_AL              (machine_state.Index_AL)
+#define Index_AR              (machine_state.Index_AR)
+#define Index_BL              (machine_state.Index_BL)
+#define Index_BR              (machine_state.Index_BR)
+#define Index_CL              (machine_state.Index_CL)
+#define Index_CR              (machine_state.Index_CR)
+#define PreAmp                (machine_state.PreAmp)
+#define PreAmpMax             (machine_state.PreAmpMax)
+#define Left_Chan             (machine_state.Left_Chan)
+#define Right_Chan            (machine_state.Right_Chan)
+#define Samples_Pending       (machine_state.Samples_Pending)
+#define Sample_Bytes          (machine_state.Sample_Bytes)
+#define Synthesizer_Render    (machine_state.Synthesizer_Render)
+#define Blep_Residual_L       (machine_state.Blep_Residual_L)
+#define Blep_Residual_R       (machine_state.Blep_Residual_R)
+#define Blep_Pos              (machine_state.Blep_Pos)
+#define Blep_Level_L          (machine_state.Blep_Level_L)
+#define Blep_Level_R          (machine_state.Blep_Level_R)
+
+// To be called on each write through membank_write.
+inline void ram_mark_write(word addr) {
+   ram_page_stamp[membank_write_page[addr >> 14] + ((addr >> RAM_PAGE_SHIFT) & 3)] = ram_write_stamp;
+}
+
+#endif
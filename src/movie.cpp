@@ -0,0 +1,316 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Input movies.
+*/
+
+#include "movie.h"
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include "cap32.h"
+#include "errors.h"
+#include "log.h"
+
+extern thread_local t_CPC CPC;
+extern thread_local byte keyboard_matrix[16];
+
+namespace
+{
+
+const char MOVIE_MAGIC[8] = { 'C', 'P', 'C', 'M', 'O', 'V', 'I', 'E' };
+const byte MOVIE_VERSION = 1;
+const size_t MOVIE_HEADER_SIZE = sizeof(MOVIE_MAGIC) + 4;
+const byte PHAZER_CHANGED = 0x01;
+
+void put_varint(std::vector<byte>& out, dword val)
+{
+   while (val >= 0x80) {
+      out.push_back(static_cast<byte>(val | 0x80));
+      val >>= 7;
+   }
+   out.push_back(static_cast<byte>(val));
+}
+
+void put_word(std::vector<byte>& out, word val)
+{
+   out.push_back(val & 0xff);
+   out.push_back(val >> 8);
+}
+
+}
+
+bool t_MovieInput::operator==(const t_MovieInput& other) const
+{
+   return !memcmp(keyboard_matrix, other.keyboard_matrix, sizeof(keyboard_matrix)) &&
+          phazer_pressed == other.phazer_pressed && phazer_x == other.phazer_x && phazer_y == other.phazer_y;
+}
+
+t_MovieInput movie_idle_input()
+{
+   t_MovieInput input;
+   memset(input.keyboard_matrix, 0xff, sizeof(input.keyboard_matrix));
+   input.phazer_pressed = false;
+   input.phazer_x = 0;
+   input.phazer_y = 0;
+   return input;
+}
+
+
+
+MovieWriter::MovieWriter(unsigned int model, unsigned int ram_size) : last(movie_idle_input())
+{
+   buffer.insert(buffer.end(), MOVIE_MAGIC, MOVIE_MAGIC + sizeof(MOVIE_MAGIC));
+   buffer.push_back(MOVIE_VERSION);
+   buffer.push_back(model);
+   put_word(buffer, ram_size);
+}
+
+void MovieWriter::frame(const t_MovieInput& input)
+{
+   if (input != last) {
+      word rows = 0;
+      for (int row = 0; row < 16; row++) {
+         if (input.keyboard_matrix[row] != last.keyboard_matrix[row]) {
+            rows |= 1 << row;
+         }
+      }
+      byte flags = 0;
+      if (input.phazer_pressed != last.phazer_pressed || input.phazer_x != last.phazer_x || input.phazer_y != last.phazer_y) {
+         flags |= PHAZER_CHANGED;
+      }
+      put_varint(buffer, frames - last_change);
+      put_word(buffer, rows);
+      buffer.push_back(flags);
+      for (int row = 0; row < 16; row++) {
+         if (rows & (1 << row)) {
+            buffer.push_back(input.keyboard_matrix[row]);
+         }
+      }
+      if (flags & PHAZER_CHANGED) {
+         buffer.push_back(input.phazer_pressed);
+         put_word(buffer, input.phazer_x);
+         put_word(buffer, input.phazer_y);
+      }
+      last = input;
+      last_change = frames;
+   }
+   frames++;
+}
+
+void MovieWriter::finish()
+{
+   // A change of nothing marks the end.
+   put_varint(buffer, frames - last_change);
+   put_word(buffer, 0);
+   buffer.push_back(0);
+}
+
+
+
+bool MovieReader::open(const std::vector<byte>& data, unsigned int model, unsigned int ram_size)
+{
+   ended = true;
+   if (data.size() < MOVIE_HEADER_SIZE || memcmp(data.data(), MOVIE_MAGIC, sizeof(MOVIE_MAGIC))) {
+      LOG_ERROR("Not a movie file");
+      return false;
+   }
+   const byte *header = data.data() + sizeof(MOVIE_MAGIC);
+   if (header[0] != MOVIE_VERSION) {
+      LOG_ERROR("Unsupported movie version " << static_cast<int>(header[0]));
+      return false;
+   }
+   unsigned int movie_ram_size = header[2] | (header[3] << 8);
+   if (header[1] != model || movie_ram_size != ram_size) {
+      LOG_ERROR("Movie recorded on model " << static_cast<int>(header[1]) << " with " << movie_ram_size
+                << "kB of RAM, can't be replayed on model " << model << " with " << ram_size << "kB");
+      return false;
+   }
+   buffer = data;
+   pos = MOVIE_HEADER_SIZE;
+   current = movie_idle_input();
+   frames = 0;
+   ended = !readDelay(next_change);
+   return true;
+}
+
+bool MovieReader::frame(t_MovieInput& input)
+{
+   if (ended) {
+      return false;
+   }
+   if (frames == next_change && !readChange(current)) {
+      ended = true;
+      return false;
+   }
+   frames++;
+   input = current;
+   return true;
+}
+
+// Applies the change due for the current frame to input and reads the delay
+// until the next one. Returns false at the end of the movie.
+bool MovieReader::readChange(t_MovieInput& input)
+{
+   if (pos + 3 > buffer.size()) {
+      return false; // truncated recording
+   }
+   word rows = buffer[pos] | (buffer[pos + 1] << 8);
+   byte flags = buffer[pos + 2];
+   pos += 3;
+   if (!rows && !flags) {
+      return false;
+   }
+   for (int row = 0; row < 16; row++) {
+      if (rows & (1 << row)) {
+         if (pos >= buffer.size()) return false;
+         input.keyboard_matrix[row] = buffer[pos++];
+      }
+   }
+   if (flags & PHAZER_CHANGED) {
+      if (pos + 5 > buffer.size()) return false;
+      input.phazer_pressed = buffer[pos];
+      input.phazer_x = buffer[pos + 1] | (buffer[pos + 2] << 8);
+      input.phazer_y = buffer[pos + 3] | (buffer[pos + 4] << 8);
+      pos += 5;
+   }
+   dword delay;
+   if (!readDelay(delay)) {
+      // Truncated recording: keep the last inputs until the end.
+      delay = 0xffffffff - frames;
+   }
+   next_change = frames + delay;
+   return true;
+}
+
+bool MovieReader::readDelay(dword& delay)
+{
+   delay = 0;
+   for (int shift = 0; pos < buffer.size() && shift < 32; shift += 7) {
+      byte b = buffer[pos++];
+      delay |= static_cast<dword>(b & 0x7f) << shift;
+      if (!(b & 0x80)) {
+         return true;
+      }
+   }
+   return false;
+}
+
+
+
+namespace
+{
+
+thread_local std::unique_ptr<MovieWriter> movie_writer;
+thread_local std::unique_ptr<MovieReader> movie_reader;
+thread_local std::string movie_filename;
+thread_local t_MovieInput frame_input, host_input;
+
+t_MovieInput read_host_input()
+{
+   t_MovieInput input;
+   memcpy(input.keyboard_matrix, keyboard_matrix, sizeof(input.keyboard_matrix));
+   input.phazer_pressed = CPC.phazer_pressed;
+   input.phazer_x = CPC.phazer_x;
+   input.phazer_y = CPC.phazer_y;
+   return input;
+}
+
+void write_host_input(const t_MovieInput& input)
+{
+   memcpy(keyboard_matrix, input.keyboard_matrix, sizeof(input.keyboard_matrix));
+   CPC.phazer_pressed = input.phazer_pressed;
+   CPC.phazer_x = input.phazer_x;
+   CPC.phazer_y = input.phazer_y;
+}
+
+}
+
+int movie_record_start(const std::string& filename)
+{
+   movie_stop();
+   FILE *file = fopen(filename.c_str(), "wb");
+   if (!file) {
+      LOG_ERROR("Could not open movie file " << filename << " for writing");
+      return ERR_MOVIE_WRITE;
+   }
+   fclose(file);
+   movie_filename = filename;
+   movie_writer = std::make_unique<MovieWriter>(CPC.model, CPC.ram_size);
+   frame_input = read_host_input();
+   movie_writer->frame(frame_input);
+   LOG_INFO("Recording inputs to " << filename);
+   return 0;
+}
+
+int movie_replay_start(const std::string& filename)
+{
+   movie_stop();
+   FILE *file = fopen(filename.c_str(), "rb");
+   if (!file) {
+      LOG_ERROR("Could not open movie file " << filename);
+      return ERR_FILE_NOT_FOUND;
+   }
+   std::vector<byte> data;
+   byte chunk[4096];
+   size_t count;
+   while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+      data.insert(data.end(), chunk, chunk + count);
+   }
+   fclose(file);
+   movie_reader = std::make_unique<MovieReader>();
+   if (!movie_reader->open(data, CPC.model, CPC.ram_size) || !movie_reader->frame(frame_input)) {
+      movie_reader.reset();
+      return ERR_MOVIE_INVALID;
+   }
+   LOG_INFO("Replaying inputs from " << filename);
+   return 0;
+}
+
+void movie_stop()
+{
+   if (movie_writer) {
+      movie_writer->finish();
+      const std::vector<byte>& data = movie_writer->data();
+      FILE *file = fopen(movie_filename.c_str(), "wb");
+      if (!file || fwrite(data.data(), data.size(), 1, file) != 1) {
+         LOG_ERROR("Could not write movie file " << movie_filename);
+      }
+      if (file) {
+         fclose(file);
+      }
+      movie_writer.reset();
+   }
+   movie_reader.reset();
+}
+
+bool movie_active()
+{
+   return movie_writer || movie_reader;
+}
+
+void movie_begin_execute()
+{
+   if (!movie_active()) return;
+   host_input = read_host_input();
+   write_host_input(frame_input);
+}
+
+void movie_end_execute()
+{
+   if (!movie_active()) return;
+   write_host_input(host_input);
+}
+
+void movie_frame_completed()
+{
+   if (movie_writer) {
+      frame_input = read_host_input();
+      movie_writer->frame(frame_input);
+   } else if (movie_reader) {
+      if (!movie_reader->frame(frame_input)) {
+         LOG_INFO("End of movie reached");
+         movie_reader.reset();
+      }
+   }
+}
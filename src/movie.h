@@ -0,0 +1,84 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Input movies: recording of the inputs of the emulated CPC, frame by frame,
+   so that a run can be replayed exactly.
+   While a movie is recorded or replayed, the emulation only sees inputs change
+   at frame boundaries: host events received in the middle of a frame are held
+   back until the next one. Movies start at power on, and only reproduce a run
+   if replayed with the same configuration and media. Emulator commands (reset,
+   media changes, rewind...) are not part of them.
+*/
+
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include "types.h"
+#include <string>
+#include <vector>
+
+// Inputs of the emulated CPC during one frame.
+struct t_MovieInput {
+   byte keyboard_matrix[16];
+   bool phazer_pressed;
+   word phazer_x;
+   word phazer_y;
+
+   bool operator==(const t_MovieInput& other) const;
+   bool operator!=(const t_MovieInput& other) const { return !(*this == other); }
+};
+
+// Nothing pressed.
+t_MovieInput movie_idle_input();
+
+// Encodes the inputs of successive frames. Only the changes are stored: the
+// number of frames since the previous change, a mask of the keyboard matrix
+// rows that changed, their new values and, if it changed, the phazer state.
+class MovieWriter {
+  public:
+    MovieWriter(unsigned int model, unsigned int ram_size);
+
+    // Inputs for the next frame.
+    void frame(const t_MovieInput& input);
+    // Marks the end of the movie, no frame can be added after.
+    void finish();
+    const std::vector<byte>& data() const { return buffer; }
+
+  private:
+    std::vector<byte> buffer;
+    t_MovieInput last;
+    dword frames = 0;
+    dword last_change = 0;
+};
+
+class MovieReader {
+  public:
+    // Returns false if data is not a movie recorded with this configuration.
+    bool open(const std::vector<byte>& data, unsigned int model, unsigned int ram_size);
+    // Inputs for the next frame. Returns false once the end of the movie is reached.
+    bool frame(t_MovieInput& input);
+
+  private:
+    bool readChange(t_MovieInput& input);
+    bool readDelay(dword& delay);
+
+    std::vector<byte> buffer;
+    size_t pos = 0;
+    t_MovieInput current;
+    dword frames = 0;
+    dword next_change = 0;
+    bool ended = true;
+};
+
+int movie_record_start(const std::string& filename);
+int movie_replay_start(const std::string& filename);
+// Stops the movie in progress. A recording is written to its file.
+void movie_stop();
+bool movie_active();
+// To be called around each z80_execute: replaces the host inputs by the ones
+// of the current frame of the movie, and back.
+void movie_begin_execute();
+void movie_end_execute();
+// To be called each time a frame is complete, to move on to the next frame.
+void movie_frame_completed();
+
+#endif
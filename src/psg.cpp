@@ -23,19 +23,26 @@
 */
 
 #include <math.h>
+#include <algorithm>
+#include <complex>
 #include <memory>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "cap32.h"
+#include "capture.h"
 #include "z80.h"
 #include "log.h"
+#include "machinestate.h"
 
-extern t_CPC CPC;
-extern t_PSG PSG;
+extern thread_local t_CPC CPC;
 extern dword freq_table[];
 
 extern std::unique_ptr<byte[]> pbSndBuffer;
 extern byte *pbSndBufferEnd;
-extern byte bTapeLevel;
+extern thread_local byte bTapeLevel;
 
 #define TAPE_VOLUME 32
 
@@ -45,52 +52,14 @@ word Amplitudes_AY[16] = {
    10392, 16706, 23339, 29292, 36969, 46421, 55195, 65535
 };
 
-int Level_PP[256];
 
-union TLoopCount {
-   struct {
-      dword Lo;
-      dword Hi;
-   };
-   int64_t Re;
-} LoopCount;
-int64_t LoopCountInit;
-
-bool Ton_EnA, Ton_EnB, Ton_EnC, Noise_EnA, Noise_EnB, Noise_EnC;
-bool Envelope_EnA, Envelope_EnB, Envelope_EnC;
-void (*Case_EnvType)();
-
-union TCounter {
-   struct {
-      word Lo;
-      word Hi;
-   };
-   dword Re;
-};
-TCounter Ton_Counter_A, Ton_Counter_B, Ton_Counter_C, Noise_Counter;
-
-union TNoise {
-   struct {
-      word Low;
-      word Val;
-   };
-   dword Seed;
-} Noise;
-
-union TEnvelopeCounter {
-   struct {
-      dword Lo;
-      dword Hi;
-   };
-   int64_t Re;
-} Envelope_Counter;
-byte Ton_A, Ton_B, Ton_C;
-
-int Level_AR[32], Level_AL[32], Level_BR[32], Level_BL[32], Level_CR[32], Level_CL[32];
-int LevelTape;
-byte Index_AL, Index_AR, Index_BL, Index_BR, Index_CL, Index_CR;
-int PreAmp, PreAmpMax;
-int Left_Chan, Right_Chan;
+// Band-limited synthesis: each change of level is output as a minBLEP, the
+// step response of a minimum phase low-pass filter, instead of averaging the
+// levels of the ticks of a sample. Steps are positioned with the precision of
+// the fraction of sample they happen at.
+#define BLEP_ZERO_CROSSINGS 8
+#define BLEP_OVERSAMPLING 32
+#define BLEP_WIDTH (2 * BLEP_ZERO_CROSSINGS) // in samples
 
 
 
@@ -288,6 +257,8 @@ inline void SetEnvelopeRegister(byte Value)
 
 void SetAYRegister(int Num, byte Value)
 {
+   AY_flush(); // the samples due were played with the previous value
+   capture_ay_register(Num);
    switch(Num)
    {
       case 13:
@@ -345,7 +316,7 @@ inline void Synthesizer_Logic_Q()
    Noise_Counter.Hi++;
    if ((!(Noise_Counter.Hi & 1)) && (Noise_Counter.Hi >= (PSG.RegisterAY.Noise << 1))) {
       Noise_Counter.Hi = 0;
-      Noise.Seed = (((((Noise.Seed >> 13) ^ (Noise.Seed >> 16)) & 1) ^ 1) | Noise.Seed << 1) & 0x1ffff;
+      Noise_Generator.Seed = (((((Noise_Generator.Seed >> 13) ^ (Noise_Generator.Seed >> 16)) & 1) ^ 1) | Noise_Generator.Seed << 1) & 0x1ffff;
    }
    if (!Envelope_Counter.Hi) {
       Case_EnvType();
@@ -380,7 +351,7 @@ inline void Synthesizer_Mixer_Q()
       k = 1;
    }
    if (Noise_EnA) {
-      k &= Noise.Val;
+      k &= Noise_Generator.Val;
    }
    if (k) {
       if (Envelope_EnA) {
@@ -405,7 +376,7 @@ inline void Synthesizer_Mixer_Q()
       k = 1;
    }
    if (Noise_EnB) {
-      k &= Noise.Val;
+      k &= Noise_Generator.Val;
    }
    if (k) {
       if (Envelope_EnB) {
@@ -430,7 +401,7 @@ inline void Synthesizer_Mixer_Q()
       k = 1;
    }
    if (Noise_EnC) {
-      k &= Noise.Val;
+      k &= Noise_Generator.Val;
    }
    if (k) {
       if (Envelope_EnC) {
@@ -449,8 +420,12 @@ inline void Synthesizer_Mixer_Q()
 
 
 
+// Per sample synthesizers, running the AY and the mixer tick by tick. The block
+// synthesizer below produces the same output faster and is the one used: they
+// remain as its reference.
 void Synthesizer_Stereo16()
 {
+   t_CPC& cpc = CPC; // thread local, see render8bpp in crtc.cpp
    int Tick_Counter = 0;
    while (LoopCount.Hi) {
       Synthesizer_Logic_Q();
@@ -462,12 +437,12 @@ void Synthesizer_Stereo16()
    reg_pair val;
    val.w.l = Left_Chan / Tick_Counter;
    val.w.h = Right_Chan / Tick_Counter;
-   *reinterpret_cast<dword *>(CPC.snd_bufferptr) = val.d; // write to mixing buffer
-   CPC.snd_bufferptr += 4;
+   *reinterpret_cast<dword *>(cpc.snd_bufferptr) = val.d; // write to mixing buffer
+   cpc.snd_bufferptr += 4;
    Left_Chan = 0;
    Right_Chan = Left_Chan;
-   if (CPC.snd_bufferptr >= pbSndBufferEnd) {
-      CPC.snd_bufferptr = pbSndBuffer.get();
+   if (cpc.snd_bufferptr >= pbSndBufferEnd) {
+      cpc.snd_bufferptr = pbSndBuffer.get();
       PSG.buffer_full = 1;
    }
 }
@@ -476,6 +451,7 @@ void Synthesizer_Stereo16()
 
 void Synthesizer_Stereo8()
 {
+   t_CPC& cpc = CPC; // thread local, see render8bpp in crtc.cpp
    int Tick_Counter = 0;
    while (LoopCount.Hi) {
       Synthesizer_Logic_Q();
@@ -487,12 +463,12 @@ void Synthesizer_Stereo8()
    reg_pair val;
    val.b.l = 128 + Left_Chan / Tick_Counter;
    val.b.h = 128 + Right_Chan / Tick_Counter;
-   *reinterpret_cast<word *>(CPC.snd_bufferptr) = val.w.l; // write to mixing buffer
-   CPC.snd_bufferptr += 2;
+   *reinterpret_cast<word *>(cpc.snd_bufferptr) = val.w.l; // write to mixing buffer
+   cpc.snd_bufferptr += 2;
    Left_Chan = 0;
    Right_Chan = Left_Chan;
-   if (CPC.snd_bufferptr >= pbSndBufferEnd) {
-      CPC.snd_bufferptr = pbSndBuffer.get();
+   if (cpc.snd_bufferptr >= pbSndBufferEnd) {
+      cpc.snd_bufferptr = pbSndBuffer.get();
       PSG.buffer_full = 1;
    }
 }
@@ -520,7 +496,7 @@ inline void Synthesizer_Mixer_Q_Mono()
       k = 1;
    }
    if (Noise_EnA) {
-      k &= Noise.Val;
+      k &= Noise_Generator.Val;
    }
    if (k) {
       if (Envelope_EnA) {
@@ -543,7 +519,7 @@ inline void Synthesizer_Mixer_Q_Mono()
       k = 1;
    }
    if (Noise_EnB) {
-      k &= Noise.Val;
+      k &= Noise_Generator.Val;
    }
    if (k) {
       if (Envelope_EnB) {
@@ -566,7 +542,7 @@ inline void Synthesizer_Mixer_Q_Mono()
       k = 1;
    }
    if (Noise_EnC) {
-      k &= Noise.Val;
+      k &= Noise_Generator.Val;
    }
    if (k) {
       if (Envelope_EnC) {
@@ -584,6 +560,7 @@ inline void Synthesizer_Mixer_Q_Mono()
 
 void Synthesizer_Mono16()
 {
+   t_CPC& cpc = CPC; // thread local, see render8bpp in crtc.cpp
    int Tick_Counter = 0;
    while (LoopCount.Hi) {
       Synthesizer_Logic_Q();
@@ -592,11 +569,11 @@ void Synthesizer_Mono16()
       LoopCount.Hi--;
    }
    LoopCount.Re += LoopCountInit;
-   *reinterpret_cast<word *>(CPC.snd_bufferptr) = Left_Chan / Tick_Counter; // write to mixing buffer
-   CPC.snd_bufferptr += 2;
+   *reinterpret_cast<word *>(cpc.snd_bufferptr) = Left_Chan / Tick_Counter; // write to mixing buffer
+   cpc.snd_bufferptr += 2;
    Left_Chan = 0;
-   if (CPC.snd_bufferptr >= pbSndBufferEnd) {
-      CPC.snd_bufferptr = pbSndBuffer.get();
+   if (cpc.snd_bufferptr >= pbSndBufferEnd) {
+      cpc.snd_bufferptr = pbSndBuffer.get();
       PSG.buffer_full = 1;
    }
 }
@@ -605,6 +582,7 @@ void Synthesizer_Mono16()
 
 void Synthesizer_Mono8()
 {
+   t_CPC& cpc = CPC; // thread local, see render8bpp in crtc.cpp
    int Tick_Counter = 0;
    while (LoopCount.Hi) {
       Synthesizer_Logic_Q();
@@ -613,17 +591,365 @@ void Synthesizer_Mono8()
       LoopCount.Hi--;
    }
    LoopCount.Re += LoopCountInit;
-   *reinterpret_cast<byte *>(CPC.snd_bufferptr) = 128 + Left_Chan / Tick_Counter; // write to mixing buffer
-   CPC.snd_bufferptr++;
+   *reinterpret_cast<byte *>(cpc.snd_bufferptr) = 128 + Left_Chan / Tick_Counter; // write to mixing buffer
+   cpc.snd_bufferptr++;
    Left_Chan = 0;
-   if (CPC.snd_bufferptr >= pbSndBufferEnd) {
-      CPC.snd_bufferptr = pbSndBuffer.get();
+   if (cpc.snd_bufferptr >= pbSndBufferEnd) {
+      cpc.snd_bufferptr = pbSndBuffer.get();
       PSG.buffer_full = 1;
    }
 }
 
 
 
+// Block synthesizer: the samples due are only counted, and rendered all at
+// once when what they depend on is about to change (AY register, tape level,
+// Digiblaster) or when the sound buffer is full. Over a block, tone, noise and
+// envelope are generated run by run rather than tick by tick, then the
+// channels are mixed several ticks at a time.
+
+#define AY_BLOCK_TICKS 512
+
+// Tone of a channel for count ticks (-1 when high), as Synthesizer_Logic_Q
+// does. out can be null to only advance the counter.
+void Tone_Run(int *out, int count, TCounter& counter, byte& ton, word period)
+{
+   int t = 0;
+   while (t < count) {
+      int run = std::max(static_cast<int>(period) - counter.Hi, 1); // ticks until the next toggle
+      if (run > count - t) {
+         if (out) std::fill(out + t, out + count, ton ? -1 : 0);
+         counter.Hi += count - t;
+         return;
+      }
+      if (out) std::fill(out + t, out + t + run - 1, ton ? -1 : 0);
+      ton ^= 1;
+      if (out) out[t + run - 1] = ton ? -1 : 0;
+      counter.Hi = 0;
+      t += run;
+   }
+}
+
+
+
+void Noise_Run(int *out, int count)
+{
+   int t = 0;
+   while (t < count) {
+      // The noise generator steps on the first even count reaching its period.
+      int next = std::max(PSG.RegisterAY.Noise << 1, Noise_Counter.Hi + 1);
+      int run = next + (next & 1) - Noise_Counter.Hi;
+      if (run > count - t) {
+         if (out) std::fill(out + t, out + count, Noise_Generator.Val ? -1 : 0);
+         Noise_Counter.Hi += count - t;
+         return;
+      }
+      if (out) std::fill(out + t, out + t + run - 1, Noise_Generator.Val ? -1 : 0);
+      Noise_Generator.Seed = (((((Noise_Generator.Seed >> 13) ^ (Noise_Generator.Seed >> 16)) & 1) ^ 1) | Noise_Generator.Seed << 1) & 0x1ffff;
+      if (out) out[t + run - 1] = Noise_Generator.Val ? -1 : 0;
+      Noise_Counter.Hi = 0;
+      t += run;
+   }
+}
+
+
+
+// Envelope amplitude for count ticks.
+void Envelope_Run(int *out, int count)
+{
+   dword period = PSG.RegisterAY.Envelope;
+   int t = 0;
+   while (t < count) {
+      if (!Envelope_Counter.Hi) {
+         Case_EnvType();
+      }
+      int run = (Envelope_Counter.Hi + 1 >= period) ? 1 : period - Envelope_Counter.Hi;
+      run = std::min(run, count - t);
+      if (out) std::fill(out + t, out + t + run, PSG.AmplitudeEnv);
+      Envelope_Counter.Hi += run;
+      if (Envelope_Counter.Hi >= period) {
+         Envelope_Counter.Hi = 0;
+      }
+      t += run;
+   }
+}
+
+
+
+// Level of a channel on one side for count ticks.
+void Channel_Levels(int *out, int count, const int *table, bool fixed, byte amplitude, const int *envelope)
+{
+   if (fixed) {
+      std::fill(out, out + count, table[amplitude * 2 + 1]);
+   }
+   else {
+      for (int t = 0; t < count; t++) {
+         out[t] = table[envelope[t]];
+      }
+   }
+}
+
+
+
+// Sum of the levels of the audible channels: out[t] = base + (k[c][t] & level[c][t]) for the 3 channels.
+void Mix_Channels(int *out, int count, int base, int (*k)[AY_BLOCK_TICKS], int (*level)[AY_BLOCK_TICKS])
+{
+   int t = 0;
+#ifdef __SSE2__
+   __m128i vbase = _mm_set1_epi32(base);
+   for (; t + 4 <= count; t += 4) {
+      __m128i a = _mm_and_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(k[0] + t)), _mm_load_si128(reinterpret_cast<const __m128i*>(level[0] + t)));
+      __m128i b = _mm_and_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(k[1] + t)), _mm_load_si128(reinterpret_cast<const __m128i*>(level[1] + t)));
+      __m128i c = _mm_and_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(k[2] + t)), _mm_load_si128(reinterpret_cast<const __m128i*>(level[2] + t)));
+      _mm_store_si128(reinterpret_cast<__m128i*>(out + t), _mm_add_epi32(_mm_add_epi32(vbase, a), _mm_add_epi32(b, c)));
+   }
+#endif
+   for (; t < count; t++) {
+      out[t] = base + (k[0][t] & level[0][t]) + (k[1][t] & level[1][t]) + (k[2][t] & level[2][t]);
+   }
+}
+
+
+
+// minBLEP table (Brandt's method): a windowed sinc made minimum phase through
+// its real cepstrum, then integrated. Holds the step response minus 1, BLEP_WIDTH
+// samples long with BLEP_OVERSAMPLING points per sample.
+std::vector<float> Make_MinBLEP()
+{
+   const int n = BLEP_WIDTH * BLEP_OVERSAMPLING;
+   const double pi = 3.14159265358979323846;
+   auto dft = [n, pi](const std::vector<std::complex<double>>& in, int sign) {
+      std::vector<std::complex<double>> out(n);
+      for (int k = 0; k < n; k++) {
+         std::complex<double> sum = 0;
+         for (int i = 0; i < n; i++) {
+            sum += in[i] * std::polar(1.0, sign * 2 * pi * ((static_cast<long>(k) * i) % n) / n);
+         }
+         out[k] = (sign > 0) ? sum / static_cast<double>(n) : sum;
+      }
+      return out;
+   };
+   std::vector<std::complex<double>> buf(n);
+   for (int i = 0; i < n; i++) { // Blackman windowed sinc
+      double x = (i - n / 2.0) / BLEP_OVERSAMPLING;
+      double sinc = (x == 0) ? 1 : sin(pi * x) / (pi * x);
+      double window = 0.42 - 0.5 * cos(2 * pi * i / n) + 0.08 * cos(4 * pi * i / n);
+      buf[i] = sinc * window;
+   }
+   buf = dft(buf, -1);
+   for (auto& x : buf) {
+      x = log(std::max(std::abs(x), 1e-9));
+   }
+   buf = dft(buf, 1); // real cepstrum
+   for (int i = 1; i < n / 2; i++) { // fold to minimum phase
+      buf[i] *= 2;
+   }
+   for (int i = n / 2 + 1; i < n; i++) {
+      buf[i] = 0;
+   }
+   buf = dft(buf, -1);
+   for (auto& x : buf) {
+      x = std::exp(x);
+   }
+   buf = dft(buf, 1);
+   std::vector<float> table(n);
+   double sum = 0, total = 0;
+   for (int i = 0; i < n; i++) {
+      total += buf[i].real();
+   }
+   for (int i = 0; i < n; i++) {
+      sum += buf[i].real();
+      table[i] = static_cast<float>(sum / total - 1);
+   }
+   return table;
+}
+
+
+
+const float *MinBLEP()
+{
+   static const std::vector<float> table = Make_MinBLEP();
+   return table.data();
+}
+
+
+
+// Adds a step of delta happening offset samples (0 to 1) before the next sample out.
+inline void Blep_Step(float *residual, const float *blep, int delta, float offset)
+{
+   int phase = std::min(static_cast<int>(offset * BLEP_OVERSAMPLING), BLEP_OVERSAMPLING - 1);
+   for (int i = 0; i < BLEP_WIDTH; i++) {
+      residual[(Blep_Pos + i) & (BLEP_RING - 1)] += delta * blep[i * BLEP_OVERSAMPLING + phase];
+   }
+}
+
+
+
+inline int Blep_Output(float *residual, int level, int min, int max)
+{
+   int val = level + static_cast<int>(lrintf(residual[Blep_Pos]));
+   residual[Blep_Pos] = 0;
+   return std::min(std::max(val, min), max);
+}
+
+
+
+template<bool Stereo, bool Bits16, bool BandLimited>
+void Synthesizer_Render_Block(int count)
+{
+   t_CPC& cpc = CPC; // thread local, see render8bpp in crtc.cpp
+   alignas(16) int k[3][AY_BLOCK_TICKS]; // whether each channel is audible
+   alignas(16) int noise[AY_BLOCK_TICKS];
+   alignas(16) int envelope[AY_BLOCK_TICKS];
+   alignas(16) int level[3][AY_BLOCK_TICKS];
+   alignas(16) int left[AY_BLOCK_TICKS], right[AY_BLOCK_TICKS];
+   int ticks[AY_BLOCK_TICKS];
+   float offset[AY_BLOCK_TICKS]; // of the last tick of each sample before the sample, in samples
+
+   const bool ton_en[3] = { Ton_EnA, Ton_EnB, Ton_EnC };
+   const bool noise_en[3] = { Noise_EnA, Noise_EnB, Noise_EnC };
+   const bool fixed[3] = { Envelope_EnA, Envelope_EnB, Envelope_EnC };
+   const word ton[3] = { PSG.RegisterAY.TonA, PSG.RegisterAY.TonB, PSG.RegisterAY.TonC };
+   const byte amplitude[3] = { PSG.RegisterAY.AmplitudeA, PSG.RegisterAY.AmplitudeB, PSG.RegisterAY.AmplitudeC };
+   TCounter *counter[3] = { &Ton_Counter_A, &Ton_Counter_B, &Ton_Counter_C };
+   byte *ton_bit[3] = { &Ton_A, &Ton_B, &Ton_C };
+   const int *table_l[3] = { Level_AL, Level_BL, Level_CL };
+   const int *table_r[3] = { Level_AR, Level_BR, Level_CR };
+   bool use_tone[3];
+   for (int c = 0; c < 3; c++) {
+      use_tone[c] = ton_en[c] && (!fixed[c] || ton[c] > 4);
+   }
+   const bool use_noise = noise_en[0] || noise_en[1] || noise_en[2];
+   const bool use_envelope = !fixed[0] || !fixed[1] || !fixed[2];
+   int base = bTapeLevel ? LevelTape : 0; // start with the tape signal
+   if (cpc.snd_pp_device) {
+      base += Level_PP[cpc.printer_port];
+   }
+   const float *blep = BandLimited ? MinBLEP() : nullptr;
+   const float samples_per_tick = 4294967296.0f / LoopCountInit;
+   const int min = Bits16 ? -32768 : -128;
+   const int max = Bits16 ? 32767 : 127;
+
+   while (count) {
+      // As many samples as the tick buffers can hold.
+      int samples = 0, total = 0;
+      while (samples < count && total + static_cast<int>(LoopCount.Hi) <= AY_BLOCK_TICKS) {
+         offset[samples] = LoopCount.Lo / 4294967296.0f * samples_per_tick;
+         ticks[samples++] = LoopCount.Hi;
+         total += LoopCount.Hi;
+         LoopCount.Hi = 0;
+         LoopCount.Re += LoopCountInit;
+      }
+      count -= samples;
+
+      for (int c = 0; c < 3; c++) {
+         Tone_Run(use_tone[c] ? k[c] : nullptr, total, *counter[c], *ton_bit[c], ton[c]);
+         if (!use_tone[c]) {
+            std::fill(k[c], k[c] + total, -1);
+         }
+      }
+      Noise_Run(use_noise ? noise : nullptr, total);
+      Envelope_Run(use_envelope ? envelope : nullptr, total);
+      for (int c = 0; c < 3; c++) {
+         if (noise_en[c]) {
+            for (int t = 0; t < total; t++) {
+               k[c][t] &= noise[t];
+            }
+         }
+      }
+
+      for (int c = 0; c < 3; c++) {
+         Channel_Levels(level[c], total, table_l[c], fixed[c], amplitude[c], envelope);
+      }
+      Mix_Channels(left, total, base, k, level);
+      if (Stereo) {
+         for (int c = 0; c < 3; c++) {
+            Channel_Levels(level[c], total, table_r[c], fixed[c], amplitude[c], envelope);
+         }
+         Mix_Channels(right, total, base, k, level);
+      }
+
+      const int *l = left, *r = right;
+      for (int i = 0; i < samples; i++) {
+         int n = ticks[i];
+         int out_l, out_r = 0;
+         if (BandLimited) {
+            for (int t = 0; t < n; t++) {
+               float before = offset[i] + (n - 1 - t) * samples_per_tick;
+               if (l[t] != Blep_Level_L) {
+                  Blep_Step(Blep_Residual_L, blep, l[t] - Blep_Level_L, before);
+                  Blep_Level_L = l[t];
+               }
+               if (Stereo && r[t] != Blep_Level_R) {
+                  Blep_Step(Blep_Residual_R, blep, r[t] - Blep_Level_R, before);
+                  Blep_Level_R = r[t];
+               }
+            }
+            out_l = Blep_Output(Blep_Residual_L, Blep_Level_L, min, max);
+            if (Stereo) out_r = Blep_Output(Blep_Residual_R, Blep_Level_R, min, max);
+            Blep_Pos = (Blep_Pos + 1) & (BLEP_RING - 1);
+         }
+         else {
+            int sum_l = 0, sum_r = 0;
+            for (int t = 0; t < n; t++) {
+               sum_l += l[t];
+               if (Stereo) sum_r += r[t];
+            }
+            out_l = sum_l / n;
+            out_r = sum_r / n;
+         }
+         l += n;
+         r += n;
+         if (Stereo && Bits16) {
+            reg_pair val;
+            val.w.l = out_l;
+            val.w.h = out_r;
+            *reinterpret_cast<dword *>(cpc.snd_bufferptr) = val.d;
+         }
+         else if (Stereo) {
+            reg_pair val;
+            val.b.l = 128 + out_l;
+            val.b.h = 128 + out_r;
+            *reinterpret_cast<word *>(cpc.snd_bufferptr) = val.w.l;
+         }
+         else if (Bits16) {
+            *reinterpret_cast<word *>(cpc.snd_bufferptr) = out_l;
+         }
+         else {
+            *reinterpret_cast<byte *>(cpc.snd_bufferptr) = 128 + out_l;
+         }
+         cpc.snd_bufferptr += Sample_Bytes;
+         if (cpc.snd_bufferptr >= pbSndBufferEnd) {
+            cpc.snd_bufferptr = pbSndBuffer.get();
+            PSG.buffer_full = 1;
+         }
+      }
+   }
+}
+
+
+
+void Synthesizer_Block()
+{
+   Samples_Pending++;
+   if (CPC.snd_bufferptr + Samples_Pending * Sample_Bytes >= pbSndBufferEnd) {
+      AY_flush(); // the buffer needs them
+   }
+}
+
+
+
+void AY_flush()
+{
+   if (Samples_Pending) {
+      int count = Samples_Pending;
+      Samples_Pending = 0;
+      Synthesizer_Render(count);
+   }
+}
+
+
+
 void Calculate_Level_Tables()
 {
    int i, b, l, r;
@@ -717,7 +1043,13 @@ void ResetAYChipEmulation()
    Ton_C = 0;
    Left_Chan = 0;
    Right_Chan = 0;
-   Noise.Seed = 0xffff;
+   Samples_Pending = 0;
+   std::fill(Blep_Residual_L, Blep_Residual_L + BLEP_RING, 0.0f);
+   std::fill(Blep_Residual_R, Blep_Residual_R + BLEP_RING, 0.0f);
+   Blep_Pos = 0;
+   Blep_Level_L = 0;
+   Blep_Level_R = 0;
+   Noise_Generator.Seed = 0xffff;
 }
 
 
@@ -750,18 +1082,65 @@ void InitAY()
 
    if (CPC.snd_stereo) { // stereo mode?
       if (CPC.snd_bits) { // 16 bits per sample?
-         PSG.Synthesizer = Synthesizer_Stereo16;
+         Synthesizer_Render = CPC.snd_band_limited ? Synthesizer_Render_Block<true, true, true> : Synthesizer_Render_Block<true, true, false>;
+         Sample_Bytes = 4;
       }
       else { // 8 bits
-         PSG.Synthesizer = Synthesizer_Stereo8;
+         Synthesizer_Render = CPC.snd_band_limited ? Synthesizer_Render_Block<true, false, true> : Synthesizer_Render_Block<true, false, false>;
+         Sample_Bytes = 2;
       }
    }
    else { // mono
       if (CPC.snd_bits) { // 16 bits per sample?
-         PSG.Synthesizer = Synthesizer_Mono16;
+         Synthesizer_Render = CPC.snd_band_limited ? Synthesizer_Render_Block<false, true, true> : Synthesizer_Render_Block<false, true, false>;
+         Sample_Bytes = 2;
       }
       else { // 8 bits
-         PSG.Synthesizer = Synthesizer_Mono8;
+         Synthesizer_Render = CPC.snd_band_limited ? Synthesizer_Render_Block<false, false, true> : Synthesizer_Render_Block<false, false, false>;
+         Sample_Bytes = 1;
       }
    }
+   if (CPC.snd_band_limited) {
+      MinBLEP(); // computed now rather than in the middle of the sound
+   }
+   PSG.Synthesizer = Synthesizer_Block;
+}
+
+
+
+// Synthesizer state that is not part of t_PSG, copied as is in save states.
+#define AY_STATE_FIELDS(FIELD) \
+   FIELD(LoopCount) FIELD(Ton_EnA) FIELD(Ton_EnB) FIELD(Ton_EnC) \
+   FIELD(Noise_EnA) FIELD(Noise_EnB) FIELD(Noise_EnC) \
+   FIELD(Envelope_EnA) FIELD(Envelope_EnB) FIELD(Envelope_EnC) FIELD(Case_EnvType) \
+   FIELD(Ton_Counter_A) FIELD(Ton_Counter_B) FIELD(Ton_Counter_C) FIELD(Noise_Counter) \
+   FIELD(Noise_Generator) FIELD(Envelope_Counter) FIELD(Ton_A) FIELD(Ton_B) FIELD(Ton_C) \
+   FIELD(Left_Chan) FIELD(Right_Chan) FIELD(Samples_Pending) \
+   FIELD(Blep_Residual_L) FIELD(Blep_Residual_R) FIELD(Blep_Pos) FIELD(Blep_Level_L) FIELD(Blep_Level_R)
+
+size_t AY_state_size()
+{
+   size_t size = 0;
+   #define AY_FIELD_SIZE(field) size += sizeof(field);
+   AY_STATE_FIELDS(AY_FIELD_SIZE)
+   #undef AY_FIELD_SIZE
+   return size;
+}
+
+
+
+void AY_save_state(byte *dst)
+{
+   #define AY_FIELD_SAVE(field) memcpy(dst, &field, sizeof(field)); dst += sizeof(field);
+   AY_STATE_FIELDS(AY_FIELD_SAVE)
+   #undef AY_FIELD_SAVE
+}
+
+
+
+void AY_load_state(const byte *src)
+{
+   #define AY_FIELD_LOAD(field) memcpy(&field, src, sizeof(field)); src += sizeof(field);
+   AY_STATE_FIELDS(AY_FIELD_LOAD)
+   #undef AY_FIELD_LOAD
 }
@@ -63,7 +63,7 @@ SDL_Surface *SDL_PNGFormatAlpha(SDL_Surface *src)
   return surf;
 }
 
-int SDL_SavePNG(SDL_Surface *src, const std::string& file)
+int SDL_SavePNG(SDL_Surface *src, const std::string& file, int compression)
 {
   /* Initialize and do basic error checking */
   if (!src)
@@ -140,6 +140,9 @@ int SDL_SavePNG(SDL_Surface *src, const std::string& file)
 
 //  png_set_packing(png_ptr);
 
+  if (compression >= 0)
+    png_set_compression_level(png_ptr, compression);
+
   /* Allow BGR surfaces */
   if (surface->format->Rmask == bmask
       && surface->format->Gmask == gmask
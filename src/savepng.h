@@ -16,10 +16,12 @@
  * 
  * surface - the SDL_Surface structure containing the image to be saved
  * file - the filename to save to
+ * compression - zlib compression level from 0 (none) to 9 (best), or -1 for
+ *               the zlib default
  *
  * Returns 0 success or -1 on failure, the error message is then retrievable
  * via SDL_GetError().
  */
-extern int SDL_SavePNG(SDL_Surface *surface, const std::string& file);
+extern int SDL_SavePNG(SDL_Surface *surface, const std::string& file, int compression = -1);
 
 #endif
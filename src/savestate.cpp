@@ -0,0 +1,457 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   In-memory save states and rewind history.
+*/
+
+#include "savestate.h"
+
+#include <algorithm>
+#include <cstring>
+#include "asic.h"
+#include "cap32.h"
+#include "crtc.h"
+#include "disk.h"
+#include "errors.h"
+#include "z80.h"
+#include "machinestate.h"
+
+extern thread_local t_CPC CPC;
+extern thread_local t_drive driveA;
+extern thread_local t_drive driveB;
+extern thread_local byte *pbMF2ROM;
+extern thread_local byte *pbCartridgePages[];
+extern thread_local dword read_status_delay;
+
+// crtc.cpp
+
+// tape.cpp
+extern thread_local std::vector<byte> pbTapeImage;
+extern thread_local byte bTapeLevel, bTapeData;
+extern thread_local byte *pbTapeBlock, *pbTapeBlockData;
+extern thread_local word *pwTapePulseTable, *pwTapePulseTableEnd, *pwTapePulseTablePtr;
+extern thread_local word wCycleTable[2];
+extern thread_local int iTapeCycleCount;
+extern thread_local dword dwTapePulseCycles, dwTapeZeroPulseCycles, dwTapeOnePulseCycles;
+extern thread_local dword dwTapeStage, dwTapePulseCount, dwTapeDataCount, dwTapeBitsToShift;
+
+namespace
+{
+
+const dword SAVESTATE_MAGIC = 0x31545343; // "CST1"
+const size_t MF2_RAM_OFFSET = 8192;
+const size_t MF2_RAM_SIZE = 8192;
+
+// Identifies the configuration a state was captured with.
+struct t_SaveStateHeader {
+   dword magic;
+   dword size;
+   unsigned int model;
+   unsigned int ram_size;
+   unsigned int mf2;
+   byte *cartridge;
+   const byte *tape_image;
+   size_t tape_size;
+   const byte *ram;
+   dword ram_checkpoint; // RAM pages not written to since are already in the state
+};
+
+// Pointers of the CRTC rendering pipeline, stored as positions in the tables
+// they point to so that they survive a change of video settings.
+struct t_RenderState {
+   int prerender; // 0: normal, 1: border, 2: sync
+   int mode_map;
+   int rend_wid;
+   int rend_out;
+   int rend_pos;
+   int scr_offset; // of the rendering position in the current surface row
+};
+
+// Copies the bytes of the visited fields in a state.
+// When given the checkpoint of a previous capture in the same buffer, only the
+// RAM pages written to since are copied.
+class StateWriter {
+  public:
+    StateWriter(byte *pos, bool incremental, dword checkpoint) : pos(pos), incremental(incremental), checkpoint(checkpoint) {}
+    void bytes(void *data, size_t size) {
+      memcpy(pos, data, size);
+      pos += size;
+    }
+    void ram(byte *data, size_t size) {
+      if (!incremental) {
+        bytes(data, size);
+        return;
+      }
+      for (size_t offset = 0; offset < size; offset += RAM_PAGE_SIZE) {
+        if (ram_page_written_since(offset >> RAM_PAGE_SHIFT, checkpoint)) {
+          memcpy(pos + offset, data + offset, std::min(size - offset, static_cast<size_t>(RAM_PAGE_SIZE)));
+        }
+      }
+      pos += size;
+    }
+    template <typename T> void operator()(T& field) { bytes(&field, sizeof(field)); }
+
+  private:
+    byte *pos;
+    bool incremental;
+    dword checkpoint;
+};
+
+// Copies the bytes of a state back in the visited fields.
+class StateReader {
+  public:
+    explicit StateReader(const byte *pos) : pos(pos) {}
+    void bytes(void *data, size_t size) {
+      memcpy(data, pos, size);
+      pos += size;
+    }
+    void skip(size_t size) { pos += size; }
+    void ram(byte *data, size_t size) { bytes(data, size); }
+    template <typename T> void operator()(T& field) { bytes(&field, sizeof(field)); }
+
+  private:
+    const byte *pos;
+};
+
+// Counts the bytes of the visited fields.
+class StateSizer {
+  public:
+    void bytes(void *, size_t size) { this->size += size; }
+    void ram(void *, size_t size) { this->size += size; }
+    template <typename T> void operator()(T& field) { size += sizeof(field); }
+
+    size_t size = 0;
+};
+
+template <typename Archive>
+void visit_tape(Archive& ar)
+{
+   ar(bTapeLevel); ar(bTapeData);
+   ar(pbTapeBlock); ar(pbTapeBlockData);
+   ar(pwTapePulseTable); ar(pwTapePulseTableEnd); ar(pwTapePulseTablePtr);
+   ar(wCycleTable); ar(iTapeCycleCount);
+   ar(dwTapePulseCycles); ar(dwTapeZeroPulseCycles); ar(dwTapeOnePulseCycles);
+   ar(dwTapeStage); ar(dwTapePulseCount); ar(dwTapeDataCount); ar(dwTapeBitsToShift);
+}
+
+template <typename Archive>
+void visit_machine(Archive& ar, t_RenderState& render, std::vector<byte>& ay)
+{
+   // Z80
+   ar(z80.AF); ar(z80.BC); ar(z80.DE); ar(z80.HL); ar(z80.PC); ar(z80.SP);
+   ar(z80.AFx); ar(z80.BCx); ar(z80.DEx); ar(z80.HLx); ar(z80.IX); ar(z80.IY);
+   ar(z80.I); ar(z80.R); ar(z80.Rb7); ar(z80.IFF1); ar(z80.IFF2); ar(z80.IM);
+   ar(z80.HALT); ar(z80.EI_issued); ar(z80.int_pending);
+   ar(iCycleCount); ar(iWSAdjust);
+   ar(CPC.cycle_count); ar(CPC.tape_motor); ar(CPC.printer_port);
+
+   // Gate Array, PPI and memory mapping
+   ar(GateArray); ar(PPI); ar(VDU);
+   ar(dwMF2Flags); ar(dwMF2ExitAddr);
+   ar(pbROMlo); ar(pbExpansionROM);
+
+   // CRTC
+   ar(CRTC); ar(flags1); ar(new_dt); ar(LastPreRend);
+   ar(MinVSync); ar(MaxVSync);
+   ar(iMonHSPeakPos); ar(iMonHSStartPos); ar(iMonHSEndPos); ar(iMonHSPeakToStart);
+   ar(iMonHSStartToPeak); ar(iMonHSEndToPeak); ar(iMonHSPeakToEnd);
+   ar(HorzPos); ar(MonHSYNC); ar(MonFreeSync);
+   ar(HSyncDuration); ar(MinHSync); ar(MaxHSync); ar(HadP);
+   ar(HorzChar); ar(HorzMax); ar(RendBuff);
+   ar(render);
+
+   // PSG
+   ar(PSG);
+   ar.bytes(ay.data(), ay.size());
+
+   // FDC
+   ar(FDC); ar(read_status_delay);
+   ar(driveA.current_track); ar(driveA.current_side); ar(driveA.current_sector);
+   ar(driveB.current_track); ar(driveB.current_side); ar(driveB.current_sector);
+
+   // ASIC
+   ar(asic);
+   if (CPC.model > 2) {
+      ar.bytes(pbRegisterPage, 16*1024);
+   }
+
+   // Memory
+   ar.ram(pbRAM, CPC.ram_size*1024);
+   if (CPC.mf2 && pbMF2ROM) {
+      ar.bytes(pbMF2ROM + MF2_RAM_OFFSET, MF2_RAM_SIZE);
+   }
+}
+
+t_SaveStateHeader current_header()
+{
+   t_SaveStateHeader header;
+   memset(&header, 0, sizeof(header)); // also clears padding, so that deltas stay small
+   header.magic = SAVESTATE_MAGIC;
+   header.model = CPC.model;
+   header.ram_size = CPC.ram_size;
+   header.mf2 = CPC.mf2 && pbMF2ROM;
+   header.cartridge = CPC.model > 2 ? pbCartridgePages[0] : nullptr;
+   header.tape_image = pbTapeImage.data();
+   header.tape_size = pbTapeImage.size();
+   header.ram = pbRAM;
+   return header;
+}
+
+t_RenderState current_render_state()
+{
+   t_RenderState render;
+   if (PreRender == CPC.scr_prerendernorm) {
+      render.prerender = 0;
+   } else if (PreRender == CPC.scr_prerenderbord) {
+      render.prerender = 1;
+   } else {
+      render.prerender = 2;
+   }
+   render.mode_map = 0;
+   for (int n = 0; n < 4; n++) {
+      if (ModeMap == ModeMaps[n]) {
+         render.mode_map = n;
+      }
+   }
+   render.rend_wid = RendWid - HorzPix;
+   render.rend_out = RendOut - RendBuff;
+   render.rend_pos = reinterpret_cast<byte *>(RendPos) - RendBuff;
+   render.scr_offset = CPC.scr_pos - CPC.scr_base;
+   return render;
+}
+
+void apply_render_state(const t_RenderState& render)
+{
+   switch (render.prerender) {
+      case 0: PreRender = CPC.scr_prerendernorm; break;
+      case 1: PreRender = CPC.scr_prerenderbord; break;
+      default: PreRender = CPC.scr_prerendersync; break;
+   }
+   ModeMap = ModeMaps[render.mode_map];
+   RendWid = HorzPix + render.rend_wid;
+   RendOut = RendBuff + render.rend_out;
+   RendPos = reinterpret_cast<dword *>(RendBuff + render.rend_pos);
+   CPC.scr_pos = CPC.scr_base + render.scr_offset;
+}
+
+}
+
+int savestate_capture(std::vector<byte>& state)
+{
+   if (FDC.phase == EXEC_PHASE) {
+      return ERR_SAVESTATE_BUSY;
+   }
+   t_SaveStateHeader header = current_header();
+   t_RenderState render = current_render_state();
+   std::vector<byte> ay(AY_state_size());
+   AY_save_state(ay.data());
+
+   StateSizer sizer;
+   sizer(header);
+   visit_tape(sizer);
+   visit_machine(sizer, render, ay);
+   header.size = sizer.size;
+
+   // A previous capture of the same machine in this buffer only needs its
+   // changed RAM pages to be updated.
+   t_SaveStateHeader previous;
+   memset(&previous, 0, sizeof(previous));
+   bool incremental = false;
+   if (state.size() == header.size) {
+      memcpy(&previous, state.data(), sizeof(previous));
+      incremental = previous.magic == header.magic && previous.size == header.size &&
+                    previous.ram == header.ram && previous.ram_size == header.ram_size;
+   }
+   state.resize(header.size);
+   header.ram_checkpoint = ram_dirty_checkpoint();
+   StateWriter writer(state.data(), incremental, previous.ram_checkpoint);
+   writer(header);
+   visit_tape(writer);
+   visit_machine(writer, render, ay);
+   return 0;
+}
+
+int savestate_restore(const std::vector<byte>& state)
+{
+   t_SaveStateHeader expected = current_header();
+   t_SaveStateHeader header;
+   if (state.size() < sizeof(header)) {
+      return ERR_SAVESTATE_INVALID;
+   }
+   memcpy(&header, state.data(), sizeof(header));
+   if (header.magic != expected.magic || header.size != state.size() ||
+       header.model != expected.model || header.ram_size != expected.ram_size ||
+       header.mf2 != expected.mf2 || header.cartridge != expected.cartridge) {
+      return ERR_SAVESTATE_INVALID;
+   }
+
+   StateReader reader(state.data() + sizeof(header));
+   if (header.tape_image == expected.tape_image && header.tape_size == expected.tape_size) {
+      visit_tape(reader);
+   } else { // the tape was changed since, keep its current position
+      StateSizer tape_sizer;
+      visit_tape(tape_sizer);
+      reader.skip(tape_sizer.size);
+   }
+
+   t_RenderState render;
+   std::vector<byte> ay(AY_state_size());
+   // Sound output settings are not part of the emulated machine.
+   unsigned int buffer_full = PSG.buffer_full;
+   void (*synthesizer)() = PSG.Synthesizer;
+   visit_machine(reader, render, ay);
+   PSG.buffer_full = buffer_full;
+   PSG.Synthesizer = synthesizer;
+   AY_load_state(ay.data());
+   apply_render_state(render);
+
+   ga_init_banking_tables();
+   ga_memory_manager();
+   ram_mark_all_dirty();
+   return 0;
+}
+
+
+
+RewindBuffer::RewindBuffer(size_t budget) : budget(budget)
+{
+}
+
+namespace
+{
+
+void put_varint(std::vector<byte>& out, size_t val)
+{
+   while (val >= 0x80) {
+      out.push_back(static_cast<byte>(val | 0x80));
+      val >>= 7;
+   }
+   out.push_back(static_cast<byte>(val));
+}
+
+size_t get_varint(const byte *&pos)
+{
+   size_t val = 0;
+   for (int shift = 0; ; shift += 7) {
+      byte b = *pos++;
+      val |= static_cast<size_t>(b & 0x7f) << shift;
+      if (!(b & 0x80)) {
+         return val;
+      }
+   }
+}
+
+// Encodes from ^ to as a sequence of (count of zero bytes, count of literal
+// bytes, literal bytes). Trailing zeros are not stored.
+void xor_encode(const std::vector<byte>& from, const std::vector<byte>& to, std::vector<byte>& delta)
+{
+   const size_t MIN_ZERO_RUN = 4; // shorter runs are cheaper to store as literals
+   size_t size = from.size();
+   const byte *a = from.data();
+   const byte *b = to.data();
+   delta.clear();
+   size_t pos = 0;
+   while (pos < size) {
+      size_t start = pos;
+      while (pos + 8 <= size && !memcmp(a + pos, b + pos, 8)) {
+         pos += 8;
+      }
+      while (pos < size && a[pos] == b[pos]) {
+         pos++;
+      }
+      if (pos == size) {
+         break;
+      }
+      size_t literal_start = pos;
+      size_t zeros = 0;
+      while (pos < size && zeros < MIN_ZERO_RUN) {
+         zeros = (a[pos] == b[pos]) ? zeros + 1 : 0;
+         pos++;
+      }
+      pos -= zeros;
+      put_varint(delta, literal_start - start);
+      put_varint(delta, pos - literal_start);
+      for (size_t n = literal_start; n < pos; n++) {
+         delta.push_back(a[n] ^ b[n]);
+      }
+   }
+}
+
+void xor_decode(std::vector<byte>& state, const std::vector<byte>& delta)
+{
+   const byte *pos = delta.data();
+   const byte *end = pos + delta.size();
+   byte *dst = state.data();
+   while (pos < end) {
+      dst += get_varint(pos);
+      size_t count = get_varint(pos);
+      for (size_t n = 0; n < count; n++) {
+         *dst++ ^= *pos++;
+      }
+   }
+}
+
+}
+
+void RewindBuffer::setBudget(size_t budget)
+{
+   this->budget = budget;
+   evict();
+}
+
+void RewindBuffer::clear()
+{
+   newest.clear();
+   deltas.clear();
+   deltas_size = 0;
+}
+
+void RewindBuffer::push(const std::vector<byte>& state)
+{
+   if (!newest.empty() && newest.size() == state.size()) {
+      xor_encode(newest, state, scratch);
+      deltas_size += scratch.size();
+      deltas.push_back(scratch);
+   } else {
+      deltas.clear();
+      deltas_size = 0;
+   }
+   newest = state;
+   evict();
+}
+
+bool RewindBuffer::pop(std::vector<byte>& state)
+{
+   if (newest.empty()) {
+      return false;
+   }
+   state = newest;
+   if (deltas.empty()) {
+      newest.clear();
+   } else {
+      xor_decode(newest, deltas.back());
+      deltas_size -= deltas.back().size();
+      deltas.pop_back();
+   }
+   return true;
+}
+
+size_t RewindBuffer::count() const
+{
+   return newest.empty() ? 0 : deltas.size() + 1;
+}
+
+size_t RewindBuffer::memoryUsed() const
+{
+   return newest.size() + deltas_size;
+}
+
+void RewindBuffer::evict()
+{
+   while (!deltas.empty() && memoryUsed() > budget) {
+      deltas_size -= deltas.front().size();
+      deltas.pop_front();
+   }
+   if (memoryUsed() > budget) {
+      newest.clear();
+   }
+}
@@ -0,0 +1,61 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   In-memory save states of the emulated machine, and the rewind history built
+   on top of them.
+   Unlike snapshots, save states are not meant to be written to disk: they
+   contain pointers to the loaded ROMs and cartridge, to the render functions
+   in use... and are only valid in the process that captured them, as long as
+   the machine configuration (model, RAM size, video style) is not changed.
+   Media contents (disk images written to, tape position) are not part of them.
+*/
+
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include "types.h"
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+// Serialize the state of the Z80, CRTC, Gate Array, PPI, PSG, FDC, ASIC and
+// RAM in state, reusing its storage. If state already holds a capture of the
+// same machine, only the RAM pages written to since are copied.
+// Fails with ERR_SAVESTATE_BUSY while the FDC is transferring data, as its
+// buffers cannot be captured.
+int savestate_capture(std::vector<byte>& state);
+// Restore a state captured with savestate_capture. Must be called outside of
+// z80_execute. Fails with ERR_SAVESTATE_INVALID, without altering the emulated
+// machine, if the state doesn't match the current configuration.
+int savestate_restore(const std::vector<byte>& state);
+
+// History of save states fitting in a fixed memory budget, oldest states being
+// dropped first.
+// Only the newest state is kept in full, each older one is stored as the run
+// length encoded XOR against the state that followed it. As most of the machine
+// doesn't change from one state to the next, these deltas are small.
+class RewindBuffer {
+  public:
+    explicit RewindBuffer(size_t budget = 0);
+
+    // Budget in bytes. Setting it drops the oldest states that don't fit.
+    void setBudget(size_t budget);
+    void clear();
+    // Add a state, newer than all the ones already in the buffer.
+    void push(const std::vector<byte>& state);
+    // Retrieve and remove the newest state. Returns false if empty.
+    bool pop(std::vector<byte>& state);
+
+    size_t count() const;
+    size_t memoryUsed() const;
+
+  private:
+    void evict();
+
+    size_t budget;
+    std::vector<byte> newest;
+    std::deque<std::vector<byte>> deltas; // from oldest to newest
+    size_t deltas_size = 0;
+    std::vector<byte> scratch;
+};
+
+#endif
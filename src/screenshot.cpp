@@ -0,0 +1,146 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Screenshots.
+*/
+
+#include "screenshot.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "SDL.h"
+#include "log.h"
+#include "types.h"
+#include "savepng.h"
+
+namespace
+{
+
+// About 13MB of copies of a 768x540 screen in 32 bits.
+const size_t MAX_QUEUED = 8;
+
+struct Screenshot {
+   SDL_Surface *surface;
+   std::string filename;
+   int compression;
+};
+
+class ScreenshotWriter {
+  public:
+    ~ScreenshotWriter();
+
+    void queue(const Screenshot& screenshot);
+    bool flush();
+
+  private:
+    void loop();
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Screenshot> screenshots;
+    bool writing = false;
+    bool stopping = false;
+    bool write_failed = false;
+    std::thread thread;
+};
+
+ScreenshotWriter::~ScreenshotWriter()
+{
+   if (thread.joinable()) {
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         stopping = true;
+      }
+      cv.notify_all();
+      thread.join();
+   }
+}
+
+void ScreenshotWriter::queue(const Screenshot& screenshot)
+{
+   {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (!thread.joinable()) {
+         thread = std::thread(&ScreenshotWriter::loop, this);
+      }
+      cv.wait(lock, [this]() { return screenshots.size() < MAX_QUEUED; });
+      screenshots.push_back(screenshot);
+   }
+   cv.notify_all();
+}
+
+bool ScreenshotWriter::flush()
+{
+   std::unique_lock<std::mutex> lock(mutex);
+   cv.wait(lock, [this]() { return screenshots.empty() && !writing; });
+   bool result = !write_failed;
+   write_failed = false;
+   return result;
+}
+
+void ScreenshotWriter::loop()
+{
+   std::unique_lock<std::mutex> lock(mutex);
+   while (true) {
+      cv.wait(lock, [this]() { return stopping || !screenshots.empty(); });
+      if (screenshots.empty()) {
+         return;
+      }
+      Screenshot screenshot = screenshots.front();
+      screenshots.pop_front();
+      writing = true;
+      lock.unlock();
+      cv.notify_all();
+
+      bool failed = SDL_SavePNG(screenshot.surface, screenshot.filename, screenshot.compression) != 0;
+      if (failed) {
+         LOG_ERROR("Could not write screenshot file to " << screenshot.filename << ": " << SDL_GetError());
+      }
+      SDL_FreeSurface(screenshot.surface);
+
+      lock.lock();
+      write_failed |= failed;
+      writing = false;
+      cv.notify_all();
+   }
+}
+
+ScreenshotWriter writer;
+
+SDL_Surface *copy_surface(SDL_Surface *surface)
+{
+   const SDL_PixelFormat *format = surface->format;
+   SDL_Surface *copy = SDL_CreateRGBSurface(0, surface->w, surface->h, format->BitsPerPixel,
+         format->Rmask, format->Gmask, format->Bmask, format->Amask);
+   if (!copy) {
+      return nullptr;
+   }
+   if (format->palette) {
+      SDL_SetPaletteColors(copy->format->palette, format->palette->colors, 0, format->palette->ncolors);
+   }
+   size_t row = static_cast<size_t>(surface->w) * format->BytesPerPixel;
+   for (int y = 0; y < surface->h; y++) {
+      memcpy(static_cast<byte *>(copy->pixels) + y * copy->pitch, static_cast<byte *>(surface->pixels) + y * surface->pitch, row);
+   }
+   return copy;
+}
+
+}
+
+bool screenshot_save(SDL_Surface *surface, const std::string& filename, int compression)
+{
+   SDL_Surface *copy = copy_surface(surface);
+   if (!copy) {
+      LOG_ERROR("Could not copy the screen for " << filename << ": " << SDL_GetError());
+      return false;
+   }
+   writer.queue({copy, filename, compression});
+   return true;
+}
+
+bool screenshot_flush()
+{
+   return writer.flush();
+}
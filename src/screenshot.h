@@ -0,0 +1,29 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Screenshots: the screen is copied and the copy is converted, compressed
+   and written to a PNG file by a background thread, so that taking
+   screenshots (e.g. many of them from a script) doesn't freeze the
+   emulation. If too many screenshots wait to be written, taking the next
+   one waits for the oldest to be written.
+*/
+
+#ifndef SCREENSHOT_H
+#define SCREENSHOT_H
+
+#include <string>
+
+struct SDL_Surface;
+
+// Compression levels of the zlib compression of the PNG files.
+#define SCREENSHOT_COMPRESSION_MIN 0
+#define SCREENSHOT_COMPRESSION_MAX 9
+#define SCREENSHOT_COMPRESSION_DEFAULT 6
+
+// Queues a copy of surface to be written to filename. Returns false if the
+// copy could not be made.
+bool screenshot_save(SDL_Surface *surface, const std::string& filename, int compression);
+// Waits for the queued screenshots to be written. Returns false if writing
+// any of them failed since the last call.
+bool screenshot_flush();
+
+#endif
@@ -31,31 +31,22 @@
 #include "stringutils.h"
 #include "tape.h"
 #include "z80.h"
+#include "machinestate.h"
 #include "zip.h"
 
-extern t_CPC CPC;
-extern t_CRTC CRTC;
-extern t_FDC FDC;
-extern t_VDU VDU;
-extern t_GateArray GateArray;
-extern t_PPI PPI;
-extern t_PSG PSG;
-extern t_drive driveA;
-extern t_drive driveB;
-extern t_z80regs z80;
+extern thread_local t_CPC CPC;
+extern thread_local t_drive driveA;
+extern thread_local t_drive driveB;
 extern byte bit_values[8];
-extern t_flags1 flags1;
-extern word MaxVSync;
-extern byte *pbROM;
+extern thread_local byte *pbROM;
 extern std::string chROMFile[];
 
-byte *pbTapeImageEnd = nullptr;
-extern std::vector<byte> pbTapeImage;
-extern byte *pbGPBuffer;
-extern byte *pbRAM;
-extern byte *pbRAMbuffer;
+thread_local byte *pbTapeImageEnd = nullptr;
+extern thread_local std::vector<byte> pbTapeImage;
+extern thread_local byte *pbGPBuffer;
+extern thread_local byte *pbRAMbuffer;
 
-extern FILE *pfileObject;
+extern thread_local FILE *pfileObject;
 
 struct file_loader
 {
@@ -178,14 +169,22 @@ void fillSlots (std::vector<std::string> slot_list, t_CPC& CPC)
    }
 }
 
-void loadSlots() {
+int loadSlots() {
+   int iErrCode = 0;
+   auto load = [&iErrCode](t_slot& slot) {
+      int iErr = file_load(slot);
+      if (iErr && !slot.file.empty() && !iErrCode) {
+         iErrCode = iErr;
+      }
+   };
    memset(&driveA, 0, sizeof(t_drive)); // clear disk drive A data structure
-   file_load(CPC.driveA);
+   load(CPC.driveA);
    memset(&driveB, 0, sizeof(t_drive)); // clear disk drive B data structure
-   file_load(CPC.driveB);
-   file_load(CPC.tape);
-   file_load(CPC.snapshot);
+   load(CPC.driveB);
+   load(CPC.tape);
+   load(CPC.snapshot);
    // Cartridge was loaded by emulator_init which called cartridge_load if needed
+   return iErrCode;
 }
 
 // Extract 'filename' from 'zipfile'. Filename must end with one of the extensions listed in 'ext'.
@@ -796,6 +795,7 @@ int snapshot_load (FILE *pfile)
   }
   emulator_reset();
   n = fread(pbRAM, dwSnapSize*1024, 1, pfile); // read memory dump into CPC RAM
+  ram_mark_all_dirty();
   if (!n) {
     emulator_reset();
     LOG_ERROR("Error loading snapshot: couldn't read RAM");
@@ -41,8 +41,9 @@ int cartridge_load (FILE *file);
 int file_load(t_slot& slot);
 // Retrieve files that are passed as argument and update CPC fields so that they will be loaded properly
 void fillSlots (std::vector<std::string> slot_list, t_CPC& CPC);
-// Loads slot content in memory
-void loadSlots();
+// Loads slot content in memory. Returns 0 or the error of the first slot that
+// couldn't be loaded.
+int loadSlots();
 
 #define MAX_DISK_FORMAT          8
 #define DEFAULT_DISK_FORMAT      0
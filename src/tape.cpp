@@ -39,30 +39,30 @@
 #define MS_TO_CYCLES(p) (static_cast<dword>(p) * 4000)
 //#define MS_TO_CYCLES(p) ((dword)(p) * 3994)
 
-extern std::vector<byte> pbTapeImage;
-extern byte *pbTapeImageEnd;
-extern t_CPC CPC;
+extern thread_local std::vector<byte> pbTapeImage;
+extern thread_local byte *pbTapeImageEnd;
+extern thread_local t_CPC CPC;
 
 #ifdef DEBUG_TAPE
 extern FILE *pfoDebug;
 #endif
 
-byte bTapeLevel;
-byte bTapeData;
-byte *pbTapeBlock;
-byte *pbTapeBlockData;
-word *pwTapePulseTable;
-word *pwTapePulseTableEnd;
-word *pwTapePulseTablePtr;
-word wCycleTable[2];
-int iTapeCycleCount;
-dword dwTapePulseCycles;
-dword dwTapeZeroPulseCycles;
-dword dwTapeOnePulseCycles;
-dword dwTapeStage = TAPE_END;
-dword dwTapePulseCount;
-dword dwTapeDataCount;
-dword dwTapeBitsToShift;
+thread_local byte bTapeLevel;
+thread_local byte bTapeData;
+thread_local byte *pbTapeBlock;
+thread_local byte *pbTapeBlockData;
+thread_local word *pwTapePulseTable;
+thread_local word *pwTapePulseTableEnd;
+thread_local word *pwTapePulseTablePtr;
+thread_local word wCycleTable[2];
+thread_local int iTapeCycleCount;
+thread_local dword dwTapePulseCycles;
+thread_local dword dwTapeZeroPulseCycles;
+thread_local dword dwTapeOnePulseCycles;
+thread_local dword dwTapeStage = TAPE_END;
+thread_local dword dwTapePulseCount;
+thread_local dword dwTapeDataCount;
+thread_local dword dwTapeBitsToShift;
 
 
 
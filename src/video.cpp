@@ -47,13 +47,13 @@ SDL_Texture* texture = nullptr;
 SDL_GLContext glcontext;
 
 // the video surface ready to display
-SDL_Surface* vid = nullptr;
+thread_local SDL_Surface* vid = nullptr;
 // the video surface scaled with same format as pub
 SDL_Surface* scaled = nullptr;
 // the video surface shown by the plugin to the application
 SDL_Surface* pub = nullptr;
 
-extern t_CPC CPC;
+extern thread_local t_CPC CPC;
 
 #ifndef min
 #define min(a,b) ((a)<(b) ? (a) : (b))
@@ -173,6 +173,49 @@ void direct_close()
   if (mainSDLWindow) SDL_DestroyWindow(mainSDLWindow);
 }
 
+/* ------------------------------------------------------------------------------------ */
+/* Headless video plugin -------------------------------------------------------------- */
+/* ------------------------------------------------------------------------------------ */
+// Renders in an offscreen surface only: no window, no renderer, nothing to flip.
+// Used by --headless runs, where the frame is only needed for screenshots.
+SDL_Surface* headless_init(video_plugin* t, int scale, bool fs __attribute__((unused)))
+{
+  int surface_width, surface_height;
+  if (scale > 1) {
+    t->half_pixels = 0;
+    surface_width = CPC_VISIBLE_SCR_WIDTH * 2;
+    surface_height = CPC_VISIBLE_SCR_HEIGHT * 2;
+  } else {
+    t->half_pixels = 1;
+    surface_width = CPC_VISIBLE_SCR_WIDTH;
+    surface_height = CPC_VISIBLE_SCR_HEIGHT;
+  }
+  vid = SDL_CreateRGBSurface(0, surface_width, surface_height, 32, 0, 0, 0, 0);
+  if (!vid) return nullptr;
+  SDL_FillRect(vid, nullptr, SDL_MapRGB(vid->format,0,0,0));
+  t->x_offset = 0;
+  t->y_offset = 0;
+  t->x_scale = 1;
+  t->y_scale = 1;
+  t->width = surface_width;
+  t->height = surface_height;
+  return vid;
+}
+
+void headless_setpal(SDL_Color* c __attribute__((unused)))
+{
+}
+
+void headless_flip(video_plugin* t __attribute__((unused)))
+{
+}
+
+void headless_close()
+{
+  if (vid) SDL_FreeSurface(vid);
+  vid = nullptr;
+}
+
 
 #ifdef HAVE_GL
 /* ------------------------------------------------------------------------------------ */
@@ -1397,3 +1440,6 @@ std::vector<video_plugin> video_plugin_list =
   {"OpenGL scaling",          false, glscale_init,  glscale_setpal,  glscale_flip,  glscale_close,  0,         0, 0,          0, 0, 0, 0 },
 #endif
 };
+
+video_plugin video_headless_plugin =
+  {"Headless",                true,  headless_init, headless_setpal, headless_flip, headless_close, 1,         0, 0,          0, 0, 0, 0 };
@@ -49,6 +49,8 @@ typedef struct video_plugin
 video_plugin;
 
 extern std::vector<video_plugin> video_plugin_list;
+/* Not listed in video_plugin_list: only selected with --headless. */
+extern video_plugin video_headless_plugin;
 
 /* Only exposed for testing purposes. Do not use. */
 void compute_rects_for_tests(SDL_Rect* src, SDL_Rect* dst, Uint8 half_pixels);
@@ -0,0 +1,401 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Video capture.
+*/
+
+#include "videocapture.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "SDL.h"
+#include "errors.h"
+#include "log.h"
+#include "savepng.h"
+
+namespace
+{
+
+const char VIDEO_MAGIC[8] = { 'C', 'P', 'C', 'V', 'I', 'D', 'E', 'O' };
+const byte VIDEO_VERSION = 1;
+const size_t VIDEO_HEADER_SIZE = sizeof(VIDEO_MAGIC) + 1 + 2 + 2 + 1 + 3 * 4;
+const byte KEY_FRAME = 0x01;
+// Identical bytes shorter than this are kept in the copied bytes rather than
+// splitting them in two operations.
+const size_t MIN_SKIP = 8;
+// Frames that can wait to be encoded: about 160ms.
+const int POOL_SIZE = 8;
+
+void put_varint(std::vector<byte>& out, size_t val)
+{
+   while (val >= 0x80) {
+      out.push_back(static_cast<byte>(val | 0x80));
+      val >>= 7;
+   }
+   out.push_back(static_cast<byte>(val));
+}
+
+bool get_varint(const byte *data, size_t size, size_t& pos, size_t& val)
+{
+   val = 0;
+   for (int shift = 0; pos < size && shift < 64; shift += 7) {
+      byte b = data[pos++];
+      val |= static_cast<size_t>(b & 0x7f) << shift;
+      if (!(b & 0x80)) {
+         return true;
+      }
+   }
+   return false;
+}
+
+void put_le(std::vector<byte>& out, dword val, int size)
+{
+   for (int i = 0; i < size; i++) {
+      out.push_back(val >> (8 * i));
+   }
+}
+
+dword get_le(const byte *data, int size)
+{
+   dword val = 0;
+   for (int i = 0; i < size; i++) {
+      val |= static_cast<dword>(data[i]) << (8 * i);
+   }
+   return val;
+}
+
+// Length of the run of identical bytes from pos, 8 at a time.
+size_t same_bytes(const byte *frame, const byte *previous, size_t pos, size_t size)
+{
+   size_t start = pos;
+   while (pos + 8 <= size) {
+      uint64_t a, b;
+      memcpy(&a, frame + pos, 8);
+      memcpy(&b, previous + pos, 8);
+      if (a != b) break;
+      pos += 8;
+   }
+   while (pos < size && frame[pos] == previous[pos]) {
+      pos++;
+   }
+   return pos - start;
+}
+
+}
+
+// Operations are pairs of: count of bytes unchanged, count of bytes copied
+// followed by these bytes.
+void video_encode_frame(const byte *frame, const byte *previous, size_t size, std::vector<byte>& out)
+{
+   size_t pos = 0;
+   while (pos < size) {
+      size_t skip = previous ? same_bytes(frame, previous, pos, size) : 0;
+      size_t start = pos + skip;
+      size_t end = start;
+      while (end < size) {
+         size_t same = previous ? same_bytes(frame, previous, end, size) : 0;
+         if (same >= MIN_SKIP || end + same == size) {
+            break;
+         }
+         end += same + 1; // the byte that differs
+      }
+      put_varint(out, skip);
+      put_varint(out, end - start);
+      out.insert(out.end(), frame + start, frame + end);
+      pos = end;
+   }
+}
+
+bool video_decode_frame(const byte *data, size_t data_size, byte *frame, size_t size)
+{
+   size_t pos = 0, frame_pos = 0;
+   while (pos < data_size) {
+      size_t skip, count;
+      if (!get_varint(data, data_size, pos, skip) || !get_varint(data, data_size, pos, count) ||
+          skip > size - frame_pos || count > size - frame_pos - skip || count > data_size - pos) {
+         return false;
+      }
+      frame_pos += skip;
+      memcpy(frame + frame_pos, data + pos, count);
+      frame_pos += count;
+      pos += count;
+   }
+   return true;
+}
+
+
+
+VideoReader::~VideoReader()
+{
+   if (file) {
+      fclose(file);
+   }
+}
+
+bool VideoReader::open(const std::string& filename)
+{
+   file = fopen(filename.c_str(), "rb");
+   if (!file) {
+      LOG_ERROR("Could not open video capture " << filename);
+      return false;
+   }
+   byte header[VIDEO_HEADER_SIZE];
+   if (fread(header, sizeof(header), 1, file) != 1 || memcmp(header, VIDEO_MAGIC, sizeof(VIDEO_MAGIC))) {
+      LOG_ERROR(filename << " is not a video capture");
+      return false;
+   }
+   const byte *p = header + sizeof(VIDEO_MAGIC);
+   if (p[0] != VIDEO_VERSION) {
+      LOG_ERROR("Unsupported video capture version " << static_cast<int>(p[0]));
+      return false;
+   }
+   fmt.width = get_le(p + 1, 2);
+   fmt.height = get_le(p + 3, 2);
+   fmt.bytes_per_pixel = p[5];
+   fmt.rmask = get_le(p + 6, 4);
+   fmt.gmask = get_le(p + 10, 4);
+   fmt.bmask = get_le(p + 14, 4);
+   return true;
+}
+
+bool VideoReader::next(std::vector<byte>& frame)
+{
+   byte header[5];
+   if (!file || fread(header, sizeof(header), 1, file) != 1) {
+      return false;
+   }
+   record.resize(get_le(header, 4));
+   if (!record.empty() && fread(record.data(), record.size(), 1, file) != 1) {
+      return false; // truncated capture
+   }
+   if (header[4] & KEY_FRAME) {
+      frame.assign(fmt.frameSize(), 0);
+   }
+   else if (frame.size() != fmt.frameSize()) {
+      return false; // a delta without its key frame
+   }
+   return video_decode_frame(record.data(), record.size(), frame.data(), frame.size());
+}
+
+
+
+namespace
+{
+
+// Copies frames into its pool and encodes them on its own thread.
+class VideoRecorder {
+  public:
+    VideoRecorder(FILE *file, const t_VideoFormat& format);
+    ~VideoRecorder();
+
+    // Whether surface has the geometry and pixel format of the capture.
+    bool accepts(const SDL_Surface *surface) const;
+    void frame(SDL_Surface *surface);
+    // Returns false if writing to the file failed.
+    bool close();
+
+  private:
+    void loop();
+
+    FILE *file;
+    t_VideoFormat format;
+    std::vector<std::vector<byte>> pool;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<int> free_buffers, ready_buffers;
+    bool stopping = false;
+    bool write_failed = false;
+    std::thread thread;
+};
+
+VideoRecorder::VideoRecorder(FILE *file, const t_VideoFormat& format) : file(file), format(format), pool(POOL_SIZE, std::vector<byte>(format.frameSize()))
+{
+   for (int i = 0; i < POOL_SIZE; i++) {
+      free_buffers.push_back(i);
+   }
+   thread = std::thread(&VideoRecorder::loop, this);
+}
+
+VideoRecorder::~VideoRecorder()
+{
+   close();
+}
+
+bool VideoRecorder::accepts(const SDL_Surface *surface) const
+{
+   return surface->w == format.width && surface->h == format.height &&
+          surface->format->BytesPerPixel == format.bytes_per_pixel &&
+          surface->format->Rmask == format.rmask && surface->format->Gmask == format.gmask && surface->format->Bmask == format.bmask;
+}
+
+void VideoRecorder::frame(SDL_Surface *surface)
+{
+   int buffer;
+   {
+      std::unique_lock<std::mutex> lock(mutex);
+      cv.wait(lock, [this]() { return !free_buffers.empty(); });
+      buffer = free_buffers.front();
+      free_buffers.pop_front();
+   }
+   size_t row = static_cast<size_t>(format.width) * format.bytes_per_pixel;
+   for (int y = 0; y < format.height; y++) {
+      memcpy(pool[buffer].data() + y * row, static_cast<byte *>(surface->pixels) + y * surface->pitch, row);
+   }
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      ready_buffers.push_back(buffer);
+   }
+   cv.notify_all();
+}
+
+bool VideoRecorder::close()
+{
+   if (thread.joinable()) {
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         stopping = true;
+      }
+      cv.notify_all();
+      thread.join();
+      if (fclose(file)) {
+         write_failed = true;
+      }
+   }
+   return !write_failed;
+}
+
+void VideoRecorder::loop()
+{
+   std::vector<byte> previous(format.frameSize());
+   std::vector<byte> record;
+   unsigned int frames = 0;
+   while (true) {
+      int buffer;
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         cv.wait(lock, [this]() { return stopping || !ready_buffers.empty(); });
+         if (ready_buffers.empty()) {
+            return;
+         }
+         buffer = ready_buffers.front();
+         ready_buffers.pop_front();
+      }
+      const std::vector<byte>& frame = pool[buffer];
+      bool key = (frames++ % VIDEO_KEY_FRAME_INTERVAL) == 0;
+      record.assign(5, 0);
+      video_encode_frame(frame.data(), key ? nullptr : previous.data(), frame.size(), record);
+      dword size = record.size() - 5;
+      for (int i = 0; i < 4; i++) {
+         record[i] = size >> (8 * i);
+      }
+      record[4] = key ? KEY_FRAME : 0;
+      previous = frame;
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         free_buffers.push_back(buffer);
+      }
+      cv.notify_all();
+      if (fwrite(record.data(), record.size(), 1, file) != 1) {
+         write_failed = true;
+      }
+   }
+}
+
+std::unique_ptr<VideoRecorder> video_recorder;
+std::string video_filename;
+
+}
+
+int capture_video_start(const std::string& filename, SDL_Surface *surface)
+{
+   capture_video_stop();
+   // Only the masks are recorded, and the palette of a surface can change
+   // during the capture.
+   if (surface->format->palette) {
+      LOG_ERROR("Cannot capture the video of a palettized screen to " << filename);
+      return ERR_CAPTURE_FORMAT;
+   }
+   FILE *file = fopen(filename.c_str(), "wb");
+   if (!file) {
+      LOG_ERROR("Could not open " << filename << " for writing");
+      return ERR_CAPTURE_WRITE;
+   }
+   t_VideoFormat format;
+   format.width = surface->w;
+   format.height = surface->h;
+   format.bytes_per_pixel = surface->format->BytesPerPixel;
+   format.rmask = surface->format->Rmask;
+   format.gmask = surface->format->Gmask;
+   format.bmask = surface->format->Bmask;
+   std::vector<byte> header(VIDEO_MAGIC, VIDEO_MAGIC + sizeof(VIDEO_MAGIC));
+   header.push_back(VIDEO_VERSION);
+   put_le(header, format.width, 2);
+   put_le(header, format.height, 2);
+   header.push_back(format.bytes_per_pixel);
+   put_le(header, format.rmask, 4);
+   put_le(header, format.gmask, 4);
+   put_le(header, format.bmask, 4);
+   if (fwrite(header.data(), header.size(), 1, file) != 1) {
+      LOG_ERROR("Could not write " << filename);
+      fclose(file);
+      return ERR_CAPTURE_WRITE;
+   }
+   video_filename = filename;
+   video_recorder = std::make_unique<VideoRecorder>(file, format);
+   LOG_INFO("Capturing the video to " << filename);
+   return 0;
+}
+
+void capture_video_frame(SDL_Surface *surface)
+{
+   if (!video_recorder) return;
+   if (!video_recorder->accepts(surface)) {
+      LOG_ERROR("Video format changed: stopping the capture to " << video_filename);
+      capture_video_stop();
+      return;
+   }
+   video_recorder->frame(surface);
+}
+
+void capture_video_stop()
+{
+   if (video_recorder) {
+      if (!video_recorder->close()) {
+         LOG_ERROR("Could not write " << video_filename);
+      }
+      video_recorder.reset();
+   }
+}
+
+int capture_video_to_png(const std::string& filename, const std::string& prefix)
+{
+   VideoReader reader;
+   if (!reader.open(filename)) {
+      return ERR_FILE_NOT_FOUND;
+   }
+   const t_VideoFormat& format = reader.format();
+   std::vector<byte> frame;
+   int count = 0;
+   while (reader.next(frame)) {
+      SDL_Surface *surface = SDL_CreateRGBSurfaceFrom(frame.data(), format.width, format.height, format.bytes_per_pixel * 8,
+            format.width * format.bytes_per_pixel, format.rmask, format.gmask, format.bmask, 0);
+      if (!surface) {
+         LOG_ERROR("Could not convert the video capture: " << SDL_GetError());
+         return ERR_CAPTURE_WRITE;
+      }
+      char number[16];
+      snprintf(number, sizeof(number), "_%06d.png", count);
+      int result = SDL_SavePNG(surface, prefix + number);
+      SDL_FreeSurface(surface);
+      if (result) {
+         LOG_ERROR("Could not write " << prefix << number);
+         return ERR_CAPTURE_WRITE;
+      }
+      count++;
+   }
+   LOG_INFO("Converted " << count << " frames from " << filename);
+   return 0;
+}
@@ -0,0 +1,72 @@
+/* Caprice32 - Amstrad CPC Emulator
+
+   Video capture: lossless recording of every frame displayed by the
+   emulator, to be converted into a sequence of PNG images afterwards.
+   Frames are copied into a pool of preallocated buffers and handed to a
+   thread that encodes them and writes them, so that the emulation thread
+   neither encodes nor waits for the disk. Unlike the sound capture, frames
+   are never dropped: if the pool runs out, the emulation waits for a buffer.
+
+   Capture files are made of a header followed by one record per frame, so
+   that they can be written (and read back) as a stream. Most records only
+   hold the bytes that changed since the previous frame; every
+   VIDEO_KEY_FRAME_INTERVAL frames, a key frame holds the whole image.
+*/
+
+#ifndef VIDEOCAPTURE_H
+#define VIDEOCAPTURE_H
+
+#include "types.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct SDL_Surface;
+
+#define VIDEO_KEY_FRAME_INTERVAL 250
+
+// Appends to out the operations turning previous into frame (both of size
+// bytes), or building frame from nothing if previous is null.
+void video_encode_frame(const byte *frame, const byte *previous, size_t size, std::vector<byte>& out);
+// Applies the operations in data (as produced by video_encode_frame) to frame.
+// Returns false if they are invalid.
+bool video_decode_frame(const byte *data, size_t data_size, byte *frame, size_t size);
+
+// Geometry and pixel format of the frames of a capture.
+struct t_VideoFormat {
+   word width;
+   word height;
+   byte bytes_per_pixel;
+   dword rmask, gmask, bmask;
+
+   size_t frameSize() const { return static_cast<size_t>(width) * height * bytes_per_pixel; }
+};
+
+// Reads back the frames of a capture file.
+class VideoReader {
+  public:
+    ~VideoReader();
+    // Returns false if filename is not a capture file.
+    bool open(const std::string& filename);
+    const t_VideoFormat& format() const { return fmt; }
+    // Decodes the next frame. Returns false at the end of the capture.
+    bool next(std::vector<byte>& frame);
+
+  private:
+    FILE *file = nullptr;
+    t_VideoFormat fmt;
+    std::vector<byte> record;
+};
+
+// Starts recording the frames of surface to filename. Returns 0 or an error
+// code. Surfaces with a palette (8bpp) are not supported.
+int capture_video_start(const std::string& filename, SDL_Surface *surface);
+// To be called with each completed frame.
+void capture_video_frame(SDL_Surface *surface);
+// Writes the frames waiting in the pool and completes the file.
+void capture_video_stop();
+// Converts a capture file to a sequence of PNG files named prefix_000000.png,
+// prefix_000001.png... Returns 0 or an error code.
+int capture_video_to_png(const std::string& filename, const std::string& prefix);
+
+#endif
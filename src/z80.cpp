@@ -31,21 +31,19 @@
 #include "z80.h"
 #include "asic.h"
 #include "log.h"
+#include "machinestate.h"
 #include <algorithm>
+#include <climits>
+#include <bitset>
 #include <vector>
+#include <mutex>
 #include <iomanip>
 
 #include "z80_macros.h"
 
-extern t_CPC CPC;
-extern t_FDC FDC;
-extern t_GateArray GateArray;
-extern t_PSG PSG;
-extern t_VDU VDU;
-extern dword dwMF2Flags;
-extern dword dwMF2ExitAddr;
+extern thread_local t_CPC CPC;
 
-extern int iTapeCycleCount;
+extern thread_local int iTapeCycleCount;
 
 #ifdef DEBUG_Z80
 extern FILE *pfoDebug;
@@ -159,10 +157,15 @@ enum EDcodes {
 
 
 
-t_z80regs z80;
-std::vector<Breakpoint> breakpoints;
-std::vector<Watchpoint> watchpoints;
-int iCycleCount, iWSAdjust;
+thread_local std::vector<Breakpoint> breakpoints;
+thread_local std::vector<Watchpoint> watchpoints;
+// Return addresses of the calls made since the debugger's "step out" was requested.
+thread_local std::vector<word> z80_step_out_addresses;
+// One bit per address, so that checking for a breakpoint or a watchpoint
+// doesn't depend on how many of them are set. Rebuilt by z80_index_debug_points.
+static thread_local std::bitset<0x10000> exec_breakpoints_index;
+static thread_local std::bitset<0x10000> read_watchpoints_index;
+static thread_local std::bitset<0x10000> write_watchpoints_index;
 static byte SZ[256]; // zero and sign flags
 static byte SZ_BIT[256]; // zero, sign and parity/overflow (=zero) flags for BIT opcode
 static byte SZP[256]; // zero, sign and parity flags
@@ -171,6 +174,86 @@ static byte SZHV_dec[256]; // zero, sign, half carry and overflow flags DEC r8
 
 #include "z80daa.h"
 
+// Lazy flags: the 8 bit arithmetic instructions (ADD, ADC, SUB, SBC, CP, INC
+// and DEC) only record their operands and result. F is computed from them the
+// first time it's read, which most often doesn't happen before the next
+// instruction overwrites it. The carry and zero flags, which are the ones
+// mostly tested, are available from the result without computing F.
+// F is always up to date when not executing instructions, so that the rest of
+// the emulator (debugger, snapshots...) can use z80.AF directly.
+enum {
+   FLAGS_READY = 0,
+   FLAGS_ADD, // also ADC
+   FLAGS_SUB, // also SBC
+   FLAGS_CP,
+   FLAGS_INC,
+   FLAGS_DEC,
+};
+
+// For INC and DEC, res holds the carry (which they don't change) in bit 8.
+inline void z80_lazy_flags(byte op, byte a, byte val, word res)
+{
+   z80.flags_op = op;
+   z80.flags_a = a;
+   z80.flags_val = val;
+   z80.flags_res = res;
+}
+
+void z80_resolve_flags()
+{
+   unsigned a = z80.flags_a, val = z80.flags_val, res = z80.flags_res;
+   switch (z80.flags_op) {
+      case FLAGS_ADD:
+         z80.AF.b.l = SZ[res & 0xff] | ((res >> 8) & Cflag) | ((a ^ res ^ val) & Hflag) |
+            (((val ^ a ^ 0x80) & (val ^ res) & 0x80) >> 5);
+         break;
+      case FLAGS_SUB:
+         z80.AF.b.l = SZ[res & 0xff] | ((res >> 8) & Cflag) | Nflag | ((a ^ res ^ val) & Hflag) |
+            (((val ^ a) & (a ^ res) & 0x80) >> 5);
+         break;
+      case FLAGS_CP:
+         z80.AF.b.l = (SZ[res & 0xff] & (Sflag | Zflag)) | (val & Xflags) | ((res >> 8) & Cflag) | Nflag | ((a ^ res ^ val) & Hflag) |
+            ((((val ^ a) & (a ^ res)) >> 5) & Vflag);
+         break;
+      case FLAGS_INC:
+         z80.AF.b.l = ((res >> 8) & Cflag) | SZHV_inc[res & 0xff];
+         break;
+      case FLAGS_DEC:
+         z80.AF.b.l = ((res >> 8) & Cflag) | SZHV_dec[res & 0xff];
+         break;
+   }
+   z80.flags_op = FLAGS_READY;
+}
+
+inline byte& z80_flags()
+{
+   if (z80.flags_op != FLAGS_READY) {
+      z80_resolve_flags();
+   }
+   return z80.AF.b.l;
+}
+
+// For instructions setting all of the flags.
+inline void z80_set_flags(byte flags)
+{
+   z80.flags_op = FLAGS_READY;
+   z80.AF.b.l = flags;
+}
+
+inline byte z80_carry()
+{
+   return z80.flags_op != FLAGS_READY ? (z80.flags_res >> 8) & Cflag : z80.AF.b.l & Cflag;
+}
+
+inline byte z80_zero()
+{
+   return z80.flags_op != FLAGS_READY ? ((z80.flags_res & 0xff) ? 0 : Zflag) : z80.AF.b.l & Zflag;
+}
+
+// Only read or written through the functions above from now on.
+#undef _F
+#define _F z80_flags()
+
 static byte irep_tmp1[4][4] = {
    {0, 0, 1, 0}, {0, 1, 0, 1}, {1, 0, 1, 1}, {0, 1, 1, 0}
 };
@@ -330,38 +413,48 @@ static byte cc_ex[256] = {
 
 
 
-extern byte *membank_read[4], *membank_write[4];
 
 inline byte read_mem_no_watchpoint(word addr) {
   return (*(membank_read[addr >> 14] + (addr & 0x3fff))); // returns a byte from a 16KB memory bank
 }
 
+// Only called when the index says there's a watchpoint on addr: check its
+// type and its condition, if any.
+inline bool watchpoint_matches(word addr, WatchpointType type, byte val) {
+  return std::any_of(watchpoints.begin(), watchpoints.end(), [&](const auto& w) {
+      return w.address == addr && (w.type & type) && ((w.value ^ val) & w.mask) == 0;
+      });
+}
+
+// Debug selects the instrumented variant (watchpoints). The other one is used
+// whenever no debugger feature is active and costs nothing more than a plain
+// memory access.
+template<bool Debug>
 inline byte read_mem(word addr) {
-  if (!watchpoints.empty()) {
-    if (std::any_of(watchpoints.begin(), watchpoints.end(), [&](const auto& w) {
-          return w.address == addr && (w.type & READ);
-          })) {
+  byte val = read_mem_no_watchpoint(addr);
+  if (Debug && read_watchpoints_index.test(addr)) {
+    if (watchpoint_matches(addr, READ, val)) {
       z80.watchpoint_reached = 1;
     }
   }
-  return read_mem_no_watchpoint(addr);
+  return val;
 }
 
 inline void write_mem_no_watchpoint(word addr, byte val) {
   *(membank_write[addr >> 14] + (addr & 0x3fff)) = val; // writes a byte to a 16KB memory bank
+  ram_mark_write(addr);
 }
 
+template<bool Debug>
 inline void write_mem(word addr, byte val) {
-  if (!watchpoints.empty()) {
-    if (std::any_of(watchpoints.begin(), watchpoints.end(), [&](const auto& w) {
-          return w.address == addr && (w.type & WRITE);
-          })) {
+  if (Debug && write_watchpoints_index.test(addr)) {
+    if (watchpoint_matches(addr, WRITE, val)) {
       z80.watchpoint_reached = 1;
     }
   }
-  if (GateArray.registerPageOn) {
-    //LOG_DEBUG("Pass write to ASIC: " << static_cast<int>(val) << " at " << addr);
-    if(!asic_register_page_write(addr, val)) return;
+  if (membank_write_handler[addr >> 14]) {
+    membank_write_handler[addr >> 14](addr, val);
+    return;
   }
   //LOG_DEBUG("Write " << static_cast<int>(val) << " at " << addr);
   write_mem_no_watchpoint(addr, val);
@@ -377,45 +470,103 @@ void z80_write_mem(word addr, byte val) {
 
 
 
+// Peripheral event scheduler.
+// The sound, FDC timeout and tape peripherals only need to be serviced when
+// their next deadline is reached, so instead of updating each of them after
+// every instruction, cycles are accumulated in iEventCycleCount and only handed
+// over to them once iEventDeadline (the earliest of their deadlines) is reached,
+// or before any I/O access which could observe or modify their state.
+// The CRTC is not part of it: it is stepped after every instruction as raster
+// effects depend on the exact beam position.
+// The frame cycle counter (CPC.cycle_count) is one of these deadlines too, which
+// keeps the per instruction path clear of the (thread local) CPC structure.
+
+void z80_schedule_events()
+{
+   iEventDeadline = INT_MAX;
+   if (CPC.snd_enabled) {
+      if (PSG.cycle_count.high >= CPC.snd_cycle_count_init.high) {
+         iEventDeadline = 0;
+      } else {
+         iEventDeadline = std::min(iEventDeadline, static_cast<int>(CPC.snd_cycle_count_init.high - PSG.cycle_count.high));
+      }
+   }
+   if (FDC.phase == EXEC_PHASE) {
+      iEventDeadline = std::min(iEventDeadline, FDC.timeout);
+   }
+   if ((CPC.tape_motor) && (CPC.tape_play_button)) {
+      iEventDeadline = std::min(iEventDeadline, iTapeCycleCount);
+   }
+   iEventDeadline = std::min(iEventDeadline, CPC.cycle_count);
+}
+
+void z80_sync_events()
+{
+   int iCycles = iEventCycleCount;
+   iEventCycleCount = 0;
+   if (iCycles) {
+      CPC.cycle_count -= iCycles;
+      if (CPC.snd_enabled) {
+         PSG.cycle_count.high += iCycles;
+         if (PSG.cycle_count.high >= CPC.snd_cycle_count_init.high) {
+            PSG.cycle_count.both -= CPC.snd_cycle_count_init.both;
+            PSG.Synthesizer();
+         }
+      }
+      if (FDC.phase == EXEC_PHASE) {
+         FDC.timeout -= iCycles;
+         if (FDC.timeout <= 0) {
+            FDC.flags |= OVERRUN_flag;
+            if (FDC.cmd_direction == FDC_TO_CPU) {
+               fdc_read_data();
+            }
+            else {
+               fdc_write_data(0xff);
+            }
+         }
+      }
+      if ((CPC.tape_motor) && (CPC.tape_play_button)) {
+         iTapeCycleCount -= iCycles;
+         if (iTapeCycleCount <= 0) {
+            AY_flush(); // the tape is heard in the sound mixer
+            Tape_UpdateLevel();
+         }
+      }
+   }
+   z80_schedule_events();
+}
+
+inline byte z80_IN(reg_pair port)
+{
+   z80_sync_events();
+   byte val = z80_IN_handler(port);
+   z80_schedule_events();
+   return val;
+}
+
+inline void z80_OUT(reg_pair port, byte val)
+{
+   z80_sync_events();
+   z80_OUT_handler(port, val);
+   z80_schedule_events();
+}
+
 #define z80_wait_states \
 { \
    if (iCycleCount) { \
       crtc_cycle(iCycleCount >> 2); \
-      if (CPC.snd_enabled) { \
-         PSG.cycle_count.high += iCycleCount; \
-         if (PSG.cycle_count.high >= CPC.snd_cycle_count_init.high) { \
-            PSG.cycle_count.both -= CPC.snd_cycle_count_init.both; \
-            PSG.Synthesizer(); \
-         } \
-      } \
-      if (FDC.phase == EXEC_PHASE) { \
-         FDC.timeout -= iCycleCount; \
-         if (FDC.timeout <= 0) { \
-            FDC.flags |= OVERRUN_flag; \
-            if (FDC.cmd_direction == FDC_TO_CPU) { \
-               fdc_read_data(); \
-            } \
-            else { \
-               fdc_write_data(0xff); \
-            } \
-         } \
+      iEventCycleCount += iCycleCount; \
+      if (iEventCycleCount >= iEventDeadline) { \
+         z80_sync_events(); \
       } \
-      if ((CPC.tape_motor) && (CPC.tape_play_button)) { \
-         iTapeCycleCount -= iCycleCount; \
-         if (iTapeCycleCount <= 0) { \
-            Tape_UpdateLevel(); \
-         } \
-      } \
-      CPC.cycle_count -= iCycleCount; \
    } \
 }
 
 #define ADC(value) \
 { \
    unsigned val = value; \
-   unsigned res = _A + val + (_F & Cflag); \
-   _F = SZ[res & 0xff] | ((res >> 8) & Cflag) | ((_A ^ res ^ val) & Hflag) | \
-      (((val ^ _A ^ 0x80) & (val ^ res) & 0x80) >> 5); \
+   unsigned res = _A + val + z80_carry(); \
+   z80_lazy_flags(FLAGS_ADD, _A, val, res); \
    _A = res; \
 }
 
@@ -423,35 +574,34 @@ void z80_write_mem(word addr, byte val) {
 { \
    unsigned val = value; \
    unsigned res = _A + val; \
-   _F = SZ[static_cast<byte>(res)] | ((res >> 8) & Cflag) | ((_A ^ res ^ val) & Hflag) | \
-      (((val ^ _A ^ 0x80) & (val ^ res) & 0x80) >> 5); \
+   z80_lazy_flags(FLAGS_ADD, _A, val, res); \
    _A = static_cast<byte>(res); \
 }
 
 #define ADD16(dest, src) \
 { \
-   dword res = z80.dest.d + z80.src.d; \
-   _F = (_F & (Sflag | Zflag | Vflag)) | (((z80.dest.d ^ res ^ z80.src.d) >> 8) & Hflag) | \
+   dword res = (dest).d + (src).d; \
+   _F = (_F & (Sflag | Zflag | Vflag)) | ((((dest).d ^ res ^ (src).d) >> 8) & Hflag) | \
       ((res >> 16) & Cflag) | ((res >> 8) & Xflags); \
-   z80.dest.w.l = static_cast<word>(res); \
+   (dest).w.l = static_cast<word>(res); \
 }
 
 #define AND(val) \
 { \
    _A &= (val); \
-   _F = SZP[_A] | Hflag; \
+   z80_set_flags(SZP[_A] | Hflag); \
 }
 
 #define CALL \
 { \
-   if (z80.step_out) { \
-     z80.step_out_addresses.push_back(_PC+2); \
+   if (Debug && z80.step_out) { \
+     z80_step_out_addresses.push_back(_PC+2); \
    } \
    reg_pair dest; \
-   dest.b.l = read_mem(_PC++); /* subroutine address low byte */ \
-   dest.b.h = read_mem(_PC++); /* subroutine address high byte */ \
-   write_mem(--_SP, z80.PC.b.h); /* store high byte of current PC */ \
-   write_mem(--_SP, z80.PC.b.l); /* store low byte of current PC */ \
+   dest.b.l = read_mem<Debug>(_PC++); /* subroutine address low byte */ \
+   dest.b.h = read_mem<Debug>(_PC++); /* subroutine address high byte */ \
+   write_mem<Debug>(--_SP, z80.PC.b.h); /* store high byte of current PC */ \
+   write_mem<Debug>(--_SP, z80.PC.b.l); /* store low byte of current PC */ \
    _PC = dest.w.l; /* continue execution at subroutine */ \
 }
 
@@ -459,14 +609,13 @@ void z80_write_mem(word addr, byte val) {
 { \
    unsigned val = value; \
    unsigned res = _A - val; \
-   _F = (SZ[res & 0xff] & (Sflag | Zflag)) | (val & Xflags) | ((res >> 8) & Cflag) | Nflag | ((_A ^ res ^ val) & Hflag) | \
-      ((((val ^ _A) & (_A ^ res)) >> 5) & Vflag); \
+   z80_lazy_flags(FLAGS_CP, _A, val, res); \
 }
 
 #define DAA \
 { \
    int idx = _A; \
-   if(_F & Cflag) \
+   if(z80_carry()) \
       idx |= 0x100; \
    if(_F & Hflag) \
       idx |= 0x200; \
@@ -478,13 +627,13 @@ void z80_write_mem(word addr, byte val) {
 #define DEC(reg) \
 { \
    (reg)--; \
-   _F = (_F & Cflag) | SZHV_dec[reg]; \
+   z80_lazy_flags(FLAGS_DEC, 0, 0, (reg) | (z80_carry() << 8)); \
 }
 
 #define JR \
 { \
    signed char offset; \
-   offset = static_cast<signed char>(read_mem(_PC)); /* grab signed jump offset */ \
+   offset = static_cast<signed char>(read_mem<Debug>(_PC)); /* grab signed jump offset */ \
    _PC += offset + 1; /* add offset & correct PC */ \
 }
 
@@ -513,82 +662,82 @@ void z80_write_mem(word addr, byte val) {
 #define EX_SP(reg) \
 { \
    reg_pair temp; \
-   temp.b.l = read_mem(_SP++); \
-   temp.b.h = read_mem(_SP); \
-   write_mem(_SP--, z80.reg.b.h); \
-   write_mem(_SP, z80.reg.b.l); \
-   z80.reg.w.l = temp.w.l; \
+   temp.b.l = read_mem<Debug>(_SP++); \
+   temp.b.h = read_mem<Debug>(_SP); \
+   write_mem<Debug>(_SP--, (reg).b.h); \
+   write_mem<Debug>(_SP, (reg).b.l); \
+   (reg).w.l = temp.w.l; \
 }
 
 #define INC(reg) \
 { \
    (reg)++; \
-   _F = (_F & Cflag) | SZHV_inc[reg]; \
+   z80_lazy_flags(FLAGS_INC, 0, 0, (reg) | (z80_carry() << 8)); \
 }
 
 #define JP \
 { \
    reg_pair addr; \
-   addr.b.l = read_mem(_PC++); \
-   addr.b.h = read_mem(_PC); \
+   addr.b.l = read_mem<Debug>(_PC++); \
+   addr.b.h = read_mem<Debug>(_PC); \
    _PC = addr.w.l; \
 }
 
 #define LD16_MEM(reg) \
 { \
    reg_pair addr; \
-   addr.b.l = read_mem(_PC++); \
-   addr.b.h = read_mem(_PC++); \
-   z80.reg.b.l = read_mem(addr.w.l); \
-   z80.reg.b.h = read_mem(addr.w.l+1); \
+   addr.b.l = read_mem<Debug>(_PC++); \
+   addr.b.h = read_mem<Debug>(_PC++); \
+   (reg).b.l = read_mem<Debug>(addr.w.l); \
+   (reg).b.h = read_mem<Debug>(addr.w.l+1); \
 }
 
 #define LDMEM_16(reg) \
 { \
    reg_pair addr; \
-   addr.b.l = read_mem(_PC++); \
-   addr.b.h = read_mem(_PC++); \
-   write_mem(addr.w.l, z80.reg.b.l); \
-   write_mem(addr.w.l+1, z80.reg.b.h); \
+   addr.b.l = read_mem<Debug>(_PC++); \
+   addr.b.h = read_mem<Debug>(_PC++); \
+   write_mem<Debug>(addr.w.l, (reg).b.l); \
+   write_mem<Debug>(addr.w.l+1, (reg).b.h); \
 }
 
 #define OR(val) \
 { \
    _A |= (val); \
-   _F = SZP[_A]; \
+   z80_set_flags(SZP[_A]); \
 }
 
 #define POP(reg) \
 { \
-   z80.reg.b.l = read_mem(_SP++); \
-   z80.reg.b.h = read_mem(_SP++); \
+   (reg).b.l = read_mem<Debug>(_SP++); \
+   (reg).b.h = read_mem<Debug>(_SP++); \
 }
 
 #define PUSH(reg) \
 { \
-   write_mem(--_SP, z80.reg.b.h); \
-   write_mem(--_SP, z80.reg.b.l); \
+   write_mem<Debug>(--_SP, (reg).b.h); \
+   write_mem<Debug>(--_SP, (reg).b.l); \
 }
 
 #define RET \
 { \
-   z80.PC.b.l = read_mem(_SP++); \
-   z80.PC.b.h = read_mem(_SP++); \
-   if (z80.step_out) { \
-     if (z80.step_out_addresses.empty()) { \
+   z80.PC.b.l = read_mem<Debug>(_SP++); \
+   z80.PC.b.h = read_mem<Debug>(_SP++); \
+   if (Debug && z80.step_out) { \
+     if (z80_step_out_addresses.empty()) { \
        z80.step_out = 0; \
        z80.step_in = 2; \
      } \
      /* If the address is not in step_out_addresses, it doesn't come from a call */ \
-     else if (z80.step_out_addresses.back() == z80.PC.w.l) { \
-       z80.step_out_addresses.pop_back(); \
+     else if (z80_step_out_addresses.back() == z80.PC.w.l) { \
+       z80_step_out_addresses.pop_back(); \
      } \
    } \
 }
 
 #define RLA \
 { \
-   byte res = (_A << 1) | (_F & Cflag); \
+   byte res = (_A << 1) | z80_carry(); \
    byte carry = (_A & 0x80) ? Cflag : 0; \
    _F = (_F & (Sflag | Zflag | Pflag)) | carry | (res & Xflags); \
    _A = res; \
@@ -617,20 +766,19 @@ void z80_write_mem(word addr, byte val) {
 
 #define RST(addr) \
 { \
-   if (z80.step_out) { \
-     z80.step_out_addresses.push_back(_PC+2); \
+   if (Debug && z80.step_out) { \
+     z80_step_out_addresses.push_back(_PC+2); \
    } \
-   write_mem(--_SP, z80.PC.b.h); /* store high byte of current PC */ \
-   write_mem(--_SP, z80.PC.b.l); /* store low byte of current PC */ \
+   write_mem<Debug>(--_SP, z80.PC.b.h); /* store high byte of current PC */ \
+   write_mem<Debug>(--_SP, z80.PC.b.l); /* store low byte of current PC */ \
    _PC = addr; /* continue execution at restart address */ \
 }
 
 #define SBC(value) \
 { \
    unsigned val = value; \
-   unsigned res = _A - val - (_F & Cflag); \
-   _F = SZ[res & 0xff] | ((res >> 8) & Cflag) | Nflag | ((_A ^ res ^ val) & Hflag) | \
-      (((val ^ _A) & (_A ^ res) & 0x80) >> 5); \
+   unsigned res = _A - val - z80_carry(); \
+   z80_lazy_flags(FLAGS_SUB, _A, val, res); \
    _A = res; \
 }
 
@@ -638,19 +786,18 @@ void z80_write_mem(word addr, byte val) {
 { \
    unsigned val = value; \
    unsigned res = _A - val; \
-   _F = SZ[res & 0xff] | ((res >> 8) & Cflag) | Nflag | ((_A ^ res ^ val) & Hflag) | \
-      (((val ^ _A) & (_A ^ res) & 0x80) >> 5); \
+   z80_lazy_flags(FLAGS_SUB, _A, val, res); \
    _A = res; \
 }
 
 #define XOR(val) \
 { \
    _A ^= (val); \
-   _F = SZP[_A]; \
+   z80_set_flags(SZP[_A]); \
 }
 
 #define BIT(bit, reg) \
-   (_F = (_F & Cflag) | Hflag | SZ_BIT[(reg) & (1 << (bit))])
+   z80_set_flags(z80_carry() | Hflag | SZ_BIT[(reg) & (1 << (bit))])
 
 #define BIT_XY BIT
 
@@ -662,15 +809,15 @@ inline byte RLC(byte val) {
    unsigned res = val;
    unsigned carry = (res & 0x80) ? Cflag : 0;
    res = ((res << 1) | (res >> 7)) & 0xff;
-   _F = SZP[res] | carry;
+   z80_set_flags(SZP[res] | carry);
    return res;
 }
 
 inline byte RL(byte val) {
    unsigned res = val;
    unsigned carry = (res & 0x80) ? Cflag : 0;
-   res = ((res << 1) | (_F & Cflag)) & 0xff;
-   _F = SZP[res] | carry;
+   res = ((res << 1) | z80_carry()) & 0xff;
+   z80_set_flags(SZP[res] | carry);
    return res;
 }
 
@@ -678,7 +825,7 @@ inline byte RRC(byte val) {
    unsigned res = val;
    unsigned carry = (res & 0x01) ? Cflag : 0;
    res = ((res >> 1) | (res << 7)) & 0xff;
-   _F = SZP[res] | carry;
+   z80_set_flags(SZP[res] | carry);
    return res;
 }
 
@@ -686,7 +833,7 @@ inline byte RR(byte val) {
    unsigned res = val;
    unsigned carry = (res & 0x01) ? Cflag : 0;
    res = ((res >> 1) | (_F << 7)) & 0xff;
-   _F = SZP[res] | carry;
+   z80_set_flags(SZP[res] | carry);
    return res;
 }
 
@@ -698,7 +845,7 @@ inline byte SLA(byte val) {
    unsigned res = val;
    unsigned carry = (res & 0x80) ? Cflag : 0;
    res = (res << 1) & 0xff;
-   _F = SZP[res] | carry;
+   z80_set_flags(SZP[res] | carry);
    return res;
 }
 
@@ -706,7 +853,7 @@ inline byte SLL(byte val) {
    unsigned res = val;
    unsigned carry = (res & 0x80) ? Cflag : 0;
    res = ((res << 1) | 0x01) & 0xff;
-   _F = SZP[res] | carry;
+   z80_set_flags(SZP[res] | carry);
    return res;
 }
 
@@ -714,7 +861,7 @@ inline byte SRA(byte val) {
    unsigned res = val;
    unsigned carry = (res & 0x01) ? Cflag : 0;
    res = ((res >> 1) | (res & 0x80)) & 0xff;
-   _F = SZP[res] | carry;
+   z80_set_flags(SZP[res] | carry);
    return res;
 }
 
@@ -722,28 +869,28 @@ inline byte SRL(byte val) {
    unsigned res = val;
    unsigned carry = (res & 0x01) ? Cflag : 0;
    res = (res >> 1) & 0xff;
-   _F = SZP[res] | carry;
+   z80_set_flags(SZP[res] | carry);
    return res;
 }
 
 #define ADC16(reg) \
 { \
-   dword res = _HLdword + z80.reg.d + (_F & Cflag); \
-   _F = (((_HLdword ^ res ^ z80.reg.d) >> 8) & Hflag) | \
+   dword res = _HLdword + z80.reg.d + z80_carry(); \
+   z80_set_flags((((_HLdword ^ res ^ z80.reg.d) >> 8) & Hflag) | \
       ((res >> 16) & Cflag) | \
       ((res >> 8) & (Sflag | Xflags)) | \
       ((res & 0xffff) ? 0 : Zflag) | \
-      (((z80.reg.d ^ _HLdword ^ 0x8000) & (z80.reg.d ^ res) & 0x8000) >> 13); \
+      (((z80.reg.d ^ _HLdword ^ 0x8000) & (z80.reg.d ^ res) & 0x8000) >> 13)); \
    _HL = static_cast<word>(res); \
 }
 
 #define CPD \
 { \
-   byte val = read_mem(_HL); \
+   byte val = read_mem<Debug>(_HL); \
    byte res = _A - val; \
    _HL--; \
    _BC--; \
-   _F = (_F & Cflag) | (SZ[res] & ~Xflags) | ((_A ^ val ^ res) & Hflag) | Nflag; \
+   z80_set_flags(z80_carry() | (SZ[res] & ~Xflags) | ((_A ^ val ^ res) & Hflag) | Nflag); \
    if(_F & Hflag) res -= 1; \
    if(res & 0x02) _F |= 0x20; \
    if(res & 0x08) _F |= 0x08; \
@@ -752,7 +899,7 @@ inline byte SRL(byte val) {
 
 #define CPDR \
    CPD; \
-   if(_BC && !(_F & Zflag)) \
+   if(_BC && !z80_zero()) \
    { \
       iCycleCount += cc_ex[bOpCode]; \
       _PC -= 2; \
@@ -761,11 +908,11 @@ inline byte SRL(byte val) {
 
 #define CPI \
 { \
-   byte val = read_mem(_HL); \
+   byte val = read_mem<Debug>(_HL); \
    byte res = _A - val; \
    _HL++; \
    _BC--; \
-   _F = (_F & Cflag) | (SZ[res] & ~Xflags) | ((_A ^ val ^ res) & Hflag) | Nflag; \
+   z80_set_flags(z80_carry() | (SZ[res] & ~Xflags) | ((_A ^ val ^ res) & Hflag) | Nflag); \
    if(_F & Hflag) res -= 1; \
    if(res & 0x02) _F |= 0x20; \
    if(res & 0x08) _F |= 0x08; \
@@ -774,7 +921,7 @@ inline byte SRL(byte val) {
 
 #define CPIR \
    CPI; \
-   if(_BC && !(_F & Zflag)) \
+   if(_BC && !z80_zero()) \
    { \
       iCycleCount += cc_ex[bOpCode]; \
       _PC -= 2; \
@@ -783,11 +930,11 @@ inline byte SRL(byte val) {
 
 #define IND \
 { \
-   byte io = z80_IN_handler(z80.BC); \
+   byte io = z80_IN(z80.BC); \
    _B--; \
-   write_mem(_HL, io); \
+   write_mem<Debug>(_HL, io); \
    _HL--; \
-   _F = SZ[_B]; \
+   z80_set_flags(SZ[_B]); \
    if(io & Sflag) _F |= Nflag; \
    if((((_C - 1) & 0xff) + io) & 0x100) _F |= Hflag | Cflag; \
    if((drep_tmp1[_C & 3][io & 3] ^ breg_tmp2[_B] ^ (_C >> 2) ^ (io >> 2)) & 1) \
@@ -804,11 +951,11 @@ inline byte SRL(byte val) {
 
 #define INI \
 { \
-   byte io = z80_IN_handler(z80.BC); \
+   byte io = z80_IN(z80.BC); \
    _B--; \
-   write_mem(_HL, io); \
+   write_mem<Debug>(_HL, io); \
    _HL++; \
-   _F = SZ[_B]; \
+   z80_set_flags(SZ[_B]); \
    if(io & Sflag) _F |= Nflag; \
    if((((_C + 1) & 0xff) + io) & 0x100) _F |= Hflag | Cflag; \
    if((irep_tmp1[_C & 3][io & 3] ^ breg_tmp2[_B] ^ (_C >> 2) ^ (io >> 2)) & 1) \
@@ -825,8 +972,8 @@ inline byte SRL(byte val) {
 
 #define LDD \
 { \
-   byte io = read_mem(_HL); \
-   write_mem(_DE, io); \
+   byte io = read_mem<Debug>(_HL); \
+   write_mem<Debug>(_DE, io); \
    _F &= Sflag | Zflag | Cflag; \
    if((_A + io) & 0x02) _F |= 0x20; \
    if((_A + io) & 0x08) _F |= 0x08; \
@@ -846,8 +993,8 @@ inline byte SRL(byte val) {
 
 #define LDI \
 { \
-   byte io = read_mem(_HL); \
-   write_mem(_DE, io); \
+   byte io = read_mem<Debug>(_HL); \
+   write_mem<Debug>(_DE, io); \
    _F &= Sflag | Zflag | Cflag; \
    if((_A + io) & 0x02) _F |= 0x20; \
    if((_A + io) & 0x08) _F |= 0x08; \
@@ -874,11 +1021,11 @@ inline byte SRL(byte val) {
 
 #define OUTD \
 { \
-   byte io = read_mem(_HL); \
+   byte io = read_mem<Debug>(_HL); \
    _B--; \
-   z80_OUT_handler(z80.BC, io); \
+   z80_OUT(z80.BC, io); \
    _HL--; \
-   _F = SZ[_B]; \
+   z80_set_flags(SZ[_B]); \
    if(io & Sflag) _F |= Nflag; \
    if((((_C - 1) & 0xff) + io) & 0x100) _F |= Hflag | Cflag; \
    if((drep_tmp1[_C & 3][io & 3] ^ breg_tmp2[_B] ^ (_C >> 2) ^ (io >> 2)) & 1) \
@@ -895,11 +1042,11 @@ inline byte SRL(byte val) {
 
 #define OUTI \
 { \
-   byte io = read_mem(_HL); \
+   byte io = read_mem<Debug>(_HL); \
    _B--; \
-   z80_OUT_handler(z80.BC, io); \
+   z80_OUT(z80.BC, io); \
    _HL++; \
-   _F = SZ[_B]; \
+   z80_set_flags(SZ[_B]); \
    if(io & Sflag) _F |= Nflag; \
    if((((_C + 1) & 0xff) + io) & 0x100) _F |= Hflag | Cflag; \
    if((irep_tmp1[_C & 3][io & 3] ^ breg_tmp2[_B] ^ (_C >> 2) ^ (io >> 2)) & 1) \
@@ -916,33 +1063,114 @@ inline byte SRL(byte val) {
 
 #define RLD \
 { \
-   byte n = read_mem(_HL); \
-   write_mem(_HL, (n << 4) | (_A & 0x0f)); \
+   byte n = read_mem<Debug>(_HL); \
+   write_mem<Debug>(_HL, (n << 4) | (_A & 0x0f)); \
    _A = (_A & 0xf0) | (n >> 4); \
-   _F = (_F & Cflag) | SZP[_A]; \
+   z80_set_flags(z80_carry() | SZP[_A]); \
 }
 
 #define RRD \
 { \
-   byte n = read_mem(_HL); \
-   write_mem(_HL, (n >> 4) | (_A << 4)); \
+   byte n = read_mem<Debug>(_HL); \
+   write_mem<Debug>(_HL, (n >> 4) | (_A << 4)); \
    _A = (_A & 0xf0) | (n & 0x0f); \
-   _F = (_F & Cflag) | SZP[_A]; \
+   z80_set_flags(z80_carry() | SZP[_A]); \
 }
 
 #define SBC16(reg) \
 { \
-   dword res = _HLdword - z80.reg.d - (_F & Cflag); \
-   _F = (((_HLdword ^ res ^ z80.reg.d) >> 8) & Hflag) | Nflag | \
+   dword res = _HLdword - z80.reg.d - z80_carry(); \
+   z80_set_flags((((_HLdword ^ res ^ z80.reg.d) >> 8) & Hflag) | Nflag | \
       ((res >> 16) & Cflag) | \
       ((res >> 8) & (Sflag | Xflags)) | \
       ((res & 0xffff) ? 0 : Zflag) | \
-      (((z80.reg.d ^ _HLdword) & (_HLdword ^ res) &0x8000) >> 13); \
+      (((z80.reg.d ^ _HLdword) & (_HLdword ^ res) &0x8000) >> 13)); \
    _HL = static_cast<word>(res); \
 }
 
 
 
+// Fast path for LDIR, LDDR, CPIR and CPDR, used in place of their first
+// iteration (bOpCode is at _PC - 1) when no debugger feature is active.
+// It runs in bulk, one byte span at a time, the following iterations that
+// would repeat the instruction, up to the one before the last. The z80_execute
+// loop would have had nothing else to do in between them: no CRTC event
+// (crtc_quiet_chars), no peripheral deadline, no interrupt being enabled, no
+// break point nor MF2 exit on the instruction.
+// All of them happen before the CRTC catches up, so they must not write to the
+// video memory it fetches meanwhile, nor to the instruction itself, nor to a
+// bank with a write handler. The last
+// iteration, which computes the flags and the timing adjustments, goes
+// through the usual path.
+template<int Step, bool Compare>
+void z80_block_bulk(byte bOpCode)
+{
+   word pc = _PC - 2;
+   if (z80.EI_issued || (z80.int_pending && _IFF1) ||
+       z80.break_point == pc || ((dwMF2Flags & MF2_RUNNING) && dwMF2ExitAddr == pc)) {
+      return;
+   }
+   int cycles = cc_op[0xed] + cc_ed[bOpCode] + cc_ex[bOpCode];
+   int chars = cycles >> 2;
+   int room = iEventDeadline - iEventCycleCount - 1;
+   if (room < cycles) {
+      return;
+   }
+   // Only whole spans: they can't go past the bank of HL (or DE).
+   auto span = [](word addr) { return Step > 0 ? 0x4000 - (addr & 0x3fff) : (addr & 0x3fff) + 1; };
+   int count = (_BC ? _BC : 0x10000) - 1;
+   count = std::min(count, span(_HL));
+   if (!Compare) {
+      if (membank_write_handler[_DE >> 14]) {
+         return;
+      }
+      count = std::min(count, span(_DE));
+   }
+   count = std::min(count, room / cycles);
+   count = crtc_quiet_chars(count * chars) / chars;
+   if (count < 2) {
+      return;
+   }
+
+   const byte *src = membank_read[_HL >> 14] + (_HL & 0x3fff);
+   if (Compare) {
+      for (int n = 0; n < count; n++, src += Step) {
+         if (*src == _A) {
+            count = n; // that one ends the instruction
+            break;
+         }
+      }
+   } else {
+      byte *dest = membank_write[_DE >> 14] + (_DE & 0x3fff);
+      byte *first = Step > 0 ? dest : dest - (count - 1);
+      byte *last = first + (count - 1);
+      for (word addr : { pc, static_cast<word>(pc + 1) }) {
+         const byte *opcode = membank_read[addr >> 14] + (addr & 0x3fff);
+         if (opcode >= first && opcode <= last) {
+            return;
+         }
+      }
+      if (crtc_quiet_chars_fetch(count * chars, first, last)) {
+         return;
+      }
+      for (int n = 0; n < count; n++, src += Step, dest += Step) {
+         *dest = *src; // one byte at a time: the spans may overlap (e.g. fills)
+      }
+      word first_addr = Step > 0 ? _DE : _DE - (count - 1);
+      for (unsigned int addr = first_addr & ~(RAM_PAGE_SIZE - 1); addr <= first_addr + (count - 1u); addr += RAM_PAGE_SIZE) {
+         ram_mark_write(addr);
+      }
+      _DE += Step * count;
+   }
+   _HL += Step * count;
+   _BC -= count;
+   _R += 2 * count;
+   crtc_cycle(count * chars);
+   iEventCycleCount += count * cycles;
+}
+
+
+
 #define z80_int_handler \
 { \
    /*LOG_DEBUG("Interrupt handler " << static_cast<int>(_IFF1));*/ \
@@ -970,15 +1198,15 @@ inline byte SRL(byte val) {
          if (iWSAdjust) { \
             iCycleCount -= 4; \
          } \
-        if (z80.step_out) { \
-          z80.step_out_addresses.push_back(_PC+2); \
+        if (Debug && z80.step_out) { \
+          z80_step_out_addresses.push_back(_PC+2); \
         } \
-         write_mem(--_SP, z80.PC.b.h); /* store high byte of current PC */ \
-         write_mem(--_SP, z80.PC.b.l); /* store low byte of current PC */ \
+         write_mem<Debug>(--_SP, z80.PC.b.h); /* store high byte of current PC */ \
+         write_mem<Debug>(--_SP, z80.PC.b.l); /* store low byte of current PC */ \
          addr.b.l = 0xff; /* assemble pointer */ \
          addr.b.h = _I; \
-         z80.PC.b.l = read_mem(addr.w.l); /* retrieve low byte of vector */ \
-         z80.PC.b.h = read_mem(addr.w.l+1); /* retrieve high byte of vector */ \
+         z80.PC.b.l = read_mem<Debug>(addr.w.l); /* retrieve low byte of vector */ \
+         z80.PC.b.h = read_mem<Debug>(addr.w.l+1); /* retrieve high byte of vector */ \
          z80_wait_states \
       } \
    } \
@@ -987,44 +1215,62 @@ inline byte SRL(byte val) {
 void z80_reset()
 {
    z80 = t_z80regs();
+   z80_step_out_addresses.clear();
    _IX =
    _IY = 0xffff; // IX and IY are FFFF after a reset!
-   _F = Zflag; // set zero flag
+   z80_set_flags(Zflag); // set zero flag
    z80.break_point = 0xffffffff; // clear break point
 }
 
 void z80_init_tables()
 {
-   int i, p;
-
-   for (i = 0; i < 256; i++) {
-      p = 0;
-      if(i & 0x01) ++p;
-      if(i & 0x02) ++p;
-      if(i & 0x04) ++p;
-      if(i & 0x08) ++p;
-      if(i & 0x10) ++p;
-      if(i & 0x20) ++p;
-      if(i & 0x40) ++p;
-      if(i & 0x80) ++p;
-      SZ[i] = i ? i & Sflag : Zflag;
-      SZ[i] |= (i & Xflags);
-      SZ_BIT[i] = i ? i & Sflag : Zflag | Pflag;
-      SZ_BIT[i] |= (i & Xflags);
-      SZP[i] = SZ[i] | ((p & 1) ? 0 : Pflag);
-      SZHV_inc[i] = SZ[i];
-      if(i == 0x80) SZHV_inc[i] |= Vflag;
-      if((i & 0x0f) == 0x00) SZHV_inc[i] |= Hflag;
-      SZHV_dec[i] = SZ[i] | Nflag;
-      if(i == 0x7f) SZHV_dec[i] |= Vflag;
-      if((i & 0x0f) == 0x0f) SZHV_dec[i] |= Hflag;
-   }
+   // Shared by all the emulation threads.
+   static std::once_flag tables_initialized;
+   std::call_once(tables_initialized, [] {
+      int i, p;
+
+      for (i = 0; i < 256; i++) {
+         p = 0;
+         if(i & 0x01) ++p;
+         if(i & 0x02) ++p;
+         if(i & 0x04) ++p;
+         if(i & 0x08) ++p;
+         if(i & 0x10) ++p;
+         if(i & 0x20) ++p;
+         if(i & 0x40) ++p;
+         if(i & 0x80) ++p;
+         SZ[i] = i ? i & Sflag : Zflag;
+         SZ[i] |= (i & Xflags);
+         SZ_BIT[i] = i ? i & Sflag : Zflag | Pflag;
+         SZ_BIT[i] |= (i & Xflags);
+         SZP[i] = SZ[i] | ((p & 1) ? 0 : Pflag);
+         SZHV_inc[i] = SZ[i];
+         if(i == 0x80) SZHV_inc[i] |= Vflag;
+         if((i & 0x0f) == 0x00) SZHV_inc[i] |= Hflag;
+         SZHV_dec[i] = SZ[i] | Nflag;
+         if(i == 0x7f) SZHV_dec[i] |= Vflag;
+         if((i & 0x0f) == 0x0f) SZHV_dec[i] |= Hflag;
+      }
+   });
 }
 
 
 
+template<bool Debug> void z80_execute_instruction();
+template<bool Debug> void z80_execute_pfx_cb_instruction();
+template<bool Debug> void z80_execute_pfx_ed_instruction();
+// The DD and FD prefixed instructions are the same, except for the index
+// register (IX or IY) they use: IR points to it in t_z80regs.
+template<bool Debug, reg_pair t_z80regs::*IR> void z80_execute_pfx_xy_instruction();
+template<bool Debug, reg_pair t_z80regs::*IR> void z80_execute_pfx_xycb_instruction();
+
+#define _IRh      (z80.*IR).b.h
+#define _IRl      (z80.*IR).b.l
+#define _IR       (z80.*IR).w.l
+
 void z80_mf2stop()
 {
+   constexpr bool Debug = true; // not on the hot path, keep watchpoints working
    _R++;
    _IFF1 = 0;
    z80.EI_issued = 0;
@@ -1035,13 +1281,44 @@ void z80_mf2stop()
    dwMF2ExitAddr = _PCdword;
    RST(0x0066); // MF2 stop button causes a Z80 NMI
    z80_wait_states
+   z80_sync_events();
    dwMF2Flags = MF2_ACTIVE | MF2_RUNNING;
 }
 
 
 
+// Whether any of the debugger features (breakpoints, watchpoints, step in/out,
+// trace) is in use. These can only change while z80_execute is not running, so
+// it's enough to check it each time z80_execute is entered (i.e. at least once
+// per frame).
+bool z80_debug_active()
+{
+   return !breakpoints.empty() || !watchpoints.empty() ||
+      z80.step_in || z80.step_out || z80.trace;
+}
+
+void z80_index_debug_points()
+{
+   exec_breakpoints_index.reset();
+   read_watchpoints_index.reset();
+   write_watchpoints_index.reset();
+   for (const auto& b : breakpoints) {
+      exec_breakpoints_index.set(b.address & 0xffff);
+   }
+   for (const auto& w : watchpoints) {
+      if (w.type & READ) read_watchpoints_index.set(w.address & 0xffff);
+      if (w.type & WRITE) write_watchpoints_index.set(w.address & 0xffff);
+   }
+}
+
+template<bool Debug>
 int z80_execute()
 {
+   if (Debug) {
+      // Breakpoints and watchpoints can only be modified while the emulation is
+      // not running.
+      z80_index_debug_points();
+   }
    z80.watchpoint_reached = 0;
    z80.breakpoint_reached = 0;
    while (_PCdword != z80.break_point) { // loop until break point
@@ -1063,7 +1340,7 @@ int z80_execute()
          }
       }
 
-      z80_execute_instruction();
+      z80_execute_instruction<Debug>();
 
       z80_wait_states
 
@@ -1088,16 +1365,15 @@ int z80_execute()
          PSG.buffer_full = 0;
          return EC_SOUND_BUFFER; // exit emulation loop
       }
-      if (CPC.cycle_count <= 0) { // emulation loop ran for one frame?
+      // The cycle counter only changes when events are synced.
+      if (!iEventCycleCount && CPC.cycle_count <= 0) { // emulation loop ran for one frame?
          CPC.cycle_count += CYCLE_COUNT_INIT;
          return EC_CYCLE_COUNT; // exit emulation loop
       }
 
-      // TODO: Measure impact. If important, create templated version of
-      // z80_execute, read_mem, write_mem ...
-      if (!breakpoints.empty()) {
-        if ((z80.breakpoint_reached = std::any_of(breakpoints.begin(), breakpoints.end(), [&](const auto& b) { return b.address == _PC; }))) break;
-      }
+      if (!Debug) continue;
+
+      if ((z80.breakpoint_reached = exec_breakpoints_index.test(_PC))) break;
       if (z80.watchpoint_reached) break;
       if (z80.step_in) { z80.step_in++; break; }
 
@@ -1109,66 +1385,78 @@ int z80_execute()
    return EC_BREAKPOINT;
 }
 
+int z80_execute()
+{
+   // Peripherals state may have been changed while not running (e.g. tape or
+   // sound settings), and must be up to date when returning.
+   z80_schedule_events();
+   int iExitCondition = z80_debug_active() ? z80_execute<true>() : z80_execute<false>();
+   z80_sync_events();
+   z80_resolve_flags();
+   return iExitCondition;
+}
+
 
 
+template<bool Debug>
 void z80_execute_instruction()
 {
-      byte bOpCode = read_mem(_PC++);
+      byte bOpCode = read_mem<Debug>(_PC++);
       iCycleCount = cc_op[bOpCode];
       _R++;
       switch(bOpCode)
       {
          case adc_a:       ADC(_A); break;
          case adc_b:       ADC(_B); break;
-         case adc_byte:    ADC(read_mem(_PC++)); break;
+         case adc_byte:    ADC(read_mem<Debug>(_PC++)); break;
          case adc_c:       ADC(_C); break;
          case adc_d:       ADC(_D); break;
          case adc_e:       ADC(_E); break;
          case adc_h:       ADC(_H); break;
          case adc_l:       ADC(_L); break;
-         case adc_mhl:     ADC(read_mem(_HL)); break;
+         case adc_mhl:     ADC(read_mem<Debug>(_HL)); break;
          case add_a:       ADD(_A); break;
          case add_b:       ADD(_B); break;
-         case add_byte:    ADD(read_mem(_PC++)); break;
+         case add_byte:    ADD(read_mem<Debug>(_PC++)); break;
          case add_c:       ADD(_C); break;
          case add_d:       ADD(_D); break;
          case add_e:       ADD(_E); break;
          case add_h:       ADD(_H); break;
-         case add_hl_bc:   ADD16(HL, BC); break;
-         case add_hl_de:   ADD16(HL, DE); break;
-         case add_hl_hl:   ADD16(HL, HL); break;
-         case add_hl_sp:   ADD16(HL, SP); break;
+         case add_hl_bc:   ADD16(z80.HL, z80.BC); break;
+         case add_hl_de:   ADD16(z80.HL, z80.DE); break;
+         case add_hl_hl:   ADD16(z80.HL, z80.HL); break;
+         case add_hl_sp:   ADD16(z80.HL, z80.SP); break;
          case add_l:       ADD(_L); break;
-         case add_mhl:     ADD(read_mem(_HL)); break;
+         case add_mhl:     ADD(read_mem<Debug>(_HL)); break;
          case and_a:       AND(_A); break;
          case and_b:       AND(_B); break;
-         case and_byte:    AND(read_mem(_PC++)); break;
+         case and_byte:    AND(read_mem<Debug>(_PC++)); break;
          case and_c:       AND(_C); break;
          case and_d:       AND(_D); break;
          case and_e:       AND(_E); break;
          case and_h:       AND(_H); break;
          case and_l:       AND(_L); break;
-         case and_mhl:     AND(read_mem(_HL)); break;
+         case and_mhl:     AND(read_mem<Debug>(_HL)); break;
          case call:        CALL; break;
-         case call_c:      if (_F & Cflag) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
+         case call_c:      if (z80_carry()) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
          case call_m:      if (_F & Sflag) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
-         case call_nc:     if (!(_F & Cflag)) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
-         case call_nz:     if (!(_F & Zflag)) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
+         case call_nc:     if (!z80_carry()) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
+         case call_nz:     if (!z80_zero()) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
          case call_p:      if (!(_F & Sflag)) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
          case call_pe:     if (_F & Pflag) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
          case call_po:     if (!(_F & Pflag)) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
-         case call_z:      if (_F & Zflag) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
+         case call_z:      if (z80_zero()) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
          case ccf:         _F = ((_F & (Sflag | Zflag | Pflag | Cflag)) | ((_F & CF) << 4) | (_A & Xflags)) ^ CF; break;
          case cpl:         _A ^= 0xff; _F = (_F & (Sflag | Zflag | Pflag | Cflag)) | Hflag | Nflag | (_A & Xflags); break;
          case cp_a:        CP(_A); break;
          case cp_b:        CP(_B); break;
-         case cp_byte:     CP(read_mem(_PC++)); break;
+         case cp_byte:     CP(read_mem<Debug>(_PC++)); break;
          case cp_c:        CP(_C); break;
          case cp_d:        CP(_D); break;
          case cp_e:        CP(_E); break;
          case cp_h:        CP(_H); break;
          case cp_l:        CP(_L); break;
-         case cp_mhl:      CP(read_mem(_HL)); break;
+         case cp_mhl:      CP(read_mem<Debug>(_HL)); break;
          case daa:         DAA; break;
          case dec_a:       DEC(_A); break;
          case dec_b:       DEC(_B); break;
@@ -1180,17 +1468,17 @@ void z80_execute_instruction()
          case dec_h:       DEC(_H); break;
          case dec_hl:      _HL--; iWSAdjust++; break;
          case dec_l:       DEC(_L); break;
-         case dec_mhl:     { byte b = read_mem(_HL); DEC(b); write_mem(_HL, b); } break;
+         case dec_mhl:     { byte b = read_mem<Debug>(_HL); DEC(b); write_mem<Debug>(_HL, b); } break;
          case dec_sp:      _SP--; iWSAdjust++; break;
          case di:          _IFF1 = _IFF2 = 0; z80.EI_issued = 0; break;
          case djnz:        if (--_B) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; } break;
          case ei:          z80.EI_issued = 2; break;
          case exx:         EXX; break;
-         case ex_af_af:    EX(z80.AF, z80.AFx); break;
+         case ex_af_af:    z80_resolve_flags(); EX(z80.AF, z80.AFx); break;
          case ex_de_hl:    EX(z80.DE, z80.HL); break;
-         case ex_msp_hl:   EX_SP(HL); iWSAdjust++; break;
+         case ex_msp_hl:   EX_SP(z80.HL); iWSAdjust++; break;
          case halt:        _HALT = 1; _PC--; break;
-         case ina:         { z80_wait_states iCycleCount = Ia_;} { reg_pair p; p.b.l = read_mem(_PC++); p.b.h = _A; _A = z80_IN_handler(p); } break;
+         case ina:         { z80_wait_states iCycleCount = Ia_;} { reg_pair p; p.b.l = read_mem<Debug>(_PC++); p.b.h = _A; _A = z80_IN(p); } break;
          case inc_a:       INC(_A); break;
          case inc_b:       INC(_B); break;
          case inc_bc:      _BC++; iWSAdjust++; break;
@@ -1201,139 +1489,139 @@ void z80_execute_instruction()
          case inc_h:       INC(_H); break;
          case inc_hl:      _HL++; iWSAdjust++; break;
          case inc_l:       INC(_L); break;
-         case inc_mhl:     { byte b = read_mem(_HL); INC(b); write_mem(_HL, b); } break;
+         case inc_mhl:     { byte b = read_mem<Debug>(_HL); INC(b); write_mem<Debug>(_HL, b); } break;
          case inc_sp:      _SP++; iWSAdjust++; break;
          case jp:          JP; break;
-         case jp_c:        if (_F & Cflag) { JP } else { _PC += 2; }; break;
+         case jp_c:        if (z80_carry()) { JP } else { _PC += 2; }; break;
          case jp_m:        if (_F & Sflag) { JP } else { _PC += 2; }; break;
-         case jp_nc:       if (!(_F & Cflag)) { JP } else { _PC += 2; }; break;
-         case jp_nz:       if (!(_F & Zflag)) { JP } else { _PC += 2; }; break;
+         case jp_nc:       if (!z80_carry()) { JP } else { _PC += 2; }; break;
+         case jp_nz:       if (!z80_zero()) { JP } else { _PC += 2; }; break;
          case jp_p:        if (!(_F & Sflag)) { JP } else { _PC += 2; }; break;
          case jp_pe:       if (_F & Pflag) { JP } else { _PC += 2; }; break;
          case jp_po:       if (!(_F & Pflag)) { JP } else { _PC += 2; }; break;
-         case jp_z:        if (_F & Zflag) { JP } else { _PC += 2; }; break;
+         case jp_z:        if (z80_zero()) { JP } else { _PC += 2; }; break;
          case jr:          JR; break;
-         case jr_c:        if (_F & Cflag) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
-         case jr_nc:       if (!(_F & Cflag)) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
-         case jr_nz:       if (!(_F & Zflag)) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
-         case jr_z:        if (_F & Zflag) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
+         case jr_c:        if (z80_carry()) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
+         case jr_nc:       if (!z80_carry()) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
+         case jr_nz:       if (!z80_zero()) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
+         case jr_z:        if (z80_zero()) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
          case ld_a_a:      break;
          case ld_a_b:      _A = _B; break;
-         case ld_a_byte:   _A = read_mem(_PC++); break;
+         case ld_a_byte:   _A = read_mem<Debug>(_PC++); break;
          case ld_a_c:      _A = _C; break;
          case ld_a_d:      _A = _D; break;
          case ld_a_e:      _A = _E; break;
          case ld_a_h:      _A = _H; break;
          case ld_a_l:      _A = _L; break;
-         case ld_a_mbc:    _A = read_mem(_BC); break;
-         case ld_a_mde:    _A = read_mem(_DE); break;
-         case ld_a_mhl:    _A = read_mem(_HL); break;
-         case ld_a_mword:  { reg_pair addr; addr.b.l = read_mem(_PC++); addr.b.h = read_mem(_PC++); _A = read_mem(addr.w.l); } break;
-         case ld_bc_word:  z80.BC.b.l = read_mem(_PC++); z80.BC.b.h = read_mem(_PC++); break;
+         case ld_a_mbc:    _A = read_mem<Debug>(_BC); break;
+         case ld_a_mde:    _A = read_mem<Debug>(_DE); break;
+         case ld_a_mhl:    _A = read_mem<Debug>(_HL); break;
+         case ld_a_mword:  { reg_pair addr; addr.b.l = read_mem<Debug>(_PC++); addr.b.h = read_mem<Debug>(_PC++); _A = read_mem<Debug>(addr.w.l); } break;
+         case ld_bc_word:  z80.BC.b.l = read_mem<Debug>(_PC++); z80.BC.b.h = read_mem<Debug>(_PC++); break;
          case ld_b_a:      _B = _A; break;
          case ld_b_b:      break;
-         case ld_b_byte:   _B = read_mem(_PC++); break;
+         case ld_b_byte:   _B = read_mem<Debug>(_PC++); break;
          case ld_b_c:      _B = _C; break;
          case ld_b_d:      _B = _D; break;
          case ld_b_e:      _B = _E; break;
          case ld_b_h:      _B = _H; break;
          case ld_b_l:      _B = _L; break;
-         case ld_b_mhl:    _B = read_mem(_HL); break;
+         case ld_b_mhl:    _B = read_mem<Debug>(_HL); break;
          case ld_c_a:      _C = _A; break;
          case ld_c_b:      _C = _B; break;
-         case ld_c_byte:   _C = read_mem(_PC++); break;
+         case ld_c_byte:   _C = read_mem<Debug>(_PC++); break;
          case ld_c_c:      break;
          case ld_c_d:      _C = _D; break;
          case ld_c_e:      _C = _E; break;
          case ld_c_h:      _C = _H; break;
          case ld_c_l:      _C = _L; break;
-         case ld_c_mhl:    _C = read_mem(_HL); break;
-         case ld_de_word:  z80.DE.b.l = read_mem(_PC++); z80.DE.b.h = read_mem(_PC++); break;
+         case ld_c_mhl:    _C = read_mem<Debug>(_HL); break;
+         case ld_de_word:  z80.DE.b.l = read_mem<Debug>(_PC++); z80.DE.b.h = read_mem<Debug>(_PC++); break;
          case ld_d_a:      _D = _A; break;
          case ld_d_b:      _D = _B; break;
-         case ld_d_byte:   _D = read_mem(_PC++); break;
+         case ld_d_byte:   _D = read_mem<Debug>(_PC++); break;
          case ld_d_c:      _D = _C; break;
          case ld_d_d:      break;
          case ld_d_e:      _D = _E; break;
          case ld_d_h:      _D = _H; break;
          case ld_d_l:      _D = _L; break;
-         case ld_d_mhl:    _D = read_mem(_HL); break;
+         case ld_d_mhl:    _D = read_mem<Debug>(_HL); break;
          case ld_e_a:      _E = _A; break;
          case ld_e_b:      _E = _B; break;
-         case ld_e_byte:   _E = read_mem(_PC++); break;
+         case ld_e_byte:   _E = read_mem<Debug>(_PC++); break;
          case ld_e_c:      _E = _C; break;
          case ld_e_d:      _E = _D; break;
          case ld_e_e:      break;
          case ld_e_h:      _E = _H; break;
          case ld_e_l:      _E = _L; break;
-         case ld_e_mhl:    _E = read_mem(_HL); break;
-         case ld_hl_mword: LD16_MEM(HL); break;
-         case ld_hl_word:  z80.HL.b.l = read_mem(_PC++); z80.HL.b.h = read_mem(_PC++); break;
+         case ld_e_mhl:    _E = read_mem<Debug>(_HL); break;
+         case ld_hl_mword: LD16_MEM(z80.HL); break;
+         case ld_hl_word:  z80.HL.b.l = read_mem<Debug>(_PC++); z80.HL.b.h = read_mem<Debug>(_PC++); break;
          case ld_h_a:      _H = _A; break;
          case ld_h_b:      _H = _B; break;
-         case ld_h_byte:   _H = read_mem(_PC++); break;
+         case ld_h_byte:   _H = read_mem<Debug>(_PC++); break;
          case ld_h_c:      _H = _C; break;
          case ld_h_d:      _H = _D; break;
          case ld_h_e:      _H = _E; break;
          case ld_h_h:      break;
          case ld_h_l:      _H = _L; break;
-         case ld_h_mhl:    _H = read_mem(_HL); break;
+         case ld_h_mhl:    _H = read_mem<Debug>(_HL); break;
          case ld_l_a:      _L = _A; break;
          case ld_l_b:      _L = _B; break;
-         case ld_l_byte:   _L = read_mem(_PC++); break;
+         case ld_l_byte:   _L = read_mem<Debug>(_PC++); break;
          case ld_l_c:      _L = _C; break;
          case ld_l_d:      _L = _D; break;
          case ld_l_e:      _L = _E; break;
          case ld_l_h:      _L = _H; break;
          case ld_l_l:      break;
-         case ld_l_mhl:    _L = read_mem(_HL); break;
-         case ld_mbc_a:    write_mem(_BC, _A); break;
-         case ld_mde_a:    write_mem(_DE, _A); break;
-         case ld_mhl_a:    write_mem(_HL, _A); break;
-         case ld_mhl_b:    write_mem(_HL, _B); break;
-         case ld_mhl_byte: { byte b = read_mem(_PC++); write_mem(_HL, b); } break;
-         case ld_mhl_c:    write_mem(_HL, _C); break;
-         case ld_mhl_d:    write_mem(_HL, _D); break;
-         case ld_mhl_e:    write_mem(_HL, _E); break;
-         case ld_mhl_h:    write_mem(_HL, _H); break;
-         case ld_mhl_l:    write_mem(_HL, _L); break;
-         case ld_mword_a:  { reg_pair addr; addr.b.l = read_mem(_PC++); addr.b.h = read_mem(_PC++); write_mem(addr.w.l, _A); } break;
-         case ld_mword_hl: LDMEM_16(HL); break;
+         case ld_l_mhl:    _L = read_mem<Debug>(_HL); break;
+         case ld_mbc_a:    write_mem<Debug>(_BC, _A); break;
+         case ld_mde_a:    write_mem<Debug>(_DE, _A); break;
+         case ld_mhl_a:    write_mem<Debug>(_HL, _A); break;
+         case ld_mhl_b:    write_mem<Debug>(_HL, _B); break;
+         case ld_mhl_byte: { byte b = read_mem<Debug>(_PC++); write_mem<Debug>(_HL, b); } break;
+         case ld_mhl_c:    write_mem<Debug>(_HL, _C); break;
+         case ld_mhl_d:    write_mem<Debug>(_HL, _D); break;
+         case ld_mhl_e:    write_mem<Debug>(_HL, _E); break;
+         case ld_mhl_h:    write_mem<Debug>(_HL, _H); break;
+         case ld_mhl_l:    write_mem<Debug>(_HL, _L); break;
+         case ld_mword_a:  { reg_pair addr; addr.b.l = read_mem<Debug>(_PC++); addr.b.h = read_mem<Debug>(_PC++); write_mem<Debug>(addr.w.l, _A); } break;
+         case ld_mword_hl: LDMEM_16(z80.HL); break;
          case ld_pc_hl:    _PC = _HL; break;
          case ld_sp_hl:    _SP = _HL; iWSAdjust++; break;
-         case ld_sp_word:  z80.SP.b.l = read_mem(_PC++); z80.SP.b.h = read_mem(_PC++); break;
+         case ld_sp_word:  z80.SP.b.l = read_mem<Debug>(_PC++); z80.SP.b.h = read_mem<Debug>(_PC++); break;
          case nop:         break;
          case or_a:        OR(_A); break;
          case or_b:        OR(_B); break;
-         case or_byte:     OR(read_mem(_PC++)); break;
+         case or_byte:     OR(read_mem<Debug>(_PC++)); break;
          case or_c:        OR(_C); break;
          case or_d:        OR(_D); break;
          case or_e:        OR(_E); break;
          case or_h:        OR(_H); break;
          case or_l:        OR(_L); break;
-         case or_mhl:      OR(read_mem(_HL)); break;
-         case outa:        { z80_wait_states iCycleCount = Oa_;} { reg_pair p; p.b.l = read_mem(_PC++); p.b.h = _A; z80_OUT_handler(p, _A); } break;
-         case pfx_cb:      z80_execute_pfx_cb_instruction(); break;
-         case pfx_dd:      z80_execute_pfx_dd_instruction(); break;
-         case pfx_ed:      z80_execute_pfx_ed_instruction(); break;
-         case pfx_fd:      z80_execute_pfx_fd_instruction(); break;
-         case pop_af:      POP(AF); break;
-         case pop_bc:      POP(BC); break;
-         case pop_de:      POP(DE); break;
-         case pop_hl:      POP(HL); break;
-         case push_af:     PUSH(AF); break;
-         case push_bc:     PUSH(BC); break;
-         case push_de:     PUSH(DE); break;
-         case push_hl:     PUSH(HL); break;
+         case or_mhl:      OR(read_mem<Debug>(_HL)); break;
+         case outa:        { z80_wait_states iCycleCount = Oa_;} { reg_pair p; p.b.l = read_mem<Debug>(_PC++); p.b.h = _A; z80_OUT(p, _A); } break;
+         case pfx_cb:      z80_execute_pfx_cb_instruction<Debug>(); break;
+         case pfx_dd:      z80_execute_pfx_xy_instruction<Debug, &t_z80regs::IX>(); break;
+         case pfx_ed:      z80_execute_pfx_ed_instruction<Debug>(); break;
+         case pfx_fd:      z80_execute_pfx_xy_instruction<Debug, &t_z80regs::IY>(); break;
+         case pop_af:      z80_resolve_flags(); POP(z80.AF); break;
+         case pop_bc:      POP(z80.BC); break;
+         case pop_de:      POP(z80.DE); break;
+         case pop_hl:      POP(z80.HL); break;
+         case push_af:     z80_resolve_flags(); PUSH(z80.AF); break;
+         case push_bc:     PUSH(z80.BC); break;
+         case push_de:     PUSH(z80.DE); break;
+         case push_hl:     PUSH(z80.HL); break;
          case ret:         RET; break;
-         case ret_c:       if (_F & Cflag) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
+         case ret_c:       if (z80_carry()) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
          case ret_m:       if (_F & Sflag) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
-         case ret_nc:      if (!(_F & Cflag)) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
-         case ret_nz:      if (!(_F & Zflag)) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
+         case ret_nc:      if (!z80_carry()) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
+         case ret_nz:      if (!z80_zero()) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
          case ret_p:       if (!(_F & Sflag)) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
          case ret_pe:      if (_F & Pflag) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
          case ret_po:      if (!(_F & Pflag)) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
-         case ret_z:       if (_F & Zflag) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
+         case ret_z:       if (z80_zero()) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
          case rla:         RLA; break;
          case rlca:        RLCA; break;
          case rra:         RRA; break;
@@ -1348,42 +1636,43 @@ void z80_execute_instruction()
          case rst38:       RST(0x0038); break;
          case sbc_a:       SBC(_A); break;
          case sbc_b:       SBC(_B); break;
-         case sbc_byte:    SBC(read_mem(_PC++)); break;
+         case sbc_byte:    SBC(read_mem<Debug>(_PC++)); break;
          case sbc_c:       SBC(_C); break;
          case sbc_d:       SBC(_D); break;
          case sbc_e:       SBC(_E); break;
          case sbc_h:       SBC(_H); break;
          case sbc_l:       SBC(_L); break;
-         case sbc_mhl:     SBC(read_mem(_HL)); break;
+         case sbc_mhl:     SBC(read_mem<Debug>(_HL)); break;
          case scf:         _F = (_F & (Sflag | Zflag | Pflag)) | Cflag | (_A & Xflags); break;
          case sub_a:       SUB(_A); break;
          case sub_b:       SUB(_B); break;
-         case sub_byte:    SUB(read_mem(_PC++)); break;
+         case sub_byte:    SUB(read_mem<Debug>(_PC++)); break;
          case sub_c:       SUB(_C); break;
          case sub_d:       SUB(_D); break;
          case sub_e:       SUB(_E); break;
          case sub_h:       SUB(_H); break;
          case sub_l:       SUB(_L); break;
-         case sub_mhl:     SUB(read_mem(_HL)); break;
+         case sub_mhl:     SUB(read_mem<Debug>(_HL)); break;
          case xor_a:       XOR(_A); break;
          case xor_b:       XOR(_B); break;
-         case xor_byte:    XOR(read_mem(_PC++)); break;
+         case xor_byte:    XOR(read_mem<Debug>(_PC++)); break;
          case xor_c:       XOR(_C); break;
          case xor_d:       XOR(_D); break;
          case xor_e:       XOR(_E); break;
          case xor_h:       XOR(_H); break;
          case xor_l:       XOR(_L); break;
-         case xor_mhl:     XOR(read_mem(_HL)); break;
+         case xor_mhl:     XOR(read_mem<Debug>(_HL)); break;
       }
 }
 
 
 
+template<bool Debug>
 void z80_execute_pfx_cb_instruction()
 {
    byte bOpCode;
 
-   bOpCode = read_mem(_PC++);
+   bOpCode = read_mem<Debug>(_PC++);
    iCycleCount += cc_cb[bOpCode];
    _R++;
    switch(bOpCode)
@@ -1395,7 +1684,7 @@ void z80_execute_pfx_cb_instruction()
       case bit0_e:      BIT(0, _E); break;
       case bit0_h:      BIT(0, _H); break;
       case bit0_l:      BIT(0, _L); break;
-      case bit0_mhl:    BIT(0, read_mem(_HL)); break;
+      case bit0_mhl:    BIT(0, read_mem<Debug>(_HL)); break;
       case bit1_a:      BIT(1, _A); break;
       case bit1_b:      BIT(1, _B); break;
       case bit1_c:      BIT(1, _C); break;
@@ -1403,7 +1692,7 @@ void z80_execute_pfx_cb_instruction()
       case bit1_e:      BIT(1, _E); break;
       case bit1_h:      BIT(1, _H); break;
       case bit1_l:      BIT(1, _L); break;
-      case bit1_mhl:    BIT(1, read_mem(_HL)); break;
+      case bit1_mhl:    BIT(1, read_mem<Debug>(_HL)); break;
       case bit2_a:      BIT(2, _A); break;
       case bit2_b:      BIT(2, _B); break;
       case bit2_c:      BIT(2, _C); break;
@@ -1411,7 +1700,7 @@ void z80_execute_pfx_cb_instruction()
       case bit2_e:      BIT(2, _E); break;
       case bit2_h:      BIT(2, _H); break;
       case bit2_l:      BIT(2, _L); break;
-      case bit2_mhl:    BIT(2, read_mem(_HL)); break;
+      case bit2_mhl:    BIT(2, read_mem<Debug>(_HL)); break;
       case bit3_a:      BIT(3, _A); break;
       case bit3_b:      BIT(3, _B); break;
       case bit3_c:      BIT(3, _C); break;
@@ -1419,7 +1708,7 @@ void z80_execute_pfx_cb_instruction()
       case bit3_e:      BIT(3, _E); break;
       case bit3_h:      BIT(3, _H); break;
       case bit3_l:      BIT(3, _L); break;
-      case bit3_mhl:    BIT(3, read_mem(_HL)); break;
+      case bit3_mhl:    BIT(3, read_mem<Debug>(_HL)); break;
       case bit4_a:      BIT(4, _A); break;
       case bit4_b:      BIT(4, _B); break;
       case bit4_c:      BIT(4, _C); break;
@@ -1427,7 +1716,7 @@ void z80_execute_pfx_cb_instruction()
       case bit4_e:      BIT(4, _E); break;
       case bit4_h:      BIT(4, _H); break;
       case bit4_l:      BIT(4, _L); break;
-      case bit4_mhl:    BIT(4, read_mem(_HL)); break;
+      case bit4_mhl:    BIT(4, read_mem<Debug>(_HL)); break;
       case bit5_a:      BIT(5, _A); break;
       case bit5_b:      BIT(5, _B); break;
       case bit5_c:      BIT(5, _C); break;
@@ -1435,7 +1724,7 @@ void z80_execute_pfx_cb_instruction()
       case bit5_e:      BIT(5, _E); break;
       case bit5_h:      BIT(5, _H); break;
       case bit5_l:      BIT(5, _L); break;
-      case bit5_mhl:    BIT(5, read_mem(_HL)); break;
+      case bit5_mhl:    BIT(5, read_mem<Debug>(_HL)); break;
       case bit6_a:      BIT(6, _A); break;
       case bit6_b:      BIT(6, _B); break;
       case bit6_c:      BIT(6, _C); break;
@@ -1443,7 +1732,7 @@ void z80_execute_pfx_cb_instruction()
       case bit6_e:      BIT(6, _E); break;
       case bit6_h:      BIT(6, _H); break;
       case bit6_l:      BIT(6, _L); break;
-      case bit6_mhl:    BIT(6, read_mem(_HL)); break;
+      case bit6_mhl:    BIT(6, read_mem<Debug>(_HL)); break;
       case bit7_a:      BIT(7, _A); break;
       case bit7_b:      BIT(7, _B); break;
       case bit7_c:      BIT(7, _C); break;
@@ -1451,7 +1740,7 @@ void z80_execute_pfx_cb_instruction()
       case bit7_e:      BIT(7, _E); break;
       case bit7_h:      BIT(7, _H); break;
       case bit7_l:      BIT(7, _L); break;
-      case bit7_mhl:    BIT(7, read_mem(_HL)); break;
+      case bit7_mhl:    BIT(7, read_mem<Debug>(_HL)); break;
       case res0_a:      _A = RES(0, _A); break;
       case res0_b:      _B = RES(0, _B); break;
       case res0_c:      _C = RES(0, _C); break;
@@ -1459,7 +1748,7 @@ void z80_execute_pfx_cb_instruction()
       case res0_e:      _E = RES(0, _E); break;
       case res0_h:      _H = RES(0, _H); break;
       case res0_l:      _L = RES(0, _L); break;
-      case res0_mhl:    { byte b = read_mem(_HL); write_mem(_HL, RES(0, b)); } break;
+      case res0_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, RES(0, b)); } break;
       case res1_a:      _A = RES(1, _A); break;
       case res1_b:      _B = RES(1, _B); break;
       case res1_c:      _C = RES(1, _C); break;
@@ -1467,7 +1756,7 @@ void z80_execute_pfx_cb_instruction()
       case res1_e:      _E = RES(1, _E); break;
       case res1_h:      _H = RES(1, _H); break;
       case res1_l:      _L = RES(1, _L); break;
-      case res1_mhl:    { byte b = read_mem(_HL); write_mem(_HL, RES(1, b)); } break;
+      case res1_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, RES(1, b)); } break;
       case res2_a:      _A = RES(2, _A); break;
       case res2_b:      _B = RES(2, _B); break;
       case res2_c:      _C = RES(2, _C); break;
@@ -1475,7 +1764,7 @@ void z80_execute_pfx_cb_instruction()
       case res2_e:      _E = RES(2, _E); break;
       case res2_h:      _H = RES(2, _H); break;
       case res2_l:      _L = RES(2, _L); break;
-      case res2_mhl:    { byte b = read_mem(_HL); write_mem(_HL, RES(2, b)); } break;
+      case res2_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, RES(2, b)); } break;
       case res3_a:      _A = RES(3, _A); break;
       case res3_b:      _B = RES(3, _B); break;
       case res3_c:      _C = RES(3, _C); break;
@@ -1483,7 +1772,7 @@ void z80_execute_pfx_cb_instruction()
       case res3_e:      _E = RES(3, _E); break;
       case res3_h:      _H = RES(3, _H); break;
       case res3_l:      _L = RES(3, _L); break;
-      case res3_mhl:    { byte b = read_mem(_HL); write_mem(_HL, RES(3, b)); } break;
+      case res3_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, RES(3, b)); } break;
       case res4_a:      _A = RES(4, _A); break;
       case res4_b:      _B = RES(4, _B); break;
       case res4_c:      _C = RES(4, _C); break;
@@ -1491,7 +1780,7 @@ void z80_execute_pfx_cb_instruction()
       case res4_e:      _E = RES(4, _E); break;
       case res4_h:      _H = RES(4, _H); break;
       case res4_l:      _L = RES(4, _L); break;
-      case res4_mhl:    { byte b = read_mem(_HL); write_mem(_HL, RES(4, b)); } break;
+      case res4_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, RES(4, b)); } break;
       case res5_a:      _A = RES(5, _A); break;
       case res5_b:      _B = RES(5, _B); break;
       case res5_c:      _C = RES(5, _C); break;
@@ -1499,7 +1788,7 @@ void z80_execute_pfx_cb_instruction()
       case res5_e:      _E = RES(5, _E); break;
       case res5_h:      _H = RES(5, _H); break;
       case res5_l:      _L = RES(5, _L); break;
-      case res5_mhl:    { byte b = read_mem(_HL); write_mem(_HL, RES(5, b)); } break;
+      case res5_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, RES(5, b)); } break;
       case res6_a:      _A = RES(6, _A); break;
       case res6_b:      _B = RES(6, _B); break;
       case res6_c:      _C = RES(6, _C); break;
@@ -1507,7 +1796,7 @@ void z80_execute_pfx_cb_instruction()
       case res6_e:      _E = RES(6, _E); break;
       case res6_h:      _H = RES(6, _H); break;
       case res6_l:      _L = RES(6, _L); break;
-      case res6_mhl:    { byte b = read_mem(_HL); write_mem(_HL, RES(6, b)); } break;
+      case res6_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, RES(6, b)); } break;
       case res7_a:      _A = RES(7, _A); break;
       case res7_b:      _B = RES(7, _B); break;
       case res7_c:      _C = RES(7, _C); break;
@@ -1515,7 +1804,7 @@ void z80_execute_pfx_cb_instruction()
       case res7_e:      _E = RES(7, _E); break;
       case res7_h:      _H = RES(7, _H); break;
       case res7_l:      _L = RES(7, _L); break;
-      case res7_mhl:    { byte b = read_mem(_HL); write_mem(_HL, RES(7, b)); } break;
+      case res7_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, RES(7, b)); } break;
       case rlc_a:       _A = RLC(_A); break;
       case rlc_b:       _B = RLC(_B); break;
       case rlc_c:       _C = RLC(_C); break;
@@ -1523,7 +1812,7 @@ void z80_execute_pfx_cb_instruction()
       case rlc_e:       _E = RLC(_E); break;
       case rlc_h:       _H = RLC(_H); break;
       case rlc_l:       _L = RLC(_L); break;
-      case rlc_mhl:     { byte b = read_mem(_HL); write_mem(_HL, RLC(b)); } break;
+      case rlc_mhl:     { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, RLC(b)); } break;
       case rl_a:        _A = RL(_A); break;
       case rl_b:        _B = RL(_B); break;
       case rl_c:        _C = RL(_C); break;
@@ -1531,7 +1820,7 @@ void z80_execute_pfx_cb_instruction()
       case rl_e:        _E = RL(_E); break;
       case rl_h:        _H = RL(_H); break;
       case rl_l:        _L = RL(_L); break;
-      case rl_mhl:      { byte b = read_mem(_HL); write_mem(_HL, RL(b)); } break;
+      case rl_mhl:      { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, RL(b)); } break;
       case rrc_a:       _A = RRC(_A); break;
       case rrc_b:       _B = RRC(_B); break;
       case rrc_c:       _C = RRC(_C); break;
@@ -1539,7 +1828,7 @@ void z80_execute_pfx_cb_instruction()
       case rrc_e:       _E = RRC(_E); break;
       case rrc_h:       _H = RRC(_H); break;
       case rrc_l:       _L = RRC(_L); break;
-      case rrc_mhl:     { byte b = read_mem(_HL); write_mem(_HL, RRC(b)); } break;
+      case rrc_mhl:     { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, RRC(b)); } break;
       case rr_a:        _A = RR(_A); break;
       case rr_b:        _B = RR(_B); break;
       case rr_c:        _C = RR(_C); break;
@@ -1547,7 +1836,7 @@ void z80_execute_pfx_cb_instruction()
       case rr_e:        _E = RR(_E); break;
       case rr_h:        _H = RR(_H); break;
       case rr_l:        _L = RR(_L); break;
-      case rr_mhl:      { byte b = read_mem(_HL); write_mem(_HL, RR(b)); } break;
+      case rr_mhl:      { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, RR(b)); } break;
       case set0_a:      _A = SET(0, _A); break;
       case set0_b:      _B = SET(0, _B); break;
       case set0_c:      _C = SET(0, _C); break;
@@ -1555,7 +1844,7 @@ void z80_execute_pfx_cb_instruction()
       case set0_e:      _E = SET(0, _E); break;
       case set0_h:      _H = SET(0, _H); break;
       case set0_l:      _L = SET(0, _L); break;
-      case set0_mhl:    { byte b = read_mem(_HL); write_mem(_HL, SET(0, b)); } break;
+      case set0_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, SET(0, b)); } break;
       case set1_a:      _A = SET(1, _A); break;
       case set1_b:      _B = SET(1, _B); break;
       case set1_c:      _C = SET(1, _C); break;
@@ -1563,7 +1852,7 @@ void z80_execute_pfx_cb_instruction()
       case set1_e:      _E = SET(1, _E); break;
       case set1_h:      _H = SET(1, _H); break;
       case set1_l:      _L = SET(1, _L); break;
-      case set1_mhl:    { byte b = read_mem(_HL); write_mem(_HL, SET(1, b)); } break;
+      case set1_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, SET(1, b)); } break;
       case set2_a:      _A = SET(2, _A); break;
       case set2_b:      _B = SET(2, _B); break;
       case set2_c:      _C = SET(2, _C); break;
@@ -1571,7 +1860,7 @@ void z80_execute_pfx_cb_instruction()
       case set2_e:      _E = SET(2, _E); break;
       case set2_h:      _H = SET(2, _H); break;
       case set2_l:      _L = SET(2, _L); break;
-      case set2_mhl:    { byte b = read_mem(_HL); write_mem(_HL, SET(2, b)); } break;
+      case set2_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, SET(2, b)); } break;
       case set3_a:      _A = SET(3, _A); break;
       case set3_b:      _B = SET(3, _B); break;
       case set3_c:      _C = SET(3, _C); break;
@@ -1579,7 +1868,7 @@ void z80_execute_pfx_cb_instruction()
       case set3_e:      _E = SET(3, _E); break;
       case set3_h:      _H = SET(3, _H); break;
       case set3_l:      _L = SET(3, _L); break;
-      case set3_mhl:    { byte b = read_mem(_HL); write_mem(_HL, SET(3, b)); } break;
+      case set3_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, SET(3, b)); } break;
       case set4_a:      _A = SET(4, _A); break;
       case set4_b:      _B = SET(4, _B); break;
       case set4_c:      _C = SET(4, _C); break;
@@ -1587,7 +1876,7 @@ void z80_execute_pfx_cb_instruction()
       case set4_e:      _E = SET(4, _E); break;
       case set4_h:      _H = SET(4, _H); break;
       case set4_l:      _L = SET(4, _L); break;
-      case set4_mhl:    { byte b = read_mem(_HL); write_mem(_HL, SET(4, b)); } break;
+      case set4_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, SET(4, b)); } break;
       case set5_a:      _A = SET(5, _A); break;
       case set5_b:      _B = SET(5, _B); break;
       case set5_c:      _C = SET(5, _C); break;
@@ -1595,7 +1884,7 @@ void z80_execute_pfx_cb_instruction()
       case set5_e:      _E = SET(5, _E); break;
       case set5_h:      _H = SET(5, _H); break;
       case set5_l:      _L = SET(5, _L); break;
-      case set5_mhl:    { byte b = read_mem(_HL); write_mem(_HL, SET(5, b)); } break;
+      case set5_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, SET(5, b)); } break;
       case set6_a:      _A = SET(6, _A); break;
       case set6_b:      _B = SET(6, _B); break;
       case set6_c:      _C = SET(6, _C); break;
@@ -1603,7 +1892,7 @@ void z80_execute_pfx_cb_instruction()
       case set6_e:      _E = SET(6, _E); break;
       case set6_h:      _H = SET(6, _H); break;
       case set6_l:      _L = SET(6, _L); break;
-      case set6_mhl:    { byte b = read_mem(_HL); write_mem(_HL, SET(6, b)); } break;
+      case set6_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, SET(6, b)); } break;
       case set7_a:      _A = SET(7, _A); break;
       case set7_b:      _B = SET(7, _B); break;
       case set7_c:      _C = SET(7, _C); break;
@@ -1611,7 +1900,7 @@ void z80_execute_pfx_cb_instruction()
       case set7_e:      _E = SET(7, _E); break;
       case set7_h:      _H = SET(7, _H); break;
       case set7_l:      _L = SET(7, _L); break;
-      case set7_mhl:    { byte b = read_mem(_HL); write_mem(_HL, SET(7, b)); } break;
+      case set7_mhl:    { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, SET(7, b)); } break;
       case sla_a:       _A = SLA(_A); break;
       case sla_b:       _B = SLA(_B); break;
       case sla_c:       _C = SLA(_C); break;
@@ -1619,7 +1908,7 @@ void z80_execute_pfx_cb_instruction()
       case sla_e:       _E = SLA(_E); break;
       case sla_h:       _H = SLA(_H); break;
       case sla_l:       _L = SLA(_L); break;
-      case sla_mhl:     { byte b = read_mem(_HL); write_mem(_HL, SLA(b)); } break;
+      case sla_mhl:     { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, SLA(b)); } break;
       case sll_a:       _A = SLL(_A); break;
       case sll_b:       _B = SLL(_B); break;
       case sll_c:       _C = SLL(_C); break;
@@ -1627,7 +1916,7 @@ void z80_execute_pfx_cb_instruction()
       case sll_e:       _E = SLL(_E); break;
       case sll_h:       _H = SLL(_H); break;
       case sll_l:       _L = SLL(_L); break;
-      case sll_mhl:     { byte b = read_mem(_HL); write_mem(_HL, SLL(b)); } break;
+      case sll_mhl:     { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, SLL(b)); } break;
       case sra_a:       _A = SRA(_A); break;
       case sra_b:       _B = SRA(_B); break;
       case sra_c:       _C = SRA(_C); break;
@@ -1635,7 +1924,7 @@ void z80_execute_pfx_cb_instruction()
       case sra_e:       _E = SRA(_E); break;
       case sra_h:       _H = SRA(_H); break;
       case sra_l:       _L = SRA(_L); break;
-      case sra_mhl:     { byte b = read_mem(_HL); write_mem(_HL, SRA(b)); } break;
+      case sra_mhl:     { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, SRA(b)); } break;
       case srl_a:       _A = SRL(_A); break;
       case srl_b:       _B = SRL(_B); break;
       case srl_c:       _C = SRL(_C); break;
@@ -1643,72 +1932,73 @@ void z80_execute_pfx_cb_instruction()
       case srl_e:       _E = SRL(_E); break;
       case srl_h:       _H = SRL(_H); break;
       case srl_l:       _L = SRL(_L); break;
-      case srl_mhl:     { byte b = read_mem(_HL); write_mem(_HL, SRL(b)); } break;
+      case srl_mhl:     { byte b = read_mem<Debug>(_HL); write_mem<Debug>(_HL, SRL(b)); } break;
    }
 }
 
 
 
-void z80_execute_pfx_dd_instruction()
+template<bool Debug, reg_pair t_z80regs::*IR>
+void z80_execute_pfx_xy_instruction()
 {
    byte bOpCode;
 
-   bOpCode = read_mem(_PC++);
+   bOpCode = read_mem<Debug>(_PC++);
    iCycleCount += cc_xy[bOpCode];
    _R++;
    switch(bOpCode)
    {
       case adc_a:       ADC(_A); break;
       case adc_b:       ADC(_B); break;
-      case adc_byte:    ADC(read_mem(_PC++)); break;
+      case adc_byte:    ADC(read_mem<Debug>(_PC++)); break;
       case adc_c:       ADC(_C); break;
       case adc_d:       ADC(_D); break;
       case adc_e:       ADC(_E); break;
-      case adc_h:       ADC(_IXh); break;
-      case adc_l:       ADC(_IXl); break;
-      case adc_mhl:     { signed char o = read_mem(_PC++); ADC(read_mem(_IX+o)); } break;
+      case adc_h:       ADC(_IRh); break;
+      case adc_l:       ADC(_IRl); break;
+      case adc_mhl:     { signed char o = read_mem<Debug>(_PC++); ADC(read_mem<Debug>(_IR+o)); } break;
       case add_a:       ADD(_A); break;
       case add_b:       ADD(_B); break;
-      case add_byte:    ADD(read_mem(_PC++)); break;
+      case add_byte:    ADD(read_mem<Debug>(_PC++)); break;
       case add_c:       ADD(_C); break;
       case add_d:       ADD(_D); break;
       case add_e:       ADD(_E); break;
-      case add_h:       ADD(_IXh); break;
-      case add_hl_bc:   ADD16(IX, BC); break;
-      case add_hl_de:   ADD16(IX, DE); break;
-      case add_hl_hl:   ADD16(IX, IX); break;
-      case add_hl_sp:   ADD16(IX, SP); break;
-      case add_l:       ADD(_IXl); break;
-      case add_mhl:     { signed char o = read_mem(_PC++); ADD(read_mem(_IX+o)); } break;
+      case add_h:       ADD(_IRh); break;
+      case add_hl_bc:   ADD16(z80.*IR, z80.BC); break;
+      case add_hl_de:   ADD16(z80.*IR, z80.DE); break;
+      case add_hl_hl:   ADD16(z80.*IR, z80.*IR); break;
+      case add_hl_sp:   ADD16(z80.*IR, z80.SP); break;
+      case add_l:       ADD(_IRl); break;
+      case add_mhl:     { signed char o = read_mem<Debug>(_PC++); ADD(read_mem<Debug>(_IR+o)); } break;
       case and_a:       AND(_A); break;
       case and_b:       AND(_B); break;
-      case and_byte:    AND(read_mem(_PC++)); break;
+      case and_byte:    AND(read_mem<Debug>(_PC++)); break;
       case and_c:       AND(_C); break;
       case and_d:       AND(_D); break;
       case and_e:       AND(_E); break;
-      case and_h:       AND(_IXh); break;
-      case and_l:       AND(_IXl); break;
-      case and_mhl:     { signed char o = read_mem(_PC++); AND(read_mem(_IX+o)); } break;
+      case and_h:       AND(_IRh); break;
+      case and_l:       AND(_IRl); break;
+      case and_mhl:     { signed char o = read_mem<Debug>(_PC++); AND(read_mem<Debug>(_IR+o)); } break;
       case call:        CALL; break;
-      case call_c:      if (_F & Cflag) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
+      case call_c:      if (z80_carry()) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
       case call_m:      if (_F & Sflag) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
-      case call_nc:     if (!(_F & Cflag)) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
-      case call_nz:     if (!(_F & Zflag)) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
+      case call_nc:     if (!z80_carry()) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
+      case call_nz:     if (!z80_zero()) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
       case call_p:      if (!(_F & Sflag)) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
       case call_pe:     if (_F & Pflag) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
       case call_po:     if (!(_F & Pflag)) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
-      case call_z:      if (_F & Zflag) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
+      case call_z:      if (z80_zero()) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
       case ccf:         _F = ((_F & (Sflag | Zflag | Pflag | Cflag)) | ((_F & CF) << 4) | (_A & Xflags)) ^ CF; break;
       case cpl:         _A ^= 0xff; _F = (_F & (Sflag | Zflag | Pflag | Cflag)) | Hflag | Nflag | (_A & Xflags); break;
       case cp_a:        CP(_A); break;
       case cp_b:        CP(_B); break;
-      case cp_byte:     CP(read_mem(_PC++)); break;
+      case cp_byte:     CP(read_mem<Debug>(_PC++)); break;
       case cp_c:        CP(_C); break;
       case cp_d:        CP(_D); break;
       case cp_e:        CP(_E); break;
-      case cp_h:        CP(_IXh); break;
-      case cp_l:        CP(_IXl); break;
-      case cp_mhl:      { signed char o = read_mem(_PC++); CP(read_mem(_IX+o)); } break;
+      case cp_h:        CP(_IRh); break;
+      case cp_l:        CP(_IRl); break;
+      case cp_mhl:      { signed char o = read_mem<Debug>(_PC++); CP(read_mem<Debug>(_IR+o)); } break;
       case daa:         DAA; break;
       case dec_a:       DEC(_A); break;
       case dec_b:       DEC(_B); break;
@@ -1717,20 +2007,20 @@ void z80_execute_pfx_dd_instruction()
       case dec_d:       DEC(_D); break;
       case dec_de:      _DE--; iWSAdjust++; break;
       case dec_e:       DEC(_E); break;
-      case dec_h:       DEC(_IXh); break;
-      case dec_hl:      _IX--; iWSAdjust++; break;
-      case dec_l:       DEC(_IXl); break;
-      case dec_mhl:     { signed char o = read_mem(_PC++); byte b = read_mem(_IX+o); DEC(b); write_mem(_IX+o, b); } break;
+      case dec_h:       DEC(_IRh); break;
+      case dec_hl:      _IR--; iWSAdjust++; break;
+      case dec_l:       DEC(_IRl); break;
+      case dec_mhl:     { signed char o = read_mem<Debug>(_PC++); byte b = read_mem<Debug>(_IR+o); DEC(b); write_mem<Debug>(_IR+o, b); } break;
       case dec_sp:      _SP--; iWSAdjust++; break;
       case di:          _IFF1 = _IFF2 = 0; z80.EI_issued = 0; break;
       case djnz:        if (--_B) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; } break;
       case ei:          z80.EI_issued = 2; break;
       case exx:         EXX; break;
-      case ex_af_af:    EX(z80.AF, z80.AFx); break;
+      case ex_af_af:    z80_resolve_flags(); EX(z80.AF, z80.AFx); break;
       case ex_de_hl:    EX(z80.DE, z80.HL); break;
-      case ex_msp_hl:   EX_SP(IX); iWSAdjust++; break;
+      case ex_msp_hl:   EX_SP(z80.*IR); iWSAdjust++; break;
       case halt:        _HALT = 1; _PC--; break;
-      case ina:         { z80_wait_states iCycleCount = Ia_;} { reg_pair p; p.b.l = read_mem(_PC++); p.b.h = _A; _A = z80_IN_handler(p); } break;
+      case ina:         { z80_wait_states iCycleCount = Ia_;} { reg_pair p; p.b.l = read_mem<Debug>(_PC++); p.b.h = _A; _A = z80_IN(p); } break;
       case inc_a:       INC(_A); break;
       case inc_b:       INC(_B); break;
       case inc_bc:      _BC++; iWSAdjust++; break;
@@ -1738,142 +2028,142 @@ void z80_execute_pfx_dd_instruction()
       case inc_d:       INC(_D); break;
       case inc_de:      _DE++; iWSAdjust++; break;
       case inc_e:       INC(_E); break;
-      case inc_h:       INC(_IXh); break;
-      case inc_hl:      _IX++; iWSAdjust++; break;
-      case inc_l:       INC(_IXl); break;
-      case inc_mhl:     { signed char o = read_mem(_PC++); byte b = read_mem(_IX+o); INC(b); write_mem(_IX+o, b); } break;
+      case inc_h:       INC(_IRh); break;
+      case inc_hl:      _IR++; iWSAdjust++; break;
+      case inc_l:       INC(_IRl); break;
+      case inc_mhl:     { signed char o = read_mem<Debug>(_PC++); byte b = read_mem<Debug>(_IR+o); INC(b); write_mem<Debug>(_IR+o, b); } break;
       case inc_sp:      _SP++; iWSAdjust++; break;
       case jp:          JP; break;
-      case jp_c:        if (_F & Cflag) { JP } else { _PC += 2; }; break;
+      case jp_c:        if (z80_carry()) { JP } else { _PC += 2; }; break;
       case jp_m:        if (_F & Sflag) { JP } else { _PC += 2; }; break;
-      case jp_nc:       if (!(_F & Cflag)) { JP } else { _PC += 2; }; break;
-      case jp_nz:       if (!(_F & Zflag)) { JP } else { _PC += 2; }; break;
+      case jp_nc:       if (!z80_carry()) { JP } else { _PC += 2; }; break;
+      case jp_nz:       if (!z80_zero()) { JP } else { _PC += 2; }; break;
       case jp_p:        if (!(_F & Sflag)) { JP } else { _PC += 2; }; break;
       case jp_pe:       if (_F & Pflag) { JP } else { _PC += 2; }; break;
       case jp_po:       if (!(_F & Pflag)) { JP } else { _PC += 2; }; break;
-      case jp_z:        if (_F & Zflag) { JP } else { _PC += 2; }; break;
+      case jp_z:        if (z80_zero()) { JP } else { _PC += 2; }; break;
       case jr:          JR; break;
-      case jr_c:        if (_F & Cflag) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
-      case jr_nc:       if (!(_F & Cflag)) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
-      case jr_nz:       if (!(_F & Zflag)) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
-      case jr_z:        if (_F & Zflag) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
+      case jr_c:        if (z80_carry()) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
+      case jr_nc:       if (!z80_carry()) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
+      case jr_nz:       if (!z80_zero()) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
+      case jr_z:        if (z80_zero()) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
       case ld_a_a:      break;
       case ld_a_b:      _A = _B; break;
-      case ld_a_byte:   _A = read_mem(_PC++); break;
+      case ld_a_byte:   _A = read_mem<Debug>(_PC++); break;
       case ld_a_c:      _A = _C; break;
       case ld_a_d:      _A = _D; break;
       case ld_a_e:      _A = _E; break;
-      case ld_a_h:      _A = _IXh; break;
-      case ld_a_l:      _A = _IXl; break;
-      case ld_a_mbc:    _A = read_mem(_BC); break;
-      case ld_a_mde:    _A = read_mem(_DE); break;
-      case ld_a_mhl:    { signed char o = read_mem(_PC++); _A = read_mem(_IX+o); } break;
-      case ld_a_mword:  { reg_pair addr; addr.b.l = read_mem(_PC++); addr.b.h = read_mem(_PC++); _A = read_mem(addr.w.l); } break;
-      case ld_bc_word:  z80.BC.b.l = read_mem(_PC++); z80.BC.b.h = read_mem(_PC++); break;
+      case ld_a_h:      _A = _IRh; break;
+      case ld_a_l:      _A = _IRl; break;
+      case ld_a_mbc:    _A = read_mem<Debug>(_BC); break;
+      case ld_a_mde:    _A = read_mem<Debug>(_DE); break;
+      case ld_a_mhl:    { signed char o = read_mem<Debug>(_PC++); _A = read_mem<Debug>(_IR+o); } break;
+      case ld_a_mword:  { reg_pair addr; addr.b.l = read_mem<Debug>(_PC++); addr.b.h = read_mem<Debug>(_PC++); _A = read_mem<Debug>(addr.w.l); } break;
+      case ld_bc_word:  z80.BC.b.l = read_mem<Debug>(_PC++); z80.BC.b.h = read_mem<Debug>(_PC++); break;
       case ld_b_a:      _B = _A; break;
       case ld_b_b:      break;
-      case ld_b_byte:   _B = read_mem(_PC++); break;
+      case ld_b_byte:   _B = read_mem<Debug>(_PC++); break;
       case ld_b_c:      _B = _C; break;
       case ld_b_d:      _B = _D; break;
       case ld_b_e:      _B = _E; break;
-      case ld_b_h:      _B = _IXh; break;
-      case ld_b_l:      _B = _IXl; break;
-      case ld_b_mhl:    { signed char o = read_mem(_PC++); _B = read_mem(_IX+o); } break;
+      case ld_b_h:      _B = _IRh; break;
+      case ld_b_l:      _B = _IRl; break;
+      case ld_b_mhl:    { signed char o = read_mem<Debug>(_PC++); _B = read_mem<Debug>(_IR+o); } break;
       case ld_c_a:      _C = _A; break;
       case ld_c_b:      _C = _B; break;
-      case ld_c_byte:   _C = read_mem(_PC++); break;
+      case ld_c_byte:   _C = read_mem<Debug>(_PC++); break;
       case ld_c_c:      break;
       case ld_c_d:      _C = _D; break;
       case ld_c_e:      _C = _E; break;
-      case ld_c_h:      _C = _IXh; break;
-      case ld_c_l:      _C = _IXl; break;
-      case ld_c_mhl:    { signed char o = read_mem(_PC++); _C = read_mem(_IX+o); } break;
-      case ld_de_word:  z80.DE.b.l = read_mem(_PC++); z80.DE.b.h = read_mem(_PC++); break;
+      case ld_c_h:      _C = _IRh; break;
+      case ld_c_l:      _C = _IRl; break;
+      case ld_c_mhl:    { signed char o = read_mem<Debug>(_PC++); _C = read_mem<Debug>(_IR+o); } break;
+      case ld_de_word:  z80.DE.b.l = read_mem<Debug>(_PC++); z80.DE.b.h = read_mem<Debug>(_PC++); break;
       case ld_d_a:      _D = _A; break;
       case ld_d_b:      _D = _B; break;
-      case ld_d_byte:   _D = read_mem(_PC++); break;
+      case ld_d_byte:   _D = read_mem<Debug>(_PC++); break;
       case ld_d_c:      _D = _C; break;
       case ld_d_d:      break;
       case ld_d_e:      _D = _E; break;
-      case ld_d_h:      _D = _IXh; break;
-      case ld_d_l:      _D = _IXl; break;
-      case ld_d_mhl:    { signed char o = read_mem(_PC++); _D = read_mem(_IX+o); } break;
+      case ld_d_h:      _D = _IRh; break;
+      case ld_d_l:      _D = _IRl; break;
+      case ld_d_mhl:    { signed char o = read_mem<Debug>(_PC++); _D = read_mem<Debug>(_IR+o); } break;
       case ld_e_a:      _E = _A; break;
       case ld_e_b:      _E = _B; break;
-      case ld_e_byte:   _E = read_mem(_PC++); break;
+      case ld_e_byte:   _E = read_mem<Debug>(_PC++); break;
       case ld_e_c:      _E = _C; break;
       case ld_e_d:      _E = _D; break;
       case ld_e_e:      break;
-      case ld_e_h:      _E = _IXh; break;
-      case ld_e_l:      _E = _IXl; break;
-      case ld_e_mhl:    { signed char o = read_mem(_PC++); _E = read_mem(_IX+o); } break;
-      case ld_hl_mword: LD16_MEM(IX); break;
-      case ld_hl_word:  z80.IX.b.l = read_mem(_PC++); z80.IX.b.h = read_mem(_PC++); break;
-      case ld_h_a:      _IXh = _A; break;
-      case ld_h_b:      _IXh = _B; break;
-      case ld_h_byte:   _IXh = read_mem(_PC++); break;
-      case ld_h_c:      _IXh = _C; break;
-      case ld_h_d:      _IXh = _D; break;
-      case ld_h_e:      _IXh = _E; break;
+      case ld_e_h:      _E = _IRh; break;
+      case ld_e_l:      _E = _IRl; break;
+      case ld_e_mhl:    { signed char o = read_mem<Debug>(_PC++); _E = read_mem<Debug>(_IR+o); } break;
+      case ld_hl_mword: LD16_MEM(z80.*IR); break;
+      case ld_hl_word:  (z80.*IR).b.l = read_mem<Debug>(_PC++); (z80.*IR).b.h = read_mem<Debug>(_PC++); break;
+      case ld_h_a:      _IRh = _A; break;
+      case ld_h_b:      _IRh = _B; break;
+      case ld_h_byte:   _IRh = read_mem<Debug>(_PC++); break;
+      case ld_h_c:      _IRh = _C; break;
+      case ld_h_d:      _IRh = _D; break;
+      case ld_h_e:      _IRh = _E; break;
       case ld_h_h:      break;
-      case ld_h_l:      _IXh = _IXl; break;
-      case ld_h_mhl:    { signed char o = read_mem(_PC++); _H = read_mem(_IX+o); } break;
-      case ld_l_a:      _IXl = _A; break;
-      case ld_l_b:      _IXl = _B; break;
-      case ld_l_byte:   _IXl = read_mem(_PC++); break;
-      case ld_l_c:      _IXl = _C; break;
-      case ld_l_d:      _IXl = _D; break;
-      case ld_l_e:      _IXl = _E; break;
-      case ld_l_h:      _IXl = _IXh; break;
+      case ld_h_l:      _IRh = _IRl; break;
+      case ld_h_mhl:    { signed char o = read_mem<Debug>(_PC++); _H = read_mem<Debug>(_IR+o); } break;
+      case ld_l_a:      _IRl = _A; break;
+      case ld_l_b:      _IRl = _B; break;
+      case ld_l_byte:   _IRl = read_mem<Debug>(_PC++); break;
+      case ld_l_c:      _IRl = _C; break;
+      case ld_l_d:      _IRl = _D; break;
+      case ld_l_e:      _IRl = _E; break;
+      case ld_l_h:      _IRl = _IRh; break;
       case ld_l_l:      break;
-      case ld_l_mhl:    { signed char o = read_mem(_PC++); _L = read_mem(_IX+o); } break;
-      case ld_mbc_a:    write_mem(_BC, _A); break;
-      case ld_mde_a:    write_mem(_DE, _A); break;
-      case ld_mhl_a:    { signed char o = read_mem(_PC++); write_mem(_IX+o, _A); } break;
-      case ld_mhl_b:    { signed char o = read_mem(_PC++); write_mem(_IX+o, _B); } break;
-      case ld_mhl_byte: { signed char o = read_mem(_PC++); byte b = read_mem(_PC++); write_mem(_IX+o, b); } break;
-      case ld_mhl_c:    { signed char o = read_mem(_PC++); write_mem(_IX+o, _C); } break;
-      case ld_mhl_d:    { signed char o = read_mem(_PC++); write_mem(_IX+o, _D); } break;
-      case ld_mhl_e:    { signed char o = read_mem(_PC++); write_mem(_IX+o, _E); } break;
-      case ld_mhl_h:    { signed char o = read_mem(_PC++); write_mem(_IX+o, _H); } break;
-      case ld_mhl_l:    { signed char o = read_mem(_PC++); write_mem(_IX+o, _L); } break;
-      case ld_mword_a:  { reg_pair addr; addr.b.l = read_mem(_PC++); addr.b.h = read_mem(_PC++); write_mem(addr.w.l, _A); } break;
-      case ld_mword_hl: LDMEM_16(IX); break;
-      case ld_pc_hl:    _PC = _IX; break;
-      case ld_sp_hl:    _SP = _IX; iWSAdjust++; break;
-      case ld_sp_word:  z80.SP.b.l = read_mem(_PC++); z80.SP.b.h = read_mem(_PC++); break;
+      case ld_l_mhl:    { signed char o = read_mem<Debug>(_PC++); _L = read_mem<Debug>(_IR+o); } break;
+      case ld_mbc_a:    write_mem<Debug>(_BC, _A); break;
+      case ld_mde_a:    write_mem<Debug>(_DE, _A); break;
+      case ld_mhl_a:    { signed char o = read_mem<Debug>(_PC++); write_mem<Debug>(_IR+o, _A); } break;
+      case ld_mhl_b:    { signed char o = read_mem<Debug>(_PC++); write_mem<Debug>(_IR+o, _B); } break;
+      case ld_mhl_byte: { signed char o = read_mem<Debug>(_PC++); byte b = read_mem<Debug>(_PC++); write_mem<Debug>(_IR+o, b); } break;
+      case ld_mhl_c:    { signed char o = read_mem<Debug>(_PC++); write_mem<Debug>(_IR+o, _C); } break;
+      case ld_mhl_d:    { signed char o = read_mem<Debug>(_PC++); write_mem<Debug>(_IR+o, _D); } break;
+      case ld_mhl_e:    { signed char o = read_mem<Debug>(_PC++); write_mem<Debug>(_IR+o, _E); } break;
+      case ld_mhl_h:    { signed char o = read_mem<Debug>(_PC++); write_mem<Debug>(_IR+o, _H); } break;
+      case ld_mhl_l:    { signed char o = read_mem<Debug>(_PC++); write_mem<Debug>(_IR+o, _L); } break;
+      case ld_mword_a:  { reg_pair addr; addr.b.l = read_mem<Debug>(_PC++); addr.b.h = read_mem<Debug>(_PC++); write_mem<Debug>(addr.w.l, _A); } break;
+      case ld_mword_hl: LDMEM_16(z80.*IR); break;
+      case ld_pc_hl:    _PC = _IR; break;
+      case ld_sp_hl:    _SP = _IR; iWSAdjust++; break;
+      case ld_sp_word:  z80.SP.b.l = read_mem<Debug>(_PC++); z80.SP.b.h = read_mem<Debug>(_PC++); break;
       case nop:         break;
       case or_a:        OR(_A); break;
       case or_b:        OR(_B); break;
-      case or_byte:     OR(read_mem(_PC++)); break;
+      case or_byte:     OR(read_mem<Debug>(_PC++)); break;
       case or_c:        OR(_C); break;
       case or_d:        OR(_D); break;
       case or_e:        OR(_E); break;
-      case or_h:        OR(_IXh); break;
-      case or_l:        OR(_IXl); break;
-      case or_mhl:      { signed char o = read_mem(_PC++); OR(read_mem(_IX+o)); } break;
-      case outa:        { z80_wait_states iCycleCount = Oa_;} { reg_pair p; p.b.l = read_mem(_PC++); p.b.h = _A; z80_OUT_handler(p, _A); } break;
-      case pfx_cb:      z80_execute_pfx_ddcb_instruction(); break;
-      case pfx_dd:      z80_execute_pfx_dd_instruction(); break;
-      case pfx_ed:      z80_execute_pfx_ed_instruction(); break;
-      case pfx_fd:      z80_execute_pfx_fd_instruction(); break;
-      case pop_af:      POP(AF); break;
-      case pop_bc:      POP(BC); break;
-      case pop_de:      POP(DE); break;
-      case pop_hl:      POP(IX); break;
-      case push_af:     PUSH(AF); break;
-      case push_bc:     PUSH(BC); break;
-      case push_de:     PUSH(DE); break;
-      case push_hl:     PUSH(IX); break;
+      case or_h:        OR(_IRh); break;
+      case or_l:        OR(_IRl); break;
+      case or_mhl:      { signed char o = read_mem<Debug>(_PC++); OR(read_mem<Debug>(_IR+o)); } break;
+      case outa:        { z80_wait_states iCycleCount = Oa_;} { reg_pair p; p.b.l = read_mem<Debug>(_PC++); p.b.h = _A; z80_OUT(p, _A); } break;
+      case pfx_cb:      z80_execute_pfx_xycb_instruction<Debug, IR>(); break;
+      case pfx_dd:      z80_execute_pfx_xy_instruction<Debug, &t_z80regs::IX>(); break;
+      case pfx_ed:      z80_execute_pfx_ed_instruction<Debug>(); break;
+      case pfx_fd:      z80_execute_pfx_xy_instruction<Debug, &t_z80regs::IY>(); break;
+      case pop_af:      z80_resolve_flags(); POP(z80.AF); break;
+      case pop_bc:      POP(z80.BC); break;
+      case pop_de:      POP(z80.DE); break;
+      case pop_hl:      POP(z80.*IR); break;
+      case push_af:     z80_resolve_flags(); PUSH(z80.AF); break;
+      case push_bc:     PUSH(z80.BC); break;
+      case push_de:     PUSH(z80.DE); break;
+      case push_hl:     PUSH(z80.*IR); break;
       case ret:         RET; break;
-      case ret_c:       if (_F & Cflag) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
+      case ret_c:       if (z80_carry()) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
       case ret_m:       if (_F & Sflag) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
-      case ret_nc:      if (!(_F & Cflag)) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
-      case ret_nz:      if (!(_F & Zflag)) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
+      case ret_nc:      if (!z80_carry()) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
+      case ret_nz:      if (!z80_zero()) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
       case ret_p:       if (!(_F & Sflag)) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
       case ret_pe:      if (_F & Pflag) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
       case ret_po:      if (!(_F & Pflag)) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
-      case ret_z:       if (_F & Zflag) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
+      case ret_z:       if (z80_zero()) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
       case rla:         RLA; break;
       case rlca:        RLCA; break;
       case rra:         RRA; break;
@@ -1888,313 +2178,315 @@ void z80_execute_pfx_dd_instruction()
       case rst38:       RST(0x0038); break;
       case sbc_a:       SBC(_A); break;
       case sbc_b:       SBC(_B); break;
-      case sbc_byte:    SBC(read_mem(_PC++)); break;
+      case sbc_byte:    SBC(read_mem<Debug>(_PC++)); break;
       case sbc_c:       SBC(_C); break;
       case sbc_d:       SBC(_D); break;
       case sbc_e:       SBC(_E); break;
-      case sbc_h:       SBC(_IXh); break;
-      case sbc_l:       SBC(_IXl); break;
-      case sbc_mhl:     { signed char o = read_mem(_PC++); SBC(read_mem(_IX+o)); } break;
+      case sbc_h:       SBC(_IRh); break;
+      case sbc_l:       SBC(_IRl); break;
+      case sbc_mhl:     { signed char o = read_mem<Debug>(_PC++); SBC(read_mem<Debug>(_IR+o)); } break;
       case scf:         _F = (_F & (Sflag | Zflag | Pflag)) | Cflag | (_A & Xflags); break;
       case sub_a:       SUB(_A); break;
       case sub_b:       SUB(_B); break;
-      case sub_byte:    SUB(read_mem(_PC++)); break;
+      case sub_byte:    SUB(read_mem<Debug>(_PC++)); break;
       case sub_c:       SUB(_C); break;
       case sub_d:       SUB(_D); break;
       case sub_e:       SUB(_E); break;
-      case sub_h:       SUB(_IXh); break;
-      case sub_l:       SUB(_IXl); break;
-      case sub_mhl:     { signed char o = read_mem(_PC++); SUB(read_mem(_IX+o)); } break;
+      case sub_h:       SUB(_IRh); break;
+      case sub_l:       SUB(_IRl); break;
+      case sub_mhl:     { signed char o = read_mem<Debug>(_PC++); SUB(read_mem<Debug>(_IR+o)); } break;
       case xor_a:       XOR(_A); break;
       case xor_b:       XOR(_B); break;
-      case xor_byte:    XOR(read_mem(_PC++)); break;
+      case xor_byte:    XOR(read_mem<Debug>(_PC++)); break;
       case xor_c:       XOR(_C); break;
       case xor_d:       XOR(_D); break;
       case xor_e:       XOR(_E); break;
-      case xor_h:       XOR(_IXh); break;
-      case xor_l:       XOR(_IXl); break;
-      case xor_mhl:     { signed char o = read_mem(_PC++); XOR(read_mem(_IX+o)); } break;
+      case xor_h:       XOR(_IRh); break;
+      case xor_l:       XOR(_IRl); break;
+      case xor_mhl:     { signed char o = read_mem<Debug>(_PC++); XOR(read_mem<Debug>(_IR+o)); } break;
    }
 }
 
 
 
-void z80_execute_pfx_ddcb_instruction()
+template<bool Debug, reg_pair t_z80regs::*IR>
+void z80_execute_pfx_xycb_instruction()
 {
    signed char o;
    byte bOpCode;
 
-   o = read_mem(_PC++); // offset
-   bOpCode = read_mem(_PC++);
+   o = read_mem<Debug>(_PC++); // offset
+   bOpCode = read_mem<Debug>(_PC++);
    iCycleCount += cc_xycb[bOpCode];
    switch(bOpCode)
    {
-      case bit0_a:      BIT_XY(0, read_mem(_IX+o)); break;
-      case bit0_b:      BIT_XY(0, read_mem(_IX+o)); break;
-      case bit0_c:      BIT_XY(0, read_mem(_IX+o)); break;
-      case bit0_d:      BIT_XY(0, read_mem(_IX+o)); break;
-      case bit0_e:      BIT_XY(0, read_mem(_IX+o)); break;
-      case bit0_h:      BIT_XY(0, read_mem(_IX+o)); break;
-      case bit0_l:      BIT_XY(0, read_mem(_IX+o)); break;
-      case bit0_mhl:    BIT_XY(0, read_mem(_IX+o)); break;
-      case bit1_a:      BIT_XY(1, read_mem(_IX+o)); break;
-      case bit1_b:      BIT_XY(1, read_mem(_IX+o)); break;
-      case bit1_c:      BIT_XY(1, read_mem(_IX+o)); break;
-      case bit1_d:      BIT_XY(1, read_mem(_IX+o)); break;
-      case bit1_e:      BIT_XY(1, read_mem(_IX+o)); break;
-      case bit1_h:      BIT_XY(1, read_mem(_IX+o)); break;
-      case bit1_l:      BIT_XY(1, read_mem(_IX+o)); break;
-      case bit1_mhl:    BIT_XY(1, read_mem(_IX+o)); break;
-      case bit2_a:      BIT_XY(2, read_mem(_IX+o)); break;
-      case bit2_b:      BIT_XY(2, read_mem(_IX+o)); break;
-      case bit2_c:      BIT_XY(2, read_mem(_IX+o)); break;
-      case bit2_d:      BIT_XY(2, read_mem(_IX+o)); break;
-      case bit2_e:      BIT_XY(2, read_mem(_IX+o)); break;
-      case bit2_h:      BIT_XY(2, read_mem(_IX+o)); break;
-      case bit2_l:      BIT_XY(2, read_mem(_IX+o)); break;
-      case bit2_mhl:    BIT_XY(2, read_mem(_IX+o)); break;
-      case bit3_a:      BIT_XY(3, read_mem(_IX+o)); break;
-      case bit3_b:      BIT_XY(3, read_mem(_IX+o)); break;
-      case bit3_c:      BIT_XY(3, read_mem(_IX+o)); break;
-      case bit3_d:      BIT_XY(3, read_mem(_IX+o)); break;
-      case bit3_e:      BIT_XY(3, read_mem(_IX+o)); break;
-      case bit3_h:      BIT_XY(3, read_mem(_IX+o)); break;
-      case bit3_l:      BIT_XY(3, read_mem(_IX+o)); break;
-      case bit3_mhl:    BIT_XY(3, read_mem(_IX+o)); break;
-      case bit4_a:      BIT_XY(4, read_mem(_IX+o)); break;
-      case bit4_b:      BIT_XY(4, read_mem(_IX+o)); break;
-      case bit4_c:      BIT_XY(4, read_mem(_IX+o)); break;
-      case bit4_d:      BIT_XY(4, read_mem(_IX+o)); break;
-      case bit4_e:      BIT_XY(4, read_mem(_IX+o)); break;
-      case bit4_h:      BIT_XY(4, read_mem(_IX+o)); break;
-      case bit4_l:      BIT_XY(4, read_mem(_IX+o)); break;
-      case bit4_mhl:    BIT_XY(4, read_mem(_IX+o)); break;
-      case bit5_a:      BIT_XY(5, read_mem(_IX+o)); break;
-      case bit5_b:      BIT_XY(5, read_mem(_IX+o)); break;
-      case bit5_c:      BIT_XY(5, read_mem(_IX+o)); break;
-      case bit5_d:      BIT_XY(5, read_mem(_IX+o)); break;
-      case bit5_e:      BIT_XY(5, read_mem(_IX+o)); break;
-      case bit5_h:      BIT_XY(5, read_mem(_IX+o)); break;
-      case bit5_l:      BIT_XY(5, read_mem(_IX+o)); break;
-      case bit5_mhl:    BIT_XY(5, read_mem(_IX+o)); break;
-      case bit6_a:      BIT_XY(6, read_mem(_IX+o)); break;
-      case bit6_b:      BIT_XY(6, read_mem(_IX+o)); break;
-      case bit6_c:      BIT_XY(6, read_mem(_IX+o)); break;
-      case bit6_d:      BIT_XY(6, read_mem(_IX+o)); break;
-      case bit6_e:      BIT_XY(6, read_mem(_IX+o)); break;
-      case bit6_h:      BIT_XY(6, read_mem(_IX+o)); break;
-      case bit6_l:      BIT_XY(6, read_mem(_IX+o)); break;
-      case bit6_mhl:    BIT_XY(6, read_mem(_IX+o)); break;
-      case bit7_a:      BIT_XY(7, read_mem(_IX+o)); break;
-      case bit7_b:      BIT_XY(7, read_mem(_IX+o)); break;
-      case bit7_c:      BIT_XY(7, read_mem(_IX+o)); break;
-      case bit7_d:      BIT_XY(7, read_mem(_IX+o)); break;
-      case bit7_e:      BIT_XY(7, read_mem(_IX+o)); break;
-      case bit7_h:      BIT_XY(7, read_mem(_IX+o)); break;
-      case bit7_l:      BIT_XY(7, read_mem(_IX+o)); break;
-      case bit7_mhl:    BIT_XY(7, read_mem(_IX+o)); break;
-      case res0_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = RES(0, _A)); break;
-      case res0_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = RES(0, _B)); break;
-      case res0_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = RES(0, _C)); break;
-      case res0_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = RES(0, _D)); break;
-      case res0_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = RES(0, _E)); break;
-      case res0_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = RES(0, _H)); break;
-      case res0_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = RES(0, _L)); break;
-      case res0_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, RES(0, b)); } break;
-      case res1_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = RES(1, _A)); break;
-      case res1_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = RES(1, _B)); break;
-      case res1_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = RES(1, _C)); break;
-      case res1_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = RES(1, _D)); break;
-      case res1_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = RES(1, _E)); break;
-      case res1_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = RES(1, _H)); break;
-      case res1_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = RES(1, _L)); break;
-      case res1_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, RES(1, b)); } break;
-      case res2_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = RES(2, _A)); break;
-      case res2_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = RES(2, _B)); break;
-      case res2_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = RES(2, _C)); break;
-      case res2_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = RES(2, _D)); break;
-      case res2_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = RES(2, _E)); break;
-      case res2_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = RES(2, _H)); break;
-      case res2_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = RES(2, _L)); break;
-      case res2_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, RES(2, b)); } break;
-      case res3_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = RES(3, _A)); break;
-      case res3_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = RES(3, _B)); break;
-      case res3_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = RES(3, _C)); break;
-      case res3_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = RES(3, _D)); break;
-      case res3_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = RES(3, _E)); break;
-      case res3_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = RES(3, _H)); break;
-      case res3_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = RES(3, _L)); break;
-      case res3_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, RES(3, b)); } break;
-      case res4_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = RES(4, _A)); break;
-      case res4_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = RES(4, _B)); break;
-      case res4_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = RES(4, _C)); break;
-      case res4_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = RES(4, _D)); break;
-      case res4_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = RES(4, _E)); break;
-      case res4_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = RES(4, _H)); break;
-      case res4_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = RES(4, _L)); break;
-      case res4_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, RES(4, b)); } break;
-      case res5_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = RES(5, _A)); break;
-      case res5_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = RES(5, _B)); break;
-      case res5_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = RES(5, _C)); break;
-      case res5_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = RES(5, _D)); break;
-      case res5_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = RES(5, _E)); break;
-      case res5_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = RES(5, _H)); break;
-      case res5_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = RES(5, _L)); break;
-      case res5_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, RES(5, b)); } break;
-      case res6_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = RES(6, _A)); break;
-      case res6_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = RES(6, _B)); break;
-      case res6_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = RES(6, _C)); break;
-      case res6_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = RES(6, _D)); break;
-      case res6_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = RES(6, _E)); break;
-      case res6_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = RES(6, _H)); break;
-      case res6_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = RES(6, _L)); break;
-      case res6_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, RES(6, b)); } break;
-      case res7_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = RES(7, _A)); break;
-      case res7_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = RES(7, _B)); break;
-      case res7_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = RES(7, _C)); break;
-      case res7_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = RES(7, _D)); break;
-      case res7_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = RES(7, _E)); break;
-      case res7_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = RES(7, _H)); break;
-      case res7_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = RES(7, _L)); break;
-      case res7_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, RES(7, b)); } break;
-      case rlc_a:       _A = read_mem(_IX+o); _A = RLC(_A); write_mem(_IX+o, _A); break;
-      case rlc_b:       _B = read_mem(_IX+o); _B = RLC(_B); write_mem(_IX+o, _B); break;
-      case rlc_c:       _C = read_mem(_IX+o); _C = RLC(_C); write_mem(_IX+o, _C); break;
-      case rlc_d:       _D = read_mem(_IX+o); _D = RLC(_D); write_mem(_IX+o, _D); break;
-      case rlc_e:       _E = read_mem(_IX+o); _E = RLC(_E); write_mem(_IX+o, _E); break;
-      case rlc_h:       _H = read_mem(_IX+o); _H = RLC(_H); write_mem(_IX+o, _H); break;
-      case rlc_l:       _L = read_mem(_IX+o); _L = RLC(_L); write_mem(_IX+o, _L); break;
-      case rlc_mhl:     { byte b = read_mem(_IX+o); write_mem(_IX+o, RLC(b)); } break;
-      case rl_a:        _A = read_mem(_IX+o); _A = RL(_A); write_mem(_IX+o, _A); break;
-      case rl_b:        _B = read_mem(_IX+o); _B = RL(_B); write_mem(_IX+o, _B); break;
-      case rl_c:        _C = read_mem(_IX+o); _C = RL(_C); write_mem(_IX+o, _C); break;
-      case rl_d:        _D = read_mem(_IX+o); _D = RL(_D); write_mem(_IX+o, _D); break;
-      case rl_e:        _E = read_mem(_IX+o); _E = RL(_E); write_mem(_IX+o, _E); break;
-      case rl_h:        _H = read_mem(_IX+o); _H = RL(_H); write_mem(_IX+o, _H); break;
-      case rl_l:        _L = read_mem(_IX+o); _L = RL(_L); write_mem(_IX+o, _L); break;
-      case rl_mhl:      { byte b = read_mem(_IX+o); write_mem(_IX+o, RL(b)); } break;
-      case rrc_a:       _A = read_mem(_IX+o); _A = RRC(_A); write_mem(_IX+o, _A); break;
-      case rrc_b:       _B = read_mem(_IX+o); _B = RRC(_B); write_mem(_IX+o, _B); break;
-      case rrc_c:       _C = read_mem(_IX+o); _C = RRC(_C); write_mem(_IX+o, _C); break;
-      case rrc_d:       _D = read_mem(_IX+o); _D = RRC(_D); write_mem(_IX+o, _D); break;
-      case rrc_e:       _E = read_mem(_IX+o); _E = RRC(_E); write_mem(_IX+o, _E); break;
-      case rrc_h:       _H = read_mem(_IX+o); _H = RRC(_H); write_mem(_IX+o, _H); break;
-      case rrc_l:       _L = read_mem(_IX+o); _L = RRC(_L); write_mem(_IX+o, _L); break;
-      case rrc_mhl:     { byte b = read_mem(_IX+o); write_mem(_IX+o, RRC(b)); } break;
-      case rr_a:        _A = read_mem(_IX+o); _A = RR(_A); write_mem(_IX+o, _A); break;
-      case rr_b:        _B = read_mem(_IX+o); _B = RR(_B); write_mem(_IX+o, _B); break;
-      case rr_c:        _C = read_mem(_IX+o); _C = RR(_C); write_mem(_IX+o, _C); break;
-      case rr_d:        _D = read_mem(_IX+o); _D = RR(_D); write_mem(_IX+o, _D); break;
-      case rr_e:        _E = read_mem(_IX+o); _E = RR(_E); write_mem(_IX+o, _E); break;
-      case rr_h:        _H = read_mem(_IX+o); _H = RR(_H); write_mem(_IX+o, _H); break;
-      case rr_l:        _L = read_mem(_IX+o); _L = RR(_L); write_mem(_IX+o, _L); break;
-      case rr_mhl:      { byte b = read_mem(_IX+o); write_mem(_IX+o, RR(b)); } break;
-      case set0_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = SET(0, _A)); break;
-      case set0_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = SET(0, _B)); break;
-      case set0_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = SET(0, _C)); break;
-      case set0_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = SET(0, _D)); break;
-      case set0_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = SET(0, _E)); break;
-      case set0_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = SET(0, _H)); break;
-      case set0_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = SET(0, _L)); break;
-      case set0_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, SET(0, b)); } break;
-      case set1_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = SET(1, _A)); break;
-      case set1_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = SET(1, _B)); break;
-      case set1_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = SET(1, _C)); break;
-      case set1_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = SET(1, _D)); break;
-      case set1_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = SET(1, _E)); break;
-      case set1_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = SET(1, _H)); break;
-      case set1_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = SET(1, _L)); break;
-      case set1_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, SET(1, b)); } break;
-      case set2_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = SET(2, _A)); break;
-      case set2_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = SET(2, _B)); break;
-      case set2_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = SET(2, _C)); break;
-      case set2_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = SET(2, _D)); break;
-      case set2_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = SET(2, _E)); break;
-      case set2_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = SET(2, _H)); break;
-      case set2_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = SET(2, _L)); break;
-      case set2_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, SET(2, b)); } break;
-      case set3_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = SET(3, _A)); break;
-      case set3_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = SET(3, _B)); break;
-      case set3_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = SET(3, _C)); break;
-      case set3_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = SET(3, _D)); break;
-      case set3_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = SET(3, _E)); break;
-      case set3_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = SET(3, _H)); break;
-      case set3_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = SET(3, _L)); break;
-      case set3_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, SET(3, b)); } break;
-      case set4_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = SET(4, _A)); break;
-      case set4_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = SET(4, _B)); break;
-      case set4_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = SET(4, _C)); break;
-      case set4_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = SET(4, _D)); break;
-      case set4_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = SET(4, _E)); break;
-      case set4_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = SET(4, _H)); break;
-      case set4_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = SET(4, _L)); break;
-      case set4_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, SET(4, b)); } break;
-      case set5_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = SET(5, _A)); break;
-      case set5_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = SET(5, _B)); break;
-      case set5_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = SET(5, _C)); break;
-      case set5_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = SET(5, _D)); break;
-      case set5_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = SET(5, _E)); break;
-      case set5_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = SET(5, _H)); break;
-      case set5_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = SET(5, _L)); break;
-      case set5_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, SET(5, b)); } break;
-      case set6_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = SET(6, _A)); break;
-      case set6_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = SET(6, _B)); break;
-      case set6_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = SET(6, _C)); break;
-      case set6_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = SET(6, _D)); break;
-      case set6_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = SET(6, _E)); break;
-      case set6_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = SET(6, _H)); break;
-      case set6_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = SET(6, _L)); break;
-      case set6_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, SET(6, b)); } break;
-      case set7_a:      _A = read_mem(_IX+o); write_mem(_IX+o, _A = SET(7, _A)); break;
-      case set7_b:      _B = read_mem(_IX+o); write_mem(_IX+o, _B = SET(7, _B)); break;
-      case set7_c:      _C = read_mem(_IX+o); write_mem(_IX+o, _C = SET(7, _C)); break;
-      case set7_d:      _D = read_mem(_IX+o); write_mem(_IX+o, _D = SET(7, _D)); break;
-      case set7_e:      _E = read_mem(_IX+o); write_mem(_IX+o, _E = SET(7, _E)); break;
-      case set7_h:      _H = read_mem(_IX+o); write_mem(_IX+o, _H = SET(7, _H)); break;
-      case set7_l:      _L = read_mem(_IX+o); write_mem(_IX+o, _L = SET(7, _L)); break;
-      case set7_mhl:    { byte b = read_mem(_IX+o); write_mem(_IX+o, SET(7, b)); } break;
-      case sla_a:       _A = read_mem(_IX+o); _A = SLA(_A); write_mem(_IX+o, _A); break;
-      case sla_b:       _B = read_mem(_IX+o); _B = SLA(_B); write_mem(_IX+o, _B); break;
-      case sla_c:       _C = read_mem(_IX+o); _C = SLA(_C); write_mem(_IX+o, _C); break;
-      case sla_d:       _D = read_mem(_IX+o); _D = SLA(_D); write_mem(_IX+o, _D); break;
-      case sla_e:       _E = read_mem(_IX+o); _E = SLA(_E); write_mem(_IX+o, _E); break;
-      case sla_h:       _H = read_mem(_IX+o); _H = SLA(_H); write_mem(_IX+o, _H); break;
-      case sla_l:       _L = read_mem(_IX+o); _L = SLA(_L); write_mem(_IX+o, _L); break;
-      case sla_mhl:     { byte b = read_mem(_IX+o); write_mem(_IX+o, SLA(b)); } break;
-      case sll_a:       _A = read_mem(_IX+o); _A = SLL(_A); write_mem(_IX+o, _A); break;
-      case sll_b:       _B = read_mem(_IX+o); _B = SLL(_B); write_mem(_IX+o, _B); break;
-      case sll_c:       _C = read_mem(_IX+o); _C = SLL(_C); write_mem(_IX+o, _C); break;
-      case sll_d:       _D = read_mem(_IX+o); _D = SLL(_D); write_mem(_IX+o, _D); break;
-      case sll_e:       _E = read_mem(_IX+o); _E = SLL(_E); write_mem(_IX+o, _E); break;
-      case sll_h:       _H = read_mem(_IX+o); _H = SLL(_H); write_mem(_IX+o, _H); break;
-      case sll_l:       _L = read_mem(_IX+o); _L = SLL(_L); write_mem(_IX+o, _L); break;
-      case sll_mhl:     { byte b = read_mem(_IX+o); write_mem(_IX+o, SLL(b)); } break;
-      case sra_a:       _A = read_mem(_IX+o); _A = SRA(_A); write_mem(_IX+o, _A); break;
-      case sra_b:       _B = read_mem(_IX+o); _B = SRA(_B); write_mem(_IX+o, _B); break;
-      case sra_c:       _C = read_mem(_IX+o); _C = SRA(_C); write_mem(_IX+o, _C); break;
-      case sra_d:       _D = read_mem(_IX+o); _D = SRA(_D); write_mem(_IX+o, _D); break;
-      case sra_e:       _E = read_mem(_IX+o); _E = SRA(_E); write_mem(_IX+o, _E); break;
-      case sra_h:       _H = read_mem(_IX+o); _H = SRA(_H); write_mem(_IX+o, _H); break;
-      case sra_l:       _L = read_mem(_IX+o); _L = SRA(_L); write_mem(_IX+o, _L); break;
-      case sra_mhl:     { byte b = read_mem(_IX+o); write_mem(_IX+o, SRA(b)); } break;
-      case srl_a:       _A = read_mem(_IX+o); _A = SRL(_A); write_mem(_IX+o, _A); break;
-      case srl_b:       _B = read_mem(_IX+o); _B = SRL(_B); write_mem(_IX+o, _B); break;
-      case srl_c:       _C = read_mem(_IX+o); _C = SRL(_C); write_mem(_IX+o, _C); break;
-      case srl_d:       _D = read_mem(_IX+o); _D = SRL(_D); write_mem(_IX+o, _D); break;
-      case srl_e:       _E = read_mem(_IX+o); _E = SRL(_E); write_mem(_IX+o, _E); break;
-      case srl_h:       _H = read_mem(_IX+o); _H = SRL(_H); write_mem(_IX+o, _H); break;
-      case srl_l:       _L = read_mem(_IX+o); _L = SRL(_L); write_mem(_IX+o, _L); break;
-      case srl_mhl:     { byte b = read_mem(_IX+o); write_mem(_IX+o, SRL(b)); } break;
+      case bit0_a:      BIT_XY(0, read_mem<Debug>(_IR+o)); break;
+      case bit0_b:      BIT_XY(0, read_mem<Debug>(_IR+o)); break;
+      case bit0_c:      BIT_XY(0, read_mem<Debug>(_IR+o)); break;
+      case bit0_d:      BIT_XY(0, read_mem<Debug>(_IR+o)); break;
+      case bit0_e:      BIT_XY(0, read_mem<Debug>(_IR+o)); break;
+      case bit0_h:      BIT_XY(0, read_mem<Debug>(_IR+o)); break;
+      case bit0_l:      BIT_XY(0, read_mem<Debug>(_IR+o)); break;
+      case bit0_mhl:    BIT_XY(0, read_mem<Debug>(_IR+o)); break;
+      case bit1_a:      BIT_XY(1, read_mem<Debug>(_IR+o)); break;
+      case bit1_b:      BIT_XY(1, read_mem<Debug>(_IR+o)); break;
+      case bit1_c:      BIT_XY(1, read_mem<Debug>(_IR+o)); break;
+      case bit1_d:      BIT_XY(1, read_mem<Debug>(_IR+o)); break;
+      case bit1_e:      BIT_XY(1, read_mem<Debug>(_IR+o)); break;
+      case bit1_h:      BIT_XY(1, read_mem<Debug>(_IR+o)); break;
+      case bit1_l:      BIT_XY(1, read_mem<Debug>(_IR+o)); break;
+      case bit1_mhl:    BIT_XY(1, read_mem<Debug>(_IR+o)); break;
+      case bit2_a:      BIT_XY(2, read_mem<Debug>(_IR+o)); break;
+      case bit2_b:      BIT_XY(2, read_mem<Debug>(_IR+o)); break;
+      case bit2_c:      BIT_XY(2, read_mem<Debug>(_IR+o)); break;
+      case bit2_d:      BIT_XY(2, read_mem<Debug>(_IR+o)); break;
+      case bit2_e:      BIT_XY(2, read_mem<Debug>(_IR+o)); break;
+      case bit2_h:      BIT_XY(2, read_mem<Debug>(_IR+o)); break;
+      case bit2_l:      BIT_XY(2, read_mem<Debug>(_IR+o)); break;
+      case bit2_mhl:    BIT_XY(2, read_mem<Debug>(_IR+o)); break;
+      case bit3_a:      BIT_XY(3, read_mem<Debug>(_IR+o)); break;
+      case bit3_b:      BIT_XY(3, read_mem<Debug>(_IR+o)); break;
+      case bit3_c:      BIT_XY(3, read_mem<Debug>(_IR+o)); break;
+      case bit3_d:      BIT_XY(3, read_mem<Debug>(_IR+o)); break;
+      case bit3_e:      BIT_XY(3, read_mem<Debug>(_IR+o)); break;
+      case bit3_h:      BIT_XY(3, read_mem<Debug>(_IR+o)); break;
+      case bit3_l:      BIT_XY(3, read_mem<Debug>(_IR+o)); break;
+      case bit3_mhl:    BIT_XY(3, read_mem<Debug>(_IR+o)); break;
+      case bit4_a:      BIT_XY(4, read_mem<Debug>(_IR+o)); break;
+      case bit4_b:      BIT_XY(4, read_mem<Debug>(_IR+o)); break;
+      case bit4_c:      BIT_XY(4, read_mem<Debug>(_IR+o)); break;
+      case bit4_d:      BIT_XY(4, read_mem<Debug>(_IR+o)); break;
+      case bit4_e:      BIT_XY(4, read_mem<Debug>(_IR+o)); break;
+      case bit4_h:      BIT_XY(4, read_mem<Debug>(_IR+o)); break;
+      case bit4_l:      BIT_XY(4, read_mem<Debug>(_IR+o)); break;
+      case bit4_mhl:    BIT_XY(4, read_mem<Debug>(_IR+o)); break;
+      case bit5_a:      BIT_XY(5, read_mem<Debug>(_IR+o)); break;
+      case bit5_b:      BIT_XY(5, read_mem<Debug>(_IR+o)); break;
+      case bit5_c:      BIT_XY(5, read_mem<Debug>(_IR+o)); break;
+      case bit5_d:      BIT_XY(5, read_mem<Debug>(_IR+o)); break;
+      case bit5_e:      BIT_XY(5, read_mem<Debug>(_IR+o)); break;
+      case bit5_h:      BIT_XY(5, read_mem<Debug>(_IR+o)); break;
+      case bit5_l:      BIT_XY(5, read_mem<Debug>(_IR+o)); break;
+      case bit5_mhl:    BIT_XY(5, read_mem<Debug>(_IR+o)); break;
+      case bit6_a:      BIT_XY(6, read_mem<Debug>(_IR+o)); break;
+      case bit6_b:      BIT_XY(6, read_mem<Debug>(_IR+o)); break;
+      case bit6_c:      BIT_XY(6, read_mem<Debug>(_IR+o)); break;
+      case bit6_d:      BIT_XY(6, read_mem<Debug>(_IR+o)); break;
+      case bit6_e:      BIT_XY(6, read_mem<Debug>(_IR+o)); break;
+      case bit6_h:      BIT_XY(6, read_mem<Debug>(_IR+o)); break;
+      case bit6_l:      BIT_XY(6, read_mem<Debug>(_IR+o)); break;
+      case bit6_mhl:    BIT_XY(6, read_mem<Debug>(_IR+o)); break;
+      case bit7_a:      BIT_XY(7, read_mem<Debug>(_IR+o)); break;
+      case bit7_b:      BIT_XY(7, read_mem<Debug>(_IR+o)); break;
+      case bit7_c:      BIT_XY(7, read_mem<Debug>(_IR+o)); break;
+      case bit7_d:      BIT_XY(7, read_mem<Debug>(_IR+o)); break;
+      case bit7_e:      BIT_XY(7, read_mem<Debug>(_IR+o)); break;
+      case bit7_h:      BIT_XY(7, read_mem<Debug>(_IR+o)); break;
+      case bit7_l:      BIT_XY(7, read_mem<Debug>(_IR+o)); break;
+      case bit7_mhl:    BIT_XY(7, read_mem<Debug>(_IR+o)); break;
+      case res0_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = RES(0, _A)); break;
+      case res0_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = RES(0, _B)); break;
+      case res0_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = RES(0, _C)); break;
+      case res0_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = RES(0, _D)); break;
+      case res0_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = RES(0, _E)); break;
+      case res0_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = RES(0, _H)); break;
+      case res0_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = RES(0, _L)); break;
+      case res0_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, RES(0, b)); } break;
+      case res1_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = RES(1, _A)); break;
+      case res1_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = RES(1, _B)); break;
+      case res1_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = RES(1, _C)); break;
+      case res1_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = RES(1, _D)); break;
+      case res1_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = RES(1, _E)); break;
+      case res1_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = RES(1, _H)); break;
+      case res1_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = RES(1, _L)); break;
+      case res1_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, RES(1, b)); } break;
+      case res2_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = RES(2, _A)); break;
+      case res2_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = RES(2, _B)); break;
+      case res2_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = RES(2, _C)); break;
+      case res2_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = RES(2, _D)); break;
+      case res2_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = RES(2, _E)); break;
+      case res2_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = RES(2, _H)); break;
+      case res2_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = RES(2, _L)); break;
+      case res2_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, RES(2, b)); } break;
+      case res3_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = RES(3, _A)); break;
+      case res3_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = RES(3, _B)); break;
+      case res3_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = RES(3, _C)); break;
+      case res3_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = RES(3, _D)); break;
+      case res3_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = RES(3, _E)); break;
+      case res3_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = RES(3, _H)); break;
+      case res3_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = RES(3, _L)); break;
+      case res3_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, RES(3, b)); } break;
+      case res4_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = RES(4, _A)); break;
+      case res4_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = RES(4, _B)); break;
+      case res4_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = RES(4, _C)); break;
+      case res4_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = RES(4, _D)); break;
+      case res4_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = RES(4, _E)); break;
+      case res4_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = RES(4, _H)); break;
+      case res4_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = RES(4, _L)); break;
+      case res4_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, RES(4, b)); } break;
+      case res5_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = RES(5, _A)); break;
+      case res5_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = RES(5, _B)); break;
+      case res5_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = RES(5, _C)); break;
+      case res5_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = RES(5, _D)); break;
+      case res5_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = RES(5, _E)); break;
+      case res5_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = RES(5, _H)); break;
+      case res5_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = RES(5, _L)); break;
+      case res5_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, RES(5, b)); } break;
+      case res6_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = RES(6, _A)); break;
+      case res6_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = RES(6, _B)); break;
+      case res6_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = RES(6, _C)); break;
+      case res6_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = RES(6, _D)); break;
+      case res6_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = RES(6, _E)); break;
+      case res6_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = RES(6, _H)); break;
+      case res6_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = RES(6, _L)); break;
+      case res6_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, RES(6, b)); } break;
+      case res7_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = RES(7, _A)); break;
+      case res7_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = RES(7, _B)); break;
+      case res7_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = RES(7, _C)); break;
+      case res7_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = RES(7, _D)); break;
+      case res7_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = RES(7, _E)); break;
+      case res7_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = RES(7, _H)); break;
+      case res7_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = RES(7, _L)); break;
+      case res7_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, RES(7, b)); } break;
+      case rlc_a:       _A = read_mem<Debug>(_IR+o); _A = RLC(_A); write_mem<Debug>(_IR+o, _A); break;
+      case rlc_b:       _B = read_mem<Debug>(_IR+o); _B = RLC(_B); write_mem<Debug>(_IR+o, _B); break;
+      case rlc_c:       _C = read_mem<Debug>(_IR+o); _C = RLC(_C); write_mem<Debug>(_IR+o, _C); break;
+      case rlc_d:       _D = read_mem<Debug>(_IR+o); _D = RLC(_D); write_mem<Debug>(_IR+o, _D); break;
+      case rlc_e:       _E = read_mem<Debug>(_IR+o); _E = RLC(_E); write_mem<Debug>(_IR+o, _E); break;
+      case rlc_h:       _H = read_mem<Debug>(_IR+o); _H = RLC(_H); write_mem<Debug>(_IR+o, _H); break;
+      case rlc_l:       _L = read_mem<Debug>(_IR+o); _L = RLC(_L); write_mem<Debug>(_IR+o, _L); break;
+      case rlc_mhl:     { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, RLC(b)); } break;
+      case rl_a:        _A = read_mem<Debug>(_IR+o); _A = RL(_A); write_mem<Debug>(_IR+o, _A); break;
+      case rl_b:        _B = read_mem<Debug>(_IR+o); _B = RL(_B); write_mem<Debug>(_IR+o, _B); break;
+      case rl_c:        _C = read_mem<Debug>(_IR+o); _C = RL(_C); write_mem<Debug>(_IR+o, _C); break;
+      case rl_d:        _D = read_mem<Debug>(_IR+o); _D = RL(_D); write_mem<Debug>(_IR+o, _D); break;
+      case rl_e:        _E = read_mem<Debug>(_IR+o); _E = RL(_E); write_mem<Debug>(_IR+o, _E); break;
+      case rl_h:        _H = read_mem<Debug>(_IR+o); _H = RL(_H); write_mem<Debug>(_IR+o, _H); break;
+      case rl_l:        _L = read_mem<Debug>(_IR+o); _L = RL(_L); write_mem<Debug>(_IR+o, _L); break;
+      case rl_mhl:      { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, RL(b)); } break;
+      case rrc_a:       _A = read_mem<Debug>(_IR+o); _A = RRC(_A); write_mem<Debug>(_IR+o, _A); break;
+      case rrc_b:       _B = read_mem<Debug>(_IR+o); _B = RRC(_B); write_mem<Debug>(_IR+o, _B); break;
+      case rrc_c:       _C = read_mem<Debug>(_IR+o); _C = RRC(_C); write_mem<Debug>(_IR+o, _C); break;
+      case rrc_d:       _D = read_mem<Debug>(_IR+o); _D = RRC(_D); write_mem<Debug>(_IR+o, _D); break;
+      case rrc_e:       _E = read_mem<Debug>(_IR+o); _E = RRC(_E); write_mem<Debug>(_IR+o, _E); break;
+      case rrc_h:       _H = read_mem<Debug>(_IR+o); _H = RRC(_H); write_mem<Debug>(_IR+o, _H); break;
+      case rrc_l:       _L = read_mem<Debug>(_IR+o); _L = RRC(_L); write_mem<Debug>(_IR+o, _L); break;
+      case rrc_mhl:     { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, RRC(b)); } break;
+      case rr_a:        _A = read_mem<Debug>(_IR+o); _A = RR(_A); write_mem<Debug>(_IR+o, _A); break;
+      case rr_b:        _B = read_mem<Debug>(_IR+o); _B = RR(_B); write_mem<Debug>(_IR+o, _B); break;
+      case rr_c:        _C = read_mem<Debug>(_IR+o); _C = RR(_C); write_mem<Debug>(_IR+o, _C); break;
+      case rr_d:        _D = read_mem<Debug>(_IR+o); _D = RR(_D); write_mem<Debug>(_IR+o, _D); break;
+      case rr_e:        _E = read_mem<Debug>(_IR+o); _E = RR(_E); write_mem<Debug>(_IR+o, _E); break;
+      case rr_h:        _H = read_mem<Debug>(_IR+o); _H = RR(_H); write_mem<Debug>(_IR+o, _H); break;
+      case rr_l:        _L = read_mem<Debug>(_IR+o); _L = RR(_L); write_mem<Debug>(_IR+o, _L); break;
+      case rr_mhl:      { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, RR(b)); } break;
+      case set0_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = SET(0, _A)); break;
+      case set0_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = SET(0, _B)); break;
+      case set0_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = SET(0, _C)); break;
+      case set0_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = SET(0, _D)); break;
+      case set0_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = SET(0, _E)); break;
+      case set0_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = SET(0, _H)); break;
+      case set0_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = SET(0, _L)); break;
+      case set0_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, SET(0, b)); } break;
+      case set1_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = SET(1, _A)); break;
+      case set1_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = SET(1, _B)); break;
+      case set1_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = SET(1, _C)); break;
+      case set1_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = SET(1, _D)); break;
+      case set1_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = SET(1, _E)); break;
+      case set1_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = SET(1, _H)); break;
+      case set1_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = SET(1, _L)); break;
+      case set1_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, SET(1, b)); } break;
+      case set2_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = SET(2, _A)); break;
+      case set2_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = SET(2, _B)); break;
+      case set2_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = SET(2, _C)); break;
+      case set2_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = SET(2, _D)); break;
+      case set2_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = SET(2, _E)); break;
+      case set2_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = SET(2, _H)); break;
+      case set2_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = SET(2, _L)); break;
+      case set2_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, SET(2, b)); } break;
+      case set3_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = SET(3, _A)); break;
+      case set3_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = SET(3, _B)); break;
+      case set3_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = SET(3, _C)); break;
+      case set3_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = SET(3, _D)); break;
+      case set3_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = SET(3, _E)); break;
+      case set3_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = SET(3, _H)); break;
+      case set3_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = SET(3, _L)); break;
+      case set3_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, SET(3, b)); } break;
+      case set4_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = SET(4, _A)); break;
+      case set4_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = SET(4, _B)); break;
+      case set4_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = SET(4, _C)); break;
+      case set4_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = SET(4, _D)); break;
+      case set4_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = SET(4, _E)); break;
+      case set4_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = SET(4, _H)); break;
+      case set4_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = SET(4, _L)); break;
+      case set4_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, SET(4, b)); } break;
+      case set5_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = SET(5, _A)); break;
+      case set5_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = SET(5, _B)); break;
+      case set5_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = SET(5, _C)); break;
+      case set5_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = SET(5, _D)); break;
+      case set5_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = SET(5, _E)); break;
+      case set5_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = SET(5, _H)); break;
+      case set5_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = SET(5, _L)); break;
+      case set5_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, SET(5, b)); } break;
+      case set6_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = SET(6, _A)); break;
+      case set6_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = SET(6, _B)); break;
+      case set6_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = SET(6, _C)); break;
+      case set6_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = SET(6, _D)); break;
+      case set6_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = SET(6, _E)); break;
+      case set6_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = SET(6, _H)); break;
+      case set6_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = SET(6, _L)); break;
+      case set6_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, SET(6, b)); } break;
+      case set7_a:      _A = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _A = SET(7, _A)); break;
+      case set7_b:      _B = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _B = SET(7, _B)); break;
+      case set7_c:      _C = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _C = SET(7, _C)); break;
+      case set7_d:      _D = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _D = SET(7, _D)); break;
+      case set7_e:      _E = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _E = SET(7, _E)); break;
+      case set7_h:      _H = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _H = SET(7, _H)); break;
+      case set7_l:      _L = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, _L = SET(7, _L)); break;
+      case set7_mhl:    { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, SET(7, b)); } break;
+      case sla_a:       _A = read_mem<Debug>(_IR+o); _A = SLA(_A); write_mem<Debug>(_IR+o, _A); break;
+      case sla_b:       _B = read_mem<Debug>(_IR+o); _B = SLA(_B); write_mem<Debug>(_IR+o, _B); break;
+      case sla_c:       _C = read_mem<Debug>(_IR+o); _C = SLA(_C); write_mem<Debug>(_IR+o, _C); break;
+      case sla_d:       _D = read_mem<Debug>(_IR+o); _D = SLA(_D); write_mem<Debug>(_IR+o, _D); break;
+      case sla_e:       _E = read_mem<Debug>(_IR+o); _E = SLA(_E); write_mem<Debug>(_IR+o, _E); break;
+      case sla_h:       _H = read_mem<Debug>(_IR+o); _H = SLA(_H); write_mem<Debug>(_IR+o, _H); break;
+      case sla_l:       _L = read_mem<Debug>(_IR+o); _L = SLA(_L); write_mem<Debug>(_IR+o, _L); break;
+      case sla_mhl:     { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, SLA(b)); } break;
+      case sll_a:       _A = read_mem<Debug>(_IR+o); _A = SLL(_A); write_mem<Debug>(_IR+o, _A); break;
+      case sll_b:       _B = read_mem<Debug>(_IR+o); _B = SLL(_B); write_mem<Debug>(_IR+o, _B); break;
+      case sll_c:       _C = read_mem<Debug>(_IR+o); _C = SLL(_C); write_mem<Debug>(_IR+o, _C); break;
+      case sll_d:       _D = read_mem<Debug>(_IR+o); _D = SLL(_D); write_mem<Debug>(_IR+o, _D); break;
+      case sll_e:       _E = read_mem<Debug>(_IR+o); _E = SLL(_E); write_mem<Debug>(_IR+o, _E); break;
+      case sll_h:       _H = read_mem<Debug>(_IR+o); _H = SLL(_H); write_mem<Debug>(_IR+o, _H); break;
+      case sll_l:       _L = read_mem<Debug>(_IR+o); _L = SLL(_L); write_mem<Debug>(_IR+o, _L); break;
+      case sll_mhl:     { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, SLL(b)); } break;
+      case sra_a:       _A = read_mem<Debug>(_IR+o); _A = SRA(_A); write_mem<Debug>(_IR+o, _A); break;
+      case sra_b:       _B = read_mem<Debug>(_IR+o); _B = SRA(_B); write_mem<Debug>(_IR+o, _B); break;
+      case sra_c:       _C = read_mem<Debug>(_IR+o); _C = SRA(_C); write_mem<Debug>(_IR+o, _C); break;
+      case sra_d:       _D = read_mem<Debug>(_IR+o); _D = SRA(_D); write_mem<Debug>(_IR+o, _D); break;
+      case sra_e:       _E = read_mem<Debug>(_IR+o); _E = SRA(_E); write_mem<Debug>(_IR+o, _E); break;
+      case sra_h:       _H = read_mem<Debug>(_IR+o); _H = SRA(_H); write_mem<Debug>(_IR+o, _H); break;
+      case sra_l:       _L = read_mem<Debug>(_IR+o); _L = SRA(_L); write_mem<Debug>(_IR+o, _L); break;
+      case sra_mhl:     { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, SRA(b)); } break;
+      case srl_a:       _A = read_mem<Debug>(_IR+o); _A = SRL(_A); write_mem<Debug>(_IR+o, _A); break;
+      case srl_b:       _B = read_mem<Debug>(_IR+o); _B = SRL(_B); write_mem<Debug>(_IR+o, _B); break;
+      case srl_c:       _C = read_mem<Debug>(_IR+o); _C = SRL(_C); write_mem<Debug>(_IR+o, _C); break;
+      case srl_d:       _D = read_mem<Debug>(_IR+o); _D = SRL(_D); write_mem<Debug>(_IR+o, _D); break;
+      case srl_e:       _E = read_mem<Debug>(_IR+o); _E = SRL(_E); write_mem<Debug>(_IR+o, _E); break;
+      case srl_h:       _H = read_mem<Debug>(_IR+o); _H = SRL(_H); write_mem<Debug>(_IR+o, _H); break;
+      case srl_l:       _L = read_mem<Debug>(_IR+o); _L = SRL(_L); write_mem<Debug>(_IR+o, _L); break;
+      case srl_mhl:     { byte b = read_mem<Debug>(_IR+o); write_mem<Debug>(_IR+o, SRL(b)); } break;
    }
 }
 
 
 
+template<bool Debug>
 void z80_execute_pfx_ed_instruction()
 {
    byte bOpCode;
 
-   bOpCode = read_mem(_PC++);
+   bOpCode = read_mem<Debug>(_PC++);
    iCycleCount += cc_ed[bOpCode];
    _R++;
    switch(bOpCode)
@@ -2204,9 +2496,9 @@ void z80_execute_pfx_ed_instruction()
       case adc_hl_hl:   ADC16(HL); break;
       case adc_hl_sp:   ADC16(SP); break;
       case cpd:         CPD; break;
-      case cpdr:        CPDR; break;
+      case cpdr:        if (!Debug) z80_block_bulk<-1, true>(bOpCode); CPDR; break;
       case cpi:         CPI; break;
-      case cpir:        CPIR; break;
+      case cpir:        if (!Debug) z80_block_bulk<1, true>(bOpCode); CPIR; break;
       case ed_00:       break;
       case ed_01:       break;
       case ed_02:       break;
@@ -2397,28 +2689,28 @@ void z80_execute_pfx_ed_instruction()
       case indr:        { z80_wait_states iCycleCount = Iy_;} INDR; break;
       case ini:         { z80_wait_states iCycleCount = Iy_;} INI; break;
       case inir:        { z80_wait_states iCycleCount = Iy_;} INIR; break;
-      case in_0_c:      { z80_wait_states iCycleCount = Ix_;} { byte res = z80_IN_handler(z80.BC); _F = (_F & Cflag) | SZP[res]; } break;
-      case in_a_c:      { z80_wait_states iCycleCount = Ix_;} _A = z80_IN_handler(z80.BC); _F = (_F & Cflag) | SZP[_A]; break;
-      case in_b_c:      { z80_wait_states iCycleCount = Ix_;} _B = z80_IN_handler(z80.BC); _F = (_F & Cflag) | SZP[_B]; break;
-      case in_c_c:      { z80_wait_states iCycleCount = Ix_;} _C = z80_IN_handler(z80.BC); _F = (_F & Cflag) | SZP[_C]; break;
-      case in_d_c:      { z80_wait_states iCycleCount = Ix_;} _D = z80_IN_handler(z80.BC); _F = (_F & Cflag) | SZP[_D]; break;
-      case in_e_c:      { z80_wait_states iCycleCount = Ix_;} _E = z80_IN_handler(z80.BC); _F = (_F & Cflag) | SZP[_E]; break;
-      case in_h_c:      { z80_wait_states iCycleCount = Ix_;} _H = z80_IN_handler(z80.BC); _F = (_F & Cflag) | SZP[_H]; break;
-      case in_l_c:      { z80_wait_states iCycleCount = Ix_;} _L = z80_IN_handler(z80.BC); _F = (_F & Cflag) | SZP[_L]; break;
+      case in_0_c:      { z80_wait_states iCycleCount = Ix_;} { byte res = z80_IN(z80.BC); z80_set_flags(z80_carry() | SZP[res]); } break;
+      case in_a_c:      { z80_wait_states iCycleCount = Ix_;} _A = z80_IN(z80.BC); z80_set_flags(z80_carry() | SZP[_A]); break;
+      case in_b_c:      { z80_wait_states iCycleCount = Ix_;} _B = z80_IN(z80.BC); z80_set_flags(z80_carry() | SZP[_B]); break;
+      case in_c_c:      { z80_wait_states iCycleCount = Ix_;} _C = z80_IN(z80.BC); z80_set_flags(z80_carry() | SZP[_C]); break;
+      case in_d_c:      { z80_wait_states iCycleCount = Ix_;} _D = z80_IN(z80.BC); z80_set_flags(z80_carry() | SZP[_D]); break;
+      case in_e_c:      { z80_wait_states iCycleCount = Ix_;} _E = z80_IN(z80.BC); z80_set_flags(z80_carry() | SZP[_E]); break;
+      case in_h_c:      { z80_wait_states iCycleCount = Ix_;} _H = z80_IN(z80.BC); z80_set_flags(z80_carry() | SZP[_H]); break;
+      case in_l_c:      { z80_wait_states iCycleCount = Ix_;} _L = z80_IN(z80.BC); z80_set_flags(z80_carry() | SZP[_L]); break;
       case ldd:         LDD; iWSAdjust++; break;
-      case lddr:        LDDR; iWSAdjust++; break;
+      case lddr:        if (!Debug) z80_block_bulk<-1, false>(bOpCode); LDDR; iWSAdjust++; break;
       case ldi:         LDI; iWSAdjust++; break;
-      case ldir:        LDIR; iWSAdjust++; break;
-      case ld_a_i:      _A = _I; _F = (_F & Cflag) | SZ[_A] | _IFF2; iWSAdjust++; break;
-      case ld_a_r:      _A = (_R & 0x7f) | _Rb7; _F = (_F & Cflag) | SZ[_A] | _IFF2; iWSAdjust++; break;
-      case ld_EDbc_mword:  LD16_MEM(BC); break;
-      case ld_EDde_mword:  LD16_MEM(DE); break;
-      case ld_EDhl_mword:  LD16_MEM(HL); break;
-      case ld_EDmword_bc:  LDMEM_16(BC); break;
-      case ld_EDmword_de:  LDMEM_16(DE); break;
-      case ld_EDmword_hl:  LDMEM_16(HL); break;
-      case ld_EDmword_sp:  LDMEM_16(SP); break;
-      case ld_EDsp_mword:  LD16_MEM(SP); break;
+      case ldir:        if (!Debug) z80_block_bulk<1, false>(bOpCode); LDIR; iWSAdjust++; break;
+      case ld_a_i:      _A = _I; z80_set_flags(z80_carry() | SZ[_A] | _IFF2); iWSAdjust++; break;
+      case ld_a_r:      _A = (_R & 0x7f) | _Rb7; z80_set_flags(z80_carry() | SZ[_A] | _IFF2); iWSAdjust++; break;
+      case ld_EDbc_mword:  LD16_MEM(z80.BC); break;
+      case ld_EDde_mword:  LD16_MEM(z80.DE); break;
+      case ld_EDhl_mword:  LD16_MEM(z80.HL); break;
+      case ld_EDmword_bc:  LDMEM_16(z80.BC); break;
+      case ld_EDmword_de:  LDMEM_16(z80.DE); break;
+      case ld_EDmword_hl:  LDMEM_16(z80.HL); break;
+      case ld_EDmword_sp:  LDMEM_16(z80.SP); break;
+      case ld_EDsp_mword:  LD16_MEM(z80.SP); break;
       case ld_i_a:      _I = _A; iWSAdjust++; break;
       case ld_r_a:      _R = _A; _Rb7 = _A & 0x80; iWSAdjust++; break;
       case neg:         NEG; break;
@@ -2433,14 +2725,14 @@ void z80_execute_pfx_ed_instruction()
       case otir:        { z80_wait_states iCycleCount = Oy_;} OTIR; break;
       case outd:        { z80_wait_states iCycleCount = Oy_;} OUTD; break;
       case outi:        { z80_wait_states iCycleCount = Oy_;} OUTI; break;
-      case out_c_0:     { z80_wait_states iCycleCount = Ox_;} z80_OUT_handler(z80.BC, 0); break;
-      case out_c_a:     { z80_wait_states iCycleCount = Ox_;} z80_OUT_handler(z80.BC, _A); break;
-      case out_c_b:     { z80_wait_states iCycleCount = Ox_;} z80_OUT_handler(z80.BC, _B); break;
-      case out_c_c:     { z80_wait_states iCycleCount = Ox_;} z80_OUT_handler(z80.BC, _C); break;
-      case out_c_d:     { z80_wait_states iCycleCount = Ox_;} z80_OUT_handler(z80.BC, _D); break;
-      case out_c_e:     { z80_wait_states iCycleCount = Ox_;} z80_OUT_handler(z80.BC, _E); break;
-      case out_c_h:     { z80_wait_states iCycleCount = Ox_;} z80_OUT_handler(z80.BC, _H); break;
-      case out_c_l:     { z80_wait_states iCycleCount = Ox_;} z80_OUT_handler(z80.BC, _L); break;
+      case out_c_0:     { z80_wait_states iCycleCount = Ox_;} z80_OUT(z80.BC, 0); break;
+      case out_c_a:     { z80_wait_states iCycleCount = Ox_;} z80_OUT(z80.BC, _A); break;
+      case out_c_b:     { z80_wait_states iCycleCount = Ox_;} z80_OUT(z80.BC, _B); break;
+      case out_c_c:     { z80_wait_states iCycleCount = Ox_;} z80_OUT(z80.BC, _C); break;
+      case out_c_d:     { z80_wait_states iCycleCount = Ox_;} z80_OUT(z80.BC, _D); break;
+      case out_c_e:     { z80_wait_states iCycleCount = Ox_;} z80_OUT(z80.BC, _E); break;
+      case out_c_h:     { z80_wait_states iCycleCount = Ox_;} z80_OUT(z80.BC, _H); break;
+      case out_c_l:     { z80_wait_states iCycleCount = Ox_;} z80_OUT(z80.BC, _L); break;
       case reti:        _IFF1 = _IFF2; RET; break;
       case reti_1:      _IFF1 = _IFF2; RET; break;
       case reti_2:      _IFF1 = _IFF2; RET; break;
@@ -2460,541 +2752,44 @@ void z80_execute_pfx_ed_instruction()
 
 
 
-void z80_execute_pfx_fd_instruction()
+void z80_execute_instruction()
 {
-   byte bOpCode;
+   z80_execute_instruction<true>();
+   z80_resolve_flags();
+}
 
-   bOpCode = read_mem(_PC++);
-   iCycleCount += cc_xy[bOpCode];
-   _R++;
-   switch(bOpCode)
-   {
-      case adc_a:       ADC(_A); break;
-      case adc_b:       ADC(_B); break;
-      case adc_byte:    ADC(read_mem(_PC++)); break;
-      case adc_c:       ADC(_C); break;
-      case adc_d:       ADC(_D); break;
-      case adc_e:       ADC(_E); break;
-      case adc_h:       ADC(_IYh); break;
-      case adc_l:       ADC(_IYl); break;
-      case adc_mhl:     { signed char o = read_mem(_PC++); ADC(read_mem(_IY+o)); } break;
-      case add_a:       ADD(_A); break;
-      case add_b:       ADD(_B); break;
-      case add_byte:    ADD(read_mem(_PC++)); break;
-      case add_c:       ADD(_C); break;
-      case add_d:       ADD(_D); break;
-      case add_e:       ADD(_E); break;
-      case add_h:       ADD(_IYh); break;
-      case add_hl_bc:   ADD16(IY, BC); break;
-      case add_hl_de:   ADD16(IY, DE); break;
-      case add_hl_hl:   ADD16(IY, IY); break;
-      case add_hl_sp:   ADD16(IY, SP); break;
-      case add_l:       ADD(_IYl); break;
-      case add_mhl:     { signed char o = read_mem(_PC++); ADD(read_mem(_IY+o)); } break;
-      case and_a:       AND(_A); break;
-      case and_b:       AND(_B); break;
-      case and_byte:    AND(read_mem(_PC++)); break;
-      case and_c:       AND(_C); break;
-      case and_d:       AND(_D); break;
-      case and_e:       AND(_E); break;
-      case and_h:       AND(_IYh); break;
-      case and_l:       AND(_IYl); break;
-      case and_mhl:     { signed char o = read_mem(_PC++); AND(read_mem(_IY+o)); } break;
-      case call:        CALL; break;
-      case call_c:      if (_F & Cflag) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
-      case call_m:      if (_F & Sflag) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
-      case call_nc:     if (!(_F & Cflag)) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
-      case call_nz:     if (!(_F & Zflag)) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
-      case call_p:      if (!(_F & Sflag)) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
-      case call_pe:     if (_F & Pflag) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
-      case call_po:     if (!(_F & Pflag)) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
-      case call_z:      if (_F & Zflag) { iCycleCount += cc_ex[bOpCode]; CALL } else { _PC += 2; } break;
-      case ccf:         _F = ((_F & (Sflag | Zflag | Pflag | Cflag)) | ((_F & CF) << 4) | (_A & Xflags)) ^ CF; break;
-      case cpl:         _A ^= 0xff; _F = (_F & (Sflag | Zflag | Pflag | Cflag)) | Hflag | Nflag | (_A & Xflags); break;
-      case cp_a:        CP(_A); break;
-      case cp_b:        CP(_B); break;
-      case cp_byte:     CP(read_mem(_PC++)); break;
-      case cp_c:        CP(_C); break;
-      case cp_d:        CP(_D); break;
-      case cp_e:        CP(_E); break;
-      case cp_h:        CP(_IYh); break;
-      case cp_l:        CP(_IYl); break;
-      case cp_mhl:      { signed char o = read_mem(_PC++); CP(read_mem(_IY+o)); } break;
-      case daa:         DAA; break;
-      case dec_a:       DEC(_A); break;
-      case dec_b:       DEC(_B); break;
-      case dec_bc:      _BC--; iWSAdjust++; break;
-      case dec_c:       DEC(_C); break;
-      case dec_d:       DEC(_D); break;
-      case dec_de:      _DE--; iWSAdjust++; break;
-      case dec_e:       DEC(_E); break;
-      case dec_h:       DEC(_IYh); break;
-      case dec_hl:      _IY--; iWSAdjust++; break;
-      case dec_l:       DEC(_IYl); break;
-      case dec_mhl:     { signed char o = read_mem(_PC++); byte b = read_mem(_IY+o); DEC(b); write_mem(_IY+o, b); } break;
-      case dec_sp:      _SP--; iWSAdjust++; break;
-      case di:          _IFF1 = _IFF2 = 0; z80.EI_issued = 0; break;
-      case djnz:        if (--_B) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; } break;
-      case ei:          z80.EI_issued = 2; break;
-      case exx:         EXX; break;
-      case ex_af_af:    EX(z80.AF, z80.AFx); break;
-      case ex_de_hl:    EX(z80.DE, z80.HL); break;
-      case ex_msp_hl:   EX_SP(IY); iWSAdjust++; break;
-      case halt:        _HALT = 1; _PC--; break;
-      case ina:         { z80_wait_states iCycleCount = Ia_;} { reg_pair p; p.b.l = read_mem(_PC++); p.b.h = _A; _A = z80_IN_handler(p); } break;
-      case inc_a:       INC(_A); break;
-      case inc_b:       INC(_B); break;
-      case inc_bc:      _BC++; iWSAdjust++; break;
-      case inc_c:       INC(_C); break;
-      case inc_d:       INC(_D); break;
-      case inc_de:      _DE++; iWSAdjust++; break;
-      case inc_e:       INC(_E); break;
-      case inc_h:       INC(_IYh); break;
-      case inc_hl:      _IY++; iWSAdjust++; break;
-      case inc_l:       INC(_IYl); break;
-      case inc_mhl:     { signed char o = read_mem(_PC++); byte b = read_mem(_IY+o); INC(b); write_mem(_IY+o, b); } break;
-      case inc_sp:      _SP++; iWSAdjust++; break;
-      case jp:          JP; break;
-      case jp_c:        if (_F & Cflag) { JP } else { _PC += 2; }; break;
-      case jp_m:        if (_F & Sflag) { JP } else { _PC += 2; }; break;
-      case jp_nc:       if (!(_F & Cflag)) { JP } else { _PC += 2; }; break;
-      case jp_nz:       if (!(_F & Zflag)) { JP } else { _PC += 2; }; break;
-      case jp_p:        if (!(_F & Sflag)) { JP } else { _PC += 2; }; break;
-      case jp_pe:       if (_F & Pflag) { JP } else { _PC += 2; }; break;
-      case jp_po:       if (!(_F & Pflag)) { JP } else { _PC += 2; }; break;
-      case jp_z:        if (_F & Zflag) { JP } else { _PC += 2; }; break;
-      case jr:          JR; break;
-      case jr_c:        if (_F & Cflag) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
-      case jr_nc:       if (!(_F & Cflag)) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
-      case jr_nz:       if (!(_F & Zflag)) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
-      case jr_z:        if (_F & Zflag) { iCycleCount += cc_ex[bOpCode]; JR } else { _PC++; }; break;
-      case ld_a_a:      break;
-      case ld_a_b:      _A = _B; break;
-      case ld_a_byte:   _A = read_mem(_PC++); break;
-      case ld_a_c:      _A = _C; break;
-      case ld_a_d:      _A = _D; break;
-      case ld_a_e:      _A = _E; break;
-      case ld_a_h:      _A = _IYh; break;
-      case ld_a_l:      _A = _IYl; break;
-      case ld_a_mbc:    _A = read_mem(_BC); break;
-      case ld_a_mde:    _A = read_mem(_DE); break;
-      case ld_a_mhl:    { signed char o = read_mem(_PC++); _A = read_mem(_IY+o); } break;
-      case ld_a_mword:  { reg_pair addr; addr.b.l = read_mem(_PC++); addr.b.h = read_mem(_PC++); _A = read_mem(addr.w.l); } break;
-      case ld_bc_word:  z80.BC.b.l = read_mem(_PC++); z80.BC.b.h = read_mem(_PC++); break;
-      case ld_b_a:      _B = _A; break;
-      case ld_b_b:      break;
-      case ld_b_byte:   _B = read_mem(_PC++); break;
-      case ld_b_c:      _B = _C; break;
-      case ld_b_d:      _B = _D; break;
-      case ld_b_e:      _B = _E; break;
-      case ld_b_h:      _B = _IYh; break;
-      case ld_b_l:      _B = _IYl; break;
-      case ld_b_mhl:    { signed char o = read_mem(_PC++); _B = read_mem(_IY+o); } break;
-      case ld_c_a:      _C = _A; break;
-      case ld_c_b:      _C = _B; break;
-      case ld_c_byte:   _C = read_mem(_PC++); break;
-      case ld_c_c:      break;
-      case ld_c_d:      _C = _D; break;
-      case ld_c_e:      _C = _E; break;
-      case ld_c_h:      _C = _IYh; break;
-      case ld_c_l:      _C = _IYl; break;
-      case ld_c_mhl:    { signed char o = read_mem(_PC++); _C = read_mem(_IY+o); } break;
-      case ld_de_word:  z80.DE.b.l = read_mem(_PC++); z80.DE.b.h = read_mem(_PC++); break;
-      case ld_d_a:      _D = _A; break;
-      case ld_d_b:      _D = _B; break;
-      case ld_d_byte:   _D = read_mem(_PC++); break;
-      case ld_d_c:      _D = _C; break;
-      case ld_d_d:      break;
-      case ld_d_e:      _D = _E; break;
-      case ld_d_h:      _D = _IYh; break;
-      case ld_d_l:      _D = _IYl; break;
-      case ld_d_mhl:    { signed char o = read_mem(_PC++); _D = read_mem(_IY+o); } break;
-      case ld_e_a:      _E = _A; break;
-      case ld_e_b:      _E = _B; break;
-      case ld_e_byte:   _E = read_mem(_PC++); break;
-      case ld_e_c:      _E = _C; break;
-      case ld_e_d:      _E = _D; break;
-      case ld_e_e:      break;
-      case ld_e_h:      _E = _IYh; break;
-      case ld_e_l:      _E = _IYl; break;
-      case ld_e_mhl:    { signed char o = read_mem(_PC++); _E = read_mem(_IY+o); } break;
-      case ld_hl_mword: LD16_MEM(IY); break;
-      case ld_hl_word:  z80.IY.b.l = read_mem(_PC++); z80.IY.b.h = read_mem(_PC++); break;
-      case ld_h_a:      _IYh = _A; break;
-      case ld_h_b:      _IYh = _B; break;
-      case ld_h_byte:   _IYh = read_mem(_PC++); break;
-      case ld_h_c:      _IYh = _C; break;
-      case ld_h_d:      _IYh = _D; break;
-      case ld_h_e:      _IYh = _E; break;
-      case ld_h_h:      break;
-      case ld_h_l:      _IYh = _IYl; break;
-      case ld_h_mhl:    { signed char o = read_mem(_PC++); _H = read_mem(_IY+o); } break;
-      case ld_l_a:      _IYl = _A; break;
-      case ld_l_b:      _IYl = _B; break;
-      case ld_l_byte:   _IYl = read_mem(_PC++); break;
-      case ld_l_c:      _IYl = _C; break;
-      case ld_l_d:      _IYl = _D; break;
-      case ld_l_e:      _IYl = _E; break;
-      case ld_l_h:      _IYl = _IYh; break;
-      case ld_l_l:      break;
-      case ld_l_mhl:    { signed char o = read_mem(_PC++); _L = read_mem(_IY+o); } break;
-      case ld_mbc_a:    write_mem(_BC, _A); break;
-      case ld_mde_a:    write_mem(_DE, _A); break;
-      case ld_mhl_a:    { signed char o = read_mem(_PC++); write_mem(_IY+o, _A); } break;
-      case ld_mhl_b:    { signed char o = read_mem(_PC++); write_mem(_IY+o, _B); } break;
-      case ld_mhl_byte: { signed char o = read_mem(_PC++); byte b = read_mem(_PC++); write_mem(_IY+o, b); } break;
-      case ld_mhl_c:    { signed char o = read_mem(_PC++); write_mem(_IY+o, _C); } break;
-      case ld_mhl_d:    { signed char o = read_mem(_PC++); write_mem(_IY+o, _D); } break;
-      case ld_mhl_e:    { signed char o = read_mem(_PC++); write_mem(_IY+o, _E); } break;
-      case ld_mhl_h:    { signed char o = read_mem(_PC++); write_mem(_IY+o, _H); } break;
-      case ld_mhl_l:    { signed char o = read_mem(_PC++); write_mem(_IY+o, _L); } break;
-      case ld_mword_a:  { reg_pair addr; addr.b.l = read_mem(_PC++); addr.b.h = read_mem(_PC++); write_mem(addr.w.l, _A); } break;
-      case ld_mword_hl: LDMEM_16(IY); break;
-      case ld_pc_hl:    _PC = _IY; break;
-      case ld_sp_hl:    _SP = _IY; iWSAdjust++; break;
-      case ld_sp_word:  z80.SP.b.l = read_mem(_PC++); z80.SP.b.h = read_mem(_PC++); break;
-      case nop:         break;
-      case or_a:        OR(_A); break;
-      case or_b:        OR(_B); break;
-      case or_byte:     OR(read_mem(_PC++)); break;
-      case or_c:        OR(_C); break;
-      case or_d:        OR(_D); break;
-      case or_e:        OR(_E); break;
-      case or_h:        OR(_IYh); break;
-      case or_l:        OR(_IYl); break;
-      case or_mhl:      { signed char o = read_mem(_PC++); OR(read_mem(_IY+o)); } break;
-      case outa:        { z80_wait_states iCycleCount = Oa_;} { reg_pair p; p.b.l = read_mem(_PC++); p.b.h = _A; z80_OUT_handler(p, _A); } break;
-      case pfx_cb:      z80_execute_pfx_fdcb_instruction(); break;
-      case pfx_dd:      z80_execute_pfx_dd_instruction(); break;
-      case pfx_ed:      z80_execute_pfx_ed_instruction(); break;
-      case pfx_fd:      z80_execute_pfx_fd_instruction(); break;
-      case pop_af:      POP(AF); break;
-      case pop_bc:      POP(BC); break;
-      case pop_de:      POP(DE); break;
-      case pop_hl:      POP(IY); break;
-      case push_af:     PUSH(AF); break;
-      case push_bc:     PUSH(BC); break;
-      case push_de:     PUSH(DE); break;
-      case push_hl:     PUSH(IY); break;
-      case ret:         RET; break;
-      case ret_c:       if (_F & Cflag) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
-      case ret_m:       if (_F & Sflag) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
-      case ret_nc:      if (!(_F & Cflag)) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
-      case ret_nz:      if (!(_F & Zflag)) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
-      case ret_p:       if (!(_F & Sflag)) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
-      case ret_pe:      if (_F & Pflag) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
-      case ret_po:      if (!(_F & Pflag)) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
-      case ret_z:       if (_F & Zflag) { iCycleCount += cc_ex[bOpCode]; RET } else { iWSAdjust++; } ; break;
-      case rla:         RLA; break;
-      case rlca:        RLCA; break;
-      case rra:         RRA; break;
-      case rrca:        RRCA; break;
-      case rst00:       RST(0x0000); break;
-      case rst08:       RST(0x0008); break;
-      case rst10:       RST(0x0010); break;
-      case rst18:       RST(0x0018); break;
-      case rst20:       RST(0x0020); break;
-      case rst28:       RST(0x0028); break;
-      case rst30:       RST(0x0030); break;
-      case rst38:       RST(0x0038); break;
-      case sbc_a:       SBC(_A); break;
-      case sbc_b:       SBC(_B); break;
-      case sbc_byte:    SBC(read_mem(_PC++)); break;
-      case sbc_c:       SBC(_C); break;
-      case sbc_d:       SBC(_D); break;
-      case sbc_e:       SBC(_E); break;
-      case sbc_h:       SBC(_IYh); break;
-      case sbc_l:       SBC(_IYl); break;
-      case sbc_mhl:     { signed char o = read_mem(_PC++); SBC(read_mem(_IY+o)); } break;
-      case scf:         _F = (_F & (Sflag | Zflag | Pflag)) | Cflag | (_A & Xflags); break;
-      case sub_a:       SUB(_A); break;
-      case sub_b:       SUB(_B); break;
-      case sub_byte:    SUB(read_mem(_PC++)); break;
-      case sub_c:       SUB(_C); break;
-      case sub_d:       SUB(_D); break;
-      case sub_e:       SUB(_E); break;
-      case sub_h:       SUB(_IYh); break;
-      case sub_l:       SUB(_IYl); break;
-      case sub_mhl:     { signed char o = read_mem(_PC++); SUB(read_mem(_IY+o)); } break;
-      case xor_a:       XOR(_A); break;
-      case xor_b:       XOR(_B); break;
-      case xor_byte:    XOR(read_mem(_PC++)); break;
-      case xor_c:       XOR(_C); break;
-      case xor_d:       XOR(_D); break;
-      case xor_e:       XOR(_E); break;
-      case xor_h:       XOR(_IYh); break;
-      case xor_l:       XOR(_IYl); break;
-      case xor_mhl:     { signed char o = read_mem(_PC++); XOR(read_mem(_IY+o)); } break;
-   }
+void z80_execute_pfx_cb_instruction()
+{
+   z80_execute_pfx_cb_instruction<true>();
+   z80_resolve_flags();
 }
 
+void z80_execute_pfx_dd_instruction()
+{
+   z80_execute_pfx_xy_instruction<true, &t_z80regs::IX>();
+   z80_resolve_flags();
+}
 
+void z80_execute_pfx_ddcb_instruction()
+{
+   z80_execute_pfx_xycb_instruction<true, &t_z80regs::IX>();
+   z80_resolve_flags();
+}
 
-void z80_execute_pfx_fdcb_instruction()
+void z80_execute_pfx_ed_instruction()
 {
-   signed char o;
-   byte bOpCode;
+   z80_execute_pfx_ed_instruction<true>();
+   z80_resolve_flags();
+}
 
-   o = read_mem(_PC++); // offset
-   bOpCode = read_mem(_PC++);
-   iCycleCount += cc_xycb[bOpCode];
-   switch(bOpCode)
-   {
-      case bit0_a:      BIT_XY(0, read_mem(_IY+o)); break;
-      case bit0_b:      BIT_XY(0, read_mem(_IY+o)); break;
-      case bit0_c:      BIT_XY(0, read_mem(_IY+o)); break;
-      case bit0_d:      BIT_XY(0, read_mem(_IY+o)); break;
-      case bit0_e:      BIT_XY(0, read_mem(_IY+o)); break;
-      case bit0_h:      BIT_XY(0, read_mem(_IY+o)); break;
-      case bit0_l:      BIT_XY(0, read_mem(_IY+o)); break;
-      case bit0_mhl:    BIT_XY(0, read_mem(_IY+o)); break;
-      case bit1_a:      BIT_XY(1, read_mem(_IY+o)); break;
-      case bit1_b:      BIT_XY(1, read_mem(_IY+o)); break;
-      case bit1_c:      BIT_XY(1, read_mem(_IY+o)); break;
-      case bit1_d:      BIT_XY(1, read_mem(_IY+o)); break;
-      case bit1_e:      BIT_XY(1, read_mem(_IY+o)); break;
-      case bit1_h:      BIT_XY(1, read_mem(_IY+o)); break;
-      case bit1_l:      BIT_XY(1, read_mem(_IY+o)); break;
-      case bit1_mhl:    BIT_XY(1, read_mem(_IY+o)); break;
-      case bit2_a:      BIT_XY(2, read_mem(_IY+o)); break;
-      case bit2_b:      BIT_XY(2, read_mem(_IY+o)); break;
-      case bit2_c:      BIT_XY(2, read_mem(_IY+o)); break;
-      case bit2_d:      BIT_XY(2, read_mem(_IY+o)); break;
-      case bit2_e:      BIT_XY(2, read_mem(_IY+o)); break;
-      case bit2_h:      BIT_XY(2, read_mem(_IY+o)); break;
-      case bit2_l:      BIT_XY(2, read_mem(_IY+o)); break;
-      case bit2_mhl:    BIT_XY(2, read_mem(_IY+o)); break;
-      case bit3_a:      BIT_XY(3, read_mem(_IY+o)); break;
-      case bit3_b:      BIT_XY(3, read_mem(_IY+o)); break;
-      case bit3_c:      BIT_XY(3, read_mem(_IY+o)); break;
-      case bit3_d:      BIT_XY(3, read_mem(_IY+o)); break;
-      case bit3_e:      BIT_XY(3, read_mem(_IY+o)); break;
-      case bit3_h:      BIT_XY(3, read_mem(_IY+o)); break;
-      case bit3_l:      BIT_XY(3, read_mem(_IY+o)); break;
-      case bit3_mhl:    BIT_XY(3, read_mem(_IY+o)); break;
-      case bit4_a:      BIT_XY(4, read_mem(_IY+o)); break;
-      case bit4_b:      BIT_XY(4, read_mem(_IY+o)); break;
-      case bit4_c:      BIT_XY(4, read_mem(_IY+o)); break;
-      case bit4_d:      BIT_XY(4, read_mem(_IY+o)); break;
-      case bit4_e:      BIT_XY(4, read_mem(_IY+o)); break;
-      case bit4_h:      BIT_XY(4, read_mem(_IY+o)); break;
-      case bit4_l:      BIT_XY(4, read_mem(_IY+o)); break;
-      case bit4_mhl:    BIT_XY(4, read_mem(_IY+o)); break;
-      case bit5_a:      BIT_XY(5, read_mem(_IY+o)); break;
-      case bit5_b:      BIT_XY(5, read_mem(_IY+o)); break;
-      case bit5_c:      BIT_XY(5, read_mem(_IY+o)); break;
-      case bit5_d:      BIT_XY(5, read_mem(_IY+o)); break;
-      case bit5_e:      BIT_XY(5, read_mem(_IY+o)); break;
-      case bit5_h:      BIT_XY(5, read_mem(_IY+o)); break;
-      case bit5_l:      BIT_XY(5, read_mem(_IY+o)); break;
-      case bit5_mhl:    BIT_XY(5, read_mem(_IY+o)); break;
-      case bit6_a:      BIT_XY(6, read_mem(_IY+o)); break;
-      case bit6_b:      BIT_XY(6, read_mem(_IY+o)); break;
-      case bit6_c:      BIT_XY(6, read_mem(_IY+o)); break;
-      case bit6_d:      BIT_XY(6, read_mem(_IY+o)); break;
-      case bit6_e:      BIT_XY(6, read_mem(_IY+o)); break;
-      case bit6_h:      BIT_XY(6, read_mem(_IY+o)); break;
-      case bit6_l:      BIT_XY(6, read_mem(_IY+o)); break;
-      case bit6_mhl:    BIT_XY(6, read_mem(_IY+o)); break;
-      case bit7_a:      BIT_XY(7, read_mem(_IY+o)); break;
-      case bit7_b:      BIT_XY(7, read_mem(_IY+o)); break;
-      case bit7_c:      BIT_XY(7, read_mem(_IY+o)); break;
-      case bit7_d:      BIT_XY(7, read_mem(_IY+o)); break;
-      case bit7_e:      BIT_XY(7, read_mem(_IY+o)); break;
-      case bit7_h:      BIT_XY(7, read_mem(_IY+o)); break;
-      case bit7_l:      BIT_XY(7, read_mem(_IY+o)); break;
-      case bit7_mhl:    BIT_XY(7, read_mem(_IY+o)); break;
-      case res0_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = RES(0, _A)); break;
-      case res0_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = RES(0, _B)); break;
-      case res0_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = RES(0, _C)); break;
-      case res0_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = RES(0, _D)); break;
-      case res0_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = RES(0, _E)); break;
-      case res0_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = RES(0, _H)); break;
-      case res0_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = RES(0, _L)); break;
-      case res0_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, RES(0, b)); } break;
-      case res1_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = RES(1, _A)); break;
-      case res1_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = RES(1, _B)); break;
-      case res1_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = RES(1, _C)); break;
-      case res1_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = RES(1, _D)); break;
-      case res1_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = RES(1, _E)); break;
-      case res1_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = RES(1, _H)); break;
-      case res1_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = RES(1, _L)); break;
-      case res1_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, RES(1, b)); } break;
-      case res2_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = RES(2, _A)); break;
-      case res2_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = RES(2, _B)); break;
-      case res2_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = RES(2, _C)); break;
-      case res2_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = RES(2, _D)); break;
-      case res2_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = RES(2, _E)); break;
-      case res2_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = RES(2, _H)); break;
-      case res2_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = RES(2, _L)); break;
-      case res2_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, RES(2, b)); } break;
-      case res3_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = RES(3, _A)); break;
-      case res3_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = RES(3, _B)); break;
-      case res3_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = RES(3, _C)); break;
-      case res3_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = RES(3, _D)); break;
-      case res3_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = RES(3, _E)); break;
-      case res3_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = RES(3, _H)); break;
-      case res3_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = RES(3, _L)); break;
-      case res3_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, RES(3, b)); } break;
-      case res4_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = RES(4, _A)); break;
-      case res4_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = RES(4, _B)); break;
-      case res4_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = RES(4, _C)); break;
-      case res4_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = RES(4, _D)); break;
-      case res4_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = RES(4, _E)); break;
-      case res4_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = RES(4, _H)); break;
-      case res4_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = RES(4, _L)); break;
-      case res4_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, RES(4, b)); } break;
-      case res5_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = RES(5, _A)); break;
-      case res5_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = RES(5, _B)); break;
-      case res5_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = RES(5, _C)); break;
-      case res5_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = RES(5, _D)); break;
-      case res5_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = RES(5, _E)); break;
-      case res5_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = RES(5, _H)); break;
-      case res5_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = RES(5, _L)); break;
-      case res5_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, RES(5, b)); } break;
-      case res6_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = RES(6, _A)); break;
-      case res6_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = RES(6, _B)); break;
-      case res6_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = RES(6, _C)); break;
-      case res6_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = RES(6, _D)); break;
-      case res6_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = RES(6, _E)); break;
-      case res6_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = RES(6, _H)); break;
-      case res6_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = RES(6, _L)); break;
-      case res6_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, RES(6, b)); } break;
-      case res7_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = RES(7, _A)); break;
-      case res7_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = RES(7, _B)); break;
-      case res7_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = RES(7, _C)); break;
-      case res7_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = RES(7, _D)); break;
-      case res7_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = RES(7, _E)); break;
-      case res7_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = RES(7, _H)); break;
-      case res7_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = RES(7, _L)); break;
-      case res7_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, RES(7, b)); } break;
-      case rlc_a:       _A = read_mem(_IY+o); _A = RLC(_A); write_mem(_IY+o, _A); break;
-      case rlc_b:       _B = read_mem(_IY+o); _B = RLC(_B); write_mem(_IY+o, _B); break;
-      case rlc_c:       _C = read_mem(_IY+o); _C = RLC(_C); write_mem(_IY+o, _C); break;
-      case rlc_d:       _D = read_mem(_IY+o); _D = RLC(_D); write_mem(_IY+o, _D); break;
-      case rlc_e:       _E = read_mem(_IY+o); _E = RLC(_E); write_mem(_IY+o, _E); break;
-      case rlc_h:       _H = read_mem(_IY+o); _H = RLC(_H); write_mem(_IY+o, _H); break;
-      case rlc_l:       _L = read_mem(_IY+o); _L = RLC(_L); write_mem(_IY+o, _L); break;
-      case rlc_mhl:     { byte b = read_mem(_IY+o); write_mem(_IY+o, RLC(b)); } break;
-      case rl_a:        _A = read_mem(_IY+o); _A = RL(_A); write_mem(_IY+o, _A); break;
-      case rl_b:        _B = read_mem(_IY+o); _B = RL(_B); write_mem(_IY+o, _B); break;
-      case rl_c:        _C = read_mem(_IY+o); _C = RL(_C); write_mem(_IY+o, _C); break;
-      case rl_d:        _D = read_mem(_IY+o); _D = RL(_D); write_mem(_IY+o, _D); break;
-      case rl_e:        _E = read_mem(_IY+o); _E = RL(_E); write_mem(_IY+o, _E); break;
-      case rl_h:        _H = read_mem(_IY+o); _H = RL(_H); write_mem(_IY+o, _H); break;
-      case rl_l:        _L = read_mem(_IY+o); _L = RL(_L); write_mem(_IY+o, _L); break;
-      case rl_mhl:      { byte b = read_mem(_IY+o); write_mem(_IY+o, RL(b)); } break;
-      case rrc_a:       _A = read_mem(_IY+o); _A = RRC(_A); write_mem(_IY+o, _A); break;
-      case rrc_b:       _B = read_mem(_IY+o); _B = RRC(_B); write_mem(_IY+o, _B); break;
-      case rrc_c:       _C = read_mem(_IY+o); _C = RRC(_C); write_mem(_IY+o, _C); break;
-      case rrc_d:       _D = read_mem(_IY+o); _D = RRC(_D); write_mem(_IY+o, _D); break;
-      case rrc_e:       _E = read_mem(_IY+o); _E = RRC(_E); write_mem(_IY+o, _E); break;
-      case rrc_h:       _H = read_mem(_IY+o); _H = RRC(_H); write_mem(_IY+o, _H); break;
-      case rrc_l:       _L = read_mem(_IY+o); _L = RRC(_L); write_mem(_IY+o, _L); break;
-      case rrc_mhl:     { byte b = read_mem(_IY+o); write_mem(_IY+o, RRC(b)); } break;
-      case rr_a:        _A = read_mem(_IY+o); _A = RR(_A); write_mem(_IY+o, _A); break;
-      case rr_b:        _B = read_mem(_IY+o); _B = RR(_B); write_mem(_IY+o, _B); break;
-      case rr_c:        _C = read_mem(_IY+o); _C = RR(_C); write_mem(_IY+o, _C); break;
-      case rr_d:        _D = read_mem(_IY+o); _D = RR(_D); write_mem(_IY+o, _D); break;
-      case rr_e:        _E = read_mem(_IY+o); _E = RR(_E); write_mem(_IY+o, _E); break;
-      case rr_h:        _H = read_mem(_IY+o); _H = RR(_H); write_mem(_IY+o, _H); break;
-      case rr_l:        _L = read_mem(_IY+o); _L = RR(_L); write_mem(_IY+o, _L); break;
-      case rr_mhl:      { byte b = read_mem(_IY+o); write_mem(_IY+o, RR(b)); } break;
-      case set0_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = SET(0, _A)); break;
-      case set0_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = SET(0, _B)); break;
-      case set0_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = SET(0, _C)); break;
-      case set0_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = SET(0, _D)); break;
-      case set0_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = SET(0, _E)); break;
-      case set0_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = SET(0, _H)); break;
-      case set0_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = SET(0, _L)); break;
-      case set0_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, SET(0, b)); } break;
-      case set1_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = SET(1, _A)); break;
-      case set1_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = SET(1, _B)); break;
-      case set1_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = SET(1, _C)); break;
-      case set1_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = SET(1, _D)); break;
-      case set1_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = SET(1, _E)); break;
-      case set1_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = SET(1, _H)); break;
-      case set1_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = SET(1, _L)); break;
-      case set1_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, SET(1, b)); } break;
-      case set2_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = SET(2, _A)); break;
-      case set2_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = SET(2, _B)); break;
-      case set2_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = SET(2, _C)); break;
-      case set2_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = SET(2, _D)); break;
-      case set2_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = SET(2, _E)); break;
-      case set2_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = SET(2, _H)); break;
-      case set2_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = SET(2, _L)); break;
-      case set2_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, SET(2, b)); } break;
-      case set3_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = SET(3, _A)); break;
-      case set3_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = SET(3, _B)); break;
-      case set3_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = SET(3, _C)); break;
-      case set3_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = SET(3, _D)); break;
-      case set3_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = SET(3, _E)); break;
-      case set3_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = SET(3, _H)); break;
-      case set3_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = SET(3, _L)); break;
-      case set3_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, SET(3, b)); } break;
-      case set4_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = SET(4, _A)); break;
-      case set4_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = SET(4, _B)); break;
-      case set4_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = SET(4, _C)); break;
-      case set4_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = SET(4, _D)); break;
-      case set4_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = SET(4, _E)); break;
-      case set4_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = SET(4, _H)); break;
-      case set4_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = SET(4, _L)); break;
-      case set4_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, SET(4, b)); } break;
-      case set5_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = SET(5, _A)); break;
-      case set5_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = SET(5, _B)); break;
-      case set5_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = SET(5, _C)); break;
-      case set5_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = SET(5, _D)); break;
-      case set5_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = SET(5, _E)); break;
-      case set5_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = SET(5, _H)); break;
-      case set5_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = SET(5, _L)); break;
-      case set5_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, SET(5, b)); } break;
-      case set6_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = SET(6, _A)); break;
-      case set6_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = SET(6, _B)); break;
-      case set6_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = SET(6, _C)); break;
-      case set6_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = SET(6, _D)); break;
-      case set6_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = SET(6, _E)); break;
-      case set6_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = SET(6, _H)); break;
-      case set6_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = SET(6, _L)); break;
-      case set6_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, SET(6, b)); } break;
-      case set7_a:      _A = read_mem(_IY+o); write_mem(_IY+o, _A = SET(7, _A)); break;
-      case set7_b:      _B = read_mem(_IY+o); write_mem(_IY+o, _B = SET(7, _B)); break;
-      case set7_c:      _C = read_mem(_IY+o); write_mem(_IY+o, _C = SET(7, _C)); break;
-      case set7_d:      _D = read_mem(_IY+o); write_mem(_IY+o, _D = SET(7, _D)); break;
-      case set7_e:      _E = read_mem(_IY+o); write_mem(_IY+o, _E = SET(7, _E)); break;
-      case set7_h:      _H = read_mem(_IY+o); write_mem(_IY+o, _H = SET(7, _H)); break;
-      case set7_l:      _L = read_mem(_IY+o); write_mem(_IY+o, _L = SET(7, _L)); break;
-      case set7_mhl:    { byte b = read_mem(_IY+o); write_mem(_IY+o, SET(7, b)); } break;
-      case sla_a:       _A = read_mem(_IY+o); _A = SLA(_A); write_mem(_IY+o, _A); break;
-      case sla_b:       _B = read_mem(_IY+o); _B = SLA(_B); write_mem(_IY+o, _B); break;
-      case sla_c:       _C = read_mem(_IY+o); _C = SLA(_C); write_mem(_IY+o, _C); break;
-      case sla_d:       _D = read_mem(_IY+o); _D = SLA(_D); write_mem(_IY+o, _D); break;
-      case sla_e:       _E = read_mem(_IY+o); _E = SLA(_E); write_mem(_IY+o, _E); break;
-      case sla_h:       _H = read_mem(_IY+o); _H = SLA(_H); write_mem(_IY+o, _H); break;
-      case sla_l:       _L = read_mem(_IY+o); _L = SLA(_L); write_mem(_IY+o, _L); break;
-      case sla_mhl:     { byte b = read_mem(_IY+o); write_mem(_IY+o, SLA(b)); } break;
-      case sll_a:       _A = read_mem(_IY+o); _A = SLL(_A); write_mem(_IY+o, _A); break;
-      case sll_b:       _B = read_mem(_IY+o); _B = SLL(_B); write_mem(_IY+o, _B); break;
-      case sll_c:       _C = read_mem(_IY+o); _C = SLL(_C); write_mem(_IY+o, _C); break;
-      case sll_d:       _D = read_mem(_IY+o); _D = SLL(_D); write_mem(_IY+o, _D); break;
-      case sll_e:       _E = read_mem(_IY+o); _E = SLL(_E); write_mem(_IY+o, _E); break;
-      case sll_h:       _H = read_mem(_IY+o); _H = SLL(_H); write_mem(_IY+o, _H); break;
-      case sll_l:       _L = read_mem(_IY+o); _L = SLL(_L); write_mem(_IY+o, _L); break;
-      case sll_mhl:     { byte b = read_mem(_IY+o); write_mem(_IY+o, SLL(b)); } break;
-      case sra_a:       _A = read_mem(_IY+o); _A = SRA(_A); write_mem(_IY+o, _A); break;
-      case sra_b:       _B = read_mem(_IY+o); _B = SRA(_B); write_mem(_IY+o, _B); break;
-      case sra_c:       _C = read_mem(_IY+o); _C = SRA(_C); write_mem(_IY+o, _C); break;
-      case sra_d:       _D = read_mem(_IY+o); _D = SRA(_D); write_mem(_IY+o, _D); break;
-      case sra_e:       _E = read_mem(_IY+o); _E = SRA(_E); write_mem(_IY+o, _E); break;
-      case sra_h:       _H = read_mem(_IY+o); _H = SRA(_H); write_mem(_IY+o, _H); break;
-      case sra_l:       _L = read_mem(_IY+o); _L = SRA(_L); write_mem(_IY+o, _L); break;
-      case sra_mhl:     { byte b = read_mem(_IY+o); write_mem(_IY+o, SRA(b)); } break;
-      case srl_a:       _A = read_mem(_IY+o); _A = SRL(_A); write_mem(_IY+o, _A); break;
-      case srl_b:       _B = read_mem(_IY+o); _B = SRL(_B); write_mem(_IY+o, _B); break;
-      case srl_c:       _C = read_mem(_IY+o); _C = SRL(_C); write_mem(_IY+o, _C); break;
-      case srl_d:       _D = read_mem(_IY+o); _D = SRL(_D); write_mem(_IY+o, _D); break;
-      case srl_e:       _E = read_mem(_IY+o); _E = SRL(_E); write_mem(_IY+o, _E); break;
-      case srl_h:       _H = read_mem(_IY+o); _H = SRL(_H); write_mem(_IY+o, _H); break;
-      case srl_l:       _L = read_mem(_IY+o); _L = SRL(_L); write_mem(_IY+o, _L); break;
-      case srl_mhl:     { byte b = read_mem(_IY+o); write_mem(_IY+o, SRL(b)); } break;
-   }
+void z80_execute_pfx_fd_instruction()
+{
+   z80_execute_pfx_xy_instruction<true, &t_z80regs::IY>();
+   z80_resolve_flags();
+}
+
+void z80_execute_pfx_fdcb_instruction()
+{
+   z80_execute_pfx_xycb_instruction<true, &t_z80regs::IY>();
+   z80_resolve_flags();
 }
@@ -72,31 +72,29 @@ enum WatchpointType {
 };
 
 struct Watchpoint {
-  Watchpoint(word val, WatchpointType t) : address(val), type(t) {};
+  Watchpoint(word val, WatchpointType t, byte value = 0, byte mask = 0) : address(val), type(t), value(value), mask(mask) {};
   dword address;
   WatchpointType type;
+  // Conditional watchpoint: only trigger if the byte read or written is equal
+  // to value on the bits set in mask. The default mask (0) always triggers.
+  byte value;
+  byte mask;
 };
 
-class t_z80regs {
-  public:
-   t_z80regs() {
-     AF.d = 0;  BC.d = 0;  DE.d = 0;  HL.d = 0;  PC.d = 0; SP.d = 0;
-     AFx.d = 0; BCx.d = 0; DEx.d = 0; HLx.d = 0; IX.d = 0; IY.d = 0;
-     I = 0; R = 0; Rb7 = 0; IFF1 = 0; IFF2 = 0; IM = 0; HALT = 0;
-     EI_issued = 0; int_pending = 0;
-     watchpoint_reached = 0; breakpoint_reached = 0;
-     step_in = 0; step_out = 0;
-     break_point = 0; trace = 0;
-   };
-
+// Kept trivial (no constructor nor destructor), as the machine state it is
+// part of (see machinestate.h). t_z80regs() gives a zeroed copy.
+struct t_z80regs {
    reg_pair AF, BC, DE, HL, PC, SP, AFx, BCx, DEx, HLx, IX, IY;
    byte I, R, Rb7, IFF1, IFF2, IM, HALT, EI_issued, int_pending;
    byte watchpoint_reached;
    byte breakpoint_reached;
    byte step_in;
    byte step_out;
-   std::vector<word> step_out_addresses;
    dword break_point, trace;
+   // Operation whose flags are still to be computed in F, see z80_flags() in
+   // z80.cpp. This is never pending outside of the emulation of instructions.
+   byte flags_op, flags_a, flags_val;
+   word flags_res;
 };
 
 
@@ -118,9 +116,23 @@ void z80_reset();
 void z80_init_tables();
 void z80_mf2stop();
 
+// Whether breakpoints, watchpoints, stepping or tracing is in use. When not,
+// z80_execute runs a variant of the emulation loop without any of these checks.
+bool z80_debug_active();
+// Rebuild the per-address index of breakpoints and watchpoints. z80_execute
+// does it on entry, only needed when calling z80_execute_instruction directly.
+void z80_index_debug_points();
+// Compute the number of cycles until the next peripheral (sound, FDC, tape)
+// needs servicing. To be called whenever their state is changed from outside
+// of the emulation of I/O instructions while z80_execute is running.
+void z80_schedule_events();
+// Bring the peripherals up to date with the cycles elapsed since they were last
+// serviced, then reschedule them.
+void z80_sync_events();
 int z80_execute();
 
 // Handle main z80 instructions.
+// These always run the instrumented (watchpoints aware) variant.
 void z80_execute_instruction();
 
 // Handle prefixed bits instructions.
@@ -10,9 +10,8 @@
 #include "cap32.h"
 #include "log.h"
 
-extern t_z80regs z80;
 #include "z80_macros.h"
-extern t_CPC CPC;
+extern thread_local t_CPC CPC;
 
 OpCode::OpCode(int value, int length, int argsize, std::string instruction) :
   value_(value), length_(length), argsize_(argsize), instruction_(std::move(instruction)) {}
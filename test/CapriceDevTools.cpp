@@ -5,9 +5,9 @@
 
 #include "CapriceDevTools.h"
 #include "cap32.h"
+#include "machinestate.h"
 
-extern byte *membank_read[4];
-extern t_CPC CPC;
+extern thread_local t_CPC CPC;
 
 using namespace wGui;
 
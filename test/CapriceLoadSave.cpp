@@ -6,7 +6,7 @@
 #include "cap32.h"
 #include <string>
 
-extern t_CPC CPC;
+extern thread_local t_CPC CPC;
 
 using namespace wGui;
 
@@ -4,7 +4,7 @@
 #include "keyboard.h"
 #include <string>
 
-extern t_CPC CPC;
+extern thread_local t_CPC CPC;
 
 class InputMapperTest : public testing::Test {
   public:
@@ -100,3 +100,85 @@ TEST(argParseTest, replaceCap32KeysRepeatedKeywords)
 
   ASSERT_EQ(expected, replaceCap32Keys(command));
 }
+
+TEST(argParseTest, headlessAndFrames)
+{
+   const char *argv[] = {"./caprice32", "--headless", "--frames=500"};
+   CapriceArgs args;
+   std::vector<std::string> slot_list;
+
+   parseArguments(3, const_cast<char **>(argv), slot_list, args);
+   ASSERT_TRUE(args.headless);
+   ASSERT_EQ(500, args.maxFrames);
+}
+
+TEST(argParseTest, headlessDefaultsOff)
+{
+   const char *argv[] = {"./caprice32"};
+   CapriceArgs args;
+   std::vector<std::string> slot_list;
+
+   parseArguments(1, const_cast<char **>(argv), slot_list, args);
+   ASSERT_FALSE(args.headless);
+   ASSERT_EQ(0, args.maxFrames);
+}
+
+TEST(argParseTest, recordAndReplay)
+{
+   const char *argv[] = {"./caprice32", "--record=run.mov", "-R", "other.mov"};
+   CapriceArgs args;
+   std::vector<std::string> slot_list;
+
+   parseArguments(4, const_cast<char **>(argv), slot_list, args);
+   ASSERT_EQ("run.mov", args.recordFile);
+   ASSERT_EQ("other.mov", args.replayFile);
+   ASSERT_TRUE(slot_list.empty());
+}
+
+TEST(argParseTest, soundCapture)
+{
+   const char *argv[] = {"./caprice32", "--wav=song.wav", "-y", "song.ym"};
+   CapriceArgs args;
+   std::vector<std::string> slot_list;
+
+   parseArguments(4, const_cast<char **>(argv), slot_list, args);
+   ASSERT_EQ("song.wav", args.wavFile);
+   ASSERT_EQ("song.ym", args.ymFile);
+}
+
+TEST(argParseTest, videoCapture)
+{
+   const char *argv[] = {"./caprice32", "-m", "demo.cpv", "--video_to_png=old.cpv"};
+   CapriceArgs args;
+   std::vector<std::string> slot_list;
+
+   parseArguments(4, const_cast<char **>(argv), slot_list, args);
+   ASSERT_EQ("demo.cpv", args.videoFile);
+   ASSERT_EQ("old.cpv", args.videoToPngFile);
+}
+
+TEST(argParseTest, batch)
+{
+   const char *argv[] = {"./caprice32", "--batch=corpus.txt", "-j", "8"};
+   CapriceArgs args;
+   std::vector<std::string> slot_list;
+
+   parseArguments(4, const_cast<char **>(argv), slot_list, args);
+   ASSERT_EQ("corpus.txt", args.batchFile);
+   ASSERT_EQ(8u, args.batchJobs);
+   ASSERT_TRUE(args.headless);
+}
+
+TEST(argParseTest, frameHashes)
+{
+   const char *argv[] = {"./caprice32", "--expect_hash=a95b0a0acf7d5181", "-e", "00000000000000FF", "-l", "hashes.log", "-a", "CAP32_ASSERTHASH"};
+   CapriceArgs args;
+   std::vector<std::string> slot_list;
+
+   parseArguments(8, const_cast<char **>(argv), slot_list, args);
+   ASSERT_EQ(2u, args.expectedHashes.size());
+   ASSERT_EQ(0xa95b0a0acf7d5181u, args.expectedHashes[0]);
+   ASSERT_EQ(0xffu, args.expectedHashes[1]);
+   ASSERT_EQ("hashes.log", args.hashLogFile);
+   ASSERT_EQ(std::string("\f") + char(CAP32_ASSERTHASH) + "\n", args.autocmd);
+}
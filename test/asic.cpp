@@ -3,10 +3,9 @@
 #include "asic.h"
 #include "cap32.h"
 #include <vector>
+#include "machinestate.h"
 
-extern byte *membank_config[8][4];
-extern byte *membank_write[4];
-extern t_GateArray GateArray;
+extern thread_local byte *membank_config[8][4];
 
 namespace 
 {
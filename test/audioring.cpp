@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include "audioring.h"
+
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+TEST(AudioRingTest, ReadsInWriteOrderAcrossWraparound)
+{
+  AudioRing ring(8);
+  byte in[6] = { 1, 2, 3, 4, 5, 6 };
+  byte out[6] = {};
+  ASSERT_EQ(6u, ring.write(in, 6));
+  ASSERT_EQ(4u, ring.read(out, 4));
+  // Now wraps around the end of the buffer.
+  ASSERT_EQ(6u, ring.write(in, 6));
+  EXPECT_EQ(8u, ring.available());
+
+  ASSERT_EQ(2u, ring.read(out, 2));
+  EXPECT_EQ(5, out[0]);
+  EXPECT_EQ(6, out[1]);
+  ASSERT_EQ(6u, ring.read(out, 6));
+  EXPECT_EQ(std::vector<byte>(in, in + 6), std::vector<byte>(out, out + 6));
+  EXPECT_EQ(0u, ring.underruns());
+  EXPECT_EQ(0u, ring.overruns());
+}
+
+TEST(AudioRingTest, DropsAndCountsWhatDoesNotFit)
+{
+  AudioRing ring(4);
+  byte in[6] = { 1, 2, 3, 4, 5, 6 };
+  byte out[4] = {};
+
+  EXPECT_EQ(4u, ring.write(in, 6));
+  EXPECT_EQ(0u, ring.write(in, 1));
+  EXPECT_EQ(3u, ring.overruns());
+  ASSERT_EQ(4u, ring.read(out, 4));
+  EXPECT_EQ(4, out[3]);
+}
+
+TEST(AudioRingTest, CountsShortReads)
+{
+  AudioRing ring(8);
+  byte data[8] = { 1, 2, 3 };
+
+  ring.write(data, 3);
+  EXPECT_EQ(3u, ring.read(data, 8));
+  EXPECT_EQ(0u, ring.read(data, 8));
+  EXPECT_EQ(2u, ring.underruns());
+}
+
+TEST(AudioRingTest, ProducerAndConsumerThreads)
+{
+  AudioRing ring(64);
+  const unsigned int total = 200000;
+  std::thread producer([&ring, total]() {
+    byte chunk[13];
+    unsigned int sent = 0;
+    while (sent < total) {
+      size_t count = std::min<size_t>(sizeof(chunk), std::min<size_t>(total - sent, ring.capacity() - ring.available()));
+      for (size_t i = 0; i < count; i++) {
+        chunk[i] = static_cast<byte>(sent + i);
+      }
+      sent += ring.write(chunk, count);
+    }
+  });
+
+  byte chunk[17];
+  unsigned int received = 0;
+  bool in_order = true;
+  while (received < total) {
+    size_t count = ring.read(chunk, std::min<size_t>(sizeof(chunk), ring.available()));
+    for (size_t i = 0; i < count; i++) {
+      in_order &= (chunk[i] == static_cast<byte>(received + i));
+    }
+    received += count;
+  }
+  producer.join();
+
+  EXPECT_TRUE(in_order);
+  EXPECT_EQ(0u, ring.overruns());
+}
+
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include "batch.h"
+
+#include <set>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+
+TEST(BatchTest, ParseManifest)
+{
+  std::istringstream manifest(
+      "# image\tautocmd\tframes\thash\n"
+      "\n"
+      "game.dsk\trun\"game\\n\t500\t0123456789ABCDEF\n"
+      "/abs/tape.cdt\tCAP32_EXIT\t0x10\n"
+      "\tprint 1\t50\t\n");
+  std::vector<t_BatchJob> jobs;
+  ASSERT_TRUE(batch_parse_manifest(manifest, "corpus", jobs));
+  ASSERT_EQ(3u, jobs.size());
+
+  EXPECT_EQ(3u, jobs[0].line);
+  EXPECT_EQ("corpus/game.dsk", jobs[0].image);
+  EXPECT_EQ("run\"game\n\n", jobs[0].autocmd);
+  EXPECT_EQ(500u, jobs[0].frames);
+  EXPECT_EQ("0123456789abcdef", jobs[0].expected_hash);
+
+  EXPECT_EQ("/abs/tape.cdt", jobs[1].image);
+  EXPECT_EQ(std::string("\f\0\n", 3), jobs[1].autocmd);
+  EXPECT_EQ(16u, jobs[1].frames);
+  EXPECT_EQ("", jobs[1].expected_hash);
+
+  EXPECT_EQ("", jobs[2].image);
+  EXPECT_EQ("print 1\n", jobs[2].autocmd);
+}
+
+TEST(BatchTest, ParseManifestRejectsInvalidLines)
+{
+  std::vector<t_BatchJob> jobs;
+  std::istringstream missing_frames("game.dsk\trun\"game\n");
+  EXPECT_FALSE(batch_parse_manifest(missing_frames, ".", jobs));
+  std::istringstream zero_frames("game.dsk\trun\"game\t0\n");
+  EXPECT_FALSE(batch_parse_manifest(zero_frames, ".", jobs));
+  std::istringstream bad_hash("game.dsk\trun\"game\t100\txyz\n");
+  EXPECT_FALSE(batch_parse_manifest(bad_hash, ".", jobs));
+}
+
+TEST(BatchTest, WorkersStealOnceTheirQueueIsEmpty)
+{
+  WorkStealingQueues queues(2, 5);
+  size_t job;
+  // Worker 0 got jobs 0, 2, 4 and worker 1 jobs 1, 3.
+  ASSERT_TRUE(queues.next(1, job));
+  EXPECT_EQ(1u, job);
+  ASSERT_TRUE(queues.next(1, job));
+  EXPECT_EQ(3u, job);
+  // Stolen from the back of worker 0's queue.
+  ASSERT_TRUE(queues.next(1, job));
+  EXPECT_EQ(4u, job);
+  ASSERT_TRUE(queues.next(0, job));
+  EXPECT_EQ(0u, job);
+  ASSERT_TRUE(queues.next(1, job));
+  EXPECT_EQ(2u, job);
+  EXPECT_FALSE(queues.next(0, job));
+  EXPECT_FALSE(queues.next(1, job));
+}
+
+TEST(BatchTest, EachJobTakenOnce)
+{
+  const size_t workers = 4, jobs = 1000;
+  WorkStealingQueues queues(workers, jobs);
+  std::vector<std::vector<size_t>> taken(workers);
+  std::vector<std::thread> threads;
+  for (size_t worker = 0; worker < workers; worker++) {
+    threads.emplace_back([&, worker]() {
+      size_t job;
+      while (queues.next(worker, job)) {
+        taken[worker].push_back(job);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  std::multiset<size_t> all;
+  for (const auto& t : taken) {
+    all.insert(t.begin(), t.end());
+  }
+  ASSERT_EQ(jobs, all.size());
+  for (size_t job = 0; job < jobs; job++) {
+    EXPECT_EQ(1u, all.count(job));
+  }
+}
+
+}
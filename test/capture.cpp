@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "capture.h"
+#include "cap32.h"
+
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+extern thread_local t_CPC CPC;
+
+namespace
+{
+
+class CaptureTest : public testing::Test {
+  public:
+    void SetUp() override {
+      char tmpFilename[] = "test/.cap32_tmp_XXXXXX";
+      int fd = mkstemp(tmpFilename);
+      ASSERT_GE(fd, 0);
+      close(fd);
+      filename = tmpFilename;
+      saved = CPC;
+    }
+
+    void TearDown() override {
+      capture_stop();
+      CPC = saved;
+      unlink(filename.c_str());
+    }
+
+  protected:
+    std::vector<byte> content() {
+      std::ifstream file(filename, std::ios::binary);
+      return std::vector<byte>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    std::string filename;
+
+  private:
+    t_CPC saved;
+};
+
+dword le32(const std::vector<byte>& data, size_t pos)
+{
+  return data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16) | (data[pos + 3] << 24);
+}
+
+dword be32(const std::vector<byte>& data, size_t pos)
+{
+  return (data[pos] << 24) | (data[pos + 1] << 16) | (data[pos + 2] << 8) | data[pos + 3];
+}
+
+TEST_F(CaptureTest, WriterAppendsAndRewrites)
+{
+  FILE *file = fopen(filename.c_str(), "wb");
+  ASSERT_NE(nullptr, file);
+  CaptureWriter writer(file, 16);
+  EXPECT_TRUE(writer.write({ 1, 2, 3, 4 }));
+  EXPECT_FALSE(writer.write(std::vector<byte>(17, 9))); // can't ever fit
+  EXPECT_TRUE(writer.write({ 5, 6 }));
+  writer.rewrite(1, { 7 });
+  EXPECT_TRUE(writer.write({ 8 }));
+  EXPECT_TRUE(writer.close());
+
+  EXPECT_EQ(std::vector<byte>({ 1, 7, 3, 4, 5, 6, 8 }), content());
+  EXPECT_EQ(17u, writer.droppedBytes());
+}
+
+TEST_F(CaptureTest, WavHasTheSoundBuffers)
+{
+  CPC.snd_playback_rate = 2;
+  CPC.snd_stereo = 1;
+  CPC.snd_bits = 1;
+  ASSERT_EQ(0, capture_wav_start(filename));
+  std::vector<byte> buffer(400);
+  for (size_t i = 0; i < buffer.size(); i++) {
+    buffer[i] = i;
+  }
+  capture_sound_buffer(buffer.data(), buffer.size());
+  capture_sound_buffer(buffer.data(), buffer.size());
+  capture_stop();
+
+  auto wav = content();
+  ASSERT_EQ(44u + 800u, wav.size());
+  EXPECT_EQ(std::string("RIFF"), std::string(wav.begin(), wav.begin() + 4));
+  EXPECT_EQ(36u + 800u, le32(wav, 4));
+  EXPECT_EQ(2, wav[22]); // channels
+  EXPECT_EQ(44100u, le32(wav, 24));
+  EXPECT_EQ(16, wav[34]); // bits
+  EXPECT_EQ(800u, le32(wav, 40));
+  EXPECT_EQ(buffer, std::vector<byte>(wav.begin() + 444, wav.end()));
+}
+
+TEST_F(CaptureTest, YmHasTheRegistersOfEachFrame)
+{
+  ASSERT_EQ(0, capture_ym_start(filename));
+  SetAYRegister(0, 0x12);
+  SetAYRegister(13, 0x0e);
+  capture_frame_completed();
+  SetAYRegister(0, 0x34);
+  SetAYRegister(0, 0x56); // only the last write of a frame is kept
+  capture_frame_completed();
+  capture_stop();
+
+  auto ym = content();
+  const size_t header = 34 + 3 + strlen("Recorded with Caprice32");
+  ASSERT_EQ(header + 2 * 16 + 4, ym.size());
+  EXPECT_EQ(std::string("YM6!LeOnArD!"), std::string(ym.begin(), ym.begin() + 12));
+  EXPECT_EQ(2u, be32(ym, 12));
+  EXPECT_EQ(1000000u, be32(ym, 22));
+  EXPECT_EQ(0x12, ym[header]);
+  EXPECT_EQ(0x0e, ym[header + 13]);
+  EXPECT_EQ(0x56, ym[header + 16]);
+  EXPECT_EQ(0xff, ym[header + 16 + 13]); // envelope not restarted
+  EXPECT_EQ(std::string("End!"), std::string(ym.end() - 4, ym.end()));
+}
+
+}
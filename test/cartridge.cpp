@@ -3,8 +3,8 @@
 #include "types.h"
 #include "errors.h"
 
-extern byte* pbGPBuffer;
-extern byte* pbCartridgeImage;
+extern thread_local byte* pbGPBuffer;
+extern thread_local byte* pbCartridgeImage;
 
 class Cartridge : public testing::Test {
    public:
@@ -1,6 +1,12 @@
 #include <gtest/gtest.h>
+#include <vector>
 
 #include "crtc.h"
+#include "cap32.h"
+#include "asic.h"
+#include "machinestate.h"
+
+extern thread_local t_CPC CPC;
 
 class CrtcTest : public testing::Test {
    public:
@@ -30,3 +36,113 @@ TEST_F(CrtcTest, ShiftLittleEndianDwordTriplet)
    EXPECT_EQ(0x01234567, val);
 }
 
+TEST_F(CrtcTest, QuietCharsStopBeforeNextMatch)
+{
+   crtc_reset();
+   // Next match is R2 (HSYNC position) at 0x2e.
+   EXPECT_EQ(0x2d, crtc_quiet_chars(64));
+   EXPECT_EQ(4, crtc_quiet_chars(4));
+
+   CRTC.char_count = CRTC.registers[0];
+   EXPECT_EQ(0, crtc_quiet_chars(64));
+
+   CRTC.char_count = 0;
+   flags1.inHSYNC = 0xff;
+   EXPECT_EQ(0, crtc_quiet_chars(64));
+   flags1.inHSYNC = 0;
+
+   // Monitor starts a new line in 3 characters.
+   HorzPos = MonHSYNC - 0x300;
+   EXPECT_EQ(2, crtc_quiet_chars(64));
+}
+
+TEST_F(CrtcTest, CycleRunsThroughQuietChars)
+{
+   crtc_reset();
+   VDU.flag_drawing = 0;
+   int pos = HorzPos;
+   byte horz_char = HorzChar;
+
+   crtc_cycle(4);
+
+   EXPECT_EQ(4u, CRTC.char_count);
+   EXPECT_EQ(pos + 0x400, HorzPos);
+   EXPECT_EQ(horz_char + 4, HorzChar);
+}
+
+namespace
+{
+// Renders 2 lines of characters of various widths with the given render
+// function, and returns the resulting surface.
+std::vector<byte> renderWith(void (*render)(), unsigned int palette_mask)
+{
+   const int bps = 4 * 64;
+   std::vector<byte> surface(2 * bps, 0);
+   byte widths[] = { 16, 5, 8, 3, 13 };
+   byte pixels[64];
+   for (unsigned int i = 0; i < sizeof(pixels); i++) {
+      pixels[i] = (i * 7) % 17;
+   }
+   for (int i = 0; i < 17; i++) {
+      GateArray.palette[i] = (0x01020304u * (i + 1) + 0x10203040u * i) & palette_mask;
+   }
+   RendWid = widths;
+   RendOut = pixels;
+   CPC.scr_pos = surface.data();
+   CPC.scr_bps = bps;
+   for (unsigned int i = 0; i < sizeof(widths); i++) {
+      render();
+   }
+   return surface;
+}
+}
+
+TEST_F(CrtcTest, SimdRenderMatchesScalar)
+{
+   if (!render_avx2_supported()) {
+      return;
+   }
+   EXPECT_NE(render32bpp, render_simd_variant(render32bpp));
+   EXPECT_EQ(renderWith(render8bpp, 0xffffffff), renderWith(render_simd_variant(render8bpp), 0xffffffff));
+   EXPECT_EQ(renderWith(render8bpp_doubleY, 0xffffffff), renderWith(render_simd_variant(render8bpp_doubleY), 0xffffffff));
+   EXPECT_EQ(renderWith(render16bpp, 0xffff), renderWith(render_simd_variant(render16bpp), 0xffff));
+   EXPECT_EQ(renderWith(render16bpp_doubleY, 0xffff), renderWith(render_simd_variant(render16bpp_doubleY), 0xffff));
+   EXPECT_EQ(renderWith(render24bpp, 0xffffffff), renderWith(render_simd_variant(render24bpp), 0xffffffff));
+   EXPECT_EQ(renderWith(render24bpp_doubleY, 0xffffffff), renderWith(render_simd_variant(render24bpp_doubleY), 0xffffffff));
+   EXPECT_EQ(renderWith(render32bpp, 0xffffffff), renderWith(render_simd_variant(render32bpp), 0xffffffff));
+   EXPECT_EQ(renderWith(render32bpp_doubleY, 0xffffffff), renderWith(render_simd_variant(render32bpp_doubleY), 0xffffffff));
+}
+
+TEST_F(CrtcTest, PrerenderNormalPlusShiftsByHscroll)
+{
+   byte *saved_ram = pbRAM;
+   dword *saved_mode_map = ModeMap;
+   byte ram[8] = { 0, 0, 0x12, 0x34, 0x56, 0x78, 0, 0 };
+   dword mode_map[512];
+   for (int i = 0; i < 512; i++) {
+      mode_map[i] = 0x9e3779b9u * (i + 1);
+   }
+   pbRAM = ram;
+   ModeMap = mode_map;
+   CRTC.next_address = 4;
+   asic.vscroll = 0;
+   for (int hscroll = 0; hscroll < 16; hscroll++) {
+      asic.hscroll = hscroll;
+      dword rendered[4];
+      RendPos = rendered;
+      prerender_normal_plus();
+      EXPECT_EQ(rendered + 4, RendPos);
+
+      unsigned int byteShift = hscroll % 8;
+      const dword *m1 = mode_map + ram[4 - hscroll / 8 - 1] * 2;
+      const dword *m2 = mode_map + ram[4 - hscroll / 8] * 2;
+      const dword *m3 = mode_map + ram[4 - hscroll / 8 + 1] * 2;
+      EXPECT_EQ(shiftLittleEndianDwordTriplet(m1[0], m1[1], m2[0], byteShift), rendered[0]) << hscroll;
+      EXPECT_EQ(shiftLittleEndianDwordTriplet(m1[1], m2[0], m2[1], byteShift), rendered[1]) << hscroll;
+      EXPECT_EQ(shiftLittleEndianDwordTriplet(m2[0], m2[1], m3[0], byteShift), rendered[2]) << hscroll;
+      EXPECT_EQ(shiftLittleEndianDwordTriplet(m2[1], m3[0], m3[1], byteShift), rendered[3]) << hscroll;
+   }
+   asic.hscroll = 0;
+   pbRAM = saved_ram;
+   ModeMap = saved_mode_map;
+}
@@ -0,0 +1,63 @@
+#include <gtest/gtest.h>
+#include "framehash.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+uint64_t xxh64(const std::string& data)
+{
+  XXH64 hash;
+  hash.update(data.data(), data.size());
+  return hash.digest();
+}
+
+TEST(FrameHashTest, ReferenceValues)
+{
+  EXPECT_EQ(0xEF46DB3751D8E999ULL, xxh64(""));
+  EXPECT_EQ(0xD24EC4F1A98C6E5BULL, xxh64("a"));
+  EXPECT_EQ(0x44BC2CF5AD770999ULL, xxh64("abc"));
+}
+
+TEST(FrameHashTest, StreamingGivesSameDigest)
+{
+  std::vector<unsigned char> data(1000);
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<unsigned char>(i * 7);
+  }
+  XXH64 whole;
+  whole.update(data.data(), data.size());
+  for (size_t chunk : { 1, 3, 31, 32, 33, 100 }) {
+    XXH64 streamed;
+    for (size_t pos = 0; pos < data.size(); pos += chunk) {
+      streamed.update(data.data() + pos, std::min(chunk, data.size() - pos));
+    }
+    EXPECT_EQ(whole.digest(), streamed.digest()) << "chunks of " << chunk;
+  }
+}
+
+TEST(FrameHashTest, LinePaddingIgnored)
+{
+  SDL_Surface *surface = SDL_CreateRGBSurface(0, 30, 4, 8, 0, 0, 0, 0);
+  ASSERT_NE(nullptr, surface);
+  ASSERT_GT(surface->pitch, 30); // rows are padded to a multiple of 4
+  memset(surface->pixels, 0x11, surface->pitch * surface->h);
+  uint64_t hash = frame_hash(surface);
+  for (int y = 0; y < surface->h; y++) {
+    static_cast<unsigned char*>(surface->pixels)[y * surface->pitch + 31] = 0x22;
+  }
+  EXPECT_EQ(hash, frame_hash(surface));
+  static_cast<unsigned char*>(surface->pixels)[29] = 0x22;
+  EXPECT_NE(hash, frame_hash(surface));
+  SDL_FreeSurface(surface);
+}
+
+TEST(FrameHashTest, ToString)
+{
+  EXPECT_EQ("0123456789abcdef", frame_hash_to_string(0x0123456789abcdefULL));
+  EXPECT_EQ("0000000000000001", frame_hash_to_string(1));
+}
+
+}
@@ -5,10 +5,10 @@ OUTPUT_DIR="output"
 LOGFILE="test.log"
 CAP32DIR="${TSTDIR}/../../../"
 
-if [ -z "$DIFF" ]
-then
-  DIFF=diff
-fi
+# Hash of the headless screen shown in model/screenshot.png. When the expected
+# screen changes, replace CAP32_ASSERTHASH by CAP32_SCRNSHOT below to update the
+# model, and take the new hash from the log of a run without --expect_hash.
+EXPECTED_HASH=a95b0a0acf7d5181
 
 rm -rvf ${OUTPUT_DIR}
 mkdir -p ${OUTPUT_DIR}
@@ -18,14 +18,9 @@ find . -iname "*~" -exec rm -fv {} \;
 cd "$TSTDIR"
 
 
-$CAP32DIR/cap32 -c cap32.cfg -a 'border 13:ink 0,13:ink 1,0:mode 1:for a=1 to 24:print"Hello World",a:next:call &bd19:call 0' -a 'CAP32_WAITBREAKCAP32_SCRNSHOT CAP32_EXIT' >> "${LOGFILE}" 2>&1
+if $CAP32DIR/cap32 --headless -c cap32.cfg --expect_hash=${EXPECTED_HASH} -a 'border 13:ink 0,13:ink 1,0:mode 1:for a=1 to 24:print"Hello World",a:next:call &bd19:call 0' -a 'CAP32_WAITBREAKCAP32_ASSERTHASH CAP32_EXIT' >> "${LOGFILE}" 2>&1
 # Intended test when ready (doesn't work for now because \n are added automatically at the end of -a):
-# $CAP32DIR/cap32 -c cap32.cfg -a 'border 13:ink 0,13:ink 1,0:mode 1:for a=1 to 24:print"Hello World",a:next:call &bd19:call 0' -a CAP32_WAITBREAK -a CAP32_SCRNSHOT -a CAP32_EXIT
-
-# Screenshot file name is not predictible (a feature, not a bug)
-mv -v ${OUTPUT_DIR}/screenshot_*png ${OUTPUT_DIR}/screenshot.png
-
-if $DIFF -ur model ${OUTPUT_DIR} >> "${LOGFILE}"
+# $CAP32DIR/cap32 --headless -c cap32.cfg --expect_hash=${EXPECTED_HASH} -a 'border 13:ink 0,13:ink 1,0:mode 1:for a=1 to 24:print"Hello World",a:next:call &bd19:call 0' -a CAP32_WAITBREAK -a CAP32_ASSERTHASH -a CAP32_EXIT
 then
   exit 0
 else
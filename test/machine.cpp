@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include "machine.h"
+
+#include <unistd.h>
+#include <cstring>
+#include <future>
+#include <vector>
+#include "argparse.h"
+#include "cap32.h"
+#include "errors.h"
+#include "z80.h"
+#include "machinestate.h"
+
+extern char chAppPath[];
+extern thread_local dword dwFrameCountOverall;
+extern thread_local std::vector<Breakpoint> breakpoints;
+
+namespace
+{
+
+// Boots machines from the cap32.cfg of the current directory, with the ROMs
+// next to it.
+class MachineTest : public testing::Test {
+  public:
+    void SetUp() override {
+      strncpy(saved_app_path, chAppPath, sizeof(saved_app_path));
+      ASSERT_NE(nullptr, getcwd(chAppPath, _MAX_PATH));
+    }
+
+    void TearDown() override {
+      strncpy(chAppPath, saved_app_path, sizeof(saved_app_path));
+    }
+
+  private:
+    char saved_app_path[_MAX_PATH + 1];
+};
+
+TEST_F(MachineTest, MachinesRunConcurrentlyWithTheirOwnState)
+{
+  Machine a, b;
+  ASSERT_EQ(0, a.init("cap32.cfg"));
+  ASSERT_EQ(0, b.init("cap32.cfg"));
+
+  auto run_a = std::async(std::launch::async, [&a]() { return a.runFrames(100); });
+  auto run_b = std::async(std::launch::async, [&b]() { return b.runFrames(30); });
+  ASSERT_EQ(0, run_a.get());
+  ASSERT_EQ(0, run_b.get());
+
+  EXPECT_EQ(100u, a.call([]() { return dwFrameCountOverall; }).get());
+  EXPECT_EQ(30u, b.call([]() { return dwFrameCountOverall; }).get());
+  // Nothing leaked to the calling thread either.
+  EXPECT_EQ(0u, dwFrameCountOverall);
+
+  a.call([]() { z80_write_mem(0x8000, 0x42); }).get();
+  b.call([]() { z80_write_mem(0x8000, 0x24); }).get();
+  EXPECT_EQ(0x42, a.call([]() { return z80_read_mem(0x8000); }).get());
+  EXPECT_EQ(0x24, b.call([]() { return z80_read_mem(0x8000); }).get());
+}
+
+TEST_F(MachineTest, SameRunGivesSameMachine)
+{
+  Machine a, b;
+  ASSERT_EQ(0, a.init("cap32.cfg"));
+  ASSERT_EQ(0, b.init("cap32.cfg"));
+
+  auto run_a = std::async(std::launch::async, [&a]() { return a.runFrames(50); });
+  ASSERT_EQ(0, b.runFrames(50));
+  ASSERT_EQ(0, run_a.get());
+
+  auto pc = []() { return z80.PC.w.l; };
+  EXPECT_EQ(a.call(pc).get(), b.call(pc).get());
+}
+
+TEST_F(MachineTest, AutocmdTypedWhileRunning)
+{
+  Machine machine;
+  ASSERT_EQ(0, machine.init("cap32.cfg"));
+  // Same as test/integrated/scripted_operations_timing
+  machine.autocmd(replaceCap32Keys("border 13:ink 0,13:ink 1,0:mode 1:for a=1 to 24:print\"Hello World\",a:next:call &bd19:call 0\n"
+                                   "CAP32_WAITBREAKCAP32_SCRNSHOT CAP32_EXIT\n"));
+  ASSERT_EQ(0, machine.runFrames(5000));
+
+  EXPECT_TRUE(machine.exited());
+  EXPECT_LT(machine.call([]() { return dwFrameCountOverall; }).get(), 5000u);
+  auto screenshots = machine.screenshots();
+  ASSERT_EQ(1u, screenshots.size());
+
+  // A machine initialized again gives the same run as a new one.
+  ASSERT_EQ(0, machine.init("cap32.cfg"));
+  EXPECT_FALSE(machine.exited());
+  EXPECT_TRUE(machine.screenshots().empty());
+  machine.autocmd(replaceCap32Keys("border 13:ink 0,13:ink 1,0:mode 1:for a=1 to 24:print\"Hello World\",a:next:call &bd19:call 0\n"
+                                   "CAP32_WAITBREAKCAP32_SCRNSHOT CAP32_EXIT\n"));
+  ASSERT_EQ(0, machine.runFrames(5000));
+  EXPECT_EQ(screenshots, machine.screenshots());
+}
+
+TEST_F(MachineTest, BlockInstructionsRunAsWithDebugger)
+{
+  // A breakpoint which is never reached makes the emulation go through the
+  // instrumented variant, where block instructions run one iteration at a time.
+  Machine fast, slow;
+  ASSERT_EQ(0, fast.init("cap32.cfg"));
+  ASSERT_EQ(0, slow.init("cap32.cfg"));
+  slow.call([]() { breakpoints.emplace_back(0x9100); }).get();
+  // Copies (to the screen, from it, backwards) and searches, forever, with the
+  // interrupts of the firmware enabled:
+  //   ld hl,(&9000) ; inc hl ; ld (&9000),hl ; ld de,&c000 ; ld bc,&2000 ; ldir
+  //   ld hl,&c000 ; ld de,&5000 ; ld bc,&0800 ; ldir
+  //   ld hl,&7fff ; ld de,&ffff ; ld bc,&1000 ; lddr
+  //   ld a,&e5 ; ld hl,&4000 ; ld bc,&4000 ; cpir ; ld (&9002),hl
+  //   ld hl,&bfff ; ld bc,&4000 ; cpdr ; ld (&9004),hl ; jr &8000
+  std::vector<byte> code = {
+    0x2a, 0x00, 0x90, 0x23, 0x22, 0x00, 0x90, 0x11, 0x00, 0xc0, 0x01, 0x00, 0x20, 0xed, 0xb0,
+    0x21, 0x00, 0xc0, 0x11, 0x00, 0x50, 0x01, 0x00, 0x08, 0xed, 0xb0,
+    0x21, 0xff, 0x7f, 0x11, 0xff, 0xff, 0x01, 0x00, 0x10, 0xed, 0xb8,
+    0x3e, 0xe5, 0x21, 0x00, 0x40, 0x01, 0x00, 0x40, 0xed, 0xb1, 0x22, 0x02, 0x90,
+    0x21, 0xff, 0xbf, 0x01, 0x00, 0x40, 0xed, 0xb9, 0x22, 0x04, 0x90, 0x18, 0xc1 };
+  for (Machine *machine : { &fast, &slow }) {
+    ASSERT_EQ(0, machine->runFrames(100));
+    machine->call([&code]() {
+      for (size_t n = 0; n < code.size(); n++) {
+        z80_write_mem(0x8000 + n, code[n]);
+      }
+      z80.PC.w.l = 0x8000;
+    }).get();
+  }
+
+  auto state = []() {
+    std::vector<byte> state = { z80.R, z80.AF.b.l, z80.HL.b.h, z80.HL.b.l };
+    for (unsigned int addr = 0; addr < 0x10000; addr++) {
+      state.push_back(z80_read_mem(addr));
+    }
+    return state;
+  };
+  for (int frame = 0; frame < 50; frame++) {
+    ASSERT_EQ(0, fast.runFrames(1));
+    ASSERT_EQ(0, slow.runFrames(1));
+    ASSERT_EQ(slow.frameHash(), fast.frameHash()) << "frame " << frame;
+  }
+  EXPECT_EQ(slow.call(state).get(), fast.call(state).get());
+}
+
+TEST(MachineNotInitializedTest, RunFramesFails)
+{
+  Machine machine;
+  EXPECT_EQ(ERR_MACHINE_NOT_READY, machine.runFrames(1));
+}
+
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include "movie.h"
+
+#include <vector>
+
+namespace
+{
+
+std::vector<t_MovieInput> someInputs()
+{
+  std::vector<t_MovieInput> inputs(300, movie_idle_input());
+  // Key held from frame 3 to 5
+  for (int frame = 3; frame <= 5; frame++) {
+    inputs[frame].keyboard_matrix[2] = 0xfb;
+  }
+  // Phazer aimed and pressed at frame 150, two keys pressed in the end
+  inputs[150].phazer_pressed = true;
+  inputs[150].phazer_x = 320;
+  inputs[150].phazer_y = 200;
+  for (int frame = 290; frame < 300; frame++) {
+    inputs[frame].keyboard_matrix[0] = 0x7f;
+    inputs[frame].keyboard_matrix[9] = 0xfe;
+  }
+  return inputs;
+}
+
+TEST(MovieTest, ReplayGivesRecordedInputs)
+{
+  auto inputs = someInputs();
+  MovieWriter writer(2, 128);
+  for (const auto& input : inputs) {
+    writer.frame(input);
+  }
+  writer.finish();
+
+  MovieReader reader;
+  ASSERT_TRUE(reader.open(writer.data(), 2, 128));
+  for (size_t frame = 0; frame < inputs.size(); frame++) {
+    t_MovieInput input;
+    ASSERT_TRUE(reader.frame(input)) << frame;
+    EXPECT_EQ(inputs[frame], input) << frame;
+  }
+  t_MovieInput input;
+  EXPECT_FALSE(reader.frame(input));
+}
+
+TEST(MovieTest, OnlyChangesAreStored)
+{
+  MovieWriter writer(2, 128);
+  for (const auto& input : someInputs()) {
+    writer.frame(input);
+  }
+  writer.finish();
+
+  // Header, 5 changes and the end mark
+  EXPECT_LT(writer.data().size(), 60u);
+}
+
+TEST(MovieTest, TruncatedRecordingReplaysUpToItsEnd)
+{
+  auto inputs = someInputs();
+  MovieWriter writer(2, 128);
+  for (const auto& input : inputs) {
+    writer.frame(input);
+  }
+  // Not finished, as when the emulator crashed while recording.
+  MovieReader reader;
+  ASSERT_TRUE(reader.open(writer.data(), 2, 128));
+  t_MovieInput input;
+  for (size_t frame = 0; frame < inputs.size() + 10; frame++) {
+    ASSERT_TRUE(reader.frame(input)) << frame;
+  }
+  EXPECT_EQ(inputs.back(), input);
+}
+
+TEST(MovieTest, RejectsOtherConfiguration)
+{
+  MovieWriter writer(3, 128);
+  writer.finish();
+
+  MovieReader reader;
+  EXPECT_FALSE(reader.open(writer.data(), 2, 128));
+  EXPECT_FALSE(reader.open(writer.data(), 3, 576));
+  EXPECT_FALSE(reader.open(std::vector<byte>(20, 0), 3, 128));
+  EXPECT_TRUE(reader.open(writer.data(), 3, 128));
+}
+
+}
@@ -3,6 +3,20 @@
 #include "cap32.h"
 #include "types.h"
 
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "machinestate.h"
+
+extern thread_local t_CPC CPC;
+extern std::unique_ptr<byte[]> pbSndBuffer;
+extern byte *pbSndBufferEnd;
+
+void Synthesizer_Stereo16();
+void Synthesizer_Stereo8();
+void Synthesizer_Mono16();
+void Synthesizer_Mono8();
+
 // Validate that alignment is correct between bytes & words structs (cf issue #104)
 TEST(PsgTest, RegisterAYAlignment)
 {
@@ -20,3 +34,126 @@ TEST(PsgTest, RegisterAYAlignment)
    psg.RegisterAY.EnvelopeHi = 5;
    EXPECT_EQ(*reinterpret_cast<word *>(&psg.RegisterAY.EnvelopeLo), psg.RegisterAY.Envelope);
 }
+
+namespace
+{
+
+// Plays a few notes, with register changes in the middle of the sound buffer,
+// and returns the samples produced by the synthesizer (the one InitAY selects
+// when null).
+std::vector<byte> play(bool stereo, bool bits16, void (*synthesizer)(), bool band_limited = false)
+{
+  t_CPC saved = CPC;
+  CPC.snd_band_limited = band_limited;
+  CPC.speed = 4;
+  CPC.snd_playback_rate = 2;
+  CPC.snd_volume = 80;
+  CPC.snd_stereo = stereo;
+  CPC.snd_bits = bits16;
+  CPC.snd_buffersize = 16384;
+  pbSndBuffer = std::make_unique<byte[]>(CPC.snd_buffersize);
+  pbSndBufferEnd = pbSndBuffer.get() + CPC.snd_buffersize;
+  CPC.snd_bufferptr = pbSndBuffer.get();
+  InitAY();
+  if (!synthesizer) {
+    synthesizer = PSG.Synthesizer;
+  }
+  // Tone on A and B, noise on A and C, envelope on B and C.
+  const byte registers[14] = { 0x40, 0x01, 0x03, 0x00, 0xc0, 0x00, 0x0f, 0x1c, 0x0f, 0x10, 0x10, 0x30, 0x00, 0x0e };
+  for (int n = 0; n < 14; n++) {
+    SetAYRegister(n, registers[n]);
+  }
+  for (int sample = 0; sample < 3000; sample++) {
+    if (sample == 700) {
+      SetAYRegister(13, 0x0a);
+      SetAYRegister(6, 0x02);
+    }
+    if (sample == 1900) {
+      SetAYRegister(7, 0x38);
+      SetAYRegister(11, 0x03);
+    }
+    synthesizer();
+  }
+  AY_flush();
+  PSG.buffer_full = 0;
+  std::vector<byte> samples(pbSndBuffer.get(), CPC.snd_bufferptr);
+  CPC = saved;
+  return samples;
+}
+
+TEST(PsgTest, BlockSynthesizerMatchesTickByTick)
+{
+  std::vector<byte> reference = play(true, true, Synthesizer_Stereo16);
+  ASSERT_EQ(12000u, reference.size());
+  EXPECT_NE(std::vector<byte>(reference.size(), reference[0]), reference);
+  EXPECT_EQ(reference, play(true, true, nullptr));
+  EXPECT_EQ(play(true, false, Synthesizer_Stereo8), play(true, false, nullptr));
+  EXPECT_EQ(play(false, true, Synthesizer_Mono16), play(false, true, nullptr));
+  EXPECT_EQ(play(false, false, Synthesizer_Mono8), play(false, false, nullptr));
+}
+
+// Amplitude of the given frequency in 16 bits mono samples at 44.1kHz.
+double amplitude(const std::vector<byte>& samples, double frequency)
+{
+  const int16_t *data = reinterpret_cast<const int16_t *>(samples.data());
+  double re = 0, im = 0;
+  for (size_t n = 0; n < samples.size() / 2; n++) {
+    re += data[n] * cos(2 * M_PI * frequency * n / 44100);
+    im += data[n] * sin(2 * M_PI * frequency * n / 44100);
+  }
+  return sqrt(re * re + im * im);
+}
+
+// A 12.5kHz square wave on channel A only.
+std::vector<byte> play_square(bool band_limited)
+{
+  t_CPC saved = CPC;
+  CPC.snd_band_limited = band_limited;
+  CPC.speed = 4;
+  CPC.snd_playback_rate = 2;
+  CPC.snd_volume = 80;
+  CPC.snd_stereo = 0;
+  CPC.snd_bits = 1;
+  CPC.snd_buffersize = 16384;
+  pbSndBuffer = std::make_unique<byte[]>(CPC.snd_buffersize);
+  pbSndBufferEnd = pbSndBuffer.get() + CPC.snd_buffersize;
+  CPC.snd_bufferptr = pbSndBuffer.get();
+  InitAY();
+  const byte registers[14] = { 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x0f, 0x00, 0x00, 0x00, 0x00, 0x00 };
+  for (int n = 0; n < 14; n++) {
+    SetAYRegister(n, registers[n]);
+  }
+  for (int sample = 0; sample < 8000; sample++) {
+    PSG.Synthesizer();
+  }
+  AY_flush();
+  PSG.buffer_full = 0;
+  std::vector<byte> samples(pbSndBuffer.get(), CPC.snd_bufferptr);
+  CPC = saved;
+  return samples;
+}
+
+TEST(PsgTest, BandLimitedSynthesizerReducesAliasing)
+{
+  std::vector<byte> averaged = play_square(false);
+  std::vector<byte> band_limited = play_square(true);
+
+  // The 3rd and 7th harmonics fold back to 6.6kHz and 700Hz.
+  for (double alias : { 6600.0, 700.0 }) {
+    double averaged_ratio = amplitude(averaged, alias) / amplitude(averaged, 12500);
+    double band_limited_ratio = amplitude(band_limited, alias) / amplitude(band_limited, 12500);
+    EXPECT_LT(band_limited_ratio, averaged_ratio / 10) << alias << "Hz";
+  }
+}
+
+TEST(PsgTest, BandLimitedSynthesizerPlaysSameNotes)
+{
+  // Same sound as the averaging synthesizer, up to the filtering.
+  std::vector<byte> averaged = play(false, true, nullptr);
+  std::vector<byte> band_limited = play(false, true, nullptr, true);
+  ASSERT_EQ(averaged.size(), band_limited.size());
+  EXPECT_NEAR(1, amplitude(band_limited, 0) / amplitude(averaged, 0), 0.01);
+  EXPECT_NEAR(1, amplitude(band_limited, 1000) / amplitude(averaged, 1000), 0.05);
+}
+
+}
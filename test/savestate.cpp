@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+#include "savestate.h"
+#include "cap32.h"
+#include "disk.h"
+#include "errors.h"
+#include "z80.h"
+
+#include <memory>
+#include "machinestate.h"
+
+extern thread_local t_CPC CPC;
+
+namespace
+{
+
+class SaveStateTest : public testing::Test {
+  public:
+    void SetUp() override {
+      saved_model = CPC.model;
+      saved_ram_size = CPC.ram_size;
+      saved_mf2 = CPC.mf2;
+      saved_pbRAM = pbRAM;
+      CPC.model = 2;
+      CPC.ram_size = 128;
+      CPC.mf2 = 0;
+      ram = std::make_unique<byte[]>(128*1024);
+      pbRAM = ram.get();
+      FDC.phase = CMD_PHASE;
+    }
+
+    void TearDown() override {
+      CPC.model = saved_model;
+      CPC.ram_size = saved_ram_size;
+      CPC.mf2 = saved_mf2;
+      pbRAM = saved_pbRAM;
+      ram_update_write_pages();
+    }
+
+  protected:
+    std::unique_ptr<byte[]> ram;
+
+  private:
+    unsigned int saved_model, saved_ram_size, saved_mf2;
+    byte *saved_pbRAM;
+};
+
+TEST_F(SaveStateTest, RestoreBringsBackCapturedMachine)
+{
+  z80.PC.w.l = 0x1234;
+  z80.AF.w.l = 0x5678;
+  CRTC.registers[1] = 40;
+  PSG.RegisterAY.AmplitudeA = 15;
+  GateArray.RAM_config = 0xc4;
+  pbRAM[0x10000] = 0xaa;
+  std::vector<byte> state;
+  ASSERT_EQ(0, savestate_capture(state));
+
+  z80.PC.w.l = 0;
+  z80.AF.w.l = 0;
+  CRTC.registers[1] = 0;
+  PSG.RegisterAY.AmplitudeA = 0;
+  GateArray.RAM_config = 0;
+  pbRAM[0x10000] = 0;
+  ASSERT_EQ(0, savestate_restore(state));
+
+  EXPECT_EQ(0x1234, z80.PC.w.l);
+  EXPECT_EQ(0x5678, z80.AF.w.l);
+  EXPECT_EQ(40, CRTC.registers[1]);
+  EXPECT_EQ(15, PSG.RegisterAY.AmplitudeA);
+  EXPECT_EQ(0xc4, GateArray.RAM_config);
+  EXPECT_EQ(0xaa, pbRAM[0x10000]);
+  // Memory mapping is rebuilt from the restored Gate Array: bank 4 in page 1
+  EXPECT_EQ(pbRAM + 0x10000, membank_read[1]);
+}
+
+TEST_F(SaveStateTest, RestoreRejectsOtherConfiguration)
+{
+  std::vector<byte> state;
+  ASSERT_EQ(0, savestate_capture(state));
+
+  CPC.ram_size = 64;
+  EXPECT_EQ(ERR_SAVESTATE_INVALID, savestate_restore(state));
+  CPC.ram_size = 128;
+  state.pop_back();
+  EXPECT_EQ(ERR_SAVESTATE_INVALID, savestate_restore(state));
+}
+
+TEST_F(SaveStateTest, RecaptureOnlyCopiesWrittenPages)
+{
+  membank_write[2] = pbRAM + 0x8000;
+  ram_update_write_pages();
+  std::vector<byte> state;
+  ASSERT_EQ(0, savestate_capture(state));
+
+  z80_write_mem(0x8010, 0x11);
+  pbRAM[0x1000] = 0x22; // not tracked, so not captured
+  ASSERT_EQ(0, savestate_capture(state));
+  pbRAM[0x8010] = 0;
+  ASSERT_EQ(0, savestate_restore(state));
+
+  EXPECT_EQ(0x11, pbRAM[0x8010]);
+  EXPECT_EQ(0, pbRAM[0x1000]);
+
+  // The restore counts as a write to the whole RAM.
+  pbRAM[0x1000] = 0x22;
+  ASSERT_EQ(0, savestate_capture(state));
+  pbRAM[0x1000] = 0;
+  ASSERT_EQ(0, savestate_restore(state));
+  EXPECT_EQ(0x22, pbRAM[0x1000]);
+}
+
+TEST_F(SaveStateTest, CaptureRefusedDuringDiskTransfer)
+{
+  std::vector<byte> state;
+  FDC.phase = EXEC_PHASE;
+
+  EXPECT_EQ(ERR_SAVESTATE_BUSY, savestate_capture(state));
+}
+
+TEST(RewindBufferTest, PopReturnsStatesFromNewest)
+{
+  RewindBuffer buffer(1024*1024);
+  std::vector<byte> first(1000, 1), second(1000, 1), third(1000, 3);
+  second[500] = 2;
+  buffer.push(first);
+  buffer.push(second);
+  buffer.push(third);
+  EXPECT_EQ(3u, buffer.count());
+
+  std::vector<byte> state;
+  ASSERT_TRUE(buffer.pop(state));
+  EXPECT_EQ(third, state);
+  ASSERT_TRUE(buffer.pop(state));
+  EXPECT_EQ(second, state);
+  ASSERT_TRUE(buffer.pop(state));
+  EXPECT_EQ(first, state);
+  EXPECT_FALSE(buffer.pop(state));
+  EXPECT_EQ(0u, buffer.count());
+}
+
+TEST(RewindBufferTest, OlderStatesStoredAsSmallDeltas)
+{
+  RewindBuffer buffer(1024*1024);
+  std::vector<byte> state(100000, 0);
+  for (int n = 0; n < 10; n++) {
+    state[n * 1000] = n;
+    state[n * 1000 + 1] = n;
+    buffer.push(state);
+  }
+
+  EXPECT_EQ(10u, buffer.count());
+  EXPECT_LT(buffer.memoryUsed(), state.size() + 100);
+}
+
+TEST(RewindBufferTest, OldestStatesDroppedToFitBudget)
+{
+  RewindBuffer buffer(1090);
+  std::vector<byte> state(1000, 0);
+  for (int n = 0; n < 10; n++) {
+    for (int i = 0; i < 30; i++) {
+      state[n * 30 + i] = n + 1;
+    }
+    buffer.push(state);
+  }
+
+  EXPECT_LE(buffer.memoryUsed(), 1090u);
+  EXPECT_EQ(3u, buffer.count());
+  std::vector<byte> popped;
+  ASSERT_TRUE(buffer.pop(popped));
+  EXPECT_EQ(state, popped);
+
+  buffer.setBudget(10);
+  EXPECT_EQ(0u, buffer.count());
+}
+
+}
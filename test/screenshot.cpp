@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include "screenshot.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+#include <vector>
+#include "SDL.h"
+#include "types.h"
+
+namespace
+{
+
+class ScreenshotTest : public testing::Test {
+  public:
+    void SetUp() override {
+      surface = SDL_CreateRGBSurface(0, 320, 200, 32, 0xff0000, 0xff00, 0xff, 0);
+      ASSERT_NE(nullptr, surface);
+      Uint32 *pixels = static_cast<Uint32 *>(surface->pixels);
+      for (int y = 0; y < surface->h; y++) {
+        for (int x = 0; x < surface->w; x++) {
+          pixels[y * surface->pitch / 4 + x] = ((x / 8) % 2) ? 0x0000ff : 0xffff00;
+        }
+      }
+    }
+
+    void TearDown() override {
+      SDL_FreeSurface(surface);
+      for (const auto& filename : filenames) {
+        unlink(filename.c_str());
+      }
+    }
+
+  protected:
+    std::string tmpFilename() {
+      char tmpFilename[] = "test/.cap32_tmp_XXXXXX";
+      int fd = mkstemp(tmpFilename);
+      EXPECT_GE(fd, 0);
+      close(fd);
+      filenames.push_back(tmpFilename);
+      return tmpFilename;
+    }
+
+    std::vector<byte> content(const std::string& filename) {
+      std::ifstream file(filename, std::ios::binary);
+      return std::vector<byte>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    SDL_Surface *surface;
+    std::vector<std::string> filenames;
+};
+
+TEST_F(ScreenshotTest, WritesACopyOfTheScreenInTheBackground)
+{
+  std::string before = tmpFilename(), after = tmpFilename();
+
+  ASSERT_TRUE(screenshot_save(surface, before, SCREENSHOT_COMPRESSION_DEFAULT));
+  // Only the copy taken when queuing is written.
+  SDL_FillRect(surface, nullptr, 0);
+  ASSERT_TRUE(screenshot_save(surface, after, SCREENSHOT_COMPRESSION_DEFAULT));
+  ASSERT_TRUE(screenshot_flush());
+
+  std::vector<byte> png = content(before);
+  ASSERT_GT(png.size(), 8u);
+  EXPECT_EQ(0, memcmp(png.data(), "\x89PNG\r\n\x1a\n", 8));
+  EXPECT_NE(png, content(after));
+}
+
+TEST_F(ScreenshotTest, CompressionLevel)
+{
+  std::string fastest = tmpFilename(), smallest = tmpFilename();
+
+  ASSERT_TRUE(screenshot_save(surface, fastest, SCREENSHOT_COMPRESSION_MIN));
+  ASSERT_TRUE(screenshot_save(surface, smallest, SCREENSHOT_COMPRESSION_MAX));
+  ASSERT_TRUE(screenshot_flush());
+
+  // Level 0 stores the pixels, 3 bytes each.
+  EXPECT_GT(content(fastest).size(), 320u * 200 * 3);
+  EXPECT_LT(content(smallest).size(), 320u * 200 / 10);
+}
+
+TEST_F(ScreenshotTest, FlushReportsFailures)
+{
+  ASSERT_TRUE(screenshot_save(surface, "test/no/such/directory/screenshot.png", SCREENSHOT_COMPRESSION_DEFAULT));
+  EXPECT_FALSE(screenshot_flush());
+  // Failures are only reported once.
+  EXPECT_TRUE(screenshot_flush());
+}
+
+}
@@ -4,7 +4,7 @@
 #include "slotshandler.h"
 #include <string>
 
-extern t_drive driveA;
+extern thread_local t_drive driveA;
 
 TEST(SlotHandlerTest, slotsInitializedWithProperDriveTypes)
 {
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include "videocapture.h"
+
+#include <unistd.h>
+#include "SDL.h"
+#include "errors.h"
+
+namespace
+{
+
+std::vector<byte> decode(const std::vector<byte>& data, std::vector<byte> frame)
+{
+  EXPECT_TRUE(video_decode_frame(data.data(), data.size(), frame.data(), frame.size()));
+  return frame;
+}
+
+TEST(VideoCaptureTest, DeltaOnlyHoldsTheChanges)
+{
+  std::vector<byte> previous(64000);
+  for (size_t i = 0; i < previous.size(); i++) {
+    previous[i] = static_cast<byte>(i * 7 / 13);
+  }
+  std::vector<byte> frame = previous;
+  frame[0] ^= 1;
+  frame[1000] ^= 1;
+  frame[1003] ^= 1; // close enough to be copied with the one above
+  for (size_t i = 30000; i < 30100; i++) {
+    frame[i] = 0;
+  }
+  frame.back() ^= 1;
+
+  std::vector<byte> key, delta;
+  video_encode_frame(frame.data(), nullptr, frame.size(), key);
+  video_encode_frame(frame.data(), previous.data(), frame.size(), delta);
+
+  EXPECT_EQ(frame, decode(key, std::vector<byte>(frame.size())));
+  EXPECT_EQ(frame, decode(delta, previous));
+  EXPECT_LT(key.size(), frame.size() + 16);
+  EXPECT_LT(delta.size(), 150u);
+
+  std::vector<byte> unchanged;
+  video_encode_frame(frame.data(), frame.data(), frame.size(), unchanged);
+  EXPECT_LE(unchanged.size(), 4u);
+  EXPECT_EQ(frame, decode(unchanged, frame));
+}
+
+TEST(VideoCaptureTest, RejectsInvalidData)
+{
+  std::vector<byte> frame(16);
+  const byte too_long[] = { 10, 10 };
+  const byte truncated[] = { 0, 4, 1, 2 };
+  const byte unterminated[] = { 0x80 };
+  EXPECT_FALSE(video_decode_frame(too_long, sizeof(too_long), frame.data(), frame.size()));
+  EXPECT_FALSE(video_decode_frame(truncated, sizeof(truncated), frame.data(), frame.size()));
+  EXPECT_FALSE(video_decode_frame(unterminated, sizeof(unterminated), frame.data(), frame.size()));
+}
+
+TEST(VideoCaptureTest, RecordsEveryFrame)
+{
+  char tmpFilename[] = "test/.cap32_tmp_XXXXXX";
+  int fd = mkstemp(tmpFilename);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  // Wider than its content, as the surfaces of the video plugins.
+  SDL_Surface *surface = SDL_CreateRGBSurface(0, 40, 30, 32, 0xff0000, 0xff00, 0xff, 0);
+  ASSERT_NE(nullptr, surface);
+  const int frames = VIDEO_KEY_FRAME_INTERVAL + 20;
+  ASSERT_EQ(0, capture_video_start(tmpFilename, surface));
+  for (int i = 0; i < frames; i++) {
+    Uint32 *pixels = static_cast<Uint32 *>(surface->pixels);
+    pixels[(i % surface->h) * surface->pitch / 4 + i % surface->w] = i;
+    capture_video_frame(surface);
+  }
+  capture_video_stop();
+
+  VideoReader reader;
+  ASSERT_TRUE(reader.open(tmpFilename));
+  EXPECT_EQ(40, reader.format().width);
+  EXPECT_EQ(30, reader.format().height);
+  EXPECT_EQ(4, reader.format().bytes_per_pixel);
+  EXPECT_EQ(0xff0000u, reader.format().rmask);
+  std::vector<byte> frame;
+  std::vector<Uint32> expected(40 * 30);
+  int count = 0;
+  while (reader.next(frame)) {
+    expected[(count % 30) * 40 + count % 40] = count;
+    ASSERT_EQ(expected.size() * 4, frame.size());
+    ASSERT_EQ(0, memcmp(expected.data(), frame.data(), frame.size())) << "frame " << count;
+    count++;
+  }
+  EXPECT_EQ(frames, count);
+
+  SDL_FreeSurface(surface);
+  unlink(tmpFilename);
+}
+
+TEST(VideoCaptureTest, RejectsPalettizedSurfaces)
+{
+  SDL_Surface *surface = SDL_CreateRGBSurface(0, 40, 30, 8, 0, 0, 0, 0);
+  ASSERT_NE(nullptr, surface);
+  ASSERT_NE(nullptr, surface->format->palette);
+  EXPECT_EQ(ERR_CAPTURE_FORMAT, capture_video_start("test/no/such/directory/capture.cv", surface));
+  SDL_FreeSurface(surface);
+}
+
+}
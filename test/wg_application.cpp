@@ -5,7 +5,7 @@
 #include "cap32.h"
 #include <string>
 
-extern t_CPC CPC;
+extern thread_local t_CPC CPC;
 
 TEST(CApplicationTest, InitThrowExceptionWhenFailToFindResources)
 {
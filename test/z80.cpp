@@ -1,11 +1,18 @@
 #include <gtest/gtest.h>
 #include "z80.h"
 #include "cap32.h"
+#include "disk.h"
 
 #include "z80_macros.h"
+#include <climits>
+#include "machinestate.h"
 
-extern byte *membank_read[4];
-extern t_z80regs z80;
+extern thread_local t_CPC CPC;
+extern thread_local t_MemBankConfig membank_config;
+extern thread_local byte *pbMF2ROM;
+extern thread_local int iTapeCycleCount;
+extern thread_local std::vector<Breakpoint> breakpoints;
+extern thread_local std::vector<Watchpoint> watchpoints;
 
 namespace
 {
@@ -102,4 +109,280 @@ TEST_F(Z80Test, SqrtRoutine)
   EXPECT_EQ(10, _A);
 }
 
+// F as computed by the 8 bit arithmetic instructions, including the
+// undocumented bits 3 and 5, for A op B with carry in.
+byte ExpectedFlags(byte opcode, unsigned a, unsigned b, unsigned carry)
+{
+  const auto sz = [](byte v) { return (v & (Sflag | Xflags)) | (v ? 0 : Zflag); };
+  unsigned res;
+  switch (opcode) {
+    case 0x80: // add a,b
+    case 0x88: // adc a,b
+      res = a + b + (opcode == 0x88 ? carry : 0);
+      return sz(res) | ((res >> 8) & Cflag) | ((a ^ res ^ b) & Hflag) | (((b ^ a ^ 0x80) & (b ^ res) & 0x80) >> 5);
+    case 0x90: // sub b
+    case 0x98: // sbc a,b
+      res = a - b - (opcode == 0x98 ? carry : 0);
+      return sz(res) | ((res >> 8) & Cflag) | Nflag | ((a ^ res ^ b) & Hflag) | (((b ^ a) & (a ^ res) & 0x80) >> 5);
+    case 0xb8: // cp b
+      res = a - b;
+      return (sz(res) & (Sflag | Zflag)) | (b & Xflags) | ((res >> 8) & Cflag) | Nflag | ((a ^ res ^ b) & Hflag) |
+        ((((b ^ a) & (a ^ res)) >> 5) & Vflag);
+    case 0x3c: // inc a
+      res = (a + 1) & 0xff;
+      return carry | sz(res) | (res == 0x80 ? Vflag : 0) | ((res & 0x0f) == 0 ? Hflag : 0);
+    case 0x3d: // dec a
+      res = (a - 1) & 0xff;
+      return carry | sz(res) | Nflag | (res == 0x7f ? Vflag : 0) | ((res & 0x0f) == 0x0f ? Hflag : 0);
+  }
+  return 0;
+}
+
+TEST_F(Z80Test, ArithmeticFlags)
+{
+  byte code[1];
+  membank_read[0] = code;
+
+  for (byte opcode : { 0x80, 0x88, 0x90, 0x98, 0xb8, 0x3c, 0x3d }) {
+    code[0] = opcode;
+    for (unsigned a = 0; a < 256; a++) {
+      for (unsigned b = 0; b < 256; b++) {
+        for (unsigned carry = 0; carry < 2; carry++) {
+          _PC = 0;
+          _A = a;
+          _B = b;
+          _F = carry ? 0xff : 0xfe;
+          z80_execute_instruction();
+          ASSERT_EQ(ExpectedFlags(opcode, a, b, carry), _F) << std::hex << "opcode " << static_cast<int>(opcode)
+            << " a " << a << " b " << b << " carry " << carry;
+        }
+      }
+    }
+  }
+}
+
+TEST_F(Z80Test, DebugActiveFollowsDebuggerState)
+{
+  z80 = t_z80regs();
+  breakpoints.clear();
+  watchpoints.clear();
+  EXPECT_FALSE(z80_debug_active());
+
+  breakpoints.emplace_back(0x4000);
+  EXPECT_TRUE(z80_debug_active());
+  breakpoints.clear();
+
+  watchpoints.emplace_back(0x4000, READ);
+  EXPECT_TRUE(z80_debug_active());
+  watchpoints.clear();
+
+  z80.step_in = 1;
+  EXPECT_TRUE(z80_debug_active());
+  z80.step_in = 0;
+
+  z80.trace = 1;
+  EXPECT_TRUE(z80_debug_active());
+  z80.trace = 0;
+
+  EXPECT_FALSE(z80_debug_active());
+}
+
+TEST_F(Z80Test, WatchpointsAreIndexed)
+{
+  // 3A 00 40 = ld a, (0x4000)
+  // 32 01 40 = ld (0x4001), a
+  byte membank0[6] = { 0x3A, 0x00, 0x40, 0x32, 0x01, 0x40 };
+  byte membank1[2] = { 0x42, 0x00 };
+
+  z80 = t_z80regs();
+  membank_read[0] = membank0;
+  membank_read[1] = membank1;
+  membank_write[1] = membank1;
+  breakpoints.clear();
+  watchpoints.clear();
+  watchpoints.emplace_back(0x4001, WRITE);
+  z80_index_debug_points();
+
+  z80_execute_instruction();
+  EXPECT_EQ(0x42, _A);
+  EXPECT_EQ(0, z80.watchpoint_reached);
+  z80_execute_instruction();
+  EXPECT_EQ(1, z80.watchpoint_reached);
+  EXPECT_EQ(0x42, membank1[1]);
+
+  watchpoints.clear();
+  z80_index_debug_points();
+}
+
+TEST_F(Z80Test, ConditionalWatchpoint)
+{
+  // 3A 00 40 = ld a, (0x4000)
+  byte membank0[3] = { 0x3A, 0x00, 0x40 };
+  byte membank1[1] = { 0x42 };
+
+  membank_read[0] = membank0;
+  membank_read[1] = membank1;
+  breakpoints.clear();
+  watchpoints.clear();
+  // Only when bit 0 is set: doesn't match 0x42.
+  watchpoints.emplace_back(0x4000, READ, 0x01, 0x01);
+  z80_index_debug_points();
+
+  z80 = t_z80regs();
+  z80_execute_instruction();
+  EXPECT_EQ(0, z80.watchpoint_reached);
+
+  membank1[0] = 0x43;
+  z80 = t_z80regs();
+  z80_execute_instruction();
+  EXPECT_EQ(1, z80.watchpoint_reached);
+
+  watchpoints.clear();
+  z80_index_debug_points();
+}
+
+TEST_F(Z80Test, EventsScheduledOnEarliestDeadline)
+{
+  CPC.snd_enabled = 0;
+  FDC.phase = CMD_PHASE;
+  CPC.tape_motor = 0;
+  CPC.tape_play_button = 0;
+  CPC.cycle_count = INT_MAX;
+  z80_schedule_events();
+  EXPECT_EQ(INT_MAX, iEventDeadline);
+
+  // The end of the frame is one of the deadlines.
+  CPC.cycle_count = 1000;
+  z80_schedule_events();
+  EXPECT_EQ(1000, iEventDeadline);
+
+  CPC.tape_motor = 1;
+  CPC.tape_play_button = 1;
+  iTapeCycleCount = 100;
+  z80_schedule_events();
+  EXPECT_EQ(100, iEventDeadline);
+
+  // Elapsed cycles are only handed over to the tape when syncing.
+  iEventCycleCount = 40;
+  EXPECT_EQ(100, iTapeCycleCount);
+  z80_sync_events();
+  EXPECT_EQ(0, iEventCycleCount);
+  EXPECT_EQ(60, iTapeCycleCount);
+  EXPECT_EQ(960, CPC.cycle_count);
+  EXPECT_EQ(60, iEventDeadline);
+
+  CPC.tape_motor = 0;
+  CPC.tape_play_button = 0;
+  z80_schedule_events();
+}
+
+TEST_F(Z80Test, WritesMarkRamPagesDirty)
+{
+  std::vector<byte> ram(64*1024, 0);
+  byte *saved_pbRAM = pbRAM;
+  unsigned int saved_ram_size = CPC.ram_size;
+  pbRAM = ram.data();
+  CPC.ram_size = 64;
+  // Page 1 maps the third 16KB bank of RAM, page 3 is outside of it.
+  byte rom[0x4000];
+  membank_write[1] = pbRAM + 0x8000;
+  membank_write[3] = rom;
+  ram_update_write_pages();
+
+  dword checkpoint = ram_dirty_checkpoint();
+  z80_write_mem(0x5001, 1);
+  z80_write_mem(0xc000, 1);
+
+  for (unsigned int page = 0; page < 16; page++) {
+    // 0x5001 is in the second 4KB page of bank 1 so the 10th page of RAM
+    EXPECT_EQ(page == 9, ram_page_written_since(page, checkpoint)) << page;
+  }
+  EXPECT_EQ(1, ram[0x9001]);
+  EXPECT_FALSE(ram_page_written_since(9, ram_dirty_checkpoint()));
+
+  pbRAM = saved_pbRAM;
+  CPC.ram_size = saved_ram_size;
+  ram_update_write_pages();
+}
+
+TEST_F(Z80Test, Mf2RomWritesGoToRam)
+{
+  std::vector<byte> ram(64*1024, 0), mf2(16*1024, 0);
+  byte *saved_pbRAM = pbRAM, *saved_pbMF2ROM = pbMF2ROM;
+  unsigned int saved_ram_size = CPC.ram_size;
+  t_GateArray saved_GateArray = GateArray;
+  pbRAM = ram.data();
+  pbMF2ROM = mf2.data();
+  CPC.ram_size = 64;
+  GateArray.ROM_config = 0x08; // lower ROM enabled, upper ROM disabled
+  GateArray.lower_ROM_bank = 0;
+  GateArray.registerPageOn = false;
+  dwMF2Flags = MF2_ACTIVE;
+  ga_init_banking(membank_config, 0);
+  ga_memory_manager();
+
+  // ld a,0x55 ; ld (0x1000),a ; ld (0x2000),a, run from the MF2 ROM
+  byte code[] = { 0x3e, 0x55, 0x32, 0x00, 0x10, 0x32, 0x00, 0x20 };
+  std::copy(code, code + sizeof(code), mf2.begin());
+  z80 = t_z80regs();
+  for (int n = 0; n < 3; n++) {
+    z80_execute_instruction();
+  }
+
+  // The first 8KB are ROM, written through to the RAM below, the next 8KB are
+  // the RAM of the MF2.
+  EXPECT_EQ(0, mf2[0x1000]);
+  EXPECT_EQ(0x55, ram[0x1000]);
+  EXPECT_EQ(0x55, mf2[0x2000]);
+  EXPECT_EQ(0, ram[0x2000]);
+
+  dwMF2Flags = 0;
+  ga_memory_manager();
+  EXPECT_EQ(nullptr, membank_write_handler[0]);
+  pbRAM = saved_pbRAM;
+  pbMF2ROM = saved_pbMF2ROM;
+  CPC.ram_size = saved_ram_size;
+  GateArray = saved_GateArray;
+  ram_update_write_pages();
+}
+
+TEST_F(Z80Test, RamBanksOfA4MBExpansion)
+{
+  std::vector<byte> ram(RAM_MAX_SIZE*1024, 0);
+  byte *saved_pbRAM = pbRAM;
+  unsigned int saved_ram_size = CPC.ram_size, saved_mf2 = CPC.mf2;
+  t_GateArray saved_GateArray = GateArray;
+  pbRAM = ram.data();
+  CPC.ram_size = RAM_MAX_SIZE;
+  CPC.mf2 = 0;
+  GateArray = t_GateArray();
+  GateArray.ROM_config = 0x0c; // ROMs disabled
+  ga_init_banking_tables();
+
+  reg_pair port;
+  port.b.l = 0;
+  // Bank 4 of the first 512KB block (&7Fxx) at 0x4000: the 6th 64KB of RAM
+  port.b.h = 0x7f;
+  z80_OUT_handler(port, 0xc4 | (4 << 3));
+  EXPECT_EQ(pbRAM + 5*65536, membank_read[1]);
+  // Same from the last 512KB block (&78xx): the last 64KB of RAM
+  port.b.h = 0x78;
+  z80_OUT_handler(port, 0xc4 | (7 << 3));
+  EXPECT_EQ(pbRAM + 64*65536, membank_write[1]);
+  EXPECT_EQ(63, GateArray.RAM_bank);
+
+  // With 576KB, A10-A8 are not decoded.
+  CPC.ram_size = 576;
+  ga_init_banking_tables();
+  z80_OUT_handler(port, 0xc4 | (7 << 3));
+  EXPECT_EQ(pbRAM + 8*65536, membank_read[1]);
+
+  pbRAM = saved_pbRAM;
+  CPC.ram_size = saved_ram_size;
+  CPC.mf2 = saved_mf2;
+  GateArray = saved_GateArray;
+  ga_init_banking_tables();
+  ram_update_write_pages();
+}
+
 }
@@ -3,9 +3,9 @@
 #include "cap32.h"
 
 #include "z80_macros.h"
+#include "machinestate.h"
 
-extern byte *membank_read[4];
-extern t_CPC CPC;
+extern thread_local t_CPC CPC;
 
 namespace
 {